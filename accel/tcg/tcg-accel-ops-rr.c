@@ -102,14 +102,31 @@ static void rr_stop_kick_timer(void)
     }
 }
 
+/*
+ * The vCPUs share one thread, so each one's idle state is tracked on its
+ * own: a vCPU is idle while it is halted with nothing to wake it, however
+ * busy the others are.
+ */
+static void rr_update_idle(void)
+{
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        cpus_notify_idle(cpu, cpu->halted && !cpu_has_work(cpu));
+    }
+}
+
 static void rr_wait_io_event(void)
 {
     CPUState *cpu;
 
+    rr_update_idle();
     while (all_cpu_threads_idle()) {
         rr_stop_kick_timer();
         qemu_cond_wait_iothread(first_cpu->halt_cond);
     }
+    /* Woken vCPUs stay halted until they next enter cpu_exec() */
+    rr_update_idle();
 
     rr_start_kick_timer();
 
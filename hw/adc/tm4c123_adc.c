@@ -0,0 +1,908 @@
+/*
+ * TM4C123 ADC
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "hw/adc/tm4c123_adc.h"
+#include "hw/irq.h"
+#include "hw/qdev-properties.h"
+#include "hw/qdev-clock.h"
+#include "qemu/timer.h"
+#include "qemu/host-utils.h"
+#include "qemu/bswap.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "migration/vmstate.h"
+#include "trace.h"
+
+#define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
+#define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
+
+/* Steps, and FIFO entries, of each sample sequencer */
+static const uint32_t adc_ss_depth[ADC_SEQUENCERS] = {8, 4, 4, 1};
+
+/* Comparator bands and modes, DCCTLn CIC/CTC and CIM/CTM */
+enum {
+    ADC_DC_LOW,
+    ADC_DC_MID,
+    ADC_DC_HIGH,
+    ADC_DC_NONE = 0xFF,
+};
+
+enum {
+    ADC_DC_ALWAYS,
+    ADC_DC_ONCE,
+    ADC_DC_HYST_ALWAYS,
+    ADC_DC_HYST_ONCE,
+};
+
+static uint32_t adc_nibble(uint32_t reg, int i)
+{
+    return extract32(reg, i * 4, 4);
+}
+
+static uint32_t adc_emux(TM4C123ADCState *s, int n)
+{
+    return adc_nibble(s->adc_emux, n);
+}
+
+static bool adc_ss_enabled(TM4C123ADCState *s, int n)
+{
+    return s->adc_actss & BIT(n);
+}
+
+/* Time of one conversion at the PC sample rate, times the hardware averaging */
+static uint64_t adc_sample_time_ns(TM4C123ADCState *s)
+{
+    uint32_t rate;
+
+    switch (s->adc_pc & 0xF) {
+        case 0x1:
+            rate = 125000;
+            break;
+        case 0x3:
+            rate = 250000;
+            break;
+        case 0x5:
+            rate = 500000;
+            break;
+        default:
+            rate = 1000000;
+            break;
+    }
+    return (NANOSECONDS_PER_SECOND / rate) << extract32(s->adc_sac, 0, 3);
+}
+
+/* Steps up to and including the one flagged END */
+static uint32_t adc_ss_steps(TM4C123ADCState *s, int n)
+{
+    uint32_t k;
+
+    for (k = 0; k < adc_ss_depth[n]; k++) {
+        if (adc_nibble(s->ss[n].ctl, k) & ADC_SSCTL_END) {
+            return k + 1;
+        }
+    }
+    return adc_ss_depth[n];
+}
+
+/*
+ * Level of analog input @ch at virtual time @t. A mapped trace is
+ * indexed straight from the time, so nothing is read ahead or copied;
+ * past its end the last sample holds.
+ */
+static uint32_t adc_ain(TM4C123ADCState *s, uint32_t ch, int64_t t)
+{
+    uint64_t idx;
+
+    if (ch >= ADC_CHANNELS) {
+        return 0;
+    }
+    if (!s->ain_data[ch]) {
+        return s->ain_value[ch] & 0xFFF;
+    }
+    idx = muldiv64(MAX(t, 0), s->sample_rate, NANOSECONDS_PER_SECOND);
+    idx = MIN(idx, s->ain_samples[ch] - 1);
+    return lduw_le_p(s->ain_data[ch] + idx * 2) & 0xFFF;
+}
+
+/* TEMP = 147.5 - (75 * 3.3 V * code) / 4096, solved for the code */
+static uint32_t adc_temp_code(TM4C123ADCState *s)
+{
+    int64_t code = (1475 - 10 * (int64_t)s->temperature) * 4096 / 2475;
+
+    return MIN(MAX(code, 0), 0xFFF);
+}
+
+/* One step of sequencer @n, averaged over the samples taken from @t on */
+static uint32_t adc_convert(TM4C123ADCState *s, int n, int k, int64_t t)
+{
+    uint32_t ctl = adc_nibble(s->ss[n].ctl, k);
+    uint32_t mux = adc_nibble(s->ss[n].mux, k);
+    uint32_t avg = 1 << extract32(s->adc_sac, 0, 3);
+    uint64_t conv_ns = adc_sample_time_ns(s) / avg;
+    uint32_t sum = 0;
+    int32_t v;
+    uint32_t i;
+
+    if (ctl & ADC_SSCTL_TS) {
+        return adc_temp_code(s);
+    }
+    for (i = 0; i < avg; i++) {
+        if (ctl & ADC_SSCTL_D) {
+            /* Differential pairs: AIN(2m) against AIN(2m + 1), centred */
+            v = (int32_t)adc_ain(s, 2 * mux, t) - (int32_t)adc_ain(s, 2 * mux + 1, t);
+            sum += v / 2 + 0x800;
+        } else {
+            sum += adc_ain(s, mux, t);
+        }
+        t += conv_ns;
+    }
+    return sum / avg;
+}
+
+static uint8_t adc_dc_band(uint32_t cmp, uint32_t v)
+{
+    if (v < extract32(cmp, 0, 12)) {
+        return ADC_DC_LOW;
+    }
+    if (v < extract32(cmp, 16, 12)) {
+        return ADC_DC_MID;
+    }
+    return ADC_DC_HIGH;
+}
+
+/* Whether a comparator in @mode watching band @cond fires on a sample in @band */
+static bool adc_dc_eval(TM4C123ADCCompareState *st, uint32_t mode, uint32_t cond,
+                        uint8_t band)
+{
+    uint8_t prev = st->band;
+    bool hit;
+
+    st->band = band;
+    if ((mode == ADC_DC_HYST_ALWAYS || mode == ADC_DC_HYST_ONCE) && cond != ADC_DC_MID) {
+        /* Armed by the band, disarmed only by reaching the opposite one */
+        if (band == cond) {
+            st->armed = true;
+        } else if (band != ADC_DC_MID) {
+            st->armed = false;
+            st->fired = false;
+        }
+        if (mode == ADC_DC_HYST_ALWAYS) {
+            return st->armed;
+        }
+        hit = st->armed && !st->fired;
+        st->fired |= hit;
+        return hit;
+    }
+
+    if (mode == ADC_DC_ONCE || mode == ADC_DC_HYST_ONCE) {
+        return band == cond && prev != cond;
+    }
+    return band == cond;
+}
+
+static void adc_compare(TM4C123ADCState *s, int dc, uint32_t v)
+{
+    uint32_t ctl = s->adc_dcctl[dc];
+    uint8_t band = adc_dc_band(s->adc_dccmp[dc], v);
+
+    if (adc_dc_eval(&s->dc_int[dc], extract32(ctl, 0, 2), extract32(ctl, 2, 2), band) &&
+        (ctl & ADC_DCCTL_CIE)) {
+        s->adc_dcisc |= BIT(dc);
+    }
+    if (adc_dc_eval(&s->dc_trig[dc], extract32(ctl, 8, 2), extract32(ctl, 10, 2), band) &&
+        (ctl & ADC_DCCTL_CTE)) {
+        qemu_irq_pulse(s->dc_trigger[dc]);
+    }
+}
+
+static void adc_dc_reset(TM4C123ADCCompareState *st)
+{
+    st->band = ADC_DC_NONE;
+    st->fired = false;
+    st->armed = false;
+}
+
+static void adc_update(TM4C123ADCState *s)
+{
+    int n;
+    bool dc = s->adc_dcisc != 0;
+
+    s->adc_ris = deposit32(s->adc_ris, 16, 1, dc);
+    for (n = 0; n < ADC_SEQUENCERS; n++) {
+        qemu_set_irq(s->irq[n], (s->adc_ris & s->adc_im & BIT(n)) ||
+                                (dc && (s->adc_im & BIT(16 + n))));
+    }
+}
+
+static void adc_fifo_push(TM4C123ADCState *s, int n, uint16_t v)
+{
+    TM4C123ADCSequencer *ss = &s->ss[n];
+    uint32_t depth = adc_ss_depth[n];
+
+    if (ss->count == depth) {
+        s->adc_ostat |= BIT(n);
+        return;
+    }
+    ss->fifo[(ss->head + ss->count) % depth] = v;
+    ss->count++;
+}
+
+static uint16_t adc_fifo_pop(TM4C123ADCState *s, int n)
+{
+    TM4C123ADCSequencer *ss = &s->ss[n];
+    uint16_t v;
+
+    if (!ss->count) {
+        s->adc_ustat |= BIT(n);
+        return 0;
+    }
+    v = ss->fifo[ss->head];
+    ss->head = (ss->head + 1) % adc_ss_depth[n];
+    ss->count--;
+    return v;
+}
+
+static void adc_start_next(TM4C123ADCState *s);
+
+/* The running sequence is over: every step lands at once, sampled at its own time */
+static void adc_complete(TM4C123ADCState *s)
+{
+    int n = s->running;
+    uint64_t step_ns = adc_sample_time_ns(s);
+    uint32_t steps = adc_ss_steps(s, n);
+    bool irq = false;
+    uint32_t v;
+    uint32_t k;
+
+    for (k = 0; k < steps; k++) {
+        v = adc_convert(s, n, k, s->start_ns + k * step_ns);
+        if (adc_nibble(s->ss[n].op, k) & 1) {
+            adc_compare(s, adc_nibble(s->ss[n].dc, k) & 7, v);
+        } else {
+            adc_fifo_push(s, n, v);
+        }
+        irq |= adc_nibble(s->ss[n].ctl, k) & ADC_SSCTL_IE;
+    }
+    trace_tm4c123_adc_done(n, steps);
+
+    if (irq) {
+        s->adc_ris |= BIT(n);
+        if (s->adc_actss & BIT(8 + n)) {
+            qemu_irq_pulse(s->dma_req[n]);
+        }
+    }
+    s->running = -1;
+    s->adc_actss &= ~ADC_ACTSS_BUSY;
+
+    /* The always trigger starts the sequence over as soon as it ends */
+    if (adc_ss_enabled(s, n) && adc_emux(s, n) == ADC_EMUX_ALWAYS) {
+        s->pending |= BIT(n);
+    }
+    adc_update(s);
+    adc_start_next(s);
+}
+
+/* Run the pending sequencer with the highest SSPRI priority */
+static void adc_start_next(TM4C123ADCState *s)
+{
+    uint32_t best = UINT32_MAX;
+    uint32_t steps;
+    int next = -1;
+    int n;
+
+    if (s->running >= 0) {
+        return;
+    }
+    for (n = 0; n < ADC_SEQUENCERS; n++) {
+        if ((s->pending & BIT(n)) && adc_ss_enabled(s, n) &&
+            adc_nibble(s->adc_sspri, n) < best) {
+            best = adc_nibble(s->adc_sspri, n);
+            next = n;
+        }
+    }
+    if (next < 0) {
+        return;
+    }
+
+    s->pending &= ~BIT(next);
+    s->running = next;
+    s->adc_actss |= ADC_ACTSS_BUSY;
+    s->start_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    steps = adc_ss_steps(s, next);
+    /*
+     * "fast" converts a triggered sequence at once. The always trigger
+     * keeps the conversion time, or it would never let the guest run.
+     */
+    if (s->fast_timing && adc_emux(s, next) != ADC_EMUX_ALWAYS) {
+        s->done_ns = s->start_ns;
+        adc_complete(s);
+        return;
+    }
+    s->done_ns = s->start_ns + steps * adc_sample_time_ns(s);
+    timer_mod(s->timer, s->done_ns);
+}
+
+/* Catch up with a sequence whose conversion time is already over */
+static void adc_sync(TM4C123ADCState *s)
+{
+    if (s->running >= 0 && qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) >= s->done_ns) {
+        timer_del(s->timer);
+        adc_complete(s);
+    }
+}
+
+static void adc_tick(void *opaque)
+{
+    adc_sync(opaque);
+}
+
+static void adc_trigger_source(TM4C123ADCState *s, uint32_t source)
+{
+    int n;
+
+    for (n = 0; n < ADC_SEQUENCERS; n++) {
+        if (adc_ss_enabled(s, n) && adc_emux(s, n) == source) {
+            s->pending |= BIT(n);
+        }
+    }
+    adc_sync(s);
+    adc_start_next(s);
+}
+
+static void adc_trigger(void *opaque, int line, int level)
+{
+    TM4C123ADCState *s = opaque;
+    bool was = s->trigger_level & BIT(line);
+
+    s->trigger_level = deposit32(s->trigger_level, line, 1, level != 0);
+    if (level && !was) {
+        adc_trigger_source(s, line);
+    }
+}
+
+/* PWM module m generator g reaches the PWMg encoding when TSSEL.PSg selects m */
+static void adc_pwm_trigger(void *opaque, int line, int level)
+{
+    TM4C123ADCState *s = opaque;
+    int module = line / 4;
+    int gen = line % 4;
+
+    if (extract32(s->adc_tssel, 4 + gen * 8, 2) == module) {
+        adc_trigger(s, ADC_EMUX_PWM0 + gen, level);
+    }
+}
+
+/* Sequencers on the always trigger start as soon as they are enabled */
+static void adc_rearm(TM4C123ADCState *s)
+{
+    int n;
+
+    for (n = 0; n < ADC_SEQUENCERS; n++) {
+        if (adc_ss_enabled(s, n) && adc_emux(s, n) == ADC_EMUX_ALWAYS &&
+            s->running != n) {
+            s->pending |= BIT(n);
+        }
+    }
+    adc_start_next(s);
+}
+
+static void tm4c123_adc_reset(DeviceState *dev)
+{
+    TM4C123ADCState *s = TM4C123_ADC(dev);
+    int i;
+
+    s->adc_actss = 0x00000000;
+    s->adc_ris = 0x00000000;
+    s->adc_im = 0x00000000;
+    s->adc_ostat = 0x00000000;
+    s->adc_emux = 0x00000000;
+    s->adc_ustat = 0x00000000;
+    s->adc_tssel = 0x00000000;
+    s->adc_sspri = 0x00003210;
+    s->adc_spc = 0x00000000;
+    s->adc_sac = 0x00000000;
+    s->adc_dcisc = 0x00000000;
+    s->adc_ctl = 0x00000000;
+    s->adc_pc = 0x00000007;
+    s->adc_cc = 0x00000000;
+    for (i = 0; i < ADC_COMPARATORS; i++) {
+        s->adc_dcctl[i] = 0;
+        s->adc_dccmp[i] = 0;
+        adc_dc_reset(&s->dc_int[i]);
+        adc_dc_reset(&s->dc_trig[i]);
+    }
+    memset(s->ss, 0, sizeof(s->ss));
+
+    s->pending = 0;
+    s->running = -1;
+    timer_del(s->timer);
+    adc_update(s);
+}
+
+static uint32_t adc_ss_read(TM4C123ADCState *s, int n, hwaddr reg)
+{
+    TM4C123ADCSequencer *ss = &s->ss[n];
+    uint32_t depth = adc_ss_depth[n];
+
+    switch (reg) {
+        case ADC_SSMUX:
+            return ss->mux;
+        case ADC_SSCTL:
+            return ss->ctl;
+        case ADC_SSFIFO:
+            return adc_fifo_pop(s, n);
+        case ADC_SSFSTAT:
+            return ((ss->head + ss->count) % depth) | (ss->head << 4) |
+                   (ss->count ? 0 : ADC_SSFSTAT_EMPTY) |
+                   (ss->count == depth ? ADC_SSFSTAT_FULL : 0);
+        case ADC_SSOP:
+            return ss->op;
+        case ADC_SSDC:
+            return ss->dc;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad sequencer %d register 0x%"HWADDR_PRIx"\n", n, reg);
+            return 0;
+    }
+}
+
+static void adc_ss_write(TM4C123ADCState *s, int n, hwaddr reg, uint32_t val32)
+{
+    TM4C123ADCSequencer *ss = &s->ss[n];
+    uint32_t mask = MAKE_64BIT_MASK(0, adc_ss_depth[n] * 4);
+
+    switch (reg) {
+        case ADC_SSMUX:
+            ss->mux = val32 & mask;
+            break;
+        case ADC_SSCTL:
+            ss->ctl = val32 & mask;
+            break;
+        case ADC_SSOP:
+            ss->op = val32 & mask & 0x11111111;
+            break;
+        case ADC_SSDC:
+            ss->dc = val32 & mask;
+            break;
+        case ADC_SSFIFO:
+        case ADC_SSFSTAT:
+            LOG(LOG_GUEST_ERROR, "sequencer %d register 0x%"HWADDR_PRIx" is readonly\n",
+                n, reg);
+            break;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad sequencer %d register 0x%"HWADDR_PRIx"\n", n, reg);
+            break;
+    }
+}
+
+static uint64_t tm4c123_adc_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    TM4C123ADCState *s = opaque;
+    uint32_t isc;
+    int n;
+
+    trace_tm4c123_adc_read(addr);
+    adc_sync(s);
+
+    if (addr >= ADC_SS_BASE && addr < ADC_SS_BASE + ADC_SEQUENCERS * ADC_SS_STRIDE) {
+        n = (addr - ADC_SS_BASE) / ADC_SS_STRIDE;
+        return adc_ss_read(s, n, (addr - ADC_SS_BASE) % ADC_SS_STRIDE);
+    }
+    if (addr >= ADC_DCCTL0 && addr < ADC_DCCTL0 + ADC_COMPARATORS * 4) {
+        return s->adc_dcctl[(addr - ADC_DCCTL0) / 4];
+    }
+    if (addr >= ADC_DCCMP0 && addr < ADC_DCCMP0 + ADC_COMPARATORS * 4) {
+        return s->adc_dccmp[(addr - ADC_DCCMP0) / 4];
+    }
+
+    switch (addr) {
+        case ADC_ACTSS:
+            return s->adc_actss;
+        case ADC_RIS:
+            return s->adc_ris;
+        case ADC_IM:
+            return s->adc_im;
+        case ADC_ISC:
+            isc = s->adc_ris & s->adc_im & 0xF;
+            if (s->adc_ris & ADC_RIS_INRDC) {
+                isc |= s->adc_im & 0xF0000;
+            }
+            return isc;
+        case ADC_OSTAT:
+            return s->adc_ostat;
+        case ADC_EMUX:
+            return s->adc_emux;
+        case ADC_USTAT:
+            return s->adc_ustat;
+        case ADC_TSSEL:
+            return s->adc_tssel;
+        case ADC_SSPRI:
+            return s->adc_sspri;
+        case ADC_SPC:
+            return s->adc_spc;
+        case ADC_SAC:
+            return s->adc_sac;
+        case ADC_DCISC:
+            return s->adc_dcisc;
+        case ADC_CTL:
+            return s->adc_ctl;
+        case ADC_PP:
+            /* 12 channels, 8 comparators, temperature sensor, 1 Msps */
+            return 0x00B020C7;
+        case ADC_PC:
+            return s->adc_pc;
+        case ADC_CC:
+            return s->adc_cc;
+        case ADC_PSSI:
+        case ADC_DCRIC:
+            return 0;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return 0;
+    }
+
+    return 0;
+}
+
+static void tm4c123_adc_write(void *opaque, hwaddr addr, uint64_t val64, unsigned int size)
+{
+    TM4C123ADCState *s = opaque;
+    uint32_t val32 = val64;
+    int n;
+
+    trace_tm4c123_adc_write(addr, val32);
+    adc_sync(s);
+
+    if (addr >= ADC_SS_BASE && addr < ADC_SS_BASE + ADC_SEQUENCERS * ADC_SS_STRIDE) {
+        n = (addr - ADC_SS_BASE) / ADC_SS_STRIDE;
+        adc_ss_write(s, n, (addr - ADC_SS_BASE) % ADC_SS_STRIDE, val32);
+        return;
+    }
+    if (addr >= ADC_DCCTL0 && addr < ADC_DCCTL0 + ADC_COMPARATORS * 4) {
+        s->adc_dcctl[(addr - ADC_DCCTL0) / 4] = val32 & 0x1F1F;
+        return;
+    }
+    if (addr >= ADC_DCCMP0 && addr < ADC_DCCMP0 + ADC_COMPARATORS * 4) {
+        s->adc_dccmp[(addr - ADC_DCCMP0) / 4] = val32 & 0x0FFF0FFF;
+        return;
+    }
+
+    switch (addr) {
+        case ADC_ACTSS:
+            s->adc_actss = (s->adc_actss & ADC_ACTSS_BUSY) | (val32 & 0xF0F);
+            s->pending &= s->adc_actss;
+            adc_rearm(s);
+            break;
+        case ADC_IM:
+            s->adc_im = val32 & 0xF000F;
+            break;
+        case ADC_ISC:
+            /* The comparator part clears through DCISC */
+            s->adc_ris &= ~(val32 & 0xF);
+            break;
+        case ADC_OSTAT:
+            s->adc_ostat &= ~val32;
+            break;
+        case ADC_EMUX:
+            s->adc_emux = val32 & 0xFFFF;
+            adc_rearm(s);
+            break;
+        case ADC_USTAT:
+            s->adc_ustat &= ~val32;
+            break;
+        case ADC_TSSEL:
+            s->adc_tssel = val32 & 0x30303030;
+            break;
+        case ADC_SSPRI:
+            s->adc_sspri = val32 & 0x3333;
+            break;
+        case ADC_SPC:
+            /* Phase delays are below what the sample timeline resolves */
+            s->adc_spc = val32 & 0xF;
+            break;
+        case ADC_PSSI:
+            if (val32 & (ADC_PSSI_GSYNC | ADC_PSSI_SYNCWAIT)) {
+                LOG(LOG_UNIMP, "synchronised sampling across ADCs is not implemented\n");
+            }
+            for (n = 0; n < ADC_SEQUENCERS; n++) {
+                if ((val32 & BIT(n)) && adc_ss_enabled(s, n) &&
+                    adc_emux(s, n) == ADC_EMUX_PROCESSOR) {
+                    s->pending |= BIT(n);
+                }
+            }
+            adc_start_next(s);
+            break;
+        case ADC_SAC:
+            s->adc_sac = val32 & 0x7;
+            break;
+        case ADC_DCISC:
+            s->adc_dcisc &= ~val32;
+            break;
+        case ADC_CTL:
+            s->adc_ctl = val32 & 0x41;
+            break;
+        case ADC_DCRIC:
+            for (n = 0; n < ADC_COMPARATORS; n++) {
+                if (val32 & BIT(n)) {
+                    adc_dc_reset(&s->dc_int[n]);
+                }
+                if (val32 & BIT(16 + n)) {
+                    adc_dc_reset(&s->dc_trig[n]);
+                }
+            }
+            break;
+        case ADC_PC:
+            s->adc_pc = val32 & 0xF;
+            break;
+        case ADC_CC:
+            s->adc_cc = val32 & 0xF;
+            break;
+        case ADC_RIS:
+        case ADC_PP:
+            READONLY;
+            break;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return;
+    }
+    adc_update(s);
+}
+
+/* Accesses with the module clock gated off answer with a bus fault */
+static MemTxResult tm4c123_adc_read_with_attrs(void *opaque, hwaddr addr, uint64_t *data,
+                                               unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123ADCState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "ADC module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_adc_read(opaque, addr, size);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_adc_write_with_attrs(void *opaque, hwaddr addr, uint64_t val64,
+                                                unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123ADCState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "ADC module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    tm4c123_adc_write(opaque, addr, val64, size);
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps tm4c123_adc_ops = {
+    .read_with_attrs = tm4c123_adc_read_with_attrs,
+    .write_with_attrs = tm4c123_adc_write_with_attrs,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+#define DEFINE_PROP_AIN(n) \
+    DEFINE_PROP_STRING("ain" #n "-file", TM4C123ADCState, ain_file[n]), \
+    DEFINE_PROP_UINT16("ain" #n, TM4C123ADCState, ain_value[n], 0)
+
+static Property tm4c123_adc_properties[] = {
+    DEFINE_PROP_AIN(0),
+    DEFINE_PROP_AIN(1),
+    DEFINE_PROP_AIN(2),
+    DEFINE_PROP_AIN(3),
+    DEFINE_PROP_AIN(4),
+    DEFINE_PROP_AIN(5),
+    DEFINE_PROP_AIN(6),
+    DEFINE_PROP_AIN(7),
+    DEFINE_PROP_AIN(8),
+    DEFINE_PROP_AIN(9),
+    DEFINE_PROP_AIN(10),
+    DEFINE_PROP_AIN(11),
+    DEFINE_PROP_UINT32("sample-rate", TM4C123ADCState, sample_rate, 1000000),
+    DEFINE_PROP_INT32("temperature", TM4C123ADCState, temperature, 25),
+    DEFINE_PROP_BOOL("fast-timing", TM4C123ADCState, fast_timing, false),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void tm4c123_adc_init(Object *obj)
+{
+    TM4C123ADCState *s = TM4C123_ADC(obj);
+    int n;
+
+    s->clk = qdev_init_clock_in(DEVICE(s), "adc_clock", NULL, NULL, 0);
+    s->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, adc_tick, s);
+
+    for (n = 0; n < ADC_SEQUENCERS; n++) {
+        sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq[n]);
+    }
+    qdev_init_gpio_in_named(DEVICE(obj), adc_trigger, "trigger", ADC_TRIGGERS);
+    qdev_init_gpio_in_named(DEVICE(obj), adc_pwm_trigger, "pwm-trigger", ADC_PWM_TRIGGERS);
+    qdev_init_gpio_out_named(DEVICE(obj), s->dma_req, "dma-req", ADC_SEQUENCERS);
+    qdev_init_gpio_out_named(DEVICE(obj), s->dc_trigger, "dc-trigger", ADC_COMPARATORS);
+
+    memory_region_init_io(&s->mmio, obj, &tm4c123_adc_ops, s,
+            TYPE_TM4C123_ADC, 0xFFF);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
+}
+
+/* Drop the sample files mapped so far */
+static void tm4c123_adc_unmap(TM4C123ADCState *s)
+{
+    int i;
+
+    for (i = 0; i < ADC_CHANNELS; i++) {
+        g_clear_pointer(&s->ain_map[i], g_mapped_file_unref);
+        s->ain_data[i] = NULL;
+        s->ain_samples[i] = 0;
+    }
+}
+
+static void tm4c123_adc_realize(DeviceState *dev, Error **errp)
+{
+    TM4C123ADCState *s = TM4C123_ADC(dev);
+    GError *gerr = NULL;
+    size_t len;
+    int i;
+
+    if (!s->sample_rate) {
+        error_setg(errp, "sample-rate must not be 0");
+        return;
+    }
+
+    for (i = 0; i < ADC_CHANNELS; i++) {
+        if (!s->ain_file[i]) {
+            continue;
+        }
+        s->ain_map[i] = g_mapped_file_new(s->ain_file[i], FALSE, &gerr);
+        if (!s->ain_map[i]) {
+            error_setg(errp, "ain%d-file: %s", i, gerr->message);
+            g_error_free(gerr);
+            tm4c123_adc_unmap(s);
+            return;
+        }
+        len = g_mapped_file_get_length(s->ain_map[i]);
+        if (len < 2) {
+            error_setg(errp, "ain%d-file: %s holds no samples", i, s->ain_file[i]);
+            tm4c123_adc_unmap(s);
+            return;
+        }
+        s->ain_data[i] = (const uint8_t *)g_mapped_file_get_contents(s->ain_map[i]);
+        s->ain_samples[i] = len / 2;
+    }
+}
+
+static void tm4c123_adc_unrealize(DeviceState *dev)
+{
+    tm4c123_adc_unmap(TM4C123_ADC(dev));
+}
+
+static const VMStateDescription vmstate_tm4c123_adc_ss = {
+    .name = "tm4c123-adc-ss",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(mux, TM4C123ADCSequencer),
+        VMSTATE_UINT32(ctl, TM4C123ADCSequencer),
+        VMSTATE_UINT32(op, TM4C123ADCSequencer),
+        VMSTATE_UINT32(dc, TM4C123ADCSequencer),
+        VMSTATE_UINT16_ARRAY(fifo, TM4C123ADCSequencer, ADC_MAX_STEPS),
+        VMSTATE_UINT32(head, TM4C123ADCSequencer),
+        VMSTATE_UINT32(count, TM4C123ADCSequencer),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const VMStateDescription vmstate_tm4c123_adc_dc = {
+    .name = "tm4c123-adc-dc",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT8(band, TM4C123ADCCompareState),
+        VMSTATE_BOOL(fired, TM4C123ADCCompareState),
+        VMSTATE_BOOL(armed, TM4C123ADCCompareState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static int tm4c123_adc_post_load(void *opaque, int version_id)
+{
+    TM4C123ADCState *s = opaque;
+    int n;
+
+    if (s->running >= ADC_SEQUENCERS) {
+        return -1;
+    }
+    for (n = 0; n < ADC_SEQUENCERS; n++) {
+        if (s->ss[n].head >= adc_ss_depth[n] || s->ss[n].count > adc_ss_depth[n]) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static const VMStateDescription vmstate_tm4c123_adc = {
+    .name = TYPE_TM4C123_ADC,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = tm4c123_adc_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(adc_actss, TM4C123ADCState),
+        VMSTATE_UINT32(adc_ris, TM4C123ADCState),
+        VMSTATE_UINT32(adc_im, TM4C123ADCState),
+        VMSTATE_UINT32(adc_ostat, TM4C123ADCState),
+        VMSTATE_UINT32(adc_emux, TM4C123ADCState),
+        VMSTATE_UINT32(adc_ustat, TM4C123ADCState),
+        VMSTATE_UINT32(adc_tssel, TM4C123ADCState),
+        VMSTATE_UINT32(adc_sspri, TM4C123ADCState),
+        VMSTATE_UINT32(adc_spc, TM4C123ADCState),
+        VMSTATE_UINT32(adc_sac, TM4C123ADCState),
+        VMSTATE_UINT32(adc_dcisc, TM4C123ADCState),
+        VMSTATE_UINT32(adc_ctl, TM4C123ADCState),
+        VMSTATE_UINT32_ARRAY(adc_dcctl, TM4C123ADCState, ADC_COMPARATORS),
+        VMSTATE_UINT32_ARRAY(adc_dccmp, TM4C123ADCState, ADC_COMPARATORS),
+        VMSTATE_UINT32(adc_pc, TM4C123ADCState),
+        VMSTATE_UINT32(adc_cc, TM4C123ADCState),
+        VMSTATE_STRUCT_ARRAY(ss, TM4C123ADCState, ADC_SEQUENCERS, 1,
+                             vmstate_tm4c123_adc_ss, TM4C123ADCSequencer),
+        VMSTATE_STRUCT_ARRAY(dc_int, TM4C123ADCState, ADC_COMPARATORS, 1,
+                             vmstate_tm4c123_adc_dc, TM4C123ADCCompareState),
+        VMSTATE_STRUCT_ARRAY(dc_trig, TM4C123ADCState, ADC_COMPARATORS, 1,
+                             vmstate_tm4c123_adc_dc, TM4C123ADCCompareState),
+        VMSTATE_UINT32(pending, TM4C123ADCState),
+        VMSTATE_INT32(running, TM4C123ADCState),
+        VMSTATE_INT64(start_ns, TM4C123ADCState),
+        VMSTATE_INT64(done_ns, TM4C123ADCState),
+        VMSTATE_UINT32(trigger_level, TM4C123ADCState),
+        VMSTATE_TIMER_PTR(timer, TM4C123ADCState),
+        VMSTATE_CLOCK(clk, TM4C123ADCState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void tm4c123_adc_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = tm4c123_adc_reset;
+    dc->vmsd = &vmstate_tm4c123_adc;
+    device_class_set_props(dc, tm4c123_adc_properties);
+    dc->realize = tm4c123_adc_realize;
+    dc->unrealize = tm4c123_adc_unrealize;
+}
+
+static const TypeInfo tm4c123_adc_info = {
+    .name          = TYPE_TM4C123_ADC,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(TM4C123ADCState),
+    .instance_init = tm4c123_adc_init,
+    .class_init    = tm4c123_adc_class_init,
+};
+
+static void tm4c123_adc_register_types(void)
+{
+    type_register_static(&tm4c123_adc_info);
+}
+
+type_init(tm4c123_adc_register_types)
@@ -31,6 +31,46 @@ static inline hwaddr bitband_addr(BitBandState *s, hwaddr offset)
     return s->base | (offset & 0x1ffffff) >> 5;
 }
 
+/*
+ * Bit-band aliases of RAM (in practice the SRAM window) are served straight
+ * from host memory through a cached mapping, rather than with a second
+ * dispatch through the source address space for every access.  Returns a
+ * pointer to the byte holding the bit, or NULL to take the slow path.
+ */
+static uint8_t *bitband_ram_byte(BitBandState *s, hwaddr offset,
+                                 unsigned size, hwaddr *cache_offset)
+{
+    hwaddr addr;
+    int bitpos;
+
+    if (!s->ram_cache_valid) {
+        address_space_cache_init(&s->ram_cache, &s->source_as, s->base,
+                                 0x100000, true);
+        s->ram_cache_valid = true;
+    }
+    if (!s->ram_cache.ptr) {
+        return NULL;
+    }
+    addr = (bitband_addr(s, offset) & (-size)) - s->base;
+    bitpos = (offset >> 2) & ((size * 8) - 1);
+    addr += bitpos >> 3;
+    if (addr >= s->ram_cache.len) {
+        return NULL;
+    }
+    *cache_offset = addr;
+    return (uint8_t *)s->ram_cache.ptr + addr;
+}
+
+static void bitband_listener_commit(MemoryListener *listener)
+{
+    BitBandState *s = container_of(listener, BitBandState, listener);
+
+    if (s->ram_cache_valid) {
+        address_space_cache_destroy(&s->ram_cache);
+        s->ram_cache_valid = false;
+    }
+}
+
 static MemTxResult bitband_read(void *opaque, hwaddr offset,
                                 uint64_t *data, unsigned size, MemTxAttrs attrs)
 {
@@ -39,9 +79,16 @@ static MemTxResult bitband_read(void *opaque, hwaddr offset,
     MemTxResult res;
     int bitpos, bit;
     hwaddr addr;
+    uint8_t *ram;
 
     assert(size <= 4);
 
+    ram = bitband_ram_byte(s, offset, size, &addr);
+    if (ram) {
+        *data = (*ram >> ((offset >> 2) & 7)) & 1;
+        return MEMTX_OK;
+    }
+
     /* Find address in underlying memory and round down to multiple of size */
     addr = bitband_addr(s, offset) & (-size);
     res = address_space_read(&s->source_as, addr, attrs, buf, size);
@@ -64,9 +111,23 @@ static MemTxResult bitband_write(void *opaque, hwaddr offset, uint64_t value,
     MemTxResult res;
     int bitpos, bit;
     hwaddr addr;
+    uint8_t *ram;
 
     assert(size <= 4);
 
+    ram = bitband_ram_byte(s, offset, size, &addr);
+    if (ram) {
+        bit = 1 << ((offset >> 2) & 7);
+        if (value & 1) {
+            *ram |= bit;
+        } else {
+            *ram &= ~bit;
+        }
+        /* Keep dirty tracking and translated code in SRAM up to date */
+        address_space_cache_invalidate(&s->ram_cache, addr, 1);
+        return MEMTX_OK;
+    }
+
     /* Find address in underlying memory and round down to multiple of size */
     addr = bitband_addr(s, offset) & (-size);
     res = address_space_read(&s->source_as, addr, attrs, buf, size);
@@ -115,6 +176,12 @@ static void bitband_realize(DeviceState *dev, Error **errp)
     }
 
     address_space_init(&s->source_as, s->source_memory, "bitband-source");
+
+    s->listener = (MemoryListener) {
+        .name = "bitband",
+        .commit = bitband_listener_commit,
+    };
+    memory_listener_register(&s->listener, &s->source_as);
 }
 
 /* Board init.  */
@@ -26,31 +26,390 @@
 #include "qapi/error.h"
 #include "hw/boards.h"
 #include "hw/qdev-properties.h"
+#include "hw/qdev-properties-system.h"
 #include "hw/qdev-clock.h"
 #include "qemu/error-report.h"
+#include "qemu/cutils.h"
 #include "hw/arm/tm4c123gh6pm_soc.h"
 #include "hw/arm/boot.h"
+#include "qemu/module.h"
+#include "sysemu/blockdev.h"
+#include "sysemu/cpus.h"
 
 
-/* Main SYSCLK frequency in Hz (24MHz) */
-#define SYSCLK_FRQ 24000000ULL
+#define TYPE_TM4C123_MACHINE MACHINE_TYPE_NAME("tm4c123-common")
 
-static void tivac_init(MachineState *machine)
+/* -smp N runs N boards, each one SoC with its own core and bus */
+#define TM4C123_MAX_BOARDS 16
+OBJECT_DECLARE_TYPE(TM4C123MachineState, TM4C123MachineClass, TM4C123_MACHINE)
+
+struct TM4C123MachineState {
+    MachineState parent_obj;
+
+    /* Buses for CAN0 and CAN1, e.g. -object can-bus,id=bus -M canbus0=bus */
+    CanBusState *canbus[CAN_COUNT];
+    /* -M idle=skip: jump to the next timer while the core sleeps in WFI */
+    bool idle_skip;
+    /* -M flash-image=fw.elf: map a pre-linked image into the flash */
+    char *flash_image;
+    /* -M uart-links=0.1-1.1: UARTs wired to a UART on another board */
+    char *uart_links;
+    /* -M gpio-links=0.A3-1.B4: pins driving a pin on another board */
+    char *gpio_links;
+};
+
+/* Each machine is a board or bare part built around one SoC type */
+struct TM4C123MachineClass {
+    MachineClass parent_class;
+
+    const char *soc_type;
+};
+
+/* Parse "<board>.<uart>", e.g. "1.3" */
+static TM4C123USARTState *tivac_parse_uart(TM4C123SoCState **soc, int boards,
+                                           const char *str, Error **errp)
+{
+    const char *end;
+    unsigned int b, n;
+
+    if (qemu_strtoui(str, &end, 10, &b) || *end != '.' ||
+        qemu_strtoui(end + 1, &end, 10, &n) || *end) {
+        error_setg(errp, "Invalid UART '%s'", str);
+        error_append_hint(errp, "Expected <board>.<uart>, e.g. 1.3\n");
+        return NULL;
+    }
+    if (b >= boards || n >= USART_COUNT ||
+        !extract32(TM4C123_SOC_GET_CLASS(soc[b])->part->ppuart, n, 1)) {
+        error_setg(errp, "No UART%u on board %u", n, b);
+        return NULL;
+    }
+    return &soc[b]->usart[n];
+}
+
+/* Parse "<board>.<port><pin>", e.g. "1.B4" */
+static TM4C123GPIOState *tivac_parse_gpio(TM4C123SoCState **soc, int boards,
+                                          const char *str, int *pin, Error **errp)
+{
+    const char *end;
+    unsigned int b, port, n;
+
+    if (qemu_strtoui(str, &end, 10, &b) || *end != '.' || !end[1]) {
+        goto invalid;
+    }
+    port = g_ascii_toupper(end[1]) - 'A';
+    if (qemu_strtoui(end + 2, &end, 10, &n) || *end) {
+        goto invalid;
+    }
+    if (b >= boards || port >= GPIO_COUNT || n >= GPIO_PINS ||
+        !extract32(TM4C123_SOC_GET_CLASS(soc[b])->part->ppgpio, port, 1)) {
+        error_setg(errp, "No GPIO pin '%s'", str);
+        return NULL;
+    }
+    *pin = n;
+    return &soc[b]->gpio[port];
+
+invalid:
+    error_setg(errp, "Invalid GPIO pin '%s'", str);
+    error_append_hint(errp, "Expected <board>.<port><pin>, e.g. 1.B4\n");
+    return NULL;
+}
+
+/* UART links run both ways: each side's TX feeds the other side's RX */
+static void tivac_link_uarts(TM4C123MachineState *tms, TM4C123SoCState **soc,
+                             int boards, Error **errp)
 {
+    g_auto(GStrv) links = g_strsplit(tms->uart_links, ":", -1);
+    TM4C123USARTState *a, *b;
+    int i;
+
+    for (i = 0; links[i]; i++) {
+        g_auto(GStrv) ends = g_strsplit(links[i], "-", 2);
+
+        if (g_strv_length(ends) != 2) {
+            error_setg(errp, "Invalid UART link '%s'", links[i]);
+            return;
+        }
+        a = tivac_parse_uart(soc, boards, ends[0], errp);
+        if (!a) {
+            return;
+        }
+        b = tivac_parse_uart(soc, boards, ends[1], errp);
+        if (!b) {
+            return;
+        }
+        if (a == b || a->peer || b->peer) {
+            error_setg(errp, "UART link '%s' reuses a UART", links[i]);
+            return;
+        }
+        a->peer = b;
+        b->peer = a;
+    }
+}
+
+/* GPIO links run one way: the first pin's level drives the second pin */
+static void tivac_link_gpios(TM4C123MachineState *tms, TM4C123SoCState **soc,
+                             int boards, Error **errp)
+{
+    g_auto(GStrv) links = g_strsplit(tms->gpio_links, ":", -1);
+    TM4C123GPIOState *out, *in;
+    int i, out_pin, in_pin;
+
+    for (i = 0; links[i]; i++) {
+        g_auto(GStrv) ends = g_strsplit(links[i], "-", 2);
+
+        if (g_strv_length(ends) != 2) {
+            error_setg(errp, "Invalid GPIO link '%s'", links[i]);
+            return;
+        }
+        out = tivac_parse_gpio(soc, boards, ends[0], &out_pin, errp);
+        if (!out) {
+            return;
+        }
+        in = tivac_parse_gpio(soc, boards, ends[1], &in_pin, errp);
+        if (!in) {
+            return;
+        }
+        if (qdev_get_gpio_out_connector(DEVICE(out), NULL, out_pin)) {
+            error_setg(errp, "GPIO pin '%s' already drives another pin", ends[0]);
+            return;
+        }
+        qdev_connect_gpio_out(DEVICE(out), out_pin,
+                              qdev_get_gpio_in(DEVICE(in), in_pin));
+    }
+}
+
+static TM4C123SoCState *tivac_soc_new(MachineState *machine, int board,
+                                      const char *image)
+{
+    TM4C123MachineState *tms = TM4C123_MACHINE(machine);
+    TM4C123MachineClass *tmc = TM4C123_MACHINE_GET_CLASS(machine);
+    TM4C123SoCState *soc;
+    DriveInfo *dinfo;
     DeviceState *dev;
-    dev = qdev_new(TYPE_TM4C123GH6PM_SOC);
+    int i;
+
+    dev = qdev_new(tmc->soc_type);
+    if (board) {
+        g_autofree char *name = g_strdup_printf("soc[%d]", board);
+
+        object_property_add_child(OBJECT(machine), name, OBJECT(dev));
+    } else {
+        object_property_add_child(OBJECT(machine), "soc", OBJECT(dev));
+    }
 
     qdev_prop_set_string(dev, "cpu-type", ARM_CPU_TYPE_NAME("cortex-m4"));
-    sysbus_realize_and_unref(SYS_BUS_DEVICE(dev), &error_fatal);
+    qdev_prop_set_uint32(dev, "board", board);
+    /* Every board sits on the same CAN buses */
+    for (i = 0; i < CAN_COUNT; i++) {
+        g_autofree char *name = g_strdup_printf("canbus%d", i);
+
+        object_property_set_link(OBJECT(dev), name, OBJECT(tms->canbus[i]),
+                                 &error_fatal);
+    }
 
-    armv7m_load_kernel(ARM_CPU(first_cpu),
-            machine->kernel_filename,
-            0, FLASH_SIZE);
+    /* -drive if=pflash,index=N keeps board N's flash contents across runs */
+    soc = TM4C123_SOC(dev);
+    dinfo = drive_get(IF_PFLASH, 0, board);
+    if (dinfo) {
+        qdev_prop_set_drive_err(DEVICE(&soc->flashctl), "drive",
+                                blk_by_legacy_dinfo(dinfo), &error_fatal);
+    }
+    if (image && *image) {
+        qdev_prop_set_string(DEVICE(&soc->flashctl), "image", image);
+    }
+    return soc;
 }
 
-static void tivac_machine_init(MachineClass *mc)
+static void tivac_init(MachineState *machine)
 {
-    mc->desc = "Tiva C (Cortex-M4)";
+    TM4C123MachineState *tms = TM4C123_MACHINE(machine);
+    TM4C123SoCState *soc[TM4C123_MAX_BOARDS];
+    int boards = machine->smp.cpus;
+    g_auto(GStrv) images = NULL;
+    int b;
+
+    /* One image per board, separated by ':'; an empty one leaves it blank */
+    if (tms->flash_image) {
+        if (machine->kernel_filename) {
+            error_report("flash-image and -kernel cannot be used together");
+            exit(1);
+        }
+        images = g_strsplit(tms->flash_image, ":", -1);
+        if (g_strv_length(images) > boards) {
+            error_report("flash-image lists more images than there are boards");
+            exit(1);
+        }
+    }
+
+    for (b = 0; b < boards; b++) {
+        soc[b] = tivac_soc_new(machine, b,
+                               images && b < g_strv_length(images) ? images[b] : NULL);
+    }
+    if (tms->uart_links) {
+        tivac_link_uarts(tms, soc, boards, &error_fatal);
+    }
+
+    /* Board N's bus shows up at N << 32, for the monitor, qtest and loaders */
+    for (b = 0; b < boards; b++) {
+        sysbus_realize_and_unref(SYS_BUS_DEVICE(soc[b]), &error_fatal);
+        sysbus_mmio_map(SYS_BUS_DEVICE(soc[b]), 0, (hwaddr)b << 32);
+    }
+    if (tms->gpio_links) {
+        tivac_link_gpios(tms, soc, boards, &error_fatal);
+    }
+
+    cpus_set_idle_skip(tms->idle_skip);
+
+    /* -kernel goes into every board; use -device loader,cpu-num=N for one */
+    for (b = 0; b < boards; b++) {
+        armv7m_load_kernel(soc[b]->armv7m.cpu, machine->kernel_filename, 0,
+                           TM4C123_SOC_GET_CLASS(soc[b])->part->flash_size);
+    }
+}
+
+static char *tivac_get_idle(Object *obj, Error **errp)
+{
+    TM4C123MachineState *tms = TM4C123_MACHINE(obj);
+
+    return g_strdup(tms->idle_skip ? "skip" : "wait");
+}
+
+static void tivac_set_idle(Object *obj, const char *value, Error **errp)
+{
+    TM4C123MachineState *tms = TM4C123_MACHINE(obj);
+
+    if (!strcmp(value, "skip")) {
+        tms->idle_skip = true;
+    } else if (!strcmp(value, "wait")) {
+        tms->idle_skip = false;
+    } else {
+        error_setg(errp, "Invalid idle mode '%s'", value);
+        error_append_hint(errp, "Valid values are 'wait' and 'skip'.\n");
+    }
+}
+
+static char *tivac_get_flash_image(Object *obj, Error **errp)
+{
+    TM4C123MachineState *tms = TM4C123_MACHINE(obj);
+
+    return g_strdup(tms->flash_image);
+}
+
+static void tivac_set_flash_image(Object *obj, const char *value, Error **errp)
+{
+    TM4C123MachineState *tms = TM4C123_MACHINE(obj);
+
+    g_free(tms->flash_image);
+    tms->flash_image = g_strdup(value);
+}
+
+static char *tivac_get_uart_links(Object *obj, Error **errp)
+{
+    TM4C123MachineState *tms = TM4C123_MACHINE(obj);
+
+    return g_strdup(tms->uart_links);
+}
+
+static void tivac_set_uart_links(Object *obj, const char *value, Error **errp)
+{
+    TM4C123MachineState *tms = TM4C123_MACHINE(obj);
+
+    g_free(tms->uart_links);
+    tms->uart_links = g_strdup(value);
+}
+
+static char *tivac_get_gpio_links(Object *obj, Error **errp)
+{
+    TM4C123MachineState *tms = TM4C123_MACHINE(obj);
+
+    return g_strdup(tms->gpio_links);
+}
+
+static void tivac_set_gpio_links(Object *obj, const char *value, Error **errp)
+{
+    TM4C123MachineState *tms = TM4C123_MACHINE(obj);
+
+    g_free(tms->gpio_links);
+    tms->gpio_links = g_strdup(value);
+}
+
+static void tivac_machine_instance_init(Object *obj)
+{
+    TM4C123MachineState *tms = TM4C123_MACHINE(obj);
+
+    object_property_add_link(obj, "canbus0", TYPE_CAN_BUS,
+                             (Object **)&tms->canbus[0],
+                             object_property_allow_set_link, 0);
+    object_property_add_link(obj, "canbus1", TYPE_CAN_BUS,
+                             (Object **)&tms->canbus[1],
+                             object_property_allow_set_link, 0);
+}
+
+static void tm4c123_machine_class_init(ObjectClass *oc, void *data)
+{
+    MachineClass *mc = MACHINE_CLASS(oc);
+
+    object_class_property_add_str(oc, "idle", tivac_get_idle, tivac_set_idle);
+    object_class_property_set_description(oc, "idle",
+        "What to do while the core sleeps: 'wait' in real time (default), "
+        "or 'skip' straight to the next timer deadline");
+    object_class_property_add_str(oc, "flash-image", tivac_get_flash_image,
+                                  tivac_set_flash_image);
+    object_class_property_set_description(oc, "flash-image",
+        "A raw or ELF image to map into the flash instead of loading it "
+        "with -kernel; it is restored at every reset. With several boards, "
+        "one image per board separated by ':'");
+    object_class_property_add_str(oc, "uart-links", tivac_get_uart_links,
+                                  tivac_set_uart_links);
+    object_class_property_set_description(oc, "uart-links",
+        "UARTs wired across boards, as <board>.<uart>-<board>.<uart> "
+        "pairs separated by ':', e.g. 0.1-1.1");
+    object_class_property_add_str(oc, "gpio-links", tivac_get_gpio_links,
+                                  tivac_set_gpio_links);
+    object_class_property_set_description(oc, "gpio-links",
+        "Pins driving a pin on another board, as "
+        "<board>.<port><pin>-<board>.<port><pin> pairs separated by ':', "
+        "e.g. 0.A3-1.B4");
     mc->init = tivac_init;
+    mc->max_cpus = TM4C123_MAX_BOARDS;
 }
-DEFINE_MACHINE("tivac", tivac_machine_init)
+
+static void tivac_machine_class_init(ObjectClass *oc, void *data)
+{
+    MachineClass *mc = MACHINE_CLASS(oc);
+    TM4C123MachineClass *tmc = TM4C123_MACHINE_CLASS(oc);
+
+    mc->desc = "Tiva C (Cortex-M4)";
+    tmc->soc_type = TYPE_TM4C123GH6PM_SOC;
+}
+
+static void tm4c1230c3pm_machine_class_init(ObjectClass *oc, void *data)
+{
+    MachineClass *mc = MACHINE_CLASS(oc);
+    TM4C123MachineClass *tmc = TM4C123_MACHINE_CLASS(oc);
+
+    mc->desc = "TI TM4C1230C3PM (Cortex-M4)";
+    tmc->soc_type = TYPE_TM4C1230C3PM_SOC;
+}
+
+static const TypeInfo tm4c123_machine_types[] = {
+    {
+        .name           = TYPE_TM4C123_MACHINE,
+        .parent         = TYPE_MACHINE,
+        .instance_size  = sizeof(TM4C123MachineState),
+        .instance_init  = tivac_machine_instance_init,
+        .class_size     = sizeof(TM4C123MachineClass),
+        .class_init     = tm4c123_machine_class_init,
+        .abstract       = true,
+    }, {
+        .name           = MACHINE_TYPE_NAME("tivac"),
+        .parent         = TYPE_TM4C123_MACHINE,
+        .class_init     = tivac_machine_class_init,
+    }, {
+        .name           = MACHINE_TYPE_NAME("tm4c1230c3pm"),
+        .parent         = TYPE_TM4C123_MACHINE,
+        .class_init     = tm4c1230c3pm_machine_class_init,
+    },
+};
+
+DEFINE_TYPES(tm4c123_machine_types)
@@ -1,5 +1,5 @@
 /*
- * TM4C123GH6PM SoC
+ * TM4C123 SoC family
  *
  * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
  *
@@ -25,251 +25,904 @@
 #include "qemu/osdep.h"
 #include "qapi/error.h"
 #include "qemu/module.h"
+#include "qemu/bitops.h"
+#include "qemu/units.h"
+#include "qemu/main-loop.h"
 #include "hw/arm/boot.h"
-#include "exec/address-spaces.h"
 #include "hw/arm/tm4c123gh6pm_soc.h"
+#include "hw/loader.h"
 #include "hw/qdev-properties.h"
 #include "hw/qdev-clock.h"
 #include "hw/misc/unimp.h"
 #include "sysemu/sysemu.h"
-
-static const uint32_t gpio_addrs[GPIO_COUNT] = {
-    0x40004000,
-    0x40005000,
-    0x40006000,
-    0x40007000,
-    0x40024000,
-    0x40025000
+#include "target/arm/arm-powerctl.h"
+#include "sysemu/cpus.h"
+
+static const TM4C123SoCMap tm4c123_map = {
+    .num_irq = 139,
+
+    .usart_addrs = {
+        0x4000C000, 0x4000D000, 0x4000E000, 0x4000F000,
+        0x40010000, 0x40011000, 0x40012000, 0x40013000,
+    },
+    .gpio_addrs = {
+        0x40004000, 0x40005000, 0x40006000, 0x40007000,
+        0x40024000, 0x40025000,
+    },
+    .gpio_ahb_addrs = {
+        0x40058000, 0x40059000, 0x4005A000, 0x4005B000,
+        0x4005C000, 0x4005D000,
+    },
+    .wdt_addrs = {0x40000000, 0x40001000},
+    .gptm_addrs = {
+        0x40030000, 0x40031000, 0x40032000, 0x40033000,
+        0x40034000, 0x40035000, 0x40036000, 0x40037000,
+        0x4004C000, 0x4004D000, 0x4004E000, 0x4004F000,
+    },
+    .ssi_addrs = {0x40008000, 0x40009000, 0x4000A000, 0x4000B000},
+    .i2c_addrs = {0x40020000, 0x40021000, 0x40022000, 0x40023000},
+    .adc_addrs = {0x40038000, 0x40039000},
+    .pwm_addrs = {0x40028000, 0x40029000},
+    .qei_addrs = {0x4002C000, 0x4002D000},
+    .can_addrs = {0x40040000, 0x40041000},
+    .acmp_addr = 0x4003C000,
+    .usb_addr = 0x40050000,
+
+    .usart_irqs = {5, 6, 33, 59, 60, 61, 62, 63},
+    .gpio_irqs = {0, 1, 2, 3, 4, 30},
+    .wdt_irqs = {18, 18},
+    .gptm_irqs = {
+        19, 20, 21, 22, 23, 24, 35, 36, 70, 71, 92, 93,
+        94, 95, 96, 97, 98, 99, 100, 101, 102, 103, 104, 105,
+    },
+    .ssi_irqs = {7, 34, 57, 58},
+    .i2c_irqs = {8, 37, 68, 69},
+    .adc_irqs = {14, 15, 16, 17, 48, 49, 50, 51},
+    .pwm_irqs = {10, 11, 12, 45, 134, 135, 136, 137},
+    .pwm_fault_irqs = {9, 138},
+    .qei_irqs = {13, 38},
+    .can_irqs = {39, 40},
+    .udma_irqs = {46, 47},
+    .flash_irq = 29,
+    .hib_irq = 43,
+
+    .usart_dma = {
+        {8, 0}, {22, 0}, {12, 1}, {16, 2}, {18, 2}, {6, 2}, {10, 2}, {20, 2}
+    },
+    .ssi_dma = {{10, 0}, {24, 0}, {12, 2}, {14, 2}},
+    .gptm_dma = {
+        {18, 0}, {19, 0}, {20, 0}, {21, 0}, {4, 1}, {5, 1}, {2, 1}, {3, 1}
+    },
+    .adc_dma = {{14, 0}, {24, 1}},
 };
 
-static const uint32_t usart_addrs[USART_COUNT] = {
-    0x4000C000,
-    0x4000D000,
-    0x4000E000,
-    0x4000F000,
-    0x40010000,
-    0x40011000,
-    0x40012000,
-    0x40013000
+/* DID0: version 1, TM4C123 class; DID1: version 1, LQFP, -40 to 105 C */
+static const TM4C123PartInfo tm4c123_parts[] = {
+    {
+        .name = "TM4C123GH6PM",
+        .map = &tm4c123_map,
+        .flash_size = 256 * KiB,
+        .sram_size = 32 * KiB,
+        .did0 = 0x10050101,
+        .did1 = 0x10A1606E,
+        .ppwd = 0x3,
+        .pptimer = 0x3F,
+        .ppgpio = 0x3F,
+        .ppdma = 0x1,
+        .pphib = 0x1,
+        .ppuart = 0xFF,
+        .ppssi = 0xF,
+        .ppi2c = 0xF,
+        .ppusb = 0x1,
+        .ppcan = 0x3,
+        .ppadc = 0x3,
+        .ppacmp = 0x1,
+        .pppwm = 0x3,
+        .ppqei = 0x3,
+        .ppeeprom = 0x1,
+        .ppwtimer = 0x3F,
+    }, {
+        /* The small-memory part: no USB, CAN, motion control PWM or QEI */
+        .name = "TM4C1230C3PM",
+        .map = &tm4c123_map,
+        .flash_size = 32 * KiB,
+        .sram_size = 12 * KiB,
+        .did0 = 0x10050101,
+        .did1 = 0x1022606E,
+        .ppwd = 0x3,
+        .pptimer = 0x3F,
+        .ppgpio = 0x3F,
+        .ppdma = 0x1,
+        .pphib = 0x1,
+        .ppuart = 0xFF,
+        .ppssi = 0xF,
+        .ppi2c = 0xF,
+        .ppadc = 0x3,
+        .ppacmp = 0x1,
+        .ppeeprom = 0x1,
+        .ppwtimer = 0x3F,
+    },
 };
 
-static const uint32_t wdt_addrs[WDT_COUNT] = {
-    0x40000000,
-    0x40001000
-};
+static bool tm4c123_soc_has(uint32_t pp, int i)
+{
+    return extract32(pp, i, 1);
+}
 
-static const uint32_t gptm_addrs[GPTM_COUNT] = {
-    0x40030000,
-    0x40031000,
-    0x40032000,
-    0x40033000,
-    0x40034000,
-    0x40035000,
-    0x40036000,
-    0x40037000,
-    0x4003C800,
-    0x4003D000,
-    0x4003E000,
-    0x4003F000,
-};
+/* The first six timers are the 16/32-bit ones, the rest the wide ones */
+static bool tm4c123_soc_has_gptm(const TM4C123PartInfo *part, int i)
+{
+    if (i < GPTM_COUNT / 2) {
+        return tm4c123_soc_has(part->pptimer, i);
+    }
+    return tm4c123_soc_has(part->ppwtimer, i - GPTM_COUNT / 2);
+}
+
+/*
+ * Hook request @n of @dev to uDMA request line @line, and the channel's
+ * completion to @done. Parts without a uDMA leave the requests open.
+ */
+static void tm4c123_soc_connect_dma(TM4C123SoCState *s, DeviceState *dev, int n,
+                                    int line, bool sreq, qemu_irq done)
+{
+    const TM4C123PartInfo *part = TM4C123_SOC_GET_CLASS(s)->part;
+    DeviceState *udma;
 
-static const uint16_t usart_irqs[USART_COUNT] = {5, 6, 33, 59, 60, 61, 62, 63};
-static const uint16_t gpio_irqs[GPIO_COUNT] = {0, 1, 2, 3, 4, 30};
-static const uint16_t wdt_irqs[WDT_COUNT] = {18, 18};
-static const uint16_t gptm_irqs[GPTM_COUNT * 2] = {
-    19, 20, 21, 22, 23, 24, 35, 36, 70, 71, 92, 93,
-    94, 95, 96, 97, 98, 99, 100, 101, 102, 103, 104, 105};
+    if (!tm4c123_soc_has(part->ppdma, 0)) {
+        return;
+    }
+    udma = DEVICE(&s->udma);
+    qdev_connect_gpio_out_named(dev, "dma-req", n,
+                                qdev_get_gpio_in_named(udma, "req", line));
+    if (sreq) {
+        qdev_connect_gpio_out_named(dev, "dma-sreq", n,
+                                    qdev_get_gpio_in_named(udma, "sreq", line));
+    }
+    qdev_connect_gpio_out_named(udma, "done", line, done);
+}
 
-static void tm4c123gh6pm_soc_initfn(Object *obj)
+static void tm4c123_soc_initfn(Object *obj)
 {
     int i;
-    TM4C123GH6PMState *s = TM4C123GH6PM_SOC(obj);
+    TM4C123SoCState *s = TM4C123_SOC(obj);
+    const TM4C123PartInfo *part = TM4C123_SOC_GET_CLASS(s)->part;
 
-    object_initialize_child(obj, "armv7m", &s->armv7m, TYPE_ARMV7M);
+    object_initialize_child(obj, "cluster", &s->cluster, TYPE_CPU_CLUSTER);
+    object_initialize_child(OBJECT(&s->cluster), "armv7m", &s->armv7m, TYPE_ARMV7M);
     object_initialize_child(obj, "sysctl", &s->sysctl, TYPE_TM4C123_SYSCTL);
 
     for (i = 0; i < USART_COUNT; i++) {
+        if (!tm4c123_soc_has(part->ppuart, i)) {
+            continue;
+        }
         object_initialize_child(obj, "usart[*]",
                                 &s->usart[i], TYPE_TM4C123_USART);
+        object_initialize_child(obj, "usart-irq-orgate[*]",
+                                &s->usart_irq_orgate[i], TYPE_OR_IRQ);
     }
 
     for (i = 0; i < GPIO_COUNT; i++) {
-        object_initialize_child(obj, "gpio[*]", &s->gpio[i], TYPE_TM4C123_GPIO);
+        if (tm4c123_soc_has(part->ppgpio, i)) {
+            object_initialize_child(obj, "gpio[*]", &s->gpio[i], TYPE_TM4C123_GPIO);
+        }
     }
 
     for (i = 0; i < WDT_COUNT; i++) {
-        object_initialize_child(obj, "watchdog-timer[*]",
-                                &s->wdt[i], TYPE_TM4C123_WATCHDOG);
+        if (tm4c123_soc_has(part->ppwd, i)) {
+            object_initialize_child(obj, "watchdog-timer[*]",
+                                    &s->wdt[i], TYPE_TM4C123_WATCHDOG);
+        }
     }
 
     for (i = 0; i < GPTM_COUNT; i++) {
-        object_initialize_child(obj, "gptm[*]", &s->gptm[i], TYPE_TM4C123_GPTM);
+        if (tm4c123_soc_has_gptm(part, i)) {
+            object_initialize_child(obj, "gptm[*]", &s->gptm[i], TYPE_TM4C123_GPTM);
+        }
+    }
+
+    for (i = 0; i < GPTM_DMA_COUNT * 2; i++) {
+        if (tm4c123_soc_has_gptm(part, i / 2)) {
+            object_initialize_child(obj, "gptm-irq-orgate[*]",
+                                    &s->gptm_irq_orgate[i], TYPE_OR_IRQ);
+        }
+    }
+
+    if (tm4c123_soc_has(part->ppdma, 0)) {
+        object_initialize_child(obj, "udma", &s->udma, TYPE_TM4C123_UDMA);
+    }
+
+    for (i = 0; i < SSI_COUNT; i++) {
+        if (!tm4c123_soc_has(part->ppssi, i)) {
+            continue;
+        }
+        object_initialize_child(obj, "ssi[*]", &s->ssi[i], TYPE_TM4C123_SSI);
+        object_initialize_child(obj, "ssi-irq-orgate[*]",
+                                &s->ssi_irq_orgate[i], TYPE_OR_IRQ);
+    }
+
+    for (i = 0; i < I2C_COUNT; i++) {
+        if (tm4c123_soc_has(part->ppi2c, i)) {
+            object_initialize_child(obj, "i2c[*]", &s->i2c[i], TYPE_TM4C123_I2C);
+        }
+    }
+
+    for (i = 0; i < ADC_COUNT; i++) {
+        if (tm4c123_soc_has(part->ppadc, i)) {
+            object_initialize_child(obj, "adc[*]", &s->adc[i], TYPE_TM4C123_ADC);
+        }
+    }
+
+    for (i = 0; i < ADC_COUNT * ADC_SEQUENCERS; i++) {
+        if (tm4c123_soc_has(part->ppadc, i / ADC_SEQUENCERS)) {
+            object_initialize_child(obj, "adc-irq-orgate[*]",
+                                    &s->adc_irq_orgate[i], TYPE_OR_IRQ);
+        }
+    }
+    object_initialize_child(obj, "adc-timer-orgate", &s->adc_timer_orgate, TYPE_OR_IRQ);
+    object_initialize_child(obj, "adc-timer-split", &s->adc_timer_split, TYPE_SPLIT_IRQ);
+
+    for (i = 0; i < PWM_COUNT; i++) {
+        if (tm4c123_soc_has(part->pppwm, i)) {
+            object_initialize_child(obj, "pwm[*]", &s->pwm[i], TYPE_TM4C123_PWM);
+        }
+    }
+
+    for (i = 0; i < PWM_COUNT * PWM_GENERATORS; i++) {
+        if (tm4c123_soc_has(part->pppwm, i / PWM_GENERATORS)) {
+            object_initialize_child(obj, "pwm-adc-split[*]",
+                                    &s->pwm_adc_split[i], TYPE_SPLIT_IRQ);
+        }
+    }
+
+    for (i = 0; i < ADC_COMPARATORS; i++) {
+        object_initialize_child(obj, "adc-dc-split[*]",
+                                &s->adc_dc_split[i], TYPE_SPLIT_IRQ);
+    }
+
+    for (i = 0; i < QEI_COUNT; i++) {
+        if (tm4c123_soc_has(part->ppqei, i)) {
+            object_initialize_child(obj, "qei[*]", &s->qei[i], TYPE_TM4C123_QEI);
+        }
+    }
+
+    for (i = 0; i < CAN_COUNT; i++) {
+        if (tm4c123_soc_has(part->ppcan, i)) {
+            object_initialize_child(obj, "can[*]", &s->can[i], TYPE_TM4C123_CAN);
+        }
+    }
+
+    if (tm4c123_soc_has(part->ppeeprom, 0)) {
+        object_initialize_child(obj, "eeprom", &s->eeprom, TYPE_TM4C123_EEPROM);
+    }
+    object_initialize_child(obj, "flash", &s->flashctl, TYPE_TM4C123_FLASH);
+    if (tm4c123_soc_has(part->pphib, 0)) {
+        object_initialize_child(obj, "hib", &s->hib, TYPE_TM4C123_HIB);
+    }
+
+    if (tm4c123_soc_has(part->ppacmp, 0)) {
+        object_initialize_child(obj, "analog-cmp", &s->acmp, TYPE_UNIMPLEMENTED_DEVICE);
+    }
+    if (tm4c123_soc_has(part->ppusb, 0)) {
+        object_initialize_child(obj, "usb", &s->usb, TYPE_UNIMPLEMENTED_DEVICE);
+    }
+    object_initialize_child(obj, "sys-exc", &s->sys_exc, TYPE_UNIMPLEMENTED_DEVICE);
+
+    /* Everything the core and the uDMA see, as an alias so a board can map it */
+    memory_region_init(&s->container, obj, "tm4c123-soc.container", 4 * GiB);
+    memory_region_init_alias(&s->bus_alias, obj, "tm4c123-soc.bus",
+                             &s->container, 0, 4 * GiB);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->bus_alias);
+}
+
+/* Peripherals are mapped into the SoC's own bus, not into system memory */
+static void tm4c123_soc_map(TM4C123SoCState *s, SysBusDevice *busdev, int n,
+                            hwaddr addr)
+{
+    memory_region_add_subregion(&s->container, addr,
+                                sysbus_mmio_get_region(busdev, n));
+}
+
+static bool tm4c123_soc_unimp(TM4C123SoCState *s, UnimplementedDeviceState *uds,
+                              const char *name, hwaddr addr, uint64_t size,
+                              Error **errp)
+{
+    qdev_prop_set_string(DEVICE(uds), "name", name);
+    qdev_prop_set_uint64(DEVICE(uds), "size", size);
+    if (!sysbus_realize(SYS_BUS_DEVICE(uds), errp)) {
+        return false;
+    }
+    memory_region_add_subregion_overlap(&s->container, addr,
+            sysbus_mmio_get_region(SYS_BUS_DEVICE(uds), 0), -1000);
+    return true;
+}
+
+/* A core waiting in WFI sleeps, or sleeps deeply when SCR.SLEEPDEEP is set */
+static void tm4c123_soc_idle(Notifier *notifier, void *data)
+{
+    TM4C123SoCState *s = container_of(notifier, TM4C123SoCState, idle_notifier);
+    CPUIdleEvent *event = data;
+    TM4C123PowerMode mode = TM4C123_POWER_RUN;
+
+    if (event->cpu != CPU(s->armv7m.cpu)) {
+        return;
+    }
+    if (event->idle) {
+        mode = s->armv7m.cpu->env.v7m.scr[M_REG_NS] & R_V7M_SCR_SLEEPDEEP_MASK ?
+               TM4C123_POWER_DEEP_SLEEP : TM4C123_POWER_SLEEP;
+    }
+    tm4c123_sysctl_set_power_mode(&s->sysctl, mode);
+}
+
+/* Hibernation powers the core down; the reset on wake-up powers it back on */
+static void tm4c123_soc_hibernate(void *opaque, int n, int level)
+{
+    TM4C123SoCState *s = opaque;
+
+    if (level) {
+        arm_set_cpu_off(s->armv7m.cpu->mp_affinity);
     }
 }
 
-static void tm4c123gh6pm_soc_realize(DeviceState *dev_soc, Error **errp)
+static int tm4c123_soc_reset_child(Object *obj, void *opaque)
 {
-    TM4C123GH6PMState *s = TM4C123GH6PM_SOC(dev_soc);
+    DeviceState *dev = (DeviceState *)object_dynamic_cast(obj, TYPE_DEVICE);
+
+    /* The core goes last, once its vector table is back in place */
+    if (dev && dev->realized && !object_dynamic_cast(obj, TYPE_CPU)) {
+        device_cold_reset(dev);
+    }
+    return 0;
+}
+
+/*
+ * The peripherals are children of the SoC rather than devices on a bus it
+ * owns, so a reset of the SoC alone would not reach them.
+ */
+static void tm4c123_soc_reset_bh(void *opaque)
+{
+    TM4C123SoCState *s = opaque;
+    CPUState *cpu = CPU(s->armv7m.cpu);
+
+    pause_all_vcpus();
+    device_cold_reset(DEVICE(s));
+    object_child_foreach_recursive(OBJECT(s), tm4c123_soc_reset_child, NULL);
+    rom_reset_address_space(cpu->as);
+    cpu_reset(cpu);
+    resume_all_vcpus();
+}
+
+void tm4c123_soc_reset(TM4C123SoCState *s)
+{
+    qemu_bh_schedule(s->reset_bh);
+}
+
+/* The watchdog, a wake from hibernation and SYSRESETREQ reset this board */
+static void tm4c123_soc_reset_request(void *opaque, int n, int level)
+{
+    if (level) {
+        tm4c123_soc_reset(opaque);
+    }
+}
+
+static void tm4c123_soc_realize(DeviceState *dev_soc, Error **errp)
+{
+    TM4C123SoCState *s = TM4C123_SOC(dev_soc);
+    const TM4C123PartInfo *part = TM4C123_SOC_GET_CLASS(s)->part;
+    const TM4C123SoCMap *map = part->map;
+    g_autofree char *sram_name = NULL;
     DeviceState *armv7m;
     DeviceState *dev;
+    DeviceState *gate;
     SysBusDevice *busdev;
-    int i;
-
-    MemoryRegion *system_memory = get_system_memory();
+    qemu_irq reset;
+    int i, j, k, ch, line;
+
+    /* RAM block names must stay unique when a machine has several boards */
+    if (s->board) {
+        g_autofree char *flash_name = g_strdup_printf("%s.%u.flash", part->name,
+                                                      s->board);
+
+        sram_name = g_strdup_printf("%s.%u.sram", part->name, s->board);
+        qdev_prop_set_string(DEVICE(&s->flashctl), "ram-name", flash_name);
+    } else {
+        sram_name = g_strdup_printf("%s.sram", part->name);
+    }
 
-    /* init flash memory */
-    memory_region_init_rom(
-            &s->flash, OBJECT(dev_soc),
-            "TM4C123GH6PM.flash", FLASH_SIZE, &error_fatal
-            );
-    memory_region_add_subregion(system_memory, FLASH_BASE_ADDRESS, &s->flash);
+    /* init flash memory, owned by its controller */
+    qdev_prop_set_uint32(DEVICE(&s->flashctl), "size", part->flash_size);
+    qdev_prop_set_uint32(DEVICE(&s->flashctl), "sram-size", part->sram_size);
+    if (!sysbus_realize(SYS_BUS_DEVICE(&s->flashctl), errp)) {
+        return;
+    }
+    busdev = SYS_BUS_DEVICE(&s->flashctl);
+    tm4c123_soc_map(s, busdev, 1, FLASH_BASE_ADDRESS);
 
     /* init sram and the sram alias region */
     memory_region_init_ram(
             &s->sram, OBJECT(dev_soc),
-            "TM4C123GH6PM.sram", SRAM_SIZE, &error_fatal);
-    memory_region_add_subregion(system_memory, SRAM_BASE_ADDRESS, &s->sram);
+            sram_name, part->sram_size, &error_fatal);
+    memory_region_add_subregion(&s->container, SRAM_BASE_ADDRESS, &s->sram);
 
     /* Init ARMv7m */
     armv7m = DEVICE(&s->armv7m);
-    qdev_prop_set_uint32(armv7m, "num-irq", 138);
+    qdev_prop_set_uint32(armv7m, "num-irq", map->num_irq);
     qdev_prop_set_string(armv7m, "cpu-type", s->cpu_type);
     qdev_prop_set_bit(armv7m, "enable-bitband", true);
     qdev_connect_clock_in(armv7m, "cpuclk", s->sysctl.mainclk);
-    qdev_connect_clock_in(armv7m, "refclk", s->sysctl.mainclk);
+    qdev_connect_clock_in(armv7m, "refclk", s->sysctl.refclk);
     object_property_set_link(OBJECT(&s->armv7m), "memory",
-            OBJECT(get_system_memory()), &error_abort);
+            OBJECT(&s->container), &error_abort);
 
     if (!sysbus_realize(SYS_BUS_DEVICE(&s->armv7m), errp)) {
         return;
     }
+    s->reset_bh = qemu_bh_new(tm4c123_soc_reset_bh, s);
+    reset = qemu_allocate_irq(tm4c123_soc_reset_request, s, 0);
+    qdev_connect_gpio_out_named(armv7m, "SYSRESETREQ", 0, reset);
+    /* The cluster can only be realized once it holds the CPU */
+    qdev_prop_set_uint32(DEVICE(&s->cluster), "cluster-id", s->board);
+    if (!qdev_realize(DEVICE(&s->cluster), NULL, errp)) {
+        return;
+    }
+    s->idle_notifier.notify = tm4c123_soc_idle;
+    qemu_add_cpu_idle_notifier(&s->idle_notifier);
+
+    /* uDMA */
+    if (tm4c123_soc_has(part->ppdma, 0)) {
+        dev = DEVICE(&(s->udma));
+        s->udma.downstream = &s->container;
+        s->udma.sysctl = &s->sysctl;
+        qdev_connect_clock_in(dev, "udma_clock",
+                              tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCDMA, 0));
+        if (!sysbus_realize(SYS_BUS_DEVICE(&s->udma), errp)) {
+            return;
+        }
+        busdev = SYS_BUS_DEVICE(dev);
+        tm4c123_soc_map(s, busdev, 0, UDMA_ADDR);
+        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, map->udma_irqs[0]));
+        sysbus_connect_irq(busdev, 1, qdev_get_gpio_in(armv7m, map->udma_irqs[1]));
+    }
 
     /* USART */
     for (i = 0; i < USART_COUNT; i++) {
+        if (!tm4c123_soc_has(part->ppuart, i)) {
+            continue;
+        }
         dev = DEVICE(&(s->usart[i]));
         s->usart[i].sysctl = &s->sysctl;
-        qdev_prop_set_chr(dev, "chardev", serial_hd(i));
+        qdev_connect_clock_in(dev, "usart_clock",
+                              tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCUART, i));
+        /* A UART linked to another board's has no host backend */
+        if (!s->usart[i].peer) {
+            qdev_prop_set_chr(dev, "chardev", serial_hd(s->board * USART_COUNT + i));
+        }
         if (!sysbus_realize(SYS_BUS_DEVICE(&s->usart[i]), errp)) {
             return;
         }
         busdev = SYS_BUS_DEVICE(dev);
-        sysbus_mmio_map(busdev, 0, usart_addrs[i]);
-        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, usart_irqs[i]));
+        tm4c123_soc_map(s, busdev, 0, map->usart_addrs[i]);
+
+        /* The interrupt line, then the RX and TX channel completions */
+        gate = DEVICE(&s->usart_irq_orgate[i]);
+        qdev_prop_set_uint32(gate, "num-lines", 3);
+        if (!qdev_realize(gate, NULL, errp)) {
+            return;
+        }
+        qdev_connect_gpio_out(gate, 0, qdev_get_gpio_in(armv7m, map->usart_irqs[i]));
+        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(gate, 0));
+        for (k = USART_DMA_RX; k <= USART_DMA_TX; k++) {
+            ch = map->usart_dma[i].ch + k;
+            line = UDMA_REQ_LINE(ch, map->usart_dma[i].enc);
+            tm4c123_soc_connect_dma(s, dev, k, line, true, qdev_get_gpio_in(gate, 1 + k));
+        }
+    }
+
+    /* SSI */
+    for (i = 0; i < SSI_COUNT; i++) {
+        if (!tm4c123_soc_has(part->ppssi, i)) {
+            continue;
+        }
+        dev = DEVICE(&(s->ssi[i]));
+        s->ssi[i].sysctl = &s->sysctl;
+        qdev_connect_clock_in(dev, "ssi_clock",
+                              tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCSSI, i));
+        if (!sysbus_realize(SYS_BUS_DEVICE(&s->ssi[i]), errp)) {
+            return;
+        }
+        busdev = SYS_BUS_DEVICE(dev);
+        tm4c123_soc_map(s, busdev, 0, map->ssi_addrs[i]);
+
+        /* The interrupt line, then the RX and TX channel completions */
+        gate = DEVICE(&s->ssi_irq_orgate[i]);
+        qdev_prop_set_uint32(gate, "num-lines", 3);
+        if (!qdev_realize(gate, NULL, errp)) {
+            return;
+        }
+        qdev_connect_gpio_out(gate, 0, qdev_get_gpio_in(armv7m, map->ssi_irqs[i]));
+        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(gate, 0));
+        for (k = SSI_DMA_RX; k <= SSI_DMA_TX; k++) {
+            ch = map->ssi_dma[i].ch + k;
+            line = UDMA_REQ_LINE(ch, map->ssi_dma[i].enc);
+            tm4c123_soc_connect_dma(s, dev, k, line, true, qdev_get_gpio_in(gate, 1 + k));
+        }
+    }
+
+    /* I2C */
+    for (i = 0; i < I2C_COUNT; i++) {
+        if (!tm4c123_soc_has(part->ppi2c, i)) {
+            continue;
+        }
+        dev = DEVICE(&(s->i2c[i]));
+        s->i2c[i].sysctl = &s->sysctl;
+        qdev_connect_clock_in(dev, "i2c_clock",
+                              tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCI2C, i));
+        if (!sysbus_realize(SYS_BUS_DEVICE(&s->i2c[i]), errp)) {
+            return;
+        }
+        busdev = SYS_BUS_DEVICE(dev);
+        tm4c123_soc_map(s, busdev, 0, map->i2c_addrs[i]);
+        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, map->i2c_irqs[i]));
+    }
+
+    /* ADC */
+    gate = DEVICE(&s->adc_timer_split);
+    qdev_prop_set_uint16(gate, "num-lines", ADC_COUNT);
+    if (!qdev_realize(gate, NULL, errp)) {
+        return;
+    }
+    gate = DEVICE(&s->adc_timer_orgate);
+    qdev_prop_set_uint32(gate, "num-lines", GPTM_COUNT);
+    if (!qdev_realize(gate, NULL, errp)) {
+        return;
+    }
+    qdev_connect_gpio_out(gate, 0, qdev_get_gpio_in(DEVICE(&s->adc_timer_split), 0));
+    for (i = 0; i < ADC_COUNT; i++) {
+        if (!tm4c123_soc_has(part->ppadc, i)) {
+            continue;
+        }
+        dev = DEVICE(&(s->adc[i]));
+        s->adc[i].sysctl = &s->sysctl;
+        qdev_connect_clock_in(dev, "adc_clock",
+                              tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCADC, i));
+        if (!sysbus_realize(SYS_BUS_DEVICE(&s->adc[i]), errp)) {
+            return;
+        }
+        busdev = SYS_BUS_DEVICE(dev);
+        tm4c123_soc_map(s, busdev, 0, map->adc_addrs[i]);
+        qdev_connect_gpio_out(DEVICE(&s->adc_timer_split), i,
+                              qdev_get_gpio_in_named(dev, "trigger", ADC_EMUX_TIMER));
+
+        /* Each sequencer's interrupt line, then its channel completion */
+        for (k = 0; k < ADC_SEQUENCERS; k++) {
+            gate = DEVICE(&s->adc_irq_orgate[i * ADC_SEQUENCERS + k]);
+            qdev_prop_set_uint32(gate, "num-lines", 2);
+            if (!qdev_realize(gate, NULL, errp)) {
+                return;
+            }
+            qdev_connect_gpio_out(gate, 0, qdev_get_gpio_in(armv7m,
+                                  map->adc_irqs[i * ADC_SEQUENCERS + k]));
+            sysbus_connect_irq(busdev, k, qdev_get_gpio_in(gate, 0));
+            line = UDMA_REQ_LINE(map->adc_dma[i].ch + k, map->adc_dma[i].enc);
+            tm4c123_soc_connect_dma(s, dev, k, line, false, qdev_get_gpio_in(gate, 1));
+        }
+    }
+
+    /* PWM */
+    for (i = 0; i < PWM_COUNT; i++) {
+        if (!tm4c123_soc_has(part->pppwm, i)) {
+            continue;
+        }
+        dev = DEVICE(&(s->pwm[i]));
+        s->pwm[i].sysctl = &s->sysctl;
+        qdev_prop_set_uint8(dev, "module", i);
+        qdev_connect_clock_in(dev, "pwm_clock",
+                              tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCPWM, i));
+        if (!sysbus_realize(SYS_BUS_DEVICE(&s->pwm[i]), errp)) {
+            return;
+        }
+        busdev = SYS_BUS_DEVICE(dev);
+        tm4c123_soc_map(s, busdev, 0, map->pwm_addrs[i]);
+        for (k = 0; k < PWM_GENERATORS; k++) {
+            sysbus_connect_irq(busdev, k,
+                    qdev_get_gpio_in(armv7m, map->pwm_irqs[i * PWM_GENERATORS + k]));
+        }
+        sysbus_connect_irq(busdev, PWM_GENERATORS,
+                           qdev_get_gpio_in(armv7m, map->pwm_fault_irqs[i]));
+
+        /* ADCTSSEL picks the module; the ADCs see generator k on line i * 4 + k */
+        for (k = 0; k < PWM_GENERATORS; k++) {
+            line = i * PWM_GENERATORS + k;
+            gate = DEVICE(&s->pwm_adc_split[line]);
+            qdev_prop_set_uint16(gate, "num-lines", ADC_COUNT);
+            if (!qdev_realize(gate, NULL, errp)) {
+                return;
+            }
+            qdev_connect_gpio_out_named(dev, "adc-trigger", k, qdev_get_gpio_in(gate, 0));
+            for (j = 0; j < ADC_COUNT; j++) {
+                if (!tm4c123_soc_has(part->ppadc, j)) {
+                    continue;
+                }
+                qdev_connect_gpio_out(gate, j,
+                        qdev_get_gpio_in_named(DEVICE(&s->adc[j]), "pwm-trigger", line));
+            }
+        }
+    }
+
+    /* The fault sources PWMnFLTSRC1 selects are ADC0's digital comparators */
+    for (k = 0; k < ADC_COMPARATORS && tm4c123_soc_has(part->ppadc, 0); k++) {
+        gate = DEVICE(&s->adc_dc_split[k]);
+        qdev_prop_set_uint16(gate, "num-lines", PWM_COUNT);
+        if (!qdev_realize(gate, NULL, errp)) {
+            return;
+        }
+        qdev_connect_gpio_out_named(DEVICE(&s->adc[0]), "dc-trigger", k,
+                                    qdev_get_gpio_in(gate, 0));
+        for (i = 0; i < PWM_COUNT; i++) {
+            if (!tm4c123_soc_has(part->pppwm, i)) {
+                continue;
+            }
+            qdev_connect_gpio_out(gate, i,
+                    qdev_get_gpio_in_named(DEVICE(&s->pwm[i]), "dcmp", k));
+        }
+    }
+
+    /* QEI */
+    for (i = 0; i < QEI_COUNT; i++) {
+        if (!tm4c123_soc_has(part->ppqei, i)) {
+            continue;
+        }
+        dev = DEVICE(&(s->qei[i]));
+        s->qei[i].sysctl = &s->sysctl;
+        qdev_connect_clock_in(dev, "qei_clock",
+                              tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCQEI, i));
+        if (!sysbus_realize(SYS_BUS_DEVICE(&s->qei[i]), errp)) {
+            return;
+        }
+        busdev = SYS_BUS_DEVICE(dev);
+        tm4c123_soc_map(s, busdev, 0, map->qei_addrs[i]);
+        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, map->qei_irqs[i]));
+    }
+
+    /* CAN */
+    for (i = 0; i < CAN_COUNT; i++) {
+        if (!tm4c123_soc_has(part->ppcan, i)) {
+            continue;
+        }
+        dev = DEVICE(&(s->can[i]));
+        s->can[i].sysctl = &s->sysctl;
+        qdev_connect_clock_in(dev, "can_clock",
+                              tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCCAN, i));
+        if (s->canbus[i]) {
+            object_property_set_link(OBJECT(dev), "canbus", OBJECT(s->canbus[i]),
+                                     &error_abort);
+        }
+        if (!sysbus_realize(SYS_BUS_DEVICE(&s->can[i]), errp)) {
+            return;
+        }
+        busdev = SYS_BUS_DEVICE(dev);
+        tm4c123_soc_map(s, busdev, 0, map->can_addrs[i]);
+        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, map->can_irqs[i]));
+    }
+
+    /* EEPROM */
+    if (tm4c123_soc_has(part->ppeeprom, 0)) {
+        dev = DEVICE(&s->eeprom);
+        s->eeprom.sysctl = &s->sysctl;
+        qdev_connect_clock_in(dev, "eeprom_clock",
+                              tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCEEPROM, 0));
+        if (!sysbus_realize(SYS_BUS_DEVICE(&s->eeprom), errp)) {
+            return;
+        }
+        busdev = SYS_BUS_DEVICE(dev);
+        tm4c123_soc_map(s, busdev, 0, EEPROM_ADDR);
+        sysbus_connect_irq(busdev, 0,
+                           qdev_get_gpio_in_named(DEVICE(&s->flashctl), "eeprom-done", 0));
+    }
+
+    /* Flash controller, plus its registers that live in the sysctl block */
+    busdev = SYS_BUS_DEVICE(&s->flashctl);
+    tm4c123_soc_map(s, busdev, 0, FLASH_CTRL_ADDR);
+    memory_region_add_subregion_overlap(&s->container, SYSCTL_ADDR + FLASH_SYSCTL_REGS,
+                                        sysbus_mmio_get_region(busdev, 2), 1);
+    memory_region_add_subregion_overlap(&s->container, SYSCTL_ADDR + FLASH_SYSCTL_FMPPE,
+                                        sysbus_mmio_get_region(busdev, 3), 1);
+    sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, map->flash_irq));
+
+    /* Hibernation module */
+    if (tm4c123_soc_has(part->pphib, 0)) {
+        dev = DEVICE(&s->hib);
+        qdev_connect_clock_in(dev, "hib_clock",
+                              tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCHIB, 0));
+        if (!sysbus_realize(SYS_BUS_DEVICE(&s->hib), errp)) {
+            return;
+        }
+        busdev = SYS_BUS_DEVICE(dev);
+        tm4c123_soc_map(s, busdev, 0, HIB_ADDR);
+        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, map->hib_irq));
+        qdev_connect_gpio_out_named(dev, "hibernate", 0,
+                                    qemu_allocate_irq(tm4c123_soc_hibernate, s, 0));
+        qdev_connect_gpio_out_named(dev, "reset", 0, reset);
+        /* The WAKE pin is a pin of the chip, so the board drives it here */
+        qdev_pass_gpios(dev, dev_soc, "wake");
     }
 
     /* GPIO */
     for (i = 0; i < GPIO_COUNT; i++) {
+        if (!tm4c123_soc_has(part->ppgpio, i)) {
+            continue;
+        }
         dev = DEVICE(&(s->gpio[i]));
         s->gpio[i].sysctl = &s->sysctl;
+        qdev_prop_set_uint32(dev, "port", i);
+        qdev_connect_clock_in(dev, "gpio_clock",
+                              tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCGPIO, i));
         if (!sysbus_realize(SYS_BUS_DEVICE(&s->gpio[i]), errp)) {
             return;
         }
         busdev = SYS_BUS_DEVICE(dev);
-        sysbus_mmio_map(busdev, 0, gpio_addrs[i]);
-        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, gpio_irqs[i]));
+        tm4c123_soc_map(s, busdev, 0, map->gpio_addrs[i]);
+        tm4c123_soc_map(s, busdev, 1, map->gpio_ahb_addrs[i]);
+        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, map->gpio_irqs[i]));
     }
 
     /* Watchdog Timers */
     for (i = 0; i < WDT_COUNT; i++) {
+        if (!tm4c123_soc_has(part->ppwd, i)) {
+            continue;
+        }
         dev = DEVICE(&(s->wdt[i]));
         s->wdt[i].sysctl = &s->sysctl;
+        qdev_connect_clock_in(dev, "wdt_clock",
+                              tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCWD, i));
         if (!sysbus_realize(SYS_BUS_DEVICE(&s->wdt[i]), errp)) {
             return;
         }
         busdev = SYS_BUS_DEVICE(dev);
-        sysbus_mmio_map(busdev, 0, wdt_addrs[i]);
-        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, wdt_irqs[i]));
+        tm4c123_soc_map(s, busdev, 0, map->wdt_addrs[i]);
+        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, map->wdt_irqs[i]));
+        qdev_connect_gpio_out_named(dev, "reset", 0, reset);
     }
 
     /* General purpose timers */
-    int j = 0;
     for (i = 0, j = 0; i < GPTM_COUNT; i++, j += 2) {
+        if (!tm4c123_soc_has_gptm(part, i)) {
+            continue;
+        }
         dev = DEVICE(&(s->gptm[i]));
         s->gptm[i].sysctl = &s->sysctl;
+        /* The first six are the 16/32-bit timers, the rest the wide ones */
+        qdev_prop_set_bit(dev, "wide", i >= GPTM_COUNT / 2);
+        if (i < GPTM_COUNT / 2) {
+            qdev_connect_clock_in(dev, "gptm_clock",
+                                  tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCTIMER, i));
+        } else {
+            qdev_connect_clock_in(dev, "gptm_clock",
+                                  tm4c123_sysctl_clock(&s->sysctl, SYSCTL_RCGCWTIMER,
+                                                       i - GPTM_COUNT / 2));
+        }
+        /* Timer 0 owns GPTMSYNC, which reaches every timer */
+        if (tm4c123_soc_has_gptm(part, 0)) {
+            s->gptm[0].sync_peer[i] = &s->gptm[i];
+        }
         if (!sysbus_realize(SYS_BUS_DEVICE(&s->gptm[i]), errp)) {
             return;
         }
         busdev = SYS_BUS_DEVICE(dev);
-        sysbus_mmio_map(busdev, 0, gptm_addrs[i]);
-        sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, gptm_irqs[j]));
-        sysbus_connect_irq(busdev, 1, qdev_get_gpio_in(armv7m, gptm_irqs[j + 1]));
+        tm4c123_soc_map(s, busdev, 0, map->gptm_addrs[i]);
+        qdev_connect_gpio_out_named(dev, "adc-trigger", 0,
+                qdev_get_gpio_in(DEVICE(&s->adc_timer_orgate), i));
+        if (i >= GPTM_DMA_COUNT) {
+            sysbus_connect_irq(busdev, 0, qdev_get_gpio_in(armv7m, map->gptm_irqs[j]));
+            sysbus_connect_irq(busdev, 1, qdev_get_gpio_in(armv7m, map->gptm_irqs[j + 1]));
+            continue;
+        }
+
+        /* Each half's interrupt line, then its channel completion */
+        for (k = 0; k < 2; k++) {
+            gate = DEVICE(&s->gptm_irq_orgate[j + k]);
+            qdev_prop_set_uint32(gate, "num-lines", 2);
+            if (!qdev_realize(gate, NULL, errp)) {
+                return;
+            }
+            qdev_connect_gpio_out(gate, 0,
+                                  qdev_get_gpio_in(armv7m, map->gptm_irqs[j + k]));
+            sysbus_connect_irq(busdev, k, qdev_get_gpio_in(gate, 0));
+            ch = map->gptm_dma[j + k].ch;
+            line = UDMA_REQ_LINE(ch, map->gptm_dma[j + k].enc);
+            tm4c123_soc_connect_dma(s, dev, k, line, false, qdev_get_gpio_in(gate, 1));
+        }
     }
 
-    /* SYSCTL */
+    /* SYSCTL, which reports the part's identity and modules */
     dev = DEVICE(&(s->sysctl));
+    qdev_prop_set_uint32(dev, "did0", part->did0);
+    qdev_prop_set_uint32(dev, "did1", part->did1);
+    qdev_prop_set_uint32(dev, "ppwd", part->ppwd);
+    qdev_prop_set_uint32(dev, "pptimer", part->pptimer);
+    qdev_prop_set_uint32(dev, "ppgpio", part->ppgpio);
+    qdev_prop_set_uint32(dev, "ppdma", part->ppdma);
+    qdev_prop_set_uint32(dev, "pphib", part->pphib);
+    qdev_prop_set_uint32(dev, "ppuart", part->ppuart);
+    qdev_prop_set_uint32(dev, "ppssi", part->ppssi);
+    qdev_prop_set_uint32(dev, "ppi2c", part->ppi2c);
+    qdev_prop_set_uint32(dev, "ppusb", part->ppusb);
+    qdev_prop_set_uint32(dev, "ppcan", part->ppcan);
+    qdev_prop_set_uint32(dev, "ppadc", part->ppadc);
+    qdev_prop_set_uint32(dev, "ppacmp", part->ppacmp);
+    qdev_prop_set_uint32(dev, "pppwm", part->pppwm);
+    qdev_prop_set_uint32(dev, "ppqei", part->ppqei);
+    qdev_prop_set_uint32(dev, "ppeeprom", part->ppeeprom);
+    qdev_prop_set_uint32(dev, "ppwtimer", part->ppwtimer);
     if (!sysbus_realize(SYS_BUS_DEVICE(&s->sysctl), errp)) {
         return;
     }
     busdev = SYS_BUS_DEVICE(dev);
-    sysbus_mmio_map(busdev, 0, SYSCTL_ADDR);
-
-
-    create_unimplemented_device("SSI_0", 0x40008000, 0xFFF);
-    create_unimplemented_device("SSI_1", 0x40009000, 0xFFF);
-    create_unimplemented_device("SSI_2", 0x4000A000, 0xFFF);
-    create_unimplemented_device("SSI_3", 0x4000B000, 0xFFF);
-
-    create_unimplemented_device("I2C_0", 0x40020000, 0xFFF);
-    create_unimplemented_device("I2C_1", 0x40021000, 0xFFF);
-    create_unimplemented_device("I2C_2", 0x40022000, 0xFFF);
-    create_unimplemented_device("I2C_3", 0x40023000, 0xFFF);
-
-    create_unimplemented_device("PWM_0", 0x40028000, 0xFFF);
-    create_unimplemented_device("PWM_1", 0x40029000, 0xFFF);
-
-    create_unimplemented_device("QEI_0", 0x4002C000, 0xFFF);
-    create_unimplemented_device("QEI_1", 0x4002D000, 0xFFF);
-
-    create_unimplemented_device("ADC_0", 0x40038000, 0xFFF);
-    create_unimplemented_device("ADC_1", 0x40039000, 0xFFF);
-
-    create_unimplemented_device("ANALOG_CMP", 0x4003C000, 0xFFF);
-
-    create_unimplemented_device("CAN_0", 0x40040000, 0xFFF);
-    create_unimplemented_device("CAN_1", 0x40041000, 0xFFF);
-
-    create_unimplemented_device("USB", 0x40050000, 0xFFF);
-
-    create_unimplemented_device("GPIO_A_AHB", 0x40058000, 0xFFF);
-    create_unimplemented_device("GPIO_B_AHB", 0x40059000, 0xFFF);
-    create_unimplemented_device("GPIO_C_AHB", 0x4005A000, 0xFFF);
-    create_unimplemented_device("GPIO_D_AHB", 0x4005B000, 0xFFF);
-    create_unimplemented_device("GPIO_E_AHB", 0x4005C000, 0xFFF);
-    create_unimplemented_device("GPIO_F_AHB", 0x4005D000, 0xFFF);
+    tm4c123_soc_map(s, busdev, 0, SYSCTL_ADDR);
 
-    create_unimplemented_device("EEPROM", 0x400AF000, 0xFFF);
-    create_unimplemented_device("SYS_EXC", 0x400F9000, 0xFFF);
-    create_unimplemented_device("HIBERNATION_MOD", 0x400FC000, 0xFFF);
-    create_unimplemented_device("FLASH_CONT", 0x400FD000, 0xFFF);
-    create_unimplemented_device("SYS_CONT", 0x400FE000, 0xFFF);
-
-    create_unimplemented_device("uDMA", 0x400FF000, 0xFFF);
+    if (tm4c123_soc_has(part->ppacmp, 0) &&
+        !tm4c123_soc_unimp(s, &s->acmp, "ANALOG_CMP", map->acmp_addr, 0xFFF, errp)) {
+        return;
+    }
+    if (tm4c123_soc_has(part->ppusb, 0) &&
+        !tm4c123_soc_unimp(s, &s->usb, "USB", map->usb_addr, 0xFFF, errp)) {
+        return;
+    }
+    tm4c123_soc_unimp(s, &s->sys_exc, "SYS_EXC", 0x400F9000, 0xFFF, errp);
 }
 
-static Property tm4c123gh6pm_soc_properties[] = {
-    DEFINE_PROP_STRING("cpu-type", TM4C123GH6PMState, cpu_type),
+static Property tm4c123_soc_properties[] = {
+    DEFINE_PROP_STRING("cpu-type", TM4C123SoCState, cpu_type),
+    DEFINE_PROP_UINT32("board", TM4C123SoCState, board, 0),
+    DEFINE_PROP_LINK("canbus0", TM4C123SoCState, canbus[0], TYPE_CAN_BUS,
+                     CanBusState *),
+    DEFINE_PROP_LINK("canbus1", TM4C123SoCState, canbus[1], TYPE_CAN_BUS,
+                     CanBusState *),
     DEFINE_PROP_END_OF_LIST(),
 };
 
-static void tm4c123gh6pm_soc_class_init(ObjectClass *klass, void *data)
+static void tm4c123_soc_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
-    dc->realize = tm4c123gh6pm_soc_realize;
-    device_class_set_props(dc, tm4c123gh6pm_soc_properties);
+    dc->realize = tm4c123_soc_realize;
+    device_class_set_props(dc, tm4c123_soc_properties);
+}
+
+static void tm4c123_soc_part_class_init(ObjectClass *klass, void *data)
+{
+    TM4C123SoCClass *sc = TM4C123_SOC_CLASS(klass);
+
+    sc->part = data;
 }
 
-static const TypeInfo tm4c123gh6pm_soc_info = {
-    .name          = TYPE_TM4C123GH6PM_SOC,
+static const TypeInfo tm4c123_soc_info = {
+    .name          = TYPE_TM4C123_SOC,
     .parent        = TYPE_SYS_BUS_DEVICE,
-    .instance_size = sizeof(TM4C123GH6PMState),
-    .instance_init = tm4c123gh6pm_soc_initfn,
-    .class_init    = tm4c123gh6pm_soc_class_init,
+    .instance_size = sizeof(TM4C123SoCState),
+    .instance_init = tm4c123_soc_initfn,
+    .class_size    = sizeof(TM4C123SoCClass),
+    .class_init    = tm4c123_soc_class_init,
+    .abstract      = true,
 };
 
-static void tm4c123gh6pm_soc_types(void)
+/* Each part is a "<part>-soc" type, e.g. tm4c123gh6pm-soc */
+static void tm4c123_soc_types(void)
 {
-    type_register_static(&tm4c123gh6pm_soc_info);
+    int i;
+
+    type_register_static(&tm4c123_soc_info);
+    for (i = 0; i < ARRAY_SIZE(tm4c123_parts); i++) {
+        g_autofree char *name = g_ascii_strdown(tm4c123_parts[i].name, -1);
+        g_autofree char *type = g_strdup_printf("%s-soc", name);
+        TypeInfo ti = {
+            .name       = type,
+            .parent     = TYPE_TM4C123_SOC,
+            .class_init = tm4c123_soc_part_class_init,
+            .class_data = (void *)&tm4c123_parts[i],
+        };
+
+        type_register(&ti);
+    }
 }
 
-type_init(tm4c123gh6pm_soc_types)
+type_init(tm4c123_soc_types)
@@ -23,74 +23,545 @@
  */
 
 #include "qemu/osdep.h"
+#include "qapi/error.h"
 #include "hw/char/tm4c123_usart.h"
 #include "hw/irq.h"
 #include "hw/qdev-properties.h"
 #include "hw/qdev-properties-system.h"
+#include "hw/qdev-clock.h"
+#include "qemu/main-loop.h"
+#include "qemu/timer.h"
+#include "qemu/host-utils.h"
+#include "qemu/bitops.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "migration/vmstate.h"
 #include "trace.h"
 
 #define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
 #define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
 
-static bool usart_clock_enabled(TM4C123SysCtlState *s, hwaddr addr)
+static uint32_t tm4c123_usart_fifo_depth(TM4C123USARTState *s)
 {
-    switch (addr) {
-        case USART_0:
-            return s->sysctl_rcgcuart & (1 << 0);
-            break;
-        case USART_1:
-            return s->sysctl_rcgcuart & (1 << 1);
-            break;
-        case USART_2:
-            return s->sysctl_rcgcuart & (1 << 2);
-            break;
-        case USART_3:
-            return s->sysctl_rcgcuart & (1 << 3);
-            break;
-        case USART_4:
-            return s->sysctl_rcgcuart & (1 << 4);
-            break;
-        case USART_5:
-            return s->sysctl_rcgcuart & (1 << 5);
-            break;
-        case USART_6:
-            return s->sysctl_rcgcuart & (1 << 6);
-            break;
-        case USART_7:
-            return s->sysctl_rcgcuart & (1 << 7);
-            break;
+    return (s->usart_lcrh & USART_LCRH_FEN) ? USART_FIFO_DEPTH : 1;
+}
+
+/*
+ * IFLS level in entries: 1/8, 1/4, 1/2, 3/4 and 7/8 of the FIFO.
+ * The RX interrupt fires when the FIFO fills up to the level, the TX
+ * interrupt when it drains down to the mirrored level.
+ */
+static const uint8_t usart_fifo_levels[] = {2, 4, 8, 12, 14};
+
+static uint32_t tm4c123_usart_rx_trigger(TM4C123USARTState *s)
+{
+    uint32_t sel = extract32(s->usart_ifls, 3, 3);
+
+    if (!(s->usart_lcrh & USART_LCRH_FEN)) {
+        return 1;
+    }
+    return usart_fifo_levels[MIN(sel, ARRAY_SIZE(usart_fifo_levels) - 1)];
+}
+
+static uint32_t tm4c123_usart_tx_trigger(TM4C123USARTState *s)
+{
+    uint32_t sel = extract32(s->usart_ifls, 0, 3);
+
+    if (!(s->usart_lcrh & USART_LCRH_FEN) || (s->usart_ctl & USART_CR_EOT)) {
+        return 0;
+    }
+    return USART_FIFO_DEPTH -
+        usart_fifo_levels[MIN(sel, ARRAY_SIZE(usart_fifo_levels) - 1)];
+}
+
+/* Duration of one bit on the line, 0 if the baud rate is not programmed */
+static uint64_t tm4c123_usart_bit_time_ns(TM4C123USARTState *s)
+{
+    uint64_t clk_hz;
+    uint64_t brd;
+    uint32_t clk_div = (s->usart_ctl & USART_CR_HSE) ? 8 : 16;
+
+    if ((s->usart_cc & 0xF) == USART_CC_CS_PIOSC) {
+        clk_hz = XTALI;
+    } else {
+        clk_hz = clock_get_hz(s->clk);
+    }
+
+    brd = (extract32(s->usart_ibrd, 0, 16) << 6) | extract32(s->usart_fbrd, 0, 6);
+    if (!clk_hz || !extract32(s->usart_ibrd, 0, 16)) {
+        return 0;
+    }
+    /* BRD = IBRD + FBRD / 64 = clk / (clk_div * baud) */
+    return muldiv64(clk_div * brd, NANOSECONDS_PER_SECOND / 64, clk_hz);
+}
+
+/*
+ * Time to shift one frame: start bit, data bits, optional parity and
+ * stop bits. 0 means the character completes instantly, which is how
+ * the "fast" timing mode and an unprogrammed baud rate behave.
+ */
+static uint64_t tm4c123_usart_char_time_ns(TM4C123USARTState *s)
+{
+    uint32_t frame_bits;
+
+    if (s->fast_timing) {
+        return 0;
+    }
+
+    frame_bits = 1 + 5 + extract32(s->usart_lcrh, 5, 2);
+    frame_bits += (s->usart_lcrh & USART_LCRH_PEN) ? 1 : 0;
+    frame_bits += (s->usart_lcrh & USART_LCRH_STP2) ? 2 : 1;
+    return frame_bits * tm4c123_usart_bit_time_ns(s);
+}
+
+/*
+ * Characters still in the FIFO. Ones that have finished shifting out only
+ * wait for the backend, which is not something the guest can see.
+ */
+static uint32_t tm4c123_usart_tx_pending(TM4C123USARTState *s)
+{
+    return s->tx_count - s->tx_done;
+}
+
+static bool tm4c123_usart_tx_full(TM4C123USARTState *s)
+{
+    return tm4c123_usart_tx_pending(s) >= tm4c123_usart_fifo_depth(s) ||
+           s->tx_count >= USART_FIFO_DEPTH;
+}
+
+static void tm4c123_usart_update(TM4C123USARTState *s)
+{
+    uint32_t depth = tm4c123_usart_fifo_depth(s);
+    bool rx_dma;
+    bool tx_dma;
+
+    s->usart_fr &= ~(USART_FR_TXFE | USART_FR_RXFF | USART_FR_TXFF |
+                     USART_FR_RXFE | USART_FR_BUSY);
+    s->usart_fr |= tm4c123_usart_tx_pending(s) ? USART_FR_BUSY : USART_FR_TXFE;
+    s->usart_fr |= s->rx_count ? 0 : USART_FR_RXFE;
+    s->usart_fr |= tm4c123_usart_tx_full(s) ? USART_FR_TXFF : 0;
+    s->usart_fr |= (s->rx_count >= depth) ? USART_FR_RXFF : 0;
+
+    s->usart_mis = s->usart_ris & s->usart_im;
+    qemu_set_irq(s->irq, s->usart_mis != 0);
+
+    /*
+     * Burst requests follow the FIFO trigger levels, single requests ask
+     * for one character whenever there is one to take or room for one.
+     */
+    rx_dma = s->usart_dma_ctl & USART_DMACTL_RXDMAE;
+    tx_dma = s->usart_dma_ctl & USART_DMACTL_TXDMAE;
+    qemu_set_irq(s->dma_req[USART_DMA_RX],
+                 rx_dma && s->rx_count >= tm4c123_usart_rx_trigger(s));
+    qemu_set_irq(s->dma_sreq[USART_DMA_RX], rx_dma && s->rx_count);
+    qemu_set_irq(s->dma_req[USART_DMA_TX],
+                 tx_dma && s->tx_count <= tm4c123_usart_tx_trigger(s));
+    qemu_set_irq(s->dma_sreq[USART_DMA_TX], tx_dma && !tm4c123_usart_tx_full(s));
+}
+
+static bool tm4c123_usart_tx_enabled(TM4C123USARTState *s)
+{
+    return (s->usart_ctl & USART_CR_EN) && (s->usart_ctl & USART_CR_TXE);
+}
+
+static bool tm4c123_usart_rx_enabled(TM4C123USARTState *s)
+{
+    return (s->usart_ctl & USART_CR_EN) && (s->usart_ctl & USART_CR_RXE);
+}
+
+/*
+ * TX side of the line. The head of the FIFO started shifting at
+ * tx_start_ns, so character i is on the wire at tx_start_ns + (i + 1) *
+ * char time. Completed characters are counted in tx_done and handed to
+ * the chardev in one write; nothing is polled per character.
+ */
+static void tm4c123_usart_tx_advance(TM4C123USARTState *s)
+{
+    uint64_t char_ns = tm4c123_usart_char_time_ns(s);
+    int64_t elapsed;
+
+    if (!tm4c123_usart_tx_enabled(s)) {
+        return;
+    }
+
+    if (!char_ns) {
+        s->tx_done = s->tx_count;
+        return;
+    }
+
+    elapsed = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - s->tx_start_ns;
+    if (elapsed <= 0) {
+        s->tx_done = 0;
+    } else {
+        s->tx_done = MIN(elapsed / char_ns, s->tx_count);
+    }
+}
+
+/* Wake up when the FIFO drains to the TX trigger level, then when it is empty */
+static void tm4c123_usart_tx_schedule(TM4C123USARTState *s)
+{
+    uint64_t char_ns = tm4c123_usart_char_time_ns(s);
+    uint32_t trigger = tm4c123_usart_tx_trigger(s);
+    uint32_t target;
+
+    if (!char_ns || !tm4c123_usart_tx_enabled(s) || s->tx_done >= s->tx_count) {
+        timer_del(s->tx_timer);
+        return;
+    }
+
+    target = s->tx_count > trigger ? s->tx_count - trigger : s->tx_count;
+    if (target <= s->tx_done) {
+        target = s->tx_count;
+    }
+    /* A linked receiver needs each character at the time it completes */
+    if (s->peer) {
+        target = s->tx_done + 1;
+    }
+    timer_mod(s->tx_timer, s->tx_start_ns + target * char_ns);
+}
+
+/* Restart the character in flight, e.g. after a baud rate change */
+static void tm4c123_usart_tx_restart(TM4C123USARTState *s)
+{
+    s->tx_start_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) -
+        s->tx_done * tm4c123_usart_char_time_ns(s);
+    tm4c123_usart_tx_schedule(s);
+    if (tm4c123_usart_tx_enabled(s) && s->tx_count) {
+        qemu_bh_schedule(s->tx_bh);
+    }
+}
+
+static void tm4c123_usart_tx_pop(TM4C123USARTState *s, uint32_t n)
+{
+    s->tx_count -= n;
+    s->tx_done -= n;
+    s->tx_start_ns += n * tm4c123_usart_char_time_ns(s);
+    memmove(s->tx_fifo, s->tx_fifo + n, s->tx_count);
+}
+
+static void tm4c123_usart_link_receive(TM4C123USARTState *s,
+                                       const uint8_t *buf, uint32_t len);
+
+static gboolean tm4c123_usart_xmit(void *do_not_use, GIOCondition cond,
+                                   void *opaque)
+{
+    TM4C123USARTState *s = opaque;
+    uint32_t sent = 0;
+    int ret;
+
+    s->watch_tag = 0;
+
+    tm4c123_usart_tx_advance(s);
+    if (!tm4c123_usart_tx_enabled(s) || !s->tx_done) {
+        tm4c123_usart_tx_schedule(s);
+        return FALSE;
+    }
+
+    if (s->peer) {
+        /* The other board's receiver sees them as they finish shifting */
+        tm4c123_usart_link_receive(s->peer, s->tx_fifo, s->tx_done);
+        sent = s->tx_done;
+        tm4c123_usart_tx_pop(s, s->tx_done);
+    }
+
+    /* Hand everything that left the shift register to the backend at once */
+    ret = s->tx_done ? qemu_chr_fe_write(&s->chr, s->tx_fifo, s->tx_done) : 0;
+    if (ret > 0) {
+        tm4c123_usart_tx_pop(s, ret);
+        sent = ret;
+    }
+
+    if (s->tx_done) {
+        s->watch_tag = qemu_chr_fe_add_watch(&s->chr, G_IO_OUT | G_IO_HUP,
+                                             tm4c123_usart_xmit, s);
+        if (!s->watch_tag) {
+            /* No backend to wait for, the data goes nowhere */
+            sent += s->tx_done;
+            tm4c123_usart_tx_pop(s, s->tx_done);
+        }
+    }
+
+    if (sent && s->tx_count <= tm4c123_usart_tx_trigger(s)) {
+        s->usart_ris |= USART_INT_TX;
+    }
+    tm4c123_usart_tx_schedule(s);
+    tm4c123_usart_update(s);
+    return FALSE;
+}
+
+static void tm4c123_usart_tx_bh(void *opaque)
+{
+    TM4C123USARTState *s = opaque;
+
+    if (!s->watch_tag) {
+        tm4c123_usart_xmit(NULL, G_IO_OUT, s);
+    }
+}
+
+static void tm4c123_usart_tx_tick(void *opaque)
+{
+    tm4c123_usart_tx_bh(opaque);
+}
+
+static void tm4c123_usart_tx_push(TM4C123USARTState *s, uint8_t ch)
+{
+    tm4c123_usart_tx_advance(s);
+    if (s->tx_count >= USART_FIFO_DEPTH && s->tx_done && !s->watch_tag) {
+        /* The buffer is full of finished characters: hand them over now */
+        tm4c123_usart_xmit(NULL, G_IO_OUT, s);
+    }
+    if (tm4c123_usart_tx_full(s)) {
+        LOG(LOG_GUEST_ERROR, "TX FIFO overflow, dropping 0x%02x\n", ch);
+        return;
+    }
+
+    if (s->tx_done == s->tx_count) {
+        /* The line is idle, this character starts shifting now */
+        tm4c123_usart_tx_restart(s);
+    }
+
+    s->tx_fifo[s->tx_count++] = ch;
+    /* Without a character time it has already left */
+    tm4c123_usart_tx_advance(s);
+    if (tm4c123_usart_tx_pending(s) > tm4c123_usart_tx_trigger(s)) {
+        s->usart_ris &= ~USART_INT_TX;
+    }
+    tm4c123_usart_tx_schedule(s);
+    tm4c123_usart_update(s);
+
+    /*
+     * Defer the chardev write so that back-to-back DR writes leave
+     * together instead of one syscall per byte.
+     */
+    if (tm4c123_usart_tx_enabled(s) && !tm4c123_usart_char_time_ns(s)) {
+        qemu_bh_schedule(s->tx_bh);
+    }
+}
+
+/*
+ * RX side of the line. Characters accepted from the chardev wait in
+ * rx_line and land in the RX FIFO one character time apart, starting
+ * at rx_line_start_ns.
+ */
+static void tm4c123_usart_rx_schedule(TM4C123USARTState *s)
+{
+    uint64_t char_ns = tm4c123_usart_char_time_ns(s);
+    uint32_t trigger = tm4c123_usart_rx_trigger(s);
+    uint32_t target;
+
+    if (!char_ns || !s->rx_line_count) {
+        timer_del(s->rx_timer);
+        return;
+    }
+
+    /* Wake up when the FIFO reaches the RX trigger level or the line drains */
+    target = s->rx_count < trigger ? trigger - s->rx_count : s->rx_line_count;
+    target = MIN(target, s->rx_line_count);
+    timer_mod(s->rx_timer, s->rx_line_start_ns + target * char_ns);
+}
+
+/* Put one received character in the FIFO, or flag an overrun */
+static void tm4c123_usart_rx_store(TM4C123USARTState *s, uint8_t ch)
+{
+    if (s->rx_count >= tm4c123_usart_fifo_depth(s)) {
+        /* The newest entry is flagged, the byte itself is lost */
+        s->rx_fifo[(s->rx_pos + s->rx_count - 1) % USART_FIFO_DEPTH] |= USART_DR_OE;
+        s->usart_ris |= USART_INT_OE;
+        return;
+    }
+    s->rx_fifo[(s->rx_pos + s->rx_count) % USART_FIFO_DEPTH] = ch;
+    s->rx_count++;
+}
+
+/* Characters just reached the FIFO */
+static void tm4c123_usart_rx_landed(TM4C123USARTState *s)
+{
+    uint64_t bit_ns;
+
+    if (s->rx_count >= tm4c123_usart_rx_trigger(s)) {
+        s->usart_ris |= USART_INT_RX;
+    }
+
+    /*
+     * RX timeout: data sitting in the FIFO for 32 bit periods. Without a
+     * baud rate the line has no bit time and it fires straight away.
+     */
+    bit_ns = tm4c123_usart_bit_time_ns(s);
+    timer_mod(s->rx_timeout, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + 32 * bit_ns);
+    tm4c123_usart_update(s);
+}
+
+static void tm4c123_usart_rx_advance(TM4C123USARTState *s)
+{
+    uint64_t char_ns = tm4c123_usart_char_time_ns(s);
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    uint32_t landed;
+    uint32_t i;
+
+    if (!s->rx_line_count) {
+        return;
+    }
+
+    if (!char_ns) {
+        landed = s->rx_line_count;
+    } else if (now <= s->rx_line_start_ns) {
+        landed = 0;
+    } else {
+        landed = MIN((now - s->rx_line_start_ns) / char_ns, s->rx_line_count);
+    }
+
+    for (i = 0; i < landed; i++) {
+        tm4c123_usart_rx_store(s, s->rx_line[i]);
+    }
+
+    s->rx_line_count -= landed;
+    s->rx_line_start_ns += landed * char_ns;
+    memmove(s->rx_line, s->rx_line + landed, s->rx_line_count);
+    tm4c123_usart_rx_schedule(s);
+
+    if (landed) {
+        tm4c123_usart_rx_landed(s);
+    }
+}
+
+static void tm4c123_usart_rx_tick(void *opaque)
+{
+    tm4c123_usart_rx_advance(opaque);
+}
+
+static uint32_t tm4c123_usart_rx_pop(TM4C123USARTState *s)
+{
+    uint32_t c;
+
+    if (!s->rx_count) {
+        return s->usart_dr;
+    }
+
+    c = s->rx_fifo[s->rx_pos];
+    s->rx_pos = (s->rx_pos + 1) % USART_FIFO_DEPTH;
+    s->rx_count--;
+
+    if (s->rx_count < tm4c123_usart_rx_trigger(s)) {
+        s->usart_ris &= ~USART_INT_RX;
+    }
+    if (!s->rx_count) {
+        s->usart_ris &= ~USART_INT_RT;
+        timer_del(s->rx_timeout);
+    }
+    s->usart_rsr = (c >> 8) & 0xF;
+    tm4c123_usart_rx_schedule(s);
+    tm4c123_usart_update(s);
+    qemu_chr_fe_accept_input(&s->chr);
+    return c;
+}
+
+static void tm4c123_usart_rx_timeout(void *opaque)
+{
+    TM4C123USARTState *s = opaque;
+
+    if (s->rx_count) {
+        s->usart_ris |= USART_INT_RT;
+        tm4c123_usart_update(s);
     }
-    return false;
 }
 
+/* Bring both directions of the line up to the current virtual time */
+static void tm4c123_usart_sync(TM4C123USARTState *s)
+{
+    tm4c123_usart_rx_advance(s);
+    tm4c123_usart_tx_advance(s);
+    if (s->tx_done && !s->watch_tag) {
+        tm4c123_usart_xmit(NULL, G_IO_OUT, s);
+    }
+}
+
+/*
+ * The trigger levels changed: RX follows the new level, TX fires if the
+ * FIFO now sits at or below a level it was above before.
+ */
+static void tm4c123_usart_retrigger(TM4C123USARTState *s, uint32_t old_tx_trigger)
+{
+    uint32_t pending = tm4c123_usart_tx_pending(s);
+
+    if (s->rx_count >= tm4c123_usart_rx_trigger(s)) {
+        s->usart_ris |= USART_INT_RX;
+    } else {
+        s->usart_ris &= ~USART_INT_RX;
+    }
+    if (pending > tm4c123_usart_tx_trigger(s)) {
+        s->usart_ris &= ~USART_INT_TX;
+    } else if (pending > old_tx_trigger) {
+        s->usart_ris |= USART_INT_TX;
+    }
+    tm4c123_usart_rx_schedule(s);
+    tm4c123_usart_tx_schedule(s);
+    tm4c123_usart_update(s);
+}
+
+/*
+ * The frame time changed: restart whatever is currently on the line.
+ * Callers sync with the old timing before changing it.
+ */
+static void tm4c123_usart_retime(TM4C123USARTState *s)
+{
+    s->rx_line_start_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    tm4c123_usart_rx_schedule(s);
+    tm4c123_usart_tx_restart(s);
+}
 
 static int tm4c123_usart_can_receive(void *opaque)
 {
     TM4C123USARTState *s = opaque;
+    uint32_t depth = tm4c123_usart_fifo_depth(s);
+    uint32_t pending = s->rx_count + s->rx_line_count;
 
-    if (!(s->usart_fr & USART_FR_RXFF)) {
-        return 1;
+    if (!tm4c123_usart_rx_enabled(s)) {
+        return 0;
     }
-    return 0;
+    return pending < depth ? depth - pending : 0;
 }
 
 static void tm4c123_usart_receive(void *opaque, const uint8_t *buf, int size)
 {
     TM4C123USARTState *s = opaque;
+    uint32_t len;
 
-    if (!(s->usart_ctl & USART_CR_EN && s->usart_ctl & USART_CR_RXE)) {
+    if (!tm4c123_usart_rx_enabled(s)) {
         LOG(LOG_GUEST_ERROR, "The module is not enbled\n");
         return;
     }
 
-    s->usart_dr = *buf;
-    s->usart_ctl &= ~USART_FR_RXFE;
+    tm4c123_usart_rx_advance(s);
+    if (!s->rx_line_count) {
+        s->rx_line_start_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    }
+
+    len = MIN(size, USART_FIFO_DEPTH - s->rx_line_count);
+    memcpy(s->rx_line + s->rx_line_count, buf, len);
+    s->rx_line_count += len;
+
+    tm4c123_usart_rx_advance(s);
+    tm4c123_usart_rx_schedule(s);
+}
+
+/*
+ * Characters from a linked UART have already spent their frame time on
+ * the sender's side, so they go straight into the FIFO. Both ends are
+ * expected to use the same frame format; a mismatch is not garbled.
+ */
+static void tm4c123_usart_link_receive(TM4C123USARTState *s,
+                                       const uint8_t *buf, uint32_t len)
+{
+    uint32_t i;
+
+    if (!tm4c123_usart_rx_enabled(s)) {
+        return;
+    }
 
-    if (s->usart_im & USART_IM_RXIM) {
-        qemu_set_irq(s->irq, 1);
+    for (i = 0; i < len; i++) {
+        tm4c123_usart_rx_store(s, buf[i]);
     }
+    tm4c123_usart_rx_landed(s);
 }
 
 static void tm4c123_usart_reset(DeviceState *dev)
@@ -128,6 +599,19 @@ static void tm4c123_usart_reset(DeviceState *dev)
     s->usart_pcell_id2 = 0x00000005;
     s->usart_pcell_id3 = 0x000000B1;
 
+    s->rx_pos = 0;
+    s->rx_count = 0;
+    s->rx_line_count = 0;
+    s->tx_count = 0;
+    s->tx_done = 0;
+    timer_del(s->rx_timeout);
+    timer_del(s->rx_timer);
+    timer_del(s->tx_timer);
+    if (s->watch_tag) {
+        g_source_remove(s->watch_tag);
+        s->watch_tag = 0;
+    }
+
     qemu_set_irq(s->irq, 0);
 }
 
@@ -135,18 +619,17 @@ static uint64_t tm4c123_usart_read(void *opaque, hwaddr addr, unsigned int size)
 {
     TM4C123USARTState *s = opaque;
 
-    if (!usart_clock_enabled(s->sysctl, s->mmio.addr)) {
-        hw_error("USART module clock is not enabled");
-    }
-
     trace_tm4c123_usart_read(addr);
 
     switch (addr) {
         case USART_DR:
+            tm4c123_usart_sync(s);
+            s->usart_dr = tm4c123_usart_rx_pop(s);
             return s->usart_dr;
         case USART_RSR:
             return s->usart_rsr;
         case USART_FR:
+            tm4c123_usart_sync(s);
             return s->usart_fr;
         case USART_ILPR:
             return s->usart_ilpr;
@@ -163,8 +646,10 @@ static uint64_t tm4c123_usart_read(void *opaque, hwaddr addr, unsigned int size)
         case USART_IM:
             return s->usart_im;
         case USART_RIS:
+            tm4c123_usart_sync(s);
             return s->usart_ris;
         case USART_MIS:
+            tm4c123_usart_sync(s);
             return s->usart_mis;
         case USART_ICR:
             return s->usart_icr;
@@ -214,24 +699,17 @@ static void tm4c123_usart_write(void *opaque, hwaddr addr, uint64_t val64, unsig
 {
     TM4C123USARTState *s = opaque;
     uint32_t val32 = val64;
-    unsigned char ch;
-
-    if (!usart_clock_enabled(s->sysctl, s->mmio.addr)) {
-        hw_error("USART module clock is not enabled");
-    }
+    uint32_t tx_trigger;
 
     trace_tm4c123_usart_write(addr, val32);
 
     switch (addr) {
         case USART_DR:
-            s->usart_dr = val32;
-            if (val32 < 0xF000) {
-                ch = val32;
-                qemu_chr_fe_write_all(&s->chr, &ch, 1);
-            }
+            tm4c123_usart_tx_push(s, val32 & 0xFF);
             break;
         case USART_RSR:
-            s->usart_rsr = val32;
+            /* Any write clears the error flags */
+            s->usart_rsr = 0;
             break;
         case USART_FR:
             READONLY;
@@ -240,22 +718,47 @@ static void tm4c123_usart_write(void *opaque, hwaddr addr, uint64_t val64, unsig
             s->usart_ilpr = val32;
             break;
         case USART_IBRD:
+            tm4c123_usart_sync(s);
             s->usart_ibrd = val32;
+            tm4c123_usart_retime(s);
             break;
         case USART_FBRD:
+            tm4c123_usart_sync(s);
             s->usart_fbrd = val32;
+            tm4c123_usart_retime(s);
             break;
         case USART_LCRH:
+            tm4c123_usart_sync(s);
+            tx_trigger = tm4c123_usart_tx_trigger(s);
+            if ((s->usart_lcrh ^ val32) & USART_LCRH_FEN) {
+                /* Switching between FIFO and character mode flushes RX */
+                s->rx_pos = 0;
+                s->rx_count = 0;
+                timer_del(s->rx_timeout);
+            }
             s->usart_lcrh = val32;
+            tm4c123_usart_retime(s);
+            tm4c123_usart_retrigger(s, tx_trigger);
+            qemu_chr_fe_accept_input(&s->chr);
             break;
         case USART_CTL:
+            tm4c123_usart_sync(s);
+            tx_trigger = tm4c123_usart_tx_trigger(s);
             s->usart_ctl = val32;
+            tm4c123_usart_retime(s);
+            /* EOT moves the TX level */
+            tm4c123_usart_retrigger(s, tx_trigger);
+            qemu_chr_fe_accept_input(&s->chr);
             break;
         case USART_IFLS:
+            tm4c123_usart_sync(s);
+            tx_trigger = tm4c123_usart_tx_trigger(s);
             s->usart_ifls = val32;
+            tm4c123_usart_retrigger(s, tx_trigger);
             break;
         case USART_IM:
             s->usart_im = val32;
+            tm4c123_usart_update(s);
             break;
         case USART_RIS:
             READONLY;
@@ -265,9 +768,12 @@ static void tm4c123_usart_write(void *opaque, hwaddr addr, uint64_t val64, unsig
             break;
         case USART_ICR:
             s->usart_icr = val32;
+            s->usart_ris &= ~val32;
+            tm4c123_usart_update(s);
             break;
         case USART_DMA_CTL:
             s->usart_dma_ctl = val32;
+            tm4c123_usart_update(s);
             break;
         case USART_9BIT_ADDR:
             s->usart_9bit_addr = val32;
@@ -279,7 +785,9 @@ static void tm4c123_usart_write(void *opaque, hwaddr addr, uint64_t val64, unsig
             READONLY;
             break;
         case USART_CC:
+            tm4c123_usart_sync(s);
             s->usart_cc = val32;
+            tm4c123_usart_retime(s);
             break;
         case USART_PER_ID4:
             READONLY;
@@ -325,22 +833,70 @@ static void tm4c123_usart_write(void *opaque, hwaddr addr, uint64_t val64, unsig
     return;
 }
 
+/* Accesses with the module clock gated off answer with a bus fault */
+static MemTxResult tm4c123_usart_read_with_attrs(void *opaque, hwaddr addr, uint64_t *data,
+                                              unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123USARTState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "USART module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_usart_read(opaque, addr, size);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_usart_write_with_attrs(void *opaque, hwaddr addr, uint64_t val64,
+                                               unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123USARTState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "USART module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    tm4c123_usart_write(opaque, addr, val64, size);
+    return MEMTX_OK;
+}
+
 static const MemoryRegionOps tm4c123_usart_ops = {
-    .read = tm4c123_usart_read,
-    .write = tm4c123_usart_write,
+    .read_with_attrs = tm4c123_usart_read_with_attrs,
+    .write_with_attrs = tm4c123_usart_write_with_attrs,
     .endianness = DEVICE_NATIVE_ENDIAN,
 };
 
 static Property tm4c123_usart_properties[] = {
     DEFINE_PROP_CHR("chardev", TM4C123USARTState, chr),
+    DEFINE_PROP_BOOL("fast-timing", TM4C123USARTState, fast_timing, false),
     DEFINE_PROP_END_OF_LIST(),
 };
 
+/* Characters already on the line finish at the old rate, the rest at the new one */
+static void tm4c123_usart_clock_update(void *opaque, ClockEvent event)
+{
+    TM4C123USARTState *s = opaque;
+
+    if (event == ClockPreUpdate) {
+        tm4c123_usart_sync(s);
+    } else {
+        tm4c123_usart_retime(s);
+    }
+}
+
 static void tm4c123_usart_init(Object *obj)
 {
     TM4C123USARTState *s = TM4C123_USART(obj);
 
+    s->clk = qdev_init_clock_in(DEVICE(s), "usart_clock", tm4c123_usart_clock_update, s,
+                                ClockPreUpdate | ClockUpdate);
+    s->rx_timeout = timer_new_ns(QEMU_CLOCK_VIRTUAL, tm4c123_usart_rx_timeout, s);
+    s->rx_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, tm4c123_usart_rx_tick, s);
+    s->tx_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, tm4c123_usart_tx_tick, s);
+
     sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    qdev_init_gpio_out_named(DEVICE(obj), s->dma_req, "dma-req", 2);
+    qdev_init_gpio_out_named(DEVICE(obj), s->dma_sreq, "dma-sreq", 2);
 
     memory_region_init_io(&s->mmio, obj, &tm4c123_usart_ops, s,
             TYPE_TM4C123_USART, 0xFFF);
@@ -351,16 +907,90 @@ static void tm4c123_usart_realize(DeviceState *dev, Error **errp)
 {
     TM4C123USARTState *s = TM4C123_USART(dev);
 
+    s->tx_bh = qemu_bh_new_guarded(tm4c123_usart_tx_bh, s, &dev->mem_reentrancy_guard);
+
     qemu_chr_fe_set_handlers(&s->chr, tm4c123_usart_can_receive,
             tm4c123_usart_receive, NULL, NULL,
             s, NULL, true);
 }
 
+static int tm4c123_usart_post_load(void *opaque, int version_id)
+{
+    TM4C123USARTState *s = opaque;
+
+    if (s->rx_pos >= USART_FIFO_DEPTH || s->rx_count > USART_FIFO_DEPTH ||
+        s->tx_count > USART_FIFO_DEPTH || s->tx_done > s->tx_count ||
+        s->rx_line_count > USART_FIFO_DEPTH) {
+        return -1;
+    }
+
+    /* The chardev watch is not migrated, restart the TX drain */
+    if (s->tx_count) {
+        qemu_bh_schedule(s->tx_bh);
+    }
+    return 0;
+}
+
+static const VMStateDescription vmstate_tm4c123_usart = {
+    .name = TYPE_TM4C123_USART,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = tm4c123_usart_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(usart_dr, TM4C123USARTState),
+        VMSTATE_UINT32(usart_rsr, TM4C123USARTState),
+        VMSTATE_UINT32(usart_fr, TM4C123USARTState),
+        VMSTATE_UINT32(usart_ilpr, TM4C123USARTState),
+        VMSTATE_UINT32(usart_ibrd, TM4C123USARTState),
+        VMSTATE_UINT32(usart_fbrd, TM4C123USARTState),
+        VMSTATE_UINT32(usart_lcrh, TM4C123USARTState),
+        VMSTATE_UINT32(usart_ctl, TM4C123USARTState),
+        VMSTATE_UINT32(usart_ifls, TM4C123USARTState),
+        VMSTATE_UINT32(usart_im, TM4C123USARTState),
+        VMSTATE_UINT32(usart_ris, TM4C123USARTState),
+        VMSTATE_UINT32(usart_mis, TM4C123USARTState),
+        VMSTATE_UINT32(usart_icr, TM4C123USARTState),
+        VMSTATE_UINT32(usart_dma_ctl, TM4C123USARTState),
+        VMSTATE_UINT32(usart_9bit_addr, TM4C123USARTState),
+        VMSTATE_UINT32(usart_9bit_mask, TM4C123USARTState),
+        VMSTATE_UINT32(usart_pp, TM4C123USARTState),
+        VMSTATE_UINT32(usart_cc, TM4C123USARTState),
+        VMSTATE_UINT32(usart_per_id4, TM4C123USARTState),
+        VMSTATE_UINT32(usart_per_id5, TM4C123USARTState),
+        VMSTATE_UINT32(usart_per_id6, TM4C123USARTState),
+        VMSTATE_UINT32(usart_per_id7, TM4C123USARTState),
+        VMSTATE_UINT32(usart_per_id0, TM4C123USARTState),
+        VMSTATE_UINT32(usart_per_id1, TM4C123USARTState),
+        VMSTATE_UINT32(usart_per_id2, TM4C123USARTState),
+        VMSTATE_UINT32(usart_per_id3, TM4C123USARTState),
+        VMSTATE_UINT32(usart_pcell_id0, TM4C123USARTState),
+        VMSTATE_UINT32(usart_pcell_id1, TM4C123USARTState),
+        VMSTATE_UINT32(usart_pcell_id2, TM4C123USARTState),
+        VMSTATE_UINT32(usart_pcell_id3, TM4C123USARTState),
+        VMSTATE_UINT16_ARRAY(rx_fifo, TM4C123USARTState, USART_FIFO_DEPTH),
+        VMSTATE_UINT32(rx_pos, TM4C123USARTState),
+        VMSTATE_UINT32(rx_count, TM4C123USARTState),
+        VMSTATE_UINT8_ARRAY(tx_fifo, TM4C123USARTState, USART_FIFO_DEPTH),
+        VMSTATE_UINT32(tx_count, TM4C123USARTState),
+        VMSTATE_UINT8_ARRAY(rx_line, TM4C123USARTState, USART_FIFO_DEPTH),
+        VMSTATE_UINT32(rx_line_count, TM4C123USARTState),
+        VMSTATE_INT64(rx_line_start_ns, TM4C123USARTState),
+        VMSTATE_UINT32(tx_done, TM4C123USARTState),
+        VMSTATE_INT64(tx_start_ns, TM4C123USARTState),
+        VMSTATE_TIMER_PTR(tx_timer, TM4C123USARTState),
+        VMSTATE_TIMER_PTR(rx_timer, TM4C123USARTState),
+        VMSTATE_TIMER_PTR(rx_timeout, TM4C123USARTState),
+        VMSTATE_CLOCK(clk, TM4C123USARTState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
 static void tm4c123_usart_class_init(ObjectClass *klass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(klass);
 
     dc->reset = tm4c123_usart_reset;
+    dc->vmsd = &vmstate_tm4c123_usart;
     device_class_set_props(dc, tm4c123_usart_properties);
     dc->realize = tm4c123_usart_realize;
 }
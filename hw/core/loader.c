@@ -1247,57 +1247,73 @@ ssize_t rom_add_option(const char *file, int32_t bootindex)
     return rom_add_file(file, "genroms", 0, bootindex, true, NULL, NULL);
 }
 
+static void rom_reset_one(Rom *rom)
+{
+    if (rom->fw_file) {
+        return;
+    }
+    /*
+     * We don't need to fill in the RAM with ROM data because we'll fill
+     * the data in during the next incoming migration in all cases.  Note
+     * that some of those RAMs can actually be modified by the guest.
+     */
+    if (runstate_check(RUN_STATE_INMIGRATE)) {
+        if (rom->data && rom->isrom) {
+            /*
+             * Free it so that a rom_reset after migration doesn't
+             * overwrite a potentially modified 'rom'.
+             */
+            rom_free_data(rom);
+        }
+        return;
+    }
+
+    if (rom->data == NULL) {
+        return;
+    }
+    if (rom->mr) {
+        void *host = memory_region_get_ram_ptr(rom->mr);
+        memcpy(host, rom->data, rom->datasize);
+        memset(host + rom->datasize, 0, rom->romsize - rom->datasize);
+    } else {
+        address_space_write_rom(rom->as, rom->addr, MEMTXATTRS_UNSPECIFIED,
+                                rom->data, rom->datasize);
+        address_space_set(rom->as, rom->addr + rom->datasize, 0,
+                          rom->romsize - rom->datasize,
+                          MEMTXATTRS_UNSPECIFIED);
+    }
+    if (rom->isrom) {
+        /* rom needs to be written only once */
+        rom_free_data(rom);
+    }
+    /*
+     * The rom loader is really on the same level as firmware in the guest
+     * shadowing a ROM into RAM. Such a shadowing mechanism needs to ensure
+     * that the instruction cache for that new region is clear, so that the
+     * CPU definitely fetches its instructions from the just written data.
+     */
+    cpu_flush_icache_range(rom->addr, rom->datasize);
+
+    trace_loader_write_rom(rom->name, rom->addr, rom->datasize, rom->isrom);
+}
+
 static void rom_reset(void *unused)
 {
     Rom *rom;
 
     QTAILQ_FOREACH(rom, &roms, next) {
-        if (rom->fw_file) {
-            continue;
-        }
-        /*
-         * We don't need to fill in the RAM with ROM data because we'll fill
-         * the data in during the next incoming migration in all cases.  Note
-         * that some of those RAMs can actually be modified by the guest.
-         */
-        if (runstate_check(RUN_STATE_INMIGRATE)) {
-            if (rom->data && rom->isrom) {
-                /*
-                 * Free it so that a rom_reset after migration doesn't
-                 * overwrite a potentially modified 'rom'.
-                 */
-                rom_free_data(rom);
-            }
-            continue;
-        }
+        rom_reset_one(rom);
+    }
+}
 
-        if (rom->data == NULL) {
-            continue;
-        }
-        if (rom->mr) {
-            void *host = memory_region_get_ram_ptr(rom->mr);
-            memcpy(host, rom->data, rom->datasize);
-            memset(host + rom->datasize, 0, rom->romsize - rom->datasize);
-        } else {
-            address_space_write_rom(rom->as, rom->addr, MEMTXATTRS_UNSPECIFIED,
-                                    rom->data, rom->datasize);
-            address_space_set(rom->as, rom->addr + rom->datasize, 0,
-                              rom->romsize - rom->datasize,
-                              MEMTXATTRS_UNSPECIFIED);
-        }
-        if (rom->isrom) {
-            /* rom needs to be written only once */
-            rom_free_data(rom);
+void rom_reset_address_space(AddressSpace *as)
+{
+    Rom *rom;
+
+    QTAILQ_FOREACH(rom, &roms, next) {
+        if (rom->as == as) {
+            rom_reset_one(rom);
         }
-        /*
-         * The rom loader is really on the same level as firmware in the guest
-         * shadowing a ROM into RAM. Such a shadowing mechanism needs to ensure
-         * that the instruction cache for that new region is clear, so that the
-         * CPU definitely fetches its instructions from the just written data.
-         */
-        cpu_flush_icache_range(rom->addr, rom->datasize);
-
-        trace_loader_write_rom(rom->name, rom->addr, rom->datasize, rom->isrom);
     }
 }
 
@@ -0,0 +1,781 @@
+/*
+ * TM4C123 uDMA
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "hw/dma/tm4c123_udma.h"
+#include "hw/irq.h"
+#include "hw/qdev-clock.h"
+#include "hw/qdev-properties.h"
+#include "qapi/error.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "qemu/bitops.h"
+#include "qemu/timer.h"
+#include "qemu/main-loop.h"
+#include "exec/address-spaces.h"
+#include "migration/vmstate.h"
+#include "trace.h"
+
+#define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
+#define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
+
+/* Bus cycles for one item: a read and a write */
+#define UDMA_ITEM_CYCLES 2
+/* Arbitrations one bottom half runs before letting the rest of QEMU in */
+#define UDMA_ARB_BUDGET 1024
+
+/* Items moved through a bounce buffer when a side is not RAM */
+#define UDMA_BOUNCE_SIZE 256
+
+typedef struct {
+    uint32_t src_end;
+    uint32_t dst_end;
+    uint32_t ctl;
+} UDMAEntry;
+
+static int udma_chmap(TM4C123UDMAState *s, int ch)
+{
+    return extract32(s->udma_chmap[ch / 8], (ch % 8) * 4, 4);
+}
+
+static hwaddr udma_entry_addr(TM4C123UDMAState *s, int ch, bool alt)
+{
+    return (s->udma_ctlbase & UDMA_CTLBASE_MASK) + (alt ? UDMA_ALT_OFFSET : 0) +
+           ch * UDMA_ENTRY_SIZE;
+}
+
+static MemTxResult udma_load_entry(TM4C123UDMAState *s, hwaddr addr, UDMAEntry *e)
+{
+    uint32_t buf[3];
+    MemTxResult r;
+
+    r = address_space_read(&s->as, addr, MEMTXATTRS_UNSPECIFIED, buf, sizeof(buf));
+    e->src_end = le32_to_cpu(buf[0]);
+    e->dst_end = le32_to_cpu(buf[1]);
+    e->ctl = le32_to_cpu(buf[2]);
+    return r;
+}
+
+static MemTxResult udma_store_ctl(TM4C123UDMAState *s, hwaddr addr, uint32_t ctl)
+{
+    uint32_t buf = cpu_to_le32(ctl);
+
+    return address_space_write(&s->as, addr + UDMA_ENTRY_CHCTL, MEMTXATTRS_UNSPECIFIED,
+                               &buf, sizeof(buf));
+}
+
+static inline uint32_t udma_ctl_mode(uint32_t ctl)
+{
+    return extract32(ctl, 0, 3);
+}
+
+/* Items left, XFERSIZE + 1 */
+static inline uint32_t udma_ctl_remaining(uint32_t ctl)
+{
+    return extract32(ctl, 4, 10) + 1;
+}
+
+static inline uint32_t udma_ctl_arbsize(uint32_t ctl)
+{
+    return 1 << extract32(ctl, 14, 4);
+}
+
+/* Address increment of one side in bytes, 0 for a fixed address */
+static inline uint32_t udma_inc(uint32_t inc)
+{
+    return inc == UDMA_INC_NONE ? 0 : 1 << inc;
+}
+
+/*
+ * Move a contiguous block. The source is mapped where it is RAM, so
+ * a memory to memory transfer is one host copy into the destination.
+ */
+static MemTxResult udma_copy_block(TM4C123UDMAState *s, hwaddr src, hwaddr dst, hwaddr len)
+{
+    MemTxAttrs attrs = MEMTXATTRS_UNSPECIFIED;
+    uint8_t bounce[UDMA_BOUNCE_SIZE];
+    MemTxResult r;
+
+    while (len) {
+        hwaddr plen = len;
+        void *p = address_space_map(&s->as, src, &plen, false, attrs);
+
+        if (p) {
+            r = address_space_write(&s->as, dst, attrs, p, plen);
+            address_space_unmap(&s->as, p, plen, false, plen);
+        } else {
+            plen = MIN(len, sizeof(bounce));
+            r = address_space_read(&s->as, src, attrs, bounce, plen);
+            if (r == MEMTX_OK) {
+                r = address_space_write(&s->as, dst, attrs, bounce, plen);
+            }
+        }
+        if (r != MEMTX_OK) {
+            return r;
+        }
+        src += plen;
+        dst += plen;
+        len -= plen;
+    }
+    return MEMTX_OK;
+}
+
+/*
+ * Transfer @count items of the structure @e, starting at the first item
+ * still to go. A FIFO on either side gets one access per item.
+ */
+static MemTxResult udma_copy(TM4C123UDMAState *s, UDMAEntry *e, uint32_t count)
+{
+    MemTxAttrs attrs = MEMTXATTRS_UNSPECIFIED;
+    uint32_t remaining = udma_ctl_remaining(e->ctl);
+    uint32_t size = 1 << extract32(e->ctl, 24, 2);
+    uint32_t sinc = udma_inc(extract32(e->ctl, 26, 2));
+    uint32_t dinc = udma_inc(extract32(e->ctl, 30, 2));
+    hwaddr src = e->src_end - (remaining - 1) * sinc;
+    hwaddr dst = e->dst_end - (remaining - 1) * dinc;
+    MemTxResult r;
+    uint32_t buf;
+    uint32_t i;
+
+    if (extract32(e->ctl, 24, 2) != extract32(e->ctl, 28, 2)) {
+        LOG(LOG_GUEST_ERROR, "SRCSIZE and DSTSIZE differ, using SRCSIZE\n");
+    }
+
+    if (sinc == size && dinc == size) {
+        return udma_copy_block(s, src, dst, (hwaddr)count * size);
+    }
+
+    for (i = 0; i < count; i++) {
+        r = address_space_read(&s->as, src, attrs, &buf, size);
+        if (r == MEMTX_OK) {
+            r = address_space_write(&s->as, dst, attrs, &buf, size);
+        }
+        if (r != MEMTX_OK) {
+            return r;
+        }
+        src += sinc;
+        dst += dinc;
+    }
+    return MEMTX_OK;
+}
+
+static void udma_update(TM4C123UDMAState *s)
+{
+    qemu_set_irq(s->irq_sw, (s->udma_chis & s->sw_channels) != 0);
+    qemu_set_irq(s->irq_err, s->udma_err != 0);
+}
+
+/* A software channel raises the uDMA software interrupt, a peripheral channel its owner's */
+static void udma_finish(TM4C123UDMAState *s, int ch)
+{
+    int enc = udma_chmap(s, ch);
+
+    trace_tm4c123_udma_done(ch);
+
+    if (s->done_last & BIT(ch)) {
+        s->udma_ena &= ~BIT(ch);
+    }
+    s->udma_chis |= BIT(ch);
+    if (!(s->sw_channels & BIT(ch)) && enc < UDMA_ENCODINGS) {
+        qemu_irq_pulse(s->done[UDMA_REQ_LINE(ch, enc)]);
+    }
+    udma_update(s);
+}
+
+static void udma_schedule_done(TM4C123UDMAState *s)
+{
+    int64_t next = INT64_MAX;
+    int ch;
+
+    for (ch = 0; ch < UDMA_CHANNELS; ch++) {
+        if (s->done_pending & BIT(ch)) {
+            next = MIN(next, s->done_ns[ch]);
+        }
+    }
+    if (next == INT64_MAX) {
+        timer_del(s->done_timer);
+    } else {
+        timer_mod(s->done_timer, next);
+    }
+}
+
+static void udma_done_tick(void *opaque)
+{
+    TM4C123UDMAState *s = opaque;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    int ch;
+
+    for (ch = 0; ch < UDMA_CHANNELS; ch++) {
+        if ((s->done_pending & BIT(ch)) && s->done_ns[ch] <= now) {
+            s->done_pending &= ~BIT(ch);
+            udma_finish(s, ch);
+        }
+    }
+    udma_schedule_done(s);
+}
+
+/*
+ * The data has already moved; with the "accurate" timing the completion
+ * is signalled once the bus would have carried @items items.
+ */
+static void udma_complete(TM4C123UDMAState *s, int ch, uint32_t items, bool last)
+{
+    s->done_last = deposit32(s->done_last, ch, 1, last);
+    if (s->fast_timing || !clock_is_enabled(s->clk)) {
+        udma_finish(s, ch);
+        return;
+    }
+    s->done_ns[ch] = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) +
+                     clock_ticks_to_ns(s->clk, (uint64_t)items * UDMA_ITEM_CYCLES);
+    s->done_pending |= BIT(ch);
+    udma_schedule_done(s);
+}
+
+static void udma_error(TM4C123UDMAState *s, int ch)
+{
+    LOG(LOG_GUEST_ERROR, "bus error on channel %d\n", ch);
+    s->udma_ena &= ~BIT(ch);
+    s->udma_err = 1;
+    udma_update(s);
+}
+
+/* Modes whose structure runs to the end on a single request */
+static bool udma_mode_auto(uint32_t mode)
+{
+    return mode == UDMA_MODE_AUTO || mode == UDMA_MODE_MEM_SG ||
+           mode == UDMA_MODE_MEM_SG_ALT;
+}
+
+/*
+ * Serve one request of channel @ch: @budget items for a burst or a
+ * software request, 1 for a single request. Auto and memory
+ * scatter-gather structures ignore the budget and run to the end. The
+ * control word is written back after each structure run, as the
+ * controller does at the end of every arbitration.
+ */
+static void udma_run(TM4C123UDMAState *s, int ch, uint32_t budget)
+{
+    uint32_t items = 0;
+    UDMAEntry e;
+
+    for (;;) {
+        bool alt = s->udma_alt & BIT(ch);
+        hwaddr addr = udma_entry_addr(s, ch, alt);
+        uint32_t mode;
+        uint32_t remaining;
+        uint32_t count;
+
+        if (udma_load_entry(s, addr, &e) != MEMTX_OK) {
+            udma_error(s, ch);
+            return;
+        }
+        mode = udma_ctl_mode(e.ctl);
+        remaining = udma_ctl_remaining(e.ctl);
+        trace_tm4c123_udma_run(ch, alt, mode, remaining);
+
+        if (mode == UDMA_MODE_STOP) {
+            /* Also where a ping-pong or scatter-gather sequence ends */
+            if (!(s->done_pending & BIT(ch))) {
+                s->udma_ena &= ~BIT(ch);
+            }
+            return;
+        }
+
+        if (!alt && (mode == UDMA_MODE_MEM_SG || mode == UDMA_MODE_PER_SG)) {
+            /* Primary: copy the next task (4 words) into the alternate structure */
+            count = MIN(remaining, 4);
+        } else if (udma_mode_auto(mode)) {
+            count = remaining;
+        } else {
+            if (!budget) {
+                return;
+            }
+            count = MIN(remaining, budget);
+            budget = 0;
+        }
+
+        if (udma_copy(s, &e, count) != MEMTX_OK) {
+            udma_error(s, ch);
+            return;
+        }
+        items += count;
+        remaining -= count;
+        if (remaining) {
+            e.ctl = deposit32(e.ctl, 4, 10, remaining - 1);
+        } else {
+            e.ctl = deposit32(e.ctl, 0, 14, UDMA_MODE_STOP);
+        }
+        if (udma_store_ctl(s, addr, e.ctl) != MEMTX_OK) {
+            udma_error(s, ch);
+            return;
+        }
+
+        if (!alt && (mode == UDMA_MODE_MEM_SG || mode == UDMA_MODE_PER_SG)) {
+            s->udma_alt |= BIT(ch);
+            continue;
+        }
+        if (remaining) {
+            /* Wait for the next request */
+            return;
+        }
+
+        switch (mode) {
+            case UDMA_MODE_PINGPONG:
+                /* The other structure takes over, the CPU refills this one */
+                s->udma_alt ^= BIT(ch);
+                udma_complete(s, ch, items, false);
+                return;
+            case UDMA_MODE_MEM_SG_ALT:
+            case UDMA_MODE_PER_SG_ALT:
+                /* Back to the primary structure for the next task */
+                s->udma_alt &= ~BIT(ch);
+                continue;
+            default:
+                udma_complete(s, ch, items, true);
+                return;
+        }
+    }
+}
+
+/* Burst (or software) request, single request, or none */
+static uint32_t udma_request_budget(TM4C123UDMAState *s, int ch)
+{
+    int enc = udma_chmap(s, ch);
+    bool burst = s->burst_pending & BIT(ch);
+    bool single = s->single_pending & BIT(ch);
+    UDMAEntry e;
+
+    if (enc < UDMA_ENCODINGS && !(s->udma_reqmask & BIT(ch))) {
+        burst |= s->burst_level[enc] & BIT(ch);
+        single |= s->single_level[enc] & BIT(ch);
+    }
+    if (s->udma_useburst & BIT(ch)) {
+        single = false;
+    }
+    if (!(s->sw_pending & BIT(ch)) && !burst && !single) {
+        return 0;
+    }
+    if (!(s->sw_pending & BIT(ch)) && !burst) {
+        return 1;
+    }
+    if (udma_load_entry(s, udma_entry_addr(s, ch, s->udma_alt & BIT(ch)), &e) != MEMTX_OK) {
+        return 1;
+    }
+    return udma_ctl_arbsize(e.ctl);
+}
+
+/* Highest priority channel with a request: PRIOSET channels first, then the lowest number */
+static int udma_next_channel(TM4C123UDMAState *s, uint32_t *budget)
+{
+    uint32_t ready = 0;
+    uint32_t budgets[UDMA_CHANNELS];
+    int ch;
+
+    for (ch = 0; ch < UDMA_CHANNELS; ch++) {
+        if (!(s->udma_ena & BIT(ch)) || (s->done_pending & BIT(ch))) {
+            continue;
+        }
+        budgets[ch] = udma_request_budget(s, ch);
+        if (budgets[ch]) {
+            ready |= BIT(ch);
+        }
+    }
+    if (!ready) {
+        return -1;
+    }
+    ch = ctz32((ready & s->udma_prio) ? ready & s->udma_prio : ready);
+    *budget = budgets[ch];
+    return ch;
+}
+
+static void udma_service(TM4C123UDMAState *s)
+{
+    uint32_t budget;
+    int arbitrations;
+    int ch;
+
+    if (!(s->udma_cfg & UDMA_CFG_MASTEN) || !clock_is_enabled(s->clk)) {
+        return;
+    }
+
+    for (arbitrations = 0; arbitrations < UDMA_ARB_BUDGET; arbitrations++) {
+        ch = udma_next_channel(s, &budget);
+        if (ch < 0) {
+            return;
+        }
+        if (!(s->sw_pending & BIT(ch))) {
+            s->sw_channels &= ~BIT(ch);
+        } else {
+            s->sw_channels |= BIT(ch);
+        }
+        s->sw_pending &= ~BIT(ch);
+        s->burst_pending &= ~BIT(ch);
+        s->single_pending &= ~BIT(ch);
+        udma_run(s, ch, budget);
+    }
+    /* Requests still standing; carry on once the rest of the machine had a go */
+    qemu_bh_schedule(s->bh);
+}
+
+static void udma_bh(void *opaque)
+{
+    udma_service(opaque);
+}
+
+/*
+ * A rising edge from the peripheral the channel is mapped to is latched,
+ * so a pulse still gets its arbitration. The requests are served from a
+ * bottom half, outside the peripheral's own register access.
+ */
+static void udma_set_request(TM4C123UDMAState *s, uint32_t *level, uint32_t *pending,
+                             int line, int value)
+{
+    int ch = line / UDMA_ENCODINGS;
+    int enc = line % UDMA_ENCODINGS;
+    bool was = extract32(level[enc], ch, 1);
+
+    level[enc] = deposit32(level[enc], ch, 1, value != 0);
+    if (value && !was && udma_chmap(s, ch) == enc) {
+        *pending |= BIT(ch);
+        qemu_bh_schedule(s->bh);
+    }
+}
+
+static void udma_burst_request(void *opaque, int line, int value)
+{
+    TM4C123UDMAState *s = opaque;
+
+    udma_set_request(s, s->burst_level, &s->burst_pending, line, value);
+}
+
+static void udma_single_request(void *opaque, int line, int value)
+{
+    TM4C123UDMAState *s = opaque;
+
+    udma_set_request(s, s->single_level, &s->single_pending, line, value);
+}
+
+static void tm4c123_udma_reset(DeviceState *dev)
+{
+    TM4C123UDMAState *s = TM4C123_UDMA(dev);
+
+    s->udma_cfg = 0;
+    s->udma_ctlbase = 0;
+    s->udma_useburst = 0;
+    s->udma_reqmask = 0;
+    s->udma_ena = 0;
+    s->udma_alt = 0;
+    s->udma_prio = 0;
+    s->udma_err = 0;
+    s->udma_chasgn = 0;
+    s->udma_chis = 0;
+    memset(s->udma_chmap, 0, sizeof(s->udma_chmap));
+    s->sw_pending = 0;
+    s->burst_pending = 0;
+    s->single_pending = 0;
+    s->sw_channels = 0;
+    s->done_pending = 0;
+    s->done_last = 0;
+    timer_del(s->done_timer);
+    udma_update(s);
+}
+
+static uint64_t tm4c123_udma_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    TM4C123UDMAState *s = opaque;
+
+    trace_tm4c123_udma_read(addr);
+
+    switch (addr) {
+        case UDMA_STAT:
+            return (s->udma_cfg & UDMA_CFG_MASTEN) | ((UDMA_CHANNELS - 1) << 16);
+        case UDMA_CTLBASE:
+            return s->udma_ctlbase;
+        case UDMA_ALTBASE:
+            return s->udma_ctlbase + UDMA_ALT_OFFSET;
+        case UDMA_WAITSTAT:
+            return 0x03C3CF00;
+        case UDMA_USEBURSTSET:
+            return s->udma_useburst;
+        case UDMA_REQMASKSET:
+            return s->udma_reqmask;
+        case UDMA_ENASET:
+            return s->udma_ena;
+        case UDMA_ALTSET:
+            return s->udma_alt;
+        case UDMA_PRIOSET:
+            return s->udma_prio;
+        case UDMA_ERRCLR:
+            return s->udma_err;
+        case UDMA_CHASGN:
+            return s->udma_chasgn;
+        case UDMA_CHIS:
+            return s->udma_chis;
+        case UDMA_CHMAP0:
+        case UDMA_CHMAP1:
+        case UDMA_CHMAP2:
+        case UDMA_CHMAP3:
+            return s->udma_chmap[(addr - UDMA_CHMAP0) / 4];
+        case UDMA_PER_ID4:
+            return 0x04;
+        case UDMA_PER_ID0:
+            return 0x30;
+        case UDMA_PER_ID1:
+            return 0xB2;
+        case UDMA_PER_ID2:
+            return 0x0B;
+        case UDMA_PER_ID3:
+            return 0x00;
+        case UDMA_PCELL_ID0:
+            return 0x0D;
+        case UDMA_PCELL_ID1:
+            return 0xF0;
+        case UDMA_PCELL_ID2:
+            return 0x05;
+        case UDMA_PCELL_ID3:
+            return 0xB1;
+        case UDMA_CFG:
+        case UDMA_SWREQ:
+        case UDMA_USEBURSTCLR:
+        case UDMA_REQMASKCLR:
+        case UDMA_ENACLR:
+        case UDMA_ALTCLR:
+        case UDMA_PRIOCLR:
+            LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a writeonly field\n", addr);
+            break;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+    }
+    return 0;
+}
+
+static void tm4c123_udma_write(void *opaque, hwaddr addr, uint64_t val64, unsigned int size)
+{
+    TM4C123UDMAState *s = opaque;
+    uint32_t val32 = val64;
+
+    trace_tm4c123_udma_write(addr, val32);
+
+    switch (addr) {
+        case UDMA_CFG:
+            s->udma_cfg = val32 & UDMA_CFG_MASTEN;
+            break;
+        case UDMA_CTLBASE:
+            s->udma_ctlbase = val32 & UDMA_CTLBASE_MASK;
+            break;
+        case UDMA_SWREQ:
+            /* Served right away, so an auto transfer is done when the write returns */
+            s->sw_pending |= val32 & s->udma_ena;
+            udma_service(s);
+            return;
+        case UDMA_USEBURSTSET:
+            s->udma_useburst |= val32;
+            break;
+        case UDMA_USEBURSTCLR:
+            s->udma_useburst &= ~val32;
+            break;
+        case UDMA_REQMASKSET:
+            s->udma_reqmask |= val32;
+            break;
+        case UDMA_REQMASKCLR:
+            s->udma_reqmask &= ~val32;
+            break;
+        case UDMA_ENASET:
+            s->udma_ena |= val32;
+            break;
+        case UDMA_ENACLR:
+            s->udma_ena &= ~val32;
+            break;
+        case UDMA_ALTSET:
+            s->udma_alt |= val32;
+            break;
+        case UDMA_ALTCLR:
+            s->udma_alt &= ~val32;
+            break;
+        case UDMA_PRIOSET:
+            s->udma_prio |= val32;
+            break;
+        case UDMA_PRIOCLR:
+            s->udma_prio &= ~val32;
+            break;
+        case UDMA_ERRCLR:
+            if (val32 & 1) {
+                s->udma_err = 0;
+            }
+            break;
+        case UDMA_CHASGN:
+            s->udma_chasgn = val32;
+            break;
+        case UDMA_CHIS:
+            s->udma_chis &= ~val32;
+            break;
+        case UDMA_CHMAP0:
+        case UDMA_CHMAP1:
+        case UDMA_CHMAP2:
+        case UDMA_CHMAP3:
+            s->udma_chmap[(addr - UDMA_CHMAP0) / 4] = val32;
+            break;
+        case UDMA_STAT:
+        case UDMA_ALTBASE:
+        case UDMA_WAITSTAT:
+        case UDMA_PER_ID4:
+        case UDMA_PER_ID0:
+        case UDMA_PER_ID1:
+        case UDMA_PER_ID2:
+        case UDMA_PER_ID3:
+        case UDMA_PCELL_ID0:
+        case UDMA_PCELL_ID1:
+        case UDMA_PCELL_ID2:
+        case UDMA_PCELL_ID3:
+            READONLY;
+            return;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return;
+    }
+    udma_update(s);
+    /* Enabling or unmasking a channel may let a standing request through */
+    qemu_bh_schedule(s->bh);
+}
+
+/* Accesses with the module clock gated off answer with a bus fault */
+static MemTxResult tm4c123_udma_read_with_attrs(void *opaque, hwaddr addr, uint64_t *data,
+                                                unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123UDMAState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "uDMA module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_udma_read(opaque, addr, size);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_udma_write_with_attrs(void *opaque, hwaddr addr, uint64_t val64,
+                                                 unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123UDMAState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "uDMA module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    tm4c123_udma_write(opaque, addr, val64, size);
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps tm4c123_udma_ops = {
+    .read_with_attrs = tm4c123_udma_read_with_attrs,
+    .write_with_attrs = tm4c123_udma_write_with_attrs,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static Property tm4c123_udma_properties[] = {
+    DEFINE_PROP_BOOL("fast-timing", TM4C123UDMAState, fast_timing, false),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void tm4c123_udma_init(Object *obj)
+{
+    TM4C123UDMAState *s = TM4C123_UDMA(obj);
+
+    s->clk = qdev_init_clock_in(DEVICE(s), "udma_clock", NULL, NULL, 0);
+    s->done_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, udma_done_tick, s);
+
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq_sw);
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq_err);
+    qdev_init_gpio_in_named(DEVICE(obj), udma_burst_request, "req", UDMA_REQ_LINES);
+    qdev_init_gpio_in_named(DEVICE(obj), udma_single_request, "sreq", UDMA_REQ_LINES);
+    qdev_init_gpio_out_named(DEVICE(obj), s->done, "done", UDMA_REQ_LINES);
+    memory_region_init_io(&s->mmio, obj, &tm4c123_udma_ops, s, TYPE_TM4C123_UDMA, 0xFFF);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
+}
+
+static void tm4c123_udma_realize(DeviceState *dev, Error **errp)
+{
+    TM4C123UDMAState *s = TM4C123_UDMA(dev);
+
+    if (!s->downstream) {
+        error_setg(errp, "uDMA needs a memory region to master");
+        return;
+    }
+    address_space_init(&s->as, s->downstream, TYPE_TM4C123_UDMA);
+    s->bh = qemu_bh_new_guarded(udma_bh, s, &dev->mem_reentrancy_guard);
+}
+
+static const VMStateDescription vmstate_tm4c123_udma = {
+    .name = TYPE_TM4C123_UDMA,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(udma_cfg, TM4C123UDMAState),
+        VMSTATE_UINT32(udma_ctlbase, TM4C123UDMAState),
+        VMSTATE_UINT32(udma_useburst, TM4C123UDMAState),
+        VMSTATE_UINT32(udma_reqmask, TM4C123UDMAState),
+        VMSTATE_UINT32(udma_ena, TM4C123UDMAState),
+        VMSTATE_UINT32(udma_alt, TM4C123UDMAState),
+        VMSTATE_UINT32(udma_prio, TM4C123UDMAState),
+        VMSTATE_UINT32(udma_err, TM4C123UDMAState),
+        VMSTATE_UINT32(udma_chasgn, TM4C123UDMAState),
+        VMSTATE_UINT32(udma_chis, TM4C123UDMAState),
+        VMSTATE_UINT32_ARRAY(udma_chmap, TM4C123UDMAState, 4),
+        VMSTATE_UINT32(sw_pending, TM4C123UDMAState),
+        VMSTATE_UINT32(burst_pending, TM4C123UDMAState),
+        VMSTATE_UINT32(single_pending, TM4C123UDMAState),
+        VMSTATE_UINT32_ARRAY(burst_level, TM4C123UDMAState, UDMA_ENCODINGS),
+        VMSTATE_UINT32_ARRAY(single_level, TM4C123UDMAState, UDMA_ENCODINGS),
+        VMSTATE_UINT32(sw_channels, TM4C123UDMAState),
+        VMSTATE_UINT32(done_pending, TM4C123UDMAState),
+        VMSTATE_UINT32(done_last, TM4C123UDMAState),
+        VMSTATE_INT64_ARRAY(done_ns, TM4C123UDMAState, UDMA_CHANNELS),
+        VMSTATE_TIMER_PTR(done_timer, TM4C123UDMAState),
+        VMSTATE_CLOCK(clk, TM4C123UDMAState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void tm4c123_udma_class_init(ObjectClass *kclass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(kclass);
+    dc->reset = tm4c123_udma_reset;
+    dc->realize = tm4c123_udma_realize;
+    dc->vmsd = &vmstate_tm4c123_udma;
+    device_class_set_props(dc, tm4c123_udma_properties);
+}
+
+static const TypeInfo tm4c123_udma_info = {
+    .name = TYPE_TM4C123_UDMA,
+    .parent = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(TM4C123UDMAState),
+    .instance_init = tm4c123_udma_init,
+    .class_init = tm4c123_udma_class_init,
+};
+
+static void tm4c123_udma_register_types(void)
+{
+    type_register_static(&tm4c123_udma_info);
+}
+
+type_init(tm4c123_udma_register_types)
@@ -27,35 +27,102 @@
 #include "qemu/log.h"
 #include "qemu/module.h"
 #include "hw/misc/tm4c123_sysctl.h"
+#include "hw/qdev-clock.h"
+#include "hw/qdev-properties.h"
+#include "qapi/error.h"
 #include "qemu/bitops.h"
+#include "migration/vmstate.h"
 #include "trace.h"
 
 #define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
 #define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
 
-static bool gpio_clock_enabled(TM4C123SysCtlState *s, hwaddr addr)
+/* A port answers on either the APB or the AHB aperture, never both */
+static bool gpio_aperture_enabled(TM4C123GPIOState *s, bool ahb)
 {
-    switch(addr) {
-        case GPIO_A:
-            return test_bit(0, (const unsigned long*)&s->sysctl_rcgcgpio);
-            break;
-        case GPIO_B:
-            return test_bit(1, (const unsigned long*)&s->sysctl_rcgcgpio);
-            break;
-        case GPIO_C:
-            return test_bit(2, (const unsigned long*)&s->sysctl_rcgcgpio);
-            break;
-        case GPIO_D:
-            return test_bit(3, (const unsigned long*)&s->sysctl_rcgcgpio);
-            break;
-        case GPIO_E:
-            return test_bit(4, (const unsigned long*)&s->sysctl_rcgcgpio);
-            break;
-        case GPIO_F:
-            return test_bit(5, (const unsigned long*)&s->sysctl_rcgcgpio);
-            break;
+    return !!(s->sysctl->sysctl_gpiohbctl & s->port_mask) == ahb;
+}
+
+static void gpio_update_wmask(TM4C123GPIOState *s)
+{
+    s->data_wmask = s->gpio_dir & s->gpio_den & ~s->gpio_afsel & 0xFF;
+}
+
+/* The pin mask is taken from the address, so a single pin is one access */
+static inline uint32_t gpio_data_mask(hwaddr addr)
+{
+    return extract32(addr, 2, 8);
+}
+
+/*
+ * Resolve the pads: GPIO outputs drive their latch (open drain ones only
+ * pull low), and everything else follows the input line if something has
+ * driven it, or else the pull resistors. Undriven pads without a pull-up
+ * read as 0.
+ */
+static uint32_t gpio_pad_levels(TM4C123GPIOState *s)
+{
+    uint32_t push = s->data_wmask & ~s->gpio_odr;
+    uint32_t sink = s->data_wmask & s->gpio_odr & ~s->gpio_data;
+    uint32_t level;
+
+    level = (s->gpio_pur & ~s->in_driven) | (s->in_level & s->in_driven);
+    level = (level & ~push) | (s->gpio_data & push);
+    return level & ~sink & MAKE_64BIT_MASK(0, GPIO_PINS);
+}
+
+/*
+ * Track pad changes: publish them on the output lines, feed the digital
+ * inputs to the edge and level detectors, and only touch the IRQ line
+ * when the masked status actually changes.
+ */
+static void gpio_update(TM4C123GPIOState *s)
+{
+    uint32_t old = s->pins;
+    uint32_t pins = gpio_pad_levels(s);
+    uint32_t changed = (old ^ pins) & s->gpio_den;
+    uint32_t edges = s->gpio_ibe | ~(pins ^ s->gpio_iev);
+    uint32_t old_mis = s->gpio_mis;
+    int i;
+
+    s->pins = pins;
+    for (i = 0; i < GPIO_PINS; i++) {
+        if ((old ^ pins) & BIT(i)) {
+            qemu_set_irq(s->out[i], extract32(pins, i, 1));
+        }
     }
-    return false;
+
+    /* Edge detection latches until GPIOICR, level detection follows the pad */
+    s->gpio_ris |= changed & ~s->gpio_is & edges;
+    s->gpio_ris = (s->gpio_ris & ~s->gpio_is) |
+                  (s->gpio_is & s->gpio_den & ~(pins ^ s->gpio_iev));
+    s->gpio_ris &= MAKE_64BIT_MASK(0, GPIO_PINS);
+
+    s->gpio_mis = s->gpio_ris & s->gpio_im;
+    if (!old_mis != !s->gpio_mis) {
+        trace_tm4c123_gpio_irq(!!s->gpio_mis);
+        qemu_set_irq(s->irq, !!s->gpio_mis);
+    }
+}
+
+static void gpio_data_write(TM4C123GPIOState *s, hwaddr addr, uint32_t val32)
+{
+    uint32_t mask = gpio_data_mask(addr) & s->data_wmask;
+
+    s->gpio_data = (s->gpio_data & ~mask) | (val32 & mask);
+    gpio_update(s);
+}
+
+/* Input lines, for buttons, sensors or other boards */
+static void tm4c123_gpio_set(void *opaque, int line, int level)
+{
+    TM4C123GPIOState *s = opaque;
+
+    trace_tm4c123_gpio_set(line, level);
+
+    s->in_driven |= BIT(line);
+    s->in_level = deposit32(s->in_level, line, 1, !!level);
+    gpio_update(s);
 }
 
 static void tm4c123_gpio_reset(DeviceState *dev)
@@ -98,70 +165,64 @@ static void tm4c123_gpio_reset(DeviceState *dev)
     s->gpio_pcell_id1 = 0x000000F0;
     s->gpio_pcell_id2 = 0x00000005;
     s->gpio_pcell_id3 = 0x000000B1;
+    gpio_update_wmask(s);
+    s->pins = gpio_pad_levels(s);
 }
 
-static void tm4c123_gpio_write(void *opaque, hwaddr addr, uint64_t val64, unsigned int size)
+static void tm4c123_gpio_write(TM4C123GPIOState *s, hwaddr addr, uint64_t val64, bool ahb)
 {
-    TM4C123GPIOState *s = opaque;
     uint32_t val32 = val64;
 
-    if (!gpio_clock_enabled(s->sysctl, s->mmio.addr)) {
-        hw_error("GPIO module clock is not enabled");
-    }
     trace_tm4c123_gpio_write(addr, val32);
 
+    if (!gpio_aperture_enabled(s, ahb)) {
+        LOG(LOG_GUEST_ERROR, "Port is not on the %s aperture\n", ahb ? "AHB" : "APB");
+        return;
+    }
+
+    if (addr <= GPIO_DATA) {
+        gpio_data_write(s, addr, val32);
+        return;
+    }
+
     switch(addr) {
-        case GPIO_DATA:
-            {
-                uint32_t rising_edge = (val32 ^ s->gpio_data) & val32;
-                //level detection
-                s->gpio_mis = s->gpio_is & s->gpio_iev & val32;
-                s->gpio_mis |= s->gpio_is & ~(s->gpio_iev | val32);
-                s->gpio_mis &= s->gpio_im;
-
-                //edge detection
-                //both edges
-                s->gpio_mis |= (s->gpio_is | s->gpio_ibe) & (~s->gpio_is);
-                //rising edge
-                s->gpio_mis |= (~(s->gpio_is | s->gpio_ibe | s->gpio_iev)) & rising_edge;
-                //falling edge
-                s->gpio_mis |= ~(s->gpio_is | s->gpio_ibe | s->gpio_iev | rising_edge);
-                s->gpio_mis &= s->gpio_im;
-                s->gpio_ris |= s->gpio_mis & val32;
-
-                s->gpio_data = val32;
-                if (s->gpio_im != 0)
-                    qemu_irq_pulse(s->irq);
-            }
-            break;
         case GPIO_DIR:
             s->gpio_dir = val32;
+            gpio_update_wmask(s);
+            gpio_update(s);
             break;
         case GPIO_IS:
             s->gpio_is = val32;
+            gpio_update(s);
             break;
         case GPIO_IBE:
             s->gpio_ibe = val32;
+            gpio_update(s);
             break;
         case GPIO_IEV:
             s->gpio_iev = val32;
+            gpio_update(s);
             break;
         case GPIO_IM:
             s->gpio_im = val32;
+            gpio_update(s);
             break;
         case GPIO_RIS:
-            s->gpio_ris = val32;
+            READONLY;
             break;
         case GPIO_MIS:
             READONLY;
             break;
         case GPIO_ICR:
-            s->gpio_mis ^= val32;
-            s->gpio_ris ^= val32;
+            /* Only edge detections latch; level ones follow the pad */
+            s->gpio_ris &= ~(val32 & ~s->gpio_is);
             s->gpio_icr = val32;
+            gpio_update(s);
             break;
         case GPIO_AFSEL:
             s->gpio_afsel = val32;
+            gpio_update_wmask(s);
+            gpio_update(s);
             break;
         case GPIO_DR2R:
             s->gpio_dr2r = val32;
@@ -174,18 +235,26 @@ static void tm4c123_gpio_write(void *opaque, hwaddr addr, uint64_t val64, unsign
             break;
         case GPIO_ODR:
             s->gpio_odr = val32;
+            gpio_update(s);
             break;
         case GPIO_PUR:
+            /* A pin has either a pull-up or a pull-down */
             s->gpio_pur = val32;
+            s->gpio_pdr &= ~val32;
+            gpio_update(s);
             break;
         case GPIO_PDR:
             s->gpio_pdr = val32;
+            s->gpio_pur &= ~val32;
+            gpio_update(s);
             break;
         case GPIO_SLR:
             s->gpio_slr = val32;
             break;
         case GPIO_DEN:
             s->gpio_den = val32;
+            gpio_update_wmask(s);
+            gpio_update(s);
             break;
         case GPIO_LOCK:
             s->gpio_lock = val32;
@@ -246,19 +315,20 @@ static void tm4c123_gpio_write(void *opaque, hwaddr addr, uint64_t val64, unsign
     }
 }
 
-static uint64_t tm4c123_gpio_read(void *opaque, hwaddr addr, unsigned int size)
+static uint64_t tm4c123_gpio_read(TM4C123GPIOState *s, hwaddr addr, bool ahb)
 {
-    TM4C123GPIOState *s = opaque;
-
     trace_tm4c123_gpio_read(addr);
 
-    if (!gpio_clock_enabled(s->sysctl, s->mmio.addr)) {
-        hw_error("GPIO module clock is not enabled");
+    if (!gpio_aperture_enabled(s, ahb)) {
+        LOG(LOG_GUEST_ERROR, "Port is not on the %s aperture\n", ahb ? "AHB" : "APB");
+        return 0;
+    }
+
+    if (addr <= GPIO_DATA) {
+        return s->pins & s->gpio_den & gpio_data_mask(addr);
     }
 
     switch(addr) {
-        case GPIO_DATA:
-            return s->gpio_data;
         case GPIO_DIR:
             return s->gpio_dir;
         case GPIO_IS:
@@ -335,9 +405,65 @@ static uint64_t tm4c123_gpio_read(void *opaque, hwaddr addr, unsigned int size)
     return 0;
 }
 
+/* A port whose RCGCGPIO bit is clear answers with a bus fault */
+static bool gpio_gated(TM4C123GPIOState *s)
+{
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "GPIO module clock is not enabled\n");
+        return true;
+    }
+    return false;
+}
+
+static MemTxResult tm4c123_gpio_apb_read(void *opaque, hwaddr addr, uint64_t *data,
+                                         unsigned int size, MemTxAttrs attrs)
+{
+    if (gpio_gated(opaque)) {
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_gpio_read(opaque, addr, false);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_gpio_apb_write(void *opaque, hwaddr addr, uint64_t val64,
+                                          unsigned int size, MemTxAttrs attrs)
+{
+    if (gpio_gated(opaque)) {
+        return MEMTX_ERROR;
+    }
+    tm4c123_gpio_write(opaque, addr, val64, false);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_gpio_ahb_read(void *opaque, hwaddr addr, uint64_t *data,
+                                         unsigned int size, MemTxAttrs attrs)
+{
+    if (gpio_gated(opaque)) {
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_gpio_read(opaque, addr, true);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_gpio_ahb_write(void *opaque, hwaddr addr, uint64_t val64,
+                                          unsigned int size, MemTxAttrs attrs)
+{
+    if (gpio_gated(opaque)) {
+        return MEMTX_ERROR;
+    }
+    tm4c123_gpio_write(opaque, addr, val64, true);
+    return MEMTX_OK;
+}
+
 static const MemoryRegionOps tm4c123_gpio_ops = {
-    .read = tm4c123_gpio_read,
-    .write = tm4c123_gpio_write,
+    .read_with_attrs = tm4c123_gpio_apb_read,
+    .write_with_attrs = tm4c123_gpio_apb_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static const MemoryRegionOps tm4c123_gpio_ahb_ops = {
+    .read_with_attrs = tm4c123_gpio_ahb_read,
+    .write_with_attrs = tm4c123_gpio_ahb_write,
     .endianness = DEVICE_NATIVE_ENDIAN,
 };
 
@@ -345,15 +471,98 @@ static void tm4c123_gpio_init(Object *obj)
 {
     TM4C123GPIOState *s = TM4C123_GPIO(obj);
 
+    s->clk = qdev_init_clock_in(DEVICE(s), "gpio_clock", NULL, NULL, 0);
     sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    qdev_init_gpio_in(DEVICE(obj), tm4c123_gpio_set, GPIO_PINS);
+    qdev_init_gpio_out(DEVICE(obj), s->out, GPIO_PINS);
     memory_region_init_io(&s->mmio, obj, &tm4c123_gpio_ops, s, TYPE_TM4C123_GPIO, 0xFFF);
     sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
+    memory_region_init_io(&s->mmio_ahb, obj, &tm4c123_gpio_ahb_ops, s,
+                          TYPE_TM4C123_GPIO "-ahb", 0xFFF);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio_ahb);
+}
+
+static void tm4c123_gpio_realize(DeviceState *dev, Error **errp)
+{
+    TM4C123GPIOState *s = TM4C123_GPIO(dev);
+
+    if (s->port >= GPIO_PORTS) {
+        error_setg(errp, "port must be below %d, not %u", GPIO_PORTS, s->port);
+        return;
+    }
+    s->port_mask = BIT(s->port);
 }
 
+static int tm4c123_gpio_post_load(void *opaque, int version_id)
+{
+    TM4C123GPIOState *s = opaque;
+
+    gpio_update_wmask(s);
+    s->pins = gpio_pad_levels(s);
+    return 0;
+}
+
+static const VMStateDescription vmstate_tm4c123_gpio = {
+    .name = TYPE_TM4C123_GPIO,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = tm4c123_gpio_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(gpio_data, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_dir, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_is, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_ibe, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_iev, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_im, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_ris, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_mis, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_icr, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_afsel, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_dr2r, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_dr4r, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_dr8r, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_odr, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_pur, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_pdr, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_slr, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_den, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_lock, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_ocr, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_amsel, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_pctl, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_adcctl, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_dmactl, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_per_id4, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_per_id5, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_per_id6, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_per_id7, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_per_id0, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_per_id1, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_per_id2, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_per_id3, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_pcell_id0, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_pcell_id1, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_pcell_id2, TM4C123GPIOState),
+        VMSTATE_UINT32(gpio_pcell_id3, TM4C123GPIOState),
+        VMSTATE_UINT32(in_level, TM4C123GPIOState),
+        VMSTATE_UINT32(in_driven, TM4C123GPIOState),
+        VMSTATE_CLOCK(clk, TM4C123GPIOState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static Property tm4c123_gpio_properties[] = {
+    DEFINE_PROP_UINT32("port", TM4C123GPIOState, port, 0),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
 static void tm4c123_gpio_class_init(ObjectClass *kclass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(kclass);
     dc->reset = tm4c123_gpio_reset;
+    dc->realize = tm4c123_gpio_realize;
+    dc->vmsd = &vmstate_tm4c123_gpio;
+    device_class_set_props(dc, tm4c123_gpio_properties);
 }
 
 static const TypeInfo tm4c123_gpio_info = {
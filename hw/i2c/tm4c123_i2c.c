@@ -0,0 +1,576 @@
+/*
+ * TM4C123 I2C
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "hw/i2c/tm4c123_i2c.h"
+#include "hw/irq.h"
+#include "hw/qdev-properties.h"
+#include "hw/qdev-clock.h"
+#include "qemu/timer.h"
+#include "qemu/host-utils.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "migration/vmstate.h"
+#include "trace.h"
+
+#define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
+#define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
+
+/* An SCL period is 2 * (1 + TPR) * (SCL_LP + SCL_HP) system clocks */
+#define I2C_SCL_LP 6
+#define I2C_SCL_HP 4
+/* A byte on the bus: 8 data bits and the acknowledge */
+#define I2C_BYTE_BITS 9
+
+static void tm4c123_i2c_update(TM4C123I2CState *s)
+{
+    qemu_set_irq(s->irq, (s->i2c_mris & s->i2c_mimr) || (s->i2c_sris & s->i2c_simr));
+}
+
+/* Duration of one SCL period, 0 if transfers complete instantly */
+static uint64_t tm4c123_i2c_bit_time_ns(TM4C123I2CState *s)
+{
+    uint64_t clk_hz = clock_get_hz(s->clk);
+    uint32_t tpr = extract32(s->i2c_mtpr, 0, 7);
+
+    if (s->fast_timing || !clk_hz) {
+        return 0;
+    }
+    return muldiv64(2 * (1 + tpr) * (I2C_SCL_LP + I2C_SCL_HP),
+                    NANOSECONDS_PER_SECOND, clk_hz);
+}
+
+/* Bus time of a master command: start and address, data byte, stop */
+static uint64_t tm4c123_i2c_cmd_time_ns(TM4C123I2CState *s, uint32_t cmd)
+{
+    uint32_t bits = 0;
+
+    if (cmd & I2C_MCS_START) {
+        bits += 1 + I2C_BYTE_BITS;
+    }
+    if (cmd & I2C_MCS_RUN) {
+        bits += I2C_BYTE_BITS;
+    }
+    if (cmd & I2C_MCS_STOP) {
+        bits += 1;
+    }
+    return bits * tm4c123_i2c_bit_time_ns(s);
+}
+
+/* Whether @addr selects our own slave module, and through which address */
+static bool tm4c123_i2c_slave_match(TM4C123I2CState *s, uint8_t addr, bool *oar2)
+{
+    if (!(s->i2c_mcr & I2C_MCR_SFE) || !s->slave_active) {
+        return false;
+    }
+    *oar2 = false;
+    if (addr == extract32(s->i2c_soar, 0, 7)) {
+        return true;
+    }
+    if ((s->i2c_soar2 & I2C_SOAR2_OAR2EN) && addr == extract32(s->i2c_soar2, 0, 7)) {
+        *oar2 = true;
+        return true;
+    }
+    return false;
+}
+
+/* Hand the master's byte to the slave module, or ask it for one */
+static void tm4c123_i2c_slave_request(TM4C123I2CState *s, bool first)
+{
+    if (s->i2c_msa & 1) {
+        s->i2c_scsr |= I2C_SCSR_TREQ;
+    } else {
+        s->i2c_sdr = s->i2c_mdr;
+        s->i2c_scsr |= I2C_SCSR_RREQ | (first ? I2C_SCSR_FBR : 0);
+    }
+    s->i2c_sris |= I2C_SINT_DATA;
+    s->slave_wait = true;
+}
+
+/*
+ * The command's bus time is over: run it against the bus and report the
+ * outcome. One event per command, so per byte, not per bit.
+ */
+static void tm4c123_i2c_complete(TM4C123I2CState *s)
+{
+    uint32_t cmd = s->cmd;
+    uint32_t status = 0;
+    bool recv = s->i2c_msa & 1;
+    bool addr_nack = false;
+
+    if (cmd & I2C_MCS_START) {
+        if (s->to_slave) {
+            /* Our own slave always acknowledges its address */
+        } else if (s->i2c_mcr & I2C_MCR_LPBK) {
+            /* Looped back, nothing but our own slave can answer */
+            addr_nack = true;
+        } else {
+            addr_nack = i2c_start_transfer(s->bus, s->i2c_msa >> 1, recv) != 0;
+        }
+        s->bus_owned = true;
+        if (addr_nack) {
+            status |= I2C_MCS_ERROR | I2C_MCS_ADRACK;
+        }
+    }
+
+    if ((cmd & I2C_MCS_RUN) && !addr_nack) {
+        if (!s->bus_owned) {
+            LOG(LOG_GUEST_ERROR, "data without a START\n");
+            status |= I2C_MCS_ERROR;
+        } else if (s->to_slave) {
+            if (!recv && s->slave_nack) {
+                status |= I2C_MCS_ERROR | I2C_MCS_DATACK;
+            }
+        } else if (recv) {
+            s->i2c_mdr = i2c_recv(s->bus);
+            if (!(cmd & I2C_MCS_ACK)) {
+                i2c_nack(s->bus);
+            }
+        } else if (i2c_send(s->bus, s->i2c_mdr)) {
+            status |= I2C_MCS_ERROR | I2C_MCS_DATACK;
+        }
+    }
+
+    if (cmd & I2C_MCS_STOP) {
+        if (s->to_slave) {
+            s->i2c_sris |= I2C_SINT_STOP;
+        } else {
+            i2c_end_transfer(s->bus);
+        }
+        s->bus_owned = false;
+        s->to_slave = false;
+    }
+
+    trace_tm4c123_i2c_complete(s->i2c_msa, cmd, status);
+
+    s->i2c_mcs = status | (s->bus_owned ? I2C_MCS_BUSBSY : 0);
+    s->i2c_mris |= I2C_MINT_RIS;
+    tm4c123_i2c_update(s);
+}
+
+static void tm4c123_i2c_try_complete(TM4C123I2CState *s)
+{
+    if (!(s->i2c_mcs & I2C_MCS_BUSY) || s->slave_wait) {
+        return;
+    }
+    if (qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) < s->busy_until_ns) {
+        timer_mod(s->timer, s->busy_until_ns);
+        return;
+    }
+    tm4c123_i2c_complete(s);
+}
+
+static void tm4c123_i2c_tick(void *opaque)
+{
+    tm4c123_i2c_try_complete(opaque);
+}
+
+static void tm4c123_i2c_command(TM4C123I2CState *s, uint32_t cmd)
+{
+    bool oar2 = false;
+    bool was_slave;
+
+    cmd &= I2C_MCS_RUN | I2C_MCS_START | I2C_MCS_STOP | I2C_MCS_ACK;
+    if (!(s->i2c_mcr & I2C_MCR_MFE)) {
+        LOG(LOG_GUEST_ERROR, "the master is not enabled\n");
+        return;
+    }
+    if (s->i2c_mcs & I2C_MCS_BUSY) {
+        LOG(LOG_GUEST_ERROR, "command while the master is busy\n");
+        return;
+    }
+    if (!(cmd & (I2C_MCS_RUN | I2C_MCS_START | I2C_MCS_STOP))) {
+        return;
+    }
+
+    s->cmd = cmd;
+    s->i2c_mcs = I2C_MCS_BUSY | I2C_MCS_BUSBSY;
+
+    if (cmd & I2C_MCS_START) {
+        was_slave = s->to_slave;
+        s->to_slave = tm4c123_i2c_slave_match(s, s->i2c_msa >> 1, &oar2);
+        if (s->to_slave) {
+            /* A repeated start moving off the external bus ends that transfer */
+            if (s->bus_owned && !was_slave) {
+                i2c_end_transfer(s->bus);
+            }
+            s->i2c_scsr = deposit32(s->i2c_scsr, 3, 1, oar2);
+            s->i2c_sris |= I2C_SINT_START;
+        }
+    }
+    if (s->to_slave && (cmd & I2C_MCS_RUN)) {
+        tm4c123_i2c_slave_request(s, cmd & I2C_MCS_START);
+    }
+    tm4c123_i2c_update(s);
+
+    s->busy_until_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) +
+                       tm4c123_i2c_cmd_time_ns(s, cmd);
+    tm4c123_i2c_try_complete(s);
+}
+
+/* The slave module answered: release the master waiting on it */
+static void tm4c123_i2c_slave_done(TM4C123I2CState *s)
+{
+    s->slave_wait = false;
+    tm4c123_i2c_update(s);
+    tm4c123_i2c_try_complete(s);
+}
+
+static uint32_t tm4c123_i2c_sdr_read(TM4C123I2CState *s)
+{
+    if (s->i2c_scsr & I2C_SCSR_RREQ) {
+        s->i2c_scsr &= ~(I2C_SCSR_RREQ | I2C_SCSR_FBR);
+        s->slave_nack = (s->i2c_sackctl & I2C_SACKCTL_ACKOEN) &&
+                        (s->i2c_sackctl & I2C_SACKCTL_ACKOVAL);
+        tm4c123_i2c_slave_done(s);
+    }
+    return s->i2c_sdr;
+}
+
+static void tm4c123_i2c_sdr_write(TM4C123I2CState *s, uint32_t val32)
+{
+    s->i2c_sdr = val32 & 0xFF;
+    if (s->i2c_scsr & I2C_SCSR_TREQ) {
+        s->i2c_scsr &= ~I2C_SCSR_TREQ;
+        s->i2c_mdr = s->i2c_sdr;
+        tm4c123_i2c_slave_done(s);
+    }
+}
+
+static void tm4c123_i2c_scsr_write(TM4C123I2CState *s, uint32_t val32)
+{
+    s->slave_active = val32 & I2C_SCSR_DA;
+    if (!s->slave_active && s->slave_wait) {
+        /* Deactivated mid-byte: the master sees a NACK, or reads the idle bus */
+        s->i2c_scsr &= ~(I2C_SCSR_RREQ | I2C_SCSR_TREQ | I2C_SCSR_FBR);
+        s->slave_nack = true;
+        if (s->i2c_msa & 1) {
+            s->i2c_mdr = 0xFF;
+        }
+        tm4c123_i2c_slave_done(s);
+    }
+}
+
+static void tm4c123_i2c_reset(DeviceState *dev)
+{
+    TM4C123I2CState *s = TM4C123_I2C(dev);
+
+    if (s->bus_owned && !s->to_slave) {
+        i2c_end_transfer(s->bus);
+    }
+
+    s->i2c_msa = 0x00000000;
+    s->i2c_mcs = I2C_MCS_IDLE;
+    s->i2c_mdr = 0x00000000;
+    s->i2c_mtpr = 0x00000001;
+    s->i2c_mimr = 0x00000000;
+    s->i2c_mris = 0x00000000;
+    s->i2c_mcr = 0x00000000;
+    s->i2c_mclkocnt = 0x00000000;
+    s->i2c_mcr2 = 0x00000000;
+    s->i2c_soar = 0x00000000;
+    s->i2c_scsr = 0x00000000;
+    s->i2c_sdr = 0x00000000;
+    s->i2c_simr = 0x00000000;
+    s->i2c_sris = 0x00000000;
+    s->i2c_soar2 = 0x00000000;
+    s->i2c_sackctl = 0x00000000;
+    s->i2c_pc = 0x00000001;
+    s->slave_active = false;
+
+    s->cmd = 0;
+    s->slave_wait = false;
+    s->bus_owned = false;
+    s->to_slave = false;
+    s->slave_nack = false;
+    timer_del(s->timer);
+
+    tm4c123_i2c_update(s);
+}
+
+static uint64_t tm4c123_i2c_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    TM4C123I2CState *s = opaque;
+
+    trace_tm4c123_i2c_read(addr);
+
+    switch (addr) {
+        case I2C_MSA:
+            return s->i2c_msa;
+        case I2C_MCS:
+            tm4c123_i2c_try_complete(s);
+            if (!(s->i2c_mcs & (I2C_MCS_BUSY | I2C_MCS_BUSBSY))) {
+                return s->i2c_mcs | I2C_MCS_IDLE;
+            }
+            return s->i2c_mcs;
+        case I2C_MDR:
+            return s->i2c_mdr;
+        case I2C_MTPR:
+            return s->i2c_mtpr;
+        case I2C_MIMR:
+            return s->i2c_mimr;
+        case I2C_MRIS:
+            return s->i2c_mris;
+        case I2C_MMIS:
+            return s->i2c_mris & s->i2c_mimr;
+        case I2C_MCR:
+            return s->i2c_mcr;
+        case I2C_MCLKOCNT:
+            return s->i2c_mclkocnt;
+        case I2C_MBMON:
+            /* Nobody holds SCL or SDA low between transfers */
+            return 0x3;
+        case I2C_MCR2:
+            return s->i2c_mcr2;
+        case I2C_SOAR:
+            return s->i2c_soar;
+        case I2C_SCSR:
+            return s->i2c_scsr;
+        case I2C_SDR:
+            return tm4c123_i2c_sdr_read(s);
+        case I2C_SIMR:
+            return s->i2c_simr;
+        case I2C_SRIS:
+            return s->i2c_sris;
+        case I2C_SMIS:
+            return s->i2c_sris & s->i2c_simr;
+        case I2C_SOAR2:
+            return s->i2c_soar2;
+        case I2C_SACKCTL:
+            return s->i2c_sackctl;
+        case I2C_PP:
+            /* High-speed capable */
+            return 0x1;
+        case I2C_PC:
+            return s->i2c_pc;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return 0;
+    }
+
+    return 0;
+}
+
+static void tm4c123_i2c_write(void *opaque, hwaddr addr, uint64_t val64, unsigned int size)
+{
+    TM4C123I2CState *s = opaque;
+    uint32_t val32 = val64;
+
+    trace_tm4c123_i2c_write(addr, val32);
+
+    switch (addr) {
+        case I2C_MSA:
+            s->i2c_msa = val32 & 0xFF;
+            break;
+        case I2C_MCS:
+            tm4c123_i2c_command(s, val32);
+            break;
+        case I2C_MDR:
+            s->i2c_mdr = val32 & 0xFF;
+            break;
+        case I2C_MTPR:
+            s->i2c_mtpr = val32 & 0xFF;
+            break;
+        case I2C_MIMR:
+            s->i2c_mimr = val32 & 0x3;
+            tm4c123_i2c_update(s);
+            break;
+        case I2C_MICR:
+            s->i2c_mris &= ~val32;
+            tm4c123_i2c_update(s);
+            break;
+        case I2C_MCR:
+            /*
+             * The glitch filter only suppresses pulses shorter than a few
+             * clocks; there are none on an emulated bus, so GFE is stored.
+             */
+            s->i2c_mcr = val32 & (I2C_MCR_LPBK | I2C_MCR_MFE | I2C_MCR_SFE | I2C_MCR_GFE);
+            break;
+        case I2C_MCLKOCNT:
+            s->i2c_mclkocnt = val32 & 0xFF;
+            break;
+        case I2C_MCR2:
+            s->i2c_mcr2 = val32 & 0x70;
+            break;
+        case I2C_SOAR:
+            s->i2c_soar = val32 & 0x7F;
+            break;
+        case I2C_SCSR:
+            tm4c123_i2c_scsr_write(s, val32);
+            break;
+        case I2C_SDR:
+            tm4c123_i2c_sdr_write(s, val32);
+            break;
+        case I2C_SIMR:
+            s->i2c_simr = val32 & 0x7;
+            tm4c123_i2c_update(s);
+            break;
+        case I2C_SICR:
+            s->i2c_sris &= ~val32;
+            tm4c123_i2c_update(s);
+            break;
+        case I2C_SOAR2:
+            s->i2c_soar2 = val32 & 0xFF;
+            break;
+        case I2C_SACKCTL:
+            s->i2c_sackctl = val32 & 0x3;
+            break;
+        case I2C_PC:
+            s->i2c_pc = val32 & 0x1;
+            break;
+        case I2C_MRIS:
+        case I2C_MMIS:
+        case I2C_MBMON:
+        case I2C_SRIS:
+        case I2C_SMIS:
+        case I2C_PP:
+            READONLY;
+            break;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return;
+    }
+
+    return;
+}
+
+/* Accesses with the module clock gated off answer with a bus fault */
+static MemTxResult tm4c123_i2c_read_with_attrs(void *opaque, hwaddr addr, uint64_t *data,
+                                               unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123I2CState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "I2C module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_i2c_read(opaque, addr, size);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_i2c_write_with_attrs(void *opaque, hwaddr addr, uint64_t val64,
+                                                unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123I2CState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "I2C module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    tm4c123_i2c_write(opaque, addr, val64, size);
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps tm4c123_i2c_ops = {
+    .read_with_attrs = tm4c123_i2c_read_with_attrs,
+    .write_with_attrs = tm4c123_i2c_write_with_attrs,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static Property tm4c123_i2c_properties[] = {
+    DEFINE_PROP_BOOL("fast-timing", TM4C123I2CState, fast_timing, false),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void tm4c123_i2c_init(Object *obj)
+{
+    TM4C123I2CState *s = TM4C123_I2C(obj);
+
+    s->clk = qdev_init_clock_in(DEVICE(s), "i2c_clock", NULL, NULL, 0);
+    s->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, tm4c123_i2c_tick, s);
+
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    memory_region_init_io(&s->mmio, obj, &tm4c123_i2c_ops, s,
+            TYPE_TM4C123_I2C, 0xFFF);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
+}
+
+static void tm4c123_i2c_realize(DeviceState *dev, Error **errp)
+{
+    TM4C123I2CState *s = TM4C123_I2C(dev);
+
+    /* Unnamed, so the controllers get i2c-bus.0 to i2c-bus.3 in creation order */
+    s->bus = i2c_init_bus(dev, NULL);
+}
+
+static const VMStateDescription vmstate_tm4c123_i2c = {
+    .name = TYPE_TM4C123_I2C,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(i2c_msa, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_mcs, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_mdr, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_mtpr, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_mimr, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_mris, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_mcr, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_mclkocnt, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_mcr2, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_soar, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_scsr, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_sdr, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_simr, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_sris, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_soar2, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_sackctl, TM4C123I2CState),
+        VMSTATE_UINT32(i2c_pc, TM4C123I2CState),
+        VMSTATE_BOOL(slave_active, TM4C123I2CState),
+        VMSTATE_UINT32(cmd, TM4C123I2CState),
+        VMSTATE_INT64(busy_until_ns, TM4C123I2CState),
+        VMSTATE_BOOL(slave_wait, TM4C123I2CState),
+        VMSTATE_BOOL(bus_owned, TM4C123I2CState),
+        VMSTATE_BOOL(to_slave, TM4C123I2CState),
+        VMSTATE_BOOL(slave_nack, TM4C123I2CState),
+        VMSTATE_TIMER_PTR(timer, TM4C123I2CState),
+        VMSTATE_CLOCK(clk, TM4C123I2CState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void tm4c123_i2c_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = tm4c123_i2c_reset;
+    dc->vmsd = &vmstate_tm4c123_i2c;
+    device_class_set_props(dc, tm4c123_i2c_properties);
+    dc->realize = tm4c123_i2c_realize;
+}
+
+static const TypeInfo tm4c123_i2c_info = {
+    .name          = TYPE_TM4C123_I2C,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(TM4C123I2CState),
+    .instance_init = tm4c123_i2c_init,
+    .class_init    = tm4c123_i2c_class_init,
+};
+
+static void tm4c123_i2c_register_types(void)
+{
+    type_register_static(&tm4c123_i2c_info);
+}
+
+type_init(tm4c123_i2c_register_types)
@@ -0,0 +1,1203 @@
+/*
+ * TM4C123 PWM
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "hw/misc/tm4c123_pwm.h"
+#include "hw/irq.h"
+#include "hw/qdev-properties.h"
+#include "hw/qdev-clock.h"
+#include "qemu/timer.h"
+#include "qemu/bswap.h"
+#include "qemu/error-report.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "sysemu/sysemu.h"
+#include "migration/vmstate.h"
+#include "trace.h"
+
+#define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
+#define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
+
+#define PWM_LOG_VERSION 1
+#define PWM_DB_NONE INT64_MAX
+
+/* How a shadowed register reaches the counter */
+enum {
+    PWM_UPD_IMMEDIATE,
+    PWM_UPD_LOCAL,
+    PWM_UPD_GLOBAL,
+};
+
+/* Events sharing a tick resolve by priority: highest first, by event bit */
+static const uint8_t pwm_prio_down[] = {0, 1, 5, 3};
+static const uint8_t pwm_prio_updown[] = {0, 1, 5, 3, 4, 2};
+
+static bool pwm_updown(TM4C123PWMGenerator *g)
+{
+    return g->ctl & PWM_GEN_CTL_MODE;
+}
+
+static bool pwm_running(TM4C123PWMState *s, TM4C123PWMGenerator *g)
+{
+    return (g->ctl & PWM_GEN_CTL_ENABLE) && clock_is_enabled(s->clk);
+}
+
+static uint32_t pwm_load(TM4C123PWMGenerator *g)
+{
+    return g->act[PWM_SH_LOAD] & 0xFFFF;
+}
+
+/* Ticks per period: LOAD + 1 counting down, twice LOAD counting up/down */
+static int64_t pwm_period(TM4C123PWMGenerator *g)
+{
+    uint32_t load = pwm_load(g);
+
+    if (pwm_updown(g)) {
+        return load ? 2 * load : 1;
+    }
+    return load + 1;
+}
+
+static uint32_t pwm_counter(TM4C123PWMGenerator *g, int64_t off)
+{
+    uint32_t load = pwm_load(g);
+
+    if (!pwm_updown(g)) {
+        return load - off;
+    }
+    return off <= load ? off : 2 * load - off;
+}
+
+/* Events at offset @off of the period */
+static uint32_t pwm_events_at(TM4C123PWMGenerator *g, int64_t off)
+{
+    uint32_t load = pwm_load(g);
+    uint32_t cnt = pwm_counter(g, off);
+    uint32_t cmp[2] = {
+        g->act[PWM_SH_CMPA] & 0xFFFF,
+        g->act[PWM_SH_CMPB] & 0xFFFF,
+    };
+    uint32_t mask = 0;
+    int i;
+
+    if (!pwm_updown(g)) {
+        mask |= off == 0 ? PWM_EV_LOAD : 0;
+        mask |= cnt == 0 ? PWM_EV_ZERO : 0;
+        for (i = 0; i < 2; i++) {
+            if (cmp[i] <= load && cnt == cmp[i]) {
+                mask |= PWM_EV_CMPAD << (2 * i);
+            }
+        }
+        return mask;
+    }
+
+    mask |= off == 0 ? PWM_EV_ZERO : 0;
+    mask |= off == load ? PWM_EV_LOAD : 0;
+    for (i = 0; i < 2; i++) {
+        if (!cmp[i] || cmp[i] > load || cnt != cmp[i]) {
+            continue;
+        }
+        if (off == load) {
+            mask |= (PWM_EV_CMPAU | PWM_EV_CMPAD) << (2 * i);
+        } else {
+            mask |= (off < load ? PWM_EV_CMPAU : PWM_EV_CMPAD) << (2 * i);
+        }
+    }
+    return mask;
+}
+
+/* First offset after @off holding an event, or the period when there is none */
+static int64_t pwm_next_offset(TM4C123PWMGenerator *g, int64_t off)
+{
+    int64_t load = pwm_load(g);
+    int64_t cand[6];
+    int64_t next = pwm_period(g);
+    int i;
+    int k = 0;
+
+    cand[k++] = 0;
+    cand[k++] = load;
+    for (i = 0; i < 2; i++) {
+        int64_t cmp = g->act[PWM_SH_CMPA + i] & 0xFFFF;
+
+        if (cmp > load) {
+            continue;
+        }
+        if (pwm_updown(g)) {
+            cand[k++] = cmp;
+            cand[k++] = 2 * load - cmp;
+        } else {
+            cand[k++] = load - cmp;
+        }
+    }
+    for (i = 0; i < k; i++) {
+        if (cand[i] > off && cand[i] < next) {
+            next = cand[i];
+        }
+    }
+    return next;
+}
+
+static uint32_t pwm_sh_mode(TM4C123PWMGenerator *g, int reg)
+{
+    uint32_t field;
+
+    switch (reg) {
+        case PWM_SH_LOAD:
+        case PWM_SH_CMPA:
+        case PWM_SH_CMPB:
+            return extract32(g->ctl, 3 + reg, 1) ? PWM_UPD_GLOBAL : PWM_UPD_LOCAL;
+        default:
+            field = extract32(g->ctl, 6 + 2 * (reg - PWM_SH_GENA), 2);
+            return field < 2 ? PWM_UPD_IMMEDIATE : field - 1;
+    }
+}
+
+static int64_t pwm_tick_ns(TM4C123PWMState *s, TM4C123PWMGenerator *g, int64_t tick)
+{
+    return g->epoch_ns + (tick > 0 ? clock_ticks_to_ns(s->clk, tick) : 0);
+}
+
+static void pwm_log_flush(TM4C123PWMState *s)
+{
+    size_t len = s->log_len * sizeof(s->log_buf[0]);
+
+    s->log_len = 0;
+    if (s->log_fd < 0 || !len) {
+        return;
+    }
+    if (qemu_write_full(s->log_fd, s->log_buf, len) != len) {
+        /* The descriptor may be shared with the other module, leave it open */
+        error_report("tm4c123-pwm: cannot write the edge log %s: %s",
+                     s->edge_log, strerror(errno));
+        s->log_fd = -1;
+    }
+}
+
+static void pwm_log(TM4C123PWMState *s, int64_t ns, int pin, bool level)
+{
+    if (s->log_fd < 0) {
+        return;
+    }
+    s->log_buf[s->log_len++] = cpu_to_le64((uint64_t)ns << 8 | (s->module & 0xF) << 4 |
+                                           pin << 1 | level);
+    if (s->log_len == PWM_LOG_ENTRIES) {
+        pwm_log_flush(s);
+    }
+}
+
+static bool pwm_pin_level(TM4C123PWMState *s, int pin)
+{
+    TM4C123PWMGenerator *g = &s->gen[pin / 2];
+
+    if (!(s->pwm_enable & BIT(pin))) {
+        return false;
+    }
+    if (g->fault && (s->pwm_fault & BIT(pin))) {
+        return s->pwm_faultval & BIT(pin);
+    }
+    return ((g->sig >> (pin & 1)) & 1) ^ ((s->pwm_invert >> pin) & 1);
+}
+
+static void pwm_drive(TM4C123PWMState *s, int pin, int64_t ns)
+{
+    bool level = pwm_pin_level(s, pin);
+
+    if (level == !!(s->pins & BIT(pin))) {
+        return;
+    }
+    s->pins ^= BIT(pin);
+    pwm_log(s, ns, pin, level);
+    qemu_set_irq(s->out[pin], level);
+}
+
+static void pwm_refresh(TM4C123PWMState *s, int64_t ns)
+{
+    int pin;
+
+    for (pin = 0; pin < PWM_OUTPUTS; pin++) {
+        pwm_drive(s, pin, ns);
+    }
+}
+
+static void pwm_set_sig(TM4C123PWMState *s, int n, int out, bool level, int64_t tick)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+
+    if (level == ((g->sig >> out) & 1)) {
+        return;
+    }
+    g->sig ^= BIT(out);
+    pwm_drive(s, 2 * n + out, pwm_tick_ns(s, g, tick));
+}
+
+/*
+ * With the dead-band on, pwmA' follows pwmA with its rising edges
+ * delayed by DBRISE, and pwmB' is the inverse of pwmA with its rising
+ * edges delayed by DBFALL. A pulse shorter than the delay is swallowed.
+ */
+static void pwm_set_raw(TM4C123PWMState *s, int n, int out, bool level, int64_t tick)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+    uint32_t rise = g->act[PWM_SH_DBRISE] & 0xFFF;
+    uint32_t fall = g->act[PWM_SH_DBFALL] & 0xFFF;
+
+    if (level == ((g->raw >> out) & 1)) {
+        return;
+    }
+    g->raw ^= BIT(out);
+
+    if (!(g->act[PWM_SH_DBCTL] & PWM_DBCTL_ENABLE)) {
+        pwm_set_sig(s, n, out, level, tick);
+        return;
+    }
+    if (out) {
+        return;
+    }
+    if (level) {
+        g->db_tick[1] = PWM_DB_NONE;
+        pwm_set_sig(s, n, 1, false, tick);
+        g->db_tick[0] = tick + rise;
+    } else {
+        g->db_tick[0] = PWM_DB_NONE;
+        pwm_set_sig(s, n, 0, false, tick);
+        g->db_tick[1] = tick + fall;
+    }
+}
+
+/* Emit the delayed dead-band edges due before tick @before */
+static void pwm_flush_db(TM4C123PWMState *s, int n, int64_t before)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+    int out;
+
+    for (;;) {
+        out = g->db_tick[0] <= g->db_tick[1] ? 0 : 1;
+        if (g->db_tick[out] >= before) {
+            return;
+        }
+        pwm_set_sig(s, n, out, true, g->db_tick[out]);
+        g->db_tick[out] = PWM_DB_NONE;
+    }
+}
+
+/* Bring the signals in line with the raw outputs, after a dead-band change */
+static void pwm_resig(TM4C123PWMState *s, int n, int64_t tick)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+    uint8_t sig = g->raw;
+
+    if (g->act[PWM_SH_DBCTL] & PWM_DBCTL_ENABLE) {
+        sig = (g->raw & 1) | (~g->raw & 1) << 1;
+    }
+    g->db_tick[0] = g->db_tick[1] = PWM_DB_NONE;
+    pwm_set_sig(s, n, 0, sig & 1, tick);
+    pwm_set_sig(s, n, 1, sig & 2, tick);
+}
+
+static bool pwm_latch_pending(TM4C123PWMState *s, int n)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+
+    return memcmp(g->act, g->wr, sizeof(g->act)) != 0;
+}
+
+/* The counter is back at its start: take the locally, or globally, synchronised values */
+static void pwm_latch(TM4C123PWMState *s, int n, int64_t tick)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+    uint32_t dbctl = g->act[PWM_SH_DBCTL];
+    int i;
+
+    for (i = 0; i < PWM_SHADOWED; i++) {
+        switch (pwm_sh_mode(g, i)) {
+            case PWM_UPD_LOCAL:
+                g->act[i] = g->wr[i];
+                break;
+            case PWM_UPD_GLOBAL:
+                if (s->pwm_ctl & BIT(n)) {
+                    g->act[i] = g->wr[i];
+                }
+                break;
+        }
+    }
+    s->pwm_ctl &= ~BIT(n);
+    if ((dbctl ^ g->act[PWM_SH_DBCTL]) & PWM_DBCTL_ENABLE) {
+        pwm_resig(s, n, tick);
+    }
+}
+
+static uint32_t pwm_action(TM4C123PWMGenerator *g, uint32_t gen, uint32_t mask)
+{
+    const uint8_t *prio = pwm_updown(g) ? pwm_prio_updown : pwm_prio_down;
+    int count = pwm_updown(g) ? ARRAY_SIZE(pwm_prio_updown) : ARRAY_SIZE(pwm_prio_down);
+    uint32_t act;
+    int i;
+
+    for (i = 0; i < count; i++) {
+        if (mask & BIT(prio[i])) {
+            act = extract32(gen, 2 * prio[i], 2);
+            if (act) {
+                return act;
+            }
+        }
+    }
+    return 0;
+}
+
+static void pwm_event(TM4C123PWMState *s, int n, uint32_t mask, int64_t tick)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+    uint32_t act;
+    int out;
+
+    g->ris |= mask;
+    if (mask & (g->inten >> 8)) {
+        qemu_irq_pulse(s->adc_trigger[n]);
+    }
+    for (out = 0; out < 2; out++) {
+        act = pwm_action(g, g->act[PWM_SH_GENA + out], mask);
+        if (act) {
+            pwm_set_raw(s, n, out, act == 1 ? !((g->raw >> out) & 1) : act == 3, tick);
+        }
+    }
+}
+
+/*
+ * Apply every counter event up to @now. Nothing runs between register
+ * accesses unless an interrupt or ADC trigger is due, so this is where
+ * the counter catches up; without an edge log to feed, whole periods
+ * that change nothing are skipped.
+ */
+static void pwm_gen_sync(TM4C123PWMState *s, int n, int64_t now)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+    int64_t limit;
+    int64_t next;
+    int64_t skip;
+    int64_t p;
+
+    if (!pwm_running(s, g) || now < g->epoch_ns) {
+        return;
+    }
+    limit = clock_ns_to_ticks(s->clk, now - g->epoch_ns);
+    if (limit <= g->synced) {
+        return;
+    }
+
+    p = pwm_period(g);
+    if (s->log_fd < 0 && !(g->inten & 0x3F00) && !pwm_latch_pending(s, n) &&
+        !(s->pwm_ctl & BIT(n)) && g->synced >= g->period_start) {
+        /* Two periods bring the outputs back even through inversions */
+        skip = (limit - g->period_start) / (2 * p) - 1;
+        if (skip > 0) {
+            pwm_flush_db(s, n, g->period_start + skip * 2 * p);
+            g->period_start += skip * 2 * p;
+            g->synced = g->period_start - 1;
+        }
+    }
+
+    for (;;) {
+        next = pwm_next_offset(g, g->synced - g->period_start);
+        if (next >= pwm_period(g)) {
+            if (g->period_start + pwm_period(g) > limit) {
+                break;
+            }
+            g->period_start += pwm_period(g);
+            pwm_flush_db(s, n, g->period_start);
+            pwm_latch(s, n, g->period_start);
+            continue;
+        }
+        if (g->period_start + next > limit) {
+            break;
+        }
+        pwm_flush_db(s, n, g->period_start + next);
+        pwm_event(s, n, pwm_events_at(g, next), g->period_start + next);
+        g->synced = g->period_start + next;
+    }
+    pwm_flush_db(s, n, limit + 1);
+    g->synced = limit;
+}
+
+static void pwm_sync(TM4C123PWMState *s)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    int n;
+
+    for (n = 0; n < PWM_GENERATORS; n++) {
+        pwm_gen_sync(s, n, now);
+    }
+}
+
+/* Count from the start of a period, as after reset, enabling or PWMSYNC */
+static void pwm_gen_restart(TM4C123PWMState *s, int n, int64_t now)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+
+    g->epoch_ns = now;
+    g->period_start = 0;
+    g->synced = -1;
+    pwm_gen_sync(s, n, now);
+}
+
+/* Move the epoch to @now, keeping the counter phase, for a new clock rate */
+static void pwm_gen_rebase(TM4C123PWMState *s, int n, int64_t now)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+    int64_t shift = MAX(g->synced, 0);
+    int i;
+
+    g->epoch_ns = now;
+    g->period_start -= shift;
+    g->synced -= shift;
+    for (i = 0; i < 2; i++) {
+        if (g->db_tick[i] != PWM_DB_NONE) {
+            g->db_tick[i] -= shift;
+        }
+    }
+}
+
+/* Tick of the next event in @wanted, or of the next latch, whichever is first */
+static int64_t pwm_next_event(TM4C123PWMState *s, int n, uint32_t wanted)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+    int64_t start = g->period_start;
+    int64_t off = g->synced - start;
+    int64_t next;
+    int i;
+
+    for (i = 0; i < 2 * ARRAY_SIZE(pwm_prio_updown) + 2; i++) {
+        next = pwm_next_offset(g, off);
+        if (next >= pwm_period(g)) {
+            start += pwm_period(g);
+            if (pwm_latch_pending(s, n) || (s->pwm_ctl & BIT(n))) {
+                return start;
+            }
+            off = -1;
+            continue;
+        }
+        if (pwm_events_at(g, next) & wanted) {
+            return start + next;
+        }
+        off = next;
+    }
+    return INT64_MAX;
+}
+
+static void pwm_update(TM4C123PWMState *s)
+{
+    TM4C123PWMGenerator *g;
+    int n;
+
+    for (n = 0; n < PWM_GENERATORS; n++) {
+        g = &s->gen[n];
+        qemu_set_irq(s->irq[n], (s->pwm_inten & BIT(n)) && (g->ris & g->inten & PWM_EV_ALL));
+    }
+    qemu_set_irq(s->irq_fault, s->pwm_ris & s->pwm_inten & 0xF0000);
+}
+
+/* Wake for the next interrupt, ADC trigger or end of a fault hold */
+static void pwm_schedule(TM4C123PWMState *s)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    int64_t deadline = INT64_MAX;
+    TM4C123PWMGenerator *g;
+    uint32_t wanted;
+    int64_t tick;
+    int n;
+
+    for (n = 0; n < PWM_GENERATORS; n++) {
+        g = &s->gen[n];
+        if (g->fault_until_ns > now) {
+            deadline = MIN(deadline, g->fault_until_ns);
+        }
+        if (!pwm_running(s, g)) {
+            continue;
+        }
+        wanted = (g->inten >> 8) & PWM_EV_ALL;
+        if (s->pwm_inten & BIT(n)) {
+            wanted |= g->inten & ~g->ris & PWM_EV_ALL;
+        }
+        if (!wanted) {
+            continue;
+        }
+        tick = pwm_next_event(s, n, wanted);
+        if (tick != INT64_MAX) {
+            /* One past the tick, so that the count has surely reached it */
+            deadline = MIN(deadline, pwm_tick_ns(s, g, tick) + 1);
+        }
+    }
+
+    if (deadline == INT64_MAX) {
+        timer_del(s->timer);
+    } else {
+        timer_mod(s->timer, deadline);
+    }
+}
+
+static uint32_t pwm_gen_fault_inputs(TM4C123PWMState *s, TM4C123PWMGenerator *g)
+{
+    uint32_t src = g->ctl & PWM_GEN_CTL_FLTSRC ? g->fltsrc0 : 1;
+
+    return (s->fault_level ^ g->fltsen) & src & 0xF;
+}
+
+/*
+ * Work out the fault condition of each generator: the selected MnFAULT
+ * inputs, as latched in FLTSTAT0/1 with LATCH set, or held for at least
+ * MINFLTPER ticks.
+ */
+static void pwm_faults_update(TM4C123PWMState *s)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    TM4C123PWMGenerator *g;
+    uint32_t in;
+    uint32_t src1;
+    bool active;
+    int n;
+
+    for (n = 0; n < PWM_GENERATORS; n++) {
+        g = &s->gen[n];
+        in = pwm_gen_fault_inputs(s, g);
+        src1 = g->ctl & PWM_GEN_CTL_FLTSRC ? g->fltsrc1 & 0xFF : 0;
+
+        if (g->ctl & PWM_GEN_CTL_LATCH) {
+            g->fltstat0 |= in;
+            active = g->fltstat0 || (g->fltstat1 & src1);
+        } else {
+            g->fltstat0 = in;
+            if (now >= g->fault_until_ns) {
+                g->fltstat1 = 0;
+            }
+            active = in || (g->fltstat1 & src1);
+        }
+        if (active && !g->fault) {
+            s->pwm_ris |= BIT(16 + n);
+            if (g->ctl & PWM_GEN_CTL_MINFLTPER) {
+                g->fault_until_ns = MAX(g->fault_until_ns,
+                        now + clock_ticks_to_ns(s->clk, (g->minfltper & 0xFFFF) + 1));
+            }
+        }
+        g->fault = active || now < g->fault_until_ns;
+    }
+    pwm_refresh(s, now);
+}
+
+static void pwm_fault_in(void *opaque, int line, int level)
+{
+    TM4C123PWMState *s = opaque;
+
+    pwm_sync(s);
+    s->fault_level = deposit32(s->fault_level, line, 1, level != 0);
+    pwm_faults_update(s);
+    pwm_update(s);
+    pwm_schedule(s);
+}
+
+/* A digital comparator trigger is a pulse: it faults for one tick, or MINFLTPER */
+static void pwm_dcmp_in(void *opaque, int line, int level)
+{
+    TM4C123PWMState *s = opaque;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    TM4C123PWMGenerator *g;
+    int n;
+
+    if (!level) {
+        return;
+    }
+    pwm_sync(s);
+    for (n = 0; n < PWM_GENERATORS; n++) {
+        g = &s->gen[n];
+        if ((g->ctl & PWM_GEN_CTL_FLTSRC) && (g->fltsrc1 & BIT(line))) {
+            g->fltstat1 |= BIT(line);
+            g->fault_until_ns = MAX(g->fault_until_ns,
+                                    now + clock_ticks_to_ns(s->clk, 1));
+        }
+    }
+    pwm_faults_update(s);
+    pwm_update(s);
+    pwm_schedule(s);
+}
+
+static void pwm_tick(void *opaque)
+{
+    TM4C123PWMState *s = opaque;
+
+    pwm_sync(s);
+    pwm_faults_update(s);
+    pwm_update(s);
+    pwm_schedule(s);
+}
+
+static void pwm_clock_update(void *opaque, ClockEvent event)
+{
+    TM4C123PWMState *s = opaque;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    int n;
+
+    if (event == ClockPreUpdate) {
+        pwm_sync(s);
+        return;
+    }
+    for (n = 0; n < PWM_GENERATORS; n++) {
+        pwm_gen_rebase(s, n, now);
+    }
+    pwm_schedule(s);
+}
+
+static void pwm_exit_notify(Notifier *notifier, void *data)
+{
+    TM4C123PWMState *s = container_of(notifier, TM4C123PWMState, exit_notifier);
+
+    pwm_sync(s);
+    pwm_log_flush(s);
+}
+
+static void tm4c123_pwm_reset(DeviceState *dev)
+{
+    TM4C123PWMState *s = TM4C123_PWM(dev);
+    TM4C123PWMGenerator *g;
+    int n;
+
+    s->pwm_ctl = 0x00000000;
+    s->pwm_enable = 0x00000000;
+    s->pwm_invert = 0x00000000;
+    s->pwm_fault = 0x00000000;
+    s->pwm_inten = 0x00000000;
+    s->pwm_ris = 0x00000000;
+    s->pwm_faultval = 0x00000000;
+    s->pwm_enupd = 0x00000000;
+
+    for (n = 0; n < PWM_GENERATORS; n++) {
+        g = &s->gen[n];
+        memset(g, 0, sizeof(*g));
+        g->synced = -1;
+        g->db_tick[0] = g->db_tick[1] = PWM_DB_NONE;
+    }
+
+    timer_del(s->timer);
+    pwm_refresh(s, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL));
+    pwm_update(s);
+}
+
+static uint64_t pwm_gen_read(TM4C123PWMState *s, int n, hwaddr reg)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+
+    switch (reg) {
+        case PWM_GEN_CTL:
+            return g->ctl;
+        case PWM_GEN_INTEN:
+            return g->inten;
+        case PWM_GEN_RIS:
+            return g->ris;
+        case PWM_GEN_ISC:
+            return g->ris & g->inten & PWM_EV_ALL;
+        case PWM_GEN_LOAD:
+            return g->wr[PWM_SH_LOAD];
+        case PWM_GEN_COUNT:
+            if (!(g->ctl & PWM_GEN_CTL_ENABLE) || g->synced < g->period_start) {
+                return pwm_counter(g, 0);
+            }
+            return pwm_counter(g, g->synced - g->period_start);
+        case PWM_GEN_CMPA:
+            return g->wr[PWM_SH_CMPA];
+        case PWM_GEN_CMPB:
+            return g->wr[PWM_SH_CMPB];
+        case PWM_GEN_GENA:
+            return g->wr[PWM_SH_GENA];
+        case PWM_GEN_GENB:
+            return g->wr[PWM_SH_GENB];
+        case PWM_GEN_DBCTL:
+            return g->wr[PWM_SH_DBCTL];
+        case PWM_GEN_DBRISE:
+            return g->wr[PWM_SH_DBRISE];
+        case PWM_GEN_DBFALL:
+            return g->wr[PWM_SH_DBFALL];
+        case PWM_GEN_FLTSRC0:
+            return g->fltsrc0;
+        case PWM_GEN_FLTSRC1:
+            return g->fltsrc1;
+        case PWM_GEN_MINFLTPER:
+            return g->minfltper;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad generator %d register 0x%"HWADDR_PRIx"\n", n, reg);
+            return 0;
+    }
+}
+
+static const uint32_t pwm_sh_masks[PWM_SHADOWED] = {
+    [PWM_SH_LOAD] = 0xFFFF,
+    [PWM_SH_CMPA] = 0xFFFF,
+    [PWM_SH_CMPB] = 0xFFFF,
+    [PWM_SH_GENA] = 0xFFF,
+    [PWM_SH_GENB] = 0xFFF,
+    [PWM_SH_DBCTL] = 0x1,
+    [PWM_SH_DBRISE] = 0xFFF,
+    [PWM_SH_DBFALL] = 0xFFF,
+};
+
+static void pwm_sh_write(TM4C123PWMState *s, int n, int reg, uint32_t val32)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+    uint32_t dbctl = g->act[PWM_SH_DBCTL];
+
+    g->wr[reg] = val32 & pwm_sh_masks[reg];
+    if (!(g->ctl & PWM_GEN_CTL_ENABLE) || pwm_sh_mode(g, reg) == PWM_UPD_IMMEDIATE) {
+        g->act[reg] = g->wr[reg];
+    }
+    if ((dbctl ^ g->act[PWM_SH_DBCTL]) & PWM_DBCTL_ENABLE) {
+        pwm_resig(s, n, MAX(g->synced, 0));
+    }
+}
+
+static void pwm_gen_write(TM4C123PWMState *s, int n, hwaddr reg, uint32_t val32)
+{
+    TM4C123PWMGenerator *g = &s->gen[n];
+    uint32_t old;
+
+    switch (reg) {
+        case PWM_GEN_CTL:
+            old = g->ctl;
+            g->ctl = val32 & 0x7FFFF;
+            if (!(old & PWM_GEN_CTL_ENABLE) && (g->ctl & PWM_GEN_CTL_ENABLE)) {
+                memcpy(g->act, g->wr, sizeof(g->act));
+                g->epoch_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+                pwm_resig(s, n, 0);
+                pwm_gen_restart(s, n, g->epoch_ns);
+            }
+            break;
+        case PWM_GEN_INTEN:
+            g->inten = val32 & 0x3F3F;
+            break;
+        case PWM_GEN_ISC:
+            g->ris &= ~val32;
+            break;
+        case PWM_GEN_LOAD:
+            pwm_sh_write(s, n, PWM_SH_LOAD, val32);
+            break;
+        case PWM_GEN_CMPA:
+            pwm_sh_write(s, n, PWM_SH_CMPA, val32);
+            break;
+        case PWM_GEN_CMPB:
+            pwm_sh_write(s, n, PWM_SH_CMPB, val32);
+            break;
+        case PWM_GEN_GENA:
+            pwm_sh_write(s, n, PWM_SH_GENA, val32);
+            break;
+        case PWM_GEN_GENB:
+            pwm_sh_write(s, n, PWM_SH_GENB, val32);
+            break;
+        case PWM_GEN_DBCTL:
+            pwm_sh_write(s, n, PWM_SH_DBCTL, val32);
+            break;
+        case PWM_GEN_DBRISE:
+            pwm_sh_write(s, n, PWM_SH_DBRISE, val32);
+            break;
+        case PWM_GEN_DBFALL:
+            pwm_sh_write(s, n, PWM_SH_DBFALL, val32);
+            break;
+        case PWM_GEN_FLTSRC0:
+            g->fltsrc0 = val32 & 0xF;
+            break;
+        case PWM_GEN_FLTSRC1:
+            g->fltsrc1 = val32 & 0xFF;
+            break;
+        case PWM_GEN_MINFLTPER:
+            g->minfltper = val32 & 0xFFFF;
+            break;
+        case PWM_GEN_RIS:
+        case PWM_GEN_COUNT:
+            LOG(LOG_GUEST_ERROR, "generator %d register 0x%"HWADDR_PRIx" is readonly\n",
+                n, reg);
+            break;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad generator %d register 0x%"HWADDR_PRIx"\n", n, reg);
+            break;
+    }
+}
+
+static uint64_t tm4c123_pwm_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    TM4C123PWMState *s = opaque;
+    TM4C123PWMGenerator *g;
+    uint32_t ris;
+    int n;
+
+    trace_tm4c123_pwm_read(addr);
+    pwm_sync(s);
+
+    if (addr >= PWM_GEN_BASE && addr < PWM_GEN_BASE + PWM_GENERATORS * PWM_GEN_STRIDE) {
+        n = (addr - PWM_GEN_BASE) / PWM_GEN_STRIDE;
+        return pwm_gen_read(s, n, (addr - PWM_GEN_BASE) % PWM_GEN_STRIDE);
+    }
+    if (addr >= PWM_FLT_BASE && addr < PWM_FLT_BASE + PWM_GENERATORS * PWM_FLT_STRIDE) {
+        g = &s->gen[(addr - PWM_FLT_BASE) / PWM_FLT_STRIDE];
+        switch ((addr - PWM_FLT_BASE) % PWM_FLT_STRIDE) {
+            case PWM_FLT_SEN:
+                return g->fltsen;
+            case PWM_FLT_STAT0:
+                return g->fltstat0;
+            case PWM_FLT_STAT1:
+                return g->fltstat1;
+        }
+        LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+        return 0;
+    }
+
+    ris = s->pwm_ris & 0xF0000;
+    for (n = 0; n < PWM_GENERATORS; n++) {
+        if (s->gen[n].ris & s->gen[n].inten & PWM_EV_ALL) {
+            ris |= BIT(n);
+        }
+    }
+
+    switch (addr) {
+        case PWM_CTL:
+            return s->pwm_ctl;
+        case PWM_SYNC:
+            return 0;
+        case PWM_ENABLE:
+            return s->pwm_enable;
+        case PWM_INVERT:
+            return s->pwm_invert;
+        case PWM_FAULT:
+            return s->pwm_fault;
+        case PWM_INTEN:
+            return s->pwm_inten;
+        case PWM_RIS:
+            return ris;
+        case PWM_ISC:
+            return ris & s->pwm_inten;
+        case PWM_STATUS:
+            ris = 0;
+            for (n = 0; n < PWM_GENERATORS; n++) {
+                ris |= s->gen[n].fault ? BIT(n) : 0;
+            }
+            return ris;
+        case PWM_FAULTVAL:
+            return s->pwm_faultval;
+        case PWM_ENUPD:
+            return s->pwm_enupd;
+        case PWM_PP:
+            /* Four generators, four fault inputs, extended sync and fault, one-shot */
+            return 0x00000744;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return 0;
+    }
+
+    return 0;
+}
+
+static void tm4c123_pwm_write(void *opaque, hwaddr addr, uint64_t val64, unsigned int size)
+{
+    TM4C123PWMState *s = opaque;
+    TM4C123PWMGenerator *g;
+    uint32_t val32 = val64;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    int n;
+
+    trace_tm4c123_pwm_write(addr, val32);
+    pwm_sync(s);
+
+    if (addr >= PWM_GEN_BASE && addr < PWM_GEN_BASE + PWM_GENERATORS * PWM_GEN_STRIDE) {
+        n = (addr - PWM_GEN_BASE) / PWM_GEN_STRIDE;
+        pwm_gen_write(s, n, (addr - PWM_GEN_BASE) % PWM_GEN_STRIDE, val32);
+    } else if (addr >= PWM_FLT_BASE &&
+               addr < PWM_FLT_BASE + PWM_GENERATORS * PWM_FLT_STRIDE) {
+        g = &s->gen[(addr - PWM_FLT_BASE) / PWM_FLT_STRIDE];
+        switch ((addr - PWM_FLT_BASE) % PWM_FLT_STRIDE) {
+            case PWM_FLT_SEN:
+                g->fltsen = val32 & 0xF;
+                break;
+            case PWM_FLT_STAT0:
+                g->fltstat0 &= ~val32;
+                break;
+            case PWM_FLT_STAT1:
+                g->fltstat1 &= ~val32;
+                break;
+            default:
+                LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+                return;
+        }
+    } else {
+        switch (addr) {
+            case PWM_CTL:
+                s->pwm_ctl |= val32 & 0xF;
+                break;
+            case PWM_SYNC:
+                for (n = 0; n < PWM_GENERATORS; n++) {
+                    if ((val32 & BIT(n)) && (s->gen[n].ctl & PWM_GEN_CTL_ENABLE)) {
+                        pwm_gen_restart(s, n, now);
+                    }
+                }
+                break;
+            case PWM_ENABLE:
+                /* Updates land at once; ENUPD is kept but not applied */
+                s->pwm_enable = val32 & 0xFF;
+                break;
+            case PWM_INVERT:
+                s->pwm_invert = val32 & 0xFF;
+                break;
+            case PWM_FAULT:
+                s->pwm_fault = val32 & 0xFF;
+                break;
+            case PWM_INTEN:
+                s->pwm_inten = val32 & 0xF000F;
+                break;
+            case PWM_ISC:
+                s->pwm_ris &= ~(val32 & 0xF0000);
+                break;
+            case PWM_FAULTVAL:
+                s->pwm_faultval = val32 & 0xFF;
+                break;
+            case PWM_ENUPD:
+                s->pwm_enupd = val32 & 0xFFFF;
+                break;
+            case PWM_RIS:
+            case PWM_STATUS:
+            case PWM_PP:
+                READONLY;
+                break;
+            default:
+                LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+                return;
+        }
+    }
+
+    pwm_faults_update(s);
+    pwm_update(s);
+    pwm_schedule(s);
+}
+
+/* Accesses with the module clock gated off answer with a bus fault */
+static MemTxResult tm4c123_pwm_read_with_attrs(void *opaque, hwaddr addr, uint64_t *data,
+                                               unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123PWMState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "PWM module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_pwm_read(opaque, addr, size);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_pwm_write_with_attrs(void *opaque, hwaddr addr, uint64_t val64,
+                                                unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123PWMState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "PWM module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    tm4c123_pwm_write(opaque, addr, val64, size);
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps tm4c123_pwm_ops = {
+    .read_with_attrs = tm4c123_pwm_read_with_attrs,
+    .write_with_attrs = tm4c123_pwm_write_with_attrs,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static Property tm4c123_pwm_properties[] = {
+    DEFINE_PROP_UINT8("module", TM4C123PWMState, module, 0),
+    DEFINE_PROP_STRING("edge-log", TM4C123PWMState, edge_log),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void tm4c123_pwm_init(Object *obj)
+{
+    TM4C123PWMState *s = TM4C123_PWM(obj);
+    int n;
+
+    s->clk = qdev_init_clock_in(DEVICE(s), "pwm_clock", pwm_clock_update, s,
+                                ClockPreUpdate | ClockUpdate);
+    s->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, pwm_tick, s);
+    s->log_fd = -1;
+
+    for (n = 0; n < PWM_GENERATORS; n++) {
+        sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq[n]);
+    }
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq_fault);
+    qdev_init_gpio_out_named(DEVICE(obj), s->out, "pwm", PWM_OUTPUTS);
+    qdev_init_gpio_out_named(DEVICE(obj), s->adc_trigger, "adc-trigger", PWM_GENERATORS);
+    qdev_init_gpio_in_named(DEVICE(obj), pwm_fault_in, "fault", PWM_FAULTS);
+    qdev_init_gpio_in_named(DEVICE(obj), pwm_dcmp_in, "dcmp", PWM_DCMPS);
+
+    memory_region_init_io(&s->mmio, obj, &tm4c123_pwm_ops, s,
+            TYPE_TM4C123_PWM, 0xFFF);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
+}
+
+/*
+ * Both modules may log to the same file. The first to open it starts a
+ * fresh log, so nothing from an earlier run is left in front of the new
+ * header; the other one appends to the same descriptor.
+ */
+typedef struct PWMEdgeLog {
+    dev_t dev;
+    ino_t ino;
+    int fd;
+} PWMEdgeLog;
+
+static GSList *pwm_edge_logs;
+
+static int pwm_edge_log_open(const char *path, Error **errp)
+{
+    uint8_t header[16] = "TM4CPWM";
+    PWMEdgeLog *log;
+    struct stat st;
+    GSList *l;
+    int fd;
+
+    fd = qemu_create(path, O_WRONLY | O_APPEND, 0644, errp);
+    if (fd < 0) {
+        return -1;
+    }
+    if (fstat(fd, &st)) {
+        error_setg_errno(errp, errno, "cannot stat the edge log %s", path);
+        close(fd);
+        return -1;
+    }
+    for (l = pwm_edge_logs; l; l = l->next) {
+        log = l->data;
+        if (log->dev == st.st_dev && log->ino == st.st_ino) {
+            close(fd);
+            return log->fd;
+        }
+    }
+
+    stl_le_p(header + 8, PWM_LOG_VERSION);
+    stl_le_p(header + 12, sizeof(uint64_t));
+    if (ftruncate(fd, 0) ||
+        qemu_write_full(fd, header, sizeof(header)) != sizeof(header)) {
+        error_setg_errno(errp, errno, "cannot write the edge log %s", path);
+        close(fd);
+        return -1;
+    }
+
+    log = g_new0(PWMEdgeLog, 1);
+    log->dev = st.st_dev;
+    log->ino = st.st_ino;
+    log->fd = fd;
+    pwm_edge_logs = g_slist_prepend(pwm_edge_logs, log);
+    return fd;
+}
+
+static void tm4c123_pwm_realize(DeviceState *dev, Error **errp)
+{
+    TM4C123PWMState *s = TM4C123_PWM(dev);
+
+    if (!s->edge_log) {
+        return;
+    }
+    s->log_fd = pwm_edge_log_open(s->edge_log, errp);
+    if (s->log_fd < 0) {
+        return;
+    }
+    s->exit_notifier.notify = pwm_exit_notify;
+    qemu_add_exit_notifier(&s->exit_notifier);
+}
+
+static const VMStateDescription vmstate_tm4c123_pwm_gen = {
+    .name = "tm4c123-pwm-gen",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(ctl, TM4C123PWMGenerator),
+        VMSTATE_UINT32(inten, TM4C123PWMGenerator),
+        VMSTATE_UINT32(ris, TM4C123PWMGenerator),
+        VMSTATE_UINT32(fltsrc0, TM4C123PWMGenerator),
+        VMSTATE_UINT32(fltsrc1, TM4C123PWMGenerator),
+        VMSTATE_UINT32(minfltper, TM4C123PWMGenerator),
+        VMSTATE_UINT32(fltsen, TM4C123PWMGenerator),
+        VMSTATE_UINT32(fltstat0, TM4C123PWMGenerator),
+        VMSTATE_UINT32(fltstat1, TM4C123PWMGenerator),
+        VMSTATE_UINT32_ARRAY(wr, TM4C123PWMGenerator, PWM_SHADOWED),
+        VMSTATE_UINT32_ARRAY(act, TM4C123PWMGenerator, PWM_SHADOWED),
+        VMSTATE_INT64(epoch_ns, TM4C123PWMGenerator),
+        VMSTATE_INT64(period_start, TM4C123PWMGenerator),
+        VMSTATE_INT64(synced, TM4C123PWMGenerator),
+        VMSTATE_UINT8(raw, TM4C123PWMGenerator),
+        VMSTATE_UINT8(sig, TM4C123PWMGenerator),
+        VMSTATE_INT64_ARRAY(db_tick, TM4C123PWMGenerator, 2),
+        VMSTATE_BOOL(fault, TM4C123PWMGenerator),
+        VMSTATE_INT64(fault_until_ns, TM4C123PWMGenerator),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const VMStateDescription vmstate_tm4c123_pwm = {
+    .name = TYPE_TM4C123_PWM,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(pwm_ctl, TM4C123PWMState),
+        VMSTATE_UINT32(pwm_enable, TM4C123PWMState),
+        VMSTATE_UINT32(pwm_invert, TM4C123PWMState),
+        VMSTATE_UINT32(pwm_fault, TM4C123PWMState),
+        VMSTATE_UINT32(pwm_inten, TM4C123PWMState),
+        VMSTATE_UINT32(pwm_ris, TM4C123PWMState),
+        VMSTATE_UINT32(pwm_faultval, TM4C123PWMState),
+        VMSTATE_UINT32(pwm_enupd, TM4C123PWMState),
+        VMSTATE_STRUCT_ARRAY(gen, TM4C123PWMState, PWM_GENERATORS, 1,
+                             vmstate_tm4c123_pwm_gen, TM4C123PWMGenerator),
+        VMSTATE_UINT32(fault_level, TM4C123PWMState),
+        VMSTATE_UINT32(pins, TM4C123PWMState),
+        VMSTATE_TIMER_PTR(timer, TM4C123PWMState),
+        VMSTATE_CLOCK(clk, TM4C123PWMState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void tm4c123_pwm_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = tm4c123_pwm_reset;
+    dc->vmsd = &vmstate_tm4c123_pwm;
+    device_class_set_props(dc, tm4c123_pwm_properties);
+    dc->realize = tm4c123_pwm_realize;
+}
+
+static const TypeInfo tm4c123_pwm_info = {
+    .name          = TYPE_TM4C123_PWM,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(TM4C123PWMState),
+    .instance_init = tm4c123_pwm_init,
+    .class_init    = tm4c123_pwm_class_init,
+};
+
+static void tm4c123_pwm_register_types(void)
+{
+    type_register_static(&tm4c123_pwm_info);
+}
+
+type_init(tm4c123_pwm_register_types)
@@ -0,0 +1,734 @@
+/*
+ * TM4C123 QEI
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include <math.h>
+#include "qapi/error.h"
+#include "hw/misc/tm4c123_qei.h"
+#include "hw/irq.h"
+#include "hw/qdev-properties.h"
+#include "hw/qdev-clock.h"
+#include "qemu/timer.h"
+#include "qemu/cutils.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "migration/vmstate.h"
+#include "trace.h"
+
+#define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
+#define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
+
+static int64_t qei_floor_div(int64_t a, int64_t n)
+{
+    return a >= 0 ? a / n : -((-a + n - 1) / n);
+}
+
+/* Edges per revolution of the profile encoder, between index pulses */
+static int64_t qei_rev_edges(TM4C123QEIState *s)
+{
+    return 4 * (int64_t)s->lines;
+}
+
+/*
+ * Position count for quadrature state @q: every state change (CAPMODE),
+ * only the PhA edges, or the PhA rising edges in clock/direction mode
+ */
+static int64_t qei_count(TM4C123QEIState *s, int64_t q)
+{
+    if (s->qei_ctl & QEI_CTL_SIGMODE) {
+        return qei_floor_div(q + 3, 4);
+    }
+    if (s->qei_ctl & QEI_CTL_CAPMODE) {
+        return q;
+    }
+    return qei_floor_div(q + 1, 2);
+}
+
+static uint32_t qei_wrap(TM4C123QEIState *s, int64_t pos)
+{
+    int64_t range = (int64_t)s->qei_maxpos + 1;
+    int64_t r = pos % range;
+
+    return r < 0 ? r + range : r;
+}
+
+static void qei_direction(TM4C123QEIState *s, bool reverse)
+{
+    if (!!(s->qei_stat & QEI_STAT_DIRECTION) != reverse) {
+        s->qei_stat ^= QEI_STAT_DIRECTION;
+        s->qei_ris |= QEI_INT_DIR;
+    }
+}
+
+/* Edges travelled by time @t, integrating the piecewise linear speed */
+static double qei_profile_edges(TM4C123QEIState *s, int64_t t)
+{
+    TM4C123QEIPoint *p = s->points;
+    uint32_t lo = 0;
+    uint32_t hi = s->num_points;
+    uint32_t mid;
+    double dt;
+    double a;
+
+    if (t < p[0].ns) {
+        return p[0].v * t;
+    }
+    /* Last point at or before @t */
+    while (hi - lo > 1) {
+        mid = (lo + hi) / 2;
+        if (p[mid].ns <= t) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    dt = t - p[lo].ns;
+    if (lo == s->num_points - 1) {
+        return p[lo].e + p[lo].v * dt;
+    }
+    a = (p[lo + 1].v - p[lo].v) / (p[lo + 1].ns - p[lo].ns);
+    return p[lo].e + p[lo].v * dt + 0.5 * a * dt * dt;
+}
+
+/* Quadrature state at time @t, forward when PhA leads PhB */
+static int64_t qei_profile_q(TM4C123QEIState *s, int64_t t)
+{
+    double e = qei_profile_edges(s, t);
+
+    return floor(s->qei_ctl & QEI_CTL_SWAP ? -e : e);
+}
+
+/* First time after @t at which the profile stops or turns, INT64_MAX if never */
+static int64_t qei_profile_turn(TM4C123QEIState *s, int64_t t)
+{
+    TM4C123QEIPoint *p = s->points;
+    int64_t tc;
+    uint32_t i;
+
+    for (i = 0; i + 1 < s->num_points; i++) {
+        if (p[i + 1].ns <= t) {
+            continue;
+        }
+        if (p[i].v * p[i + 1].v < 0) {
+            tc = p[i].ns + (int64_t)(p[i].v / (p[i].v - p[i + 1].v) *
+                                     (p[i + 1].ns - p[i].ns));
+            if (tc > t) {
+                return tc;
+            }
+        }
+        if (p[i + 1].v == 0) {
+            return p[i + 1].ns;
+        }
+    }
+    return INT64_MAX;
+}
+
+/*
+ * End of the monotonic stretch starting at @t, far enough that it covers
+ * @span edges when it never turns again. INT64_MAX if the shaft stays put.
+ */
+static int64_t qei_profile_stretch(TM4C123QEIState *s, int64_t t, int64_t span)
+{
+    TM4C123QEIPoint *last = &s->points[s->num_points - 1];
+    int64_t end = qei_profile_turn(s, t);
+    double dt;
+
+    if (end != INT64_MAX) {
+        return end;
+    }
+    if (last->v == 0) {
+        return INT64_MAX;
+    }
+    dt = (span + 2) / fabs(last->v) + 1;
+    return MAX(t, last->ns) + (int64_t)MIN(dt, (double)(INT64_MAX / 4));
+}
+
+/* Smallest time in (@lo, @hi] at which the state reaches @target, going @up */
+static int64_t qei_profile_bisect(TM4C123QEIState *s, int64_t lo, int64_t hi,
+                                  int64_t target, bool up)
+{
+    int64_t mid;
+    int64_t q;
+
+    while (hi - lo > 1) {
+        mid = lo + (hi - lo) / 2;
+        q = qei_profile_q(s, mid);
+        if (up ? q >= target : q <= target) {
+            hi = mid;
+        } else {
+            lo = mid;
+        }
+    }
+    return hi;
+}
+
+/*
+ * The shaft went from state @qa to @qb without turning: count the edges
+ * in one go, and reset at the last index pulse crossed on the way.
+ */
+static void qei_motion(TM4C123QEIState *s, int64_t qa, int64_t qb)
+{
+    int64_t n = qei_rev_edges(s);
+    int64_t delta = qei_count(s, qb) - qei_count(s, qa);
+    int64_t idx;
+    bool crossed;
+
+    if (qa == qb) {
+        return;
+    }
+    qei_direction(s, qb < qa);
+    s->vel_edges += delta < 0 ? -delta : delta;
+
+    /* The index sits between states idx - 1 and idx */
+    if (qb > qa) {
+        idx = qei_floor_div(qb, n) * n;
+        crossed = idx > qa;
+    } else {
+        idx = qei_floor_div(qb, n) * n + n;
+        crossed = idx <= qa;
+    }
+    if (crossed) {
+        s->qei_ris |= QEI_INT_INDEX;
+        if (s->qei_ctl & QEI_CTL_RESMODE) {
+            s->qei_pos = qei_wrap(s, qei_count(s, qb) - qei_count(s, idx));
+            return;
+        }
+    }
+    s->qei_pos = qei_wrap(s, s->qei_pos + delta);
+}
+
+/* Follow the profile up to @t, one monotonic stretch at a time */
+static void qei_profile_advance(TM4C123QEIState *s, int64_t t)
+{
+    int64_t end;
+    int64_t q;
+
+    while (s->gen_ns < t) {
+        end = MIN(t, qei_profile_turn(s, s->gen_ns));
+        q = qei_profile_q(s, end);
+        qei_motion(s, s->gen_q, q);
+        s->gen_q = q;
+        s->gen_ns = end;
+    }
+}
+
+static bool qei_running(TM4C123QEIState *s)
+{
+    return (s->qei_ctl & QEI_CTL_ENABLE) && clock_is_enabled(s->clk);
+}
+
+static void qei_advance(TM4C123QEIState *s, int64_t t)
+{
+    if (s->profile) {
+        qei_profile_advance(s, t);
+    }
+}
+
+static int64_t qei_vel_period_ns(TM4C123QEIState *s)
+{
+    return MAX(clock_ticks_to_ns(s->clk, (uint64_t)s->qei_load + 1), 1);
+}
+
+/*
+ * Catch up with the time elapsed since the last access. Only the last
+ * velocity period to expire shows in QEISPEED, so a long gap costs two
+ * steps of the profile, however many periods went by.
+ */
+static void qei_sync(TM4C123QEIState *s)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    int64_t period;
+    int64_t expiries;
+    int64_t last;
+
+    if (!qei_running(s)) {
+        /* Nothing is counted: pick the shaft up where it is when counting resumes */
+        if (s->profile) {
+            s->gen_q = qei_profile_q(s, now);
+        }
+        s->gen_ns = now;
+        return;
+    }
+
+    if ((s->qei_ctl & QEI_CTL_VELEN) && now >= s->vel_next_ns) {
+        period = qei_vel_period_ns(s);
+        expiries = (now - s->vel_next_ns) / period + 1;
+        last = s->vel_next_ns + (expiries - 1) * period;
+        if (expiries > 1) {
+            qei_advance(s, last - period);
+            s->vel_edges = 0;
+        }
+        qei_advance(s, last);
+        s->qei_speed = s->vel_edges >> extract32(s->qei_ctl, 6, 3);
+        s->vel_edges = 0;
+        s->qei_ris |= QEI_INT_TIMER;
+        s->vel_next_ns = last + period;
+    }
+    qei_advance(s, now);
+}
+
+static void qei_update(TM4C123QEIState *s)
+{
+    qemu_set_irq(s->irq, s->qei_ris & s->qei_inten);
+}
+
+/* When the profile next crosses the index */
+static int64_t qei_profile_next_index(TM4C123QEIState *s, int64_t t)
+{
+    int64_t n = qei_rev_edges(s);
+    int64_t q = s->gen_q;
+    int64_t end;
+    int64_t qe;
+    int64_t target;
+    uint32_t i;
+
+    for (i = 0; i < 2 * s->num_points + 2; i++) {
+        end = qei_profile_stretch(s, t, n);
+        if (end == INT64_MAX) {
+            return INT64_MAX;
+        }
+        qe = qei_profile_q(s, end);
+        if (qe > q) {
+            target = qei_floor_div(q, n) * n + n;
+            if (qe >= target) {
+                return qei_profile_bisect(s, t, end, target, true);
+            }
+        } else if (qe < q) {
+            target = qei_floor_div(q, n) * n - 1;
+            if (qe <= target) {
+                return qei_profile_bisect(s, t, end, target, false);
+            }
+        }
+        t = end;
+        q = qe;
+    }
+    return INT64_MAX;
+}
+
+/* When the profile next moves against the current direction */
+static int64_t qei_profile_next_turn(TM4C123QEIState *s, int64_t t)
+{
+    bool reverse = s->qei_stat & QEI_STAT_DIRECTION;
+    int64_t q = s->gen_q;
+    int64_t end;
+    int64_t qe;
+    uint32_t i;
+
+    for (i = 0; i < 2 * s->num_points + 2; i++) {
+        end = qei_profile_stretch(s, t, 1);
+        if (end == INT64_MAX) {
+            return INT64_MAX;
+        }
+        qe = qei_profile_q(s, end);
+        if (!reverse && qe < q) {
+            return qei_profile_bisect(s, t, end, q - 1, false);
+        }
+        if (reverse && qe > q) {
+            return qei_profile_bisect(s, t, end, q + 1, true);
+        }
+        t = end;
+        q = qe;
+    }
+    return INT64_MAX;
+}
+
+/* Wake for the next enabled interrupt; the rest waits for an access */
+static void qei_schedule(TM4C123QEIState *s)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    uint32_t wanted = s->qei_inten & ~s->qei_ris;
+    int64_t deadline = INT64_MAX;
+
+    if (qei_running(s)) {
+        if ((s->qei_ctl & QEI_CTL_VELEN) && (wanted & QEI_INT_TIMER)) {
+            deadline = s->vel_next_ns;
+        }
+        if (s->profile && (wanted & QEI_INT_INDEX)) {
+            deadline = MIN(deadline, qei_profile_next_index(s, now));
+        }
+        if (s->profile && (wanted & QEI_INT_DIR)) {
+            deadline = MIN(deadline, qei_profile_next_turn(s, now));
+        }
+    }
+
+    if (deadline == INT64_MAX) {
+        timer_del(s->timer);
+    } else {
+        timer_mod(s->timer, deadline);
+    }
+}
+
+static void qei_tick(void *opaque)
+{
+    TM4C123QEIState *s = opaque;
+
+    qei_sync(s);
+    qei_update(s);
+    qei_schedule(s);
+}
+
+static void qei_step(TM4C123QEIState *s, int step)
+{
+    qei_direction(s, step < 0);
+    s->vel_edges++;
+    s->qei_pos = qei_wrap(s, (int64_t)s->qei_pos + step);
+}
+
+/* Quadrature state of PhA and PhB, forward when PhA leads */
+static int qei_gray(bool a, bool b)
+{
+    return b ? (a ? 2 : 3) : (a ? 1 : 0);
+}
+
+static void qei_pins_decode(TM4C123QEIState *s, uint32_t pins, bool *a, bool *b, bool *idx)
+{
+    bool pha = ((pins >> QEI_PIN_PHA) & 1) ^ !!(s->qei_ctl & QEI_CTL_INVA);
+    bool phb = ((pins >> QEI_PIN_PHB) & 1) ^ !!(s->qei_ctl & QEI_CTL_INVB);
+    bool swap = s->qei_ctl & QEI_CTL_SWAP;
+
+    *a = swap ? phb : pha;
+    *b = swap ? pha : phb;
+    *idx = ((pins >> QEI_PIN_IDX) & 1) ^ !!(s->qei_ctl & QEI_CTL_INVI);
+}
+
+static void qei_pin_in(void *opaque, int line, int level)
+{
+    TM4C123QEIState *s = opaque;
+    bool a0, b0, i0, a1, b1, i1;
+    int s0, s1;
+
+    qei_sync(s);
+    qei_pins_decode(s, s->pins, &a0, &b0, &i0);
+    s->pins = deposit32(s->pins, line, 1, level != 0);
+    qei_pins_decode(s, s->pins, &a1, &b1, &i1);
+    if (!qei_running(s) || s->profile) {
+        return;
+    }
+
+    if (i1 && !i0) {
+        s->qei_ris |= QEI_INT_INDEX;
+        if (s->qei_ctl & QEI_CTL_RESMODE) {
+            s->qei_pos = 0;
+        }
+    }
+
+    if (s->qei_ctl & QEI_CTL_SIGMODE) {
+        /* Clock and direction: PhA rising edges, backwards while PhB is high */
+        if (a1 && !a0) {
+            qei_step(s, b1 ? -1 : 1);
+        }
+    } else if (a0 != a1 || b0 != b1) {
+        s0 = qei_gray(a0, b0);
+        s1 = qei_gray(a1, b1);
+        if (s1 == ((s0 + 1) & 3) || s1 == ((s0 + 3) & 3)) {
+            /* Without CAPMODE only the PhA edges count */
+            if ((s->qei_ctl & QEI_CTL_CAPMODE) || a0 != a1) {
+                qei_step(s, s1 == ((s0 + 1) & 3) ? 1 : -1);
+            } else {
+                qei_direction(s, s1 != ((s0 + 1) & 3));
+            }
+        } else {
+            s->qei_ris |= QEI_INT_ERROR;
+            s->qei_stat |= 1;
+        }
+    }
+    qei_update(s);
+    qei_schedule(s);
+}
+
+static void qei_clock_update(void *opaque, ClockEvent event)
+{
+    TM4C123QEIState *s = opaque;
+
+    if (event == ClockPreUpdate) {
+        qei_sync(s);
+        return;
+    }
+    qei_schedule(s);
+}
+
+static void tm4c123_qei_reset(DeviceState *dev)
+{
+    TM4C123QEIState *s = TM4C123_QEI(dev);
+
+    s->qei_ctl = 0x00000000;
+    s->qei_stat = 0x00000000;
+    s->qei_pos = 0x00000000;
+    s->qei_maxpos = 0x00000000;
+    s->qei_load = 0x00000000;
+    s->qei_speed = 0x00000000;
+    s->qei_inten = 0x00000000;
+    s->qei_ris = 0x00000000;
+    s->vel_edges = 0;
+    s->vel_next_ns = 0;
+    s->gen_q = 0;
+    s->gen_ns = 0;
+
+    timer_del(s->timer);
+    qei_update(s);
+}
+
+static uint64_t tm4c123_qei_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    TM4C123QEIState *s = opaque;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+
+    trace_tm4c123_qei_read(addr);
+    qei_sync(s);
+
+    switch (addr) {
+        case QEI_CTL:
+            return s->qei_ctl;
+        case QEI_STAT:
+            return s->qei_stat;
+        case QEI_POS:
+            return s->qei_pos;
+        case QEI_MAXPOS:
+            return s->qei_maxpos;
+        case QEI_LOAD:
+            return s->qei_load;
+        case QEI_TIME:
+            if (!qei_running(s) || !(s->qei_ctl & QEI_CTL_VELEN)) {
+                return s->qei_load;
+            }
+            return MIN(clock_ns_to_ticks(s->clk, s->vel_next_ns - now), s->qei_load);
+        case QEI_CNT:
+            return s->vel_edges >> extract32(s->qei_ctl, 6, 3);
+        case QEI_SPEED:
+            return s->qei_speed;
+        case QEI_INTEN:
+            return s->qei_inten;
+        case QEI_RIS:
+            return s->qei_ris;
+        case QEI_ISC:
+            return s->qei_ris & s->qei_inten;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return 0;
+    }
+
+    return 0;
+}
+
+static void tm4c123_qei_write(void *opaque, hwaddr addr, uint64_t val64, unsigned int size)
+{
+    TM4C123QEIState *s = opaque;
+    uint32_t val32 = val64;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    uint32_t old;
+
+    trace_tm4c123_qei_write(addr, val32);
+    qei_sync(s);
+
+    switch (addr) {
+        case QEI_CTL:
+            old = s->qei_ctl;
+            s->qei_ctl = val32 & 0x000F3FFF;
+            /* Counting restarts from the shaft's present state */
+            if (s->profile && ((old ^ s->qei_ctl) & (QEI_CTL_ENABLE | QEI_CTL_SWAP))) {
+                s->gen_q = qei_profile_q(s, now);
+                s->gen_ns = now;
+            }
+            if ((s->qei_ctl & QEI_CTL_VELEN) &&
+                (~old & (QEI_CTL_VELEN | QEI_CTL_ENABLE) & s->qei_ctl)) {
+                s->vel_next_ns = now + qei_vel_period_ns(s);
+                s->vel_edges = 0;
+            }
+            break;
+        case QEI_POS:
+            s->qei_pos = val32;
+            break;
+        case QEI_MAXPOS:
+            s->qei_maxpos = val32;
+            break;
+        case QEI_LOAD:
+            s->qei_load = val32;
+            break;
+        case QEI_INTEN:
+            s->qei_inten = val32 & 0xF;
+            break;
+        case QEI_ISC:
+            s->qei_ris &= ~(val32 & 0xF);
+            break;
+        case QEI_STAT:
+        case QEI_TIME:
+        case QEI_CNT:
+        case QEI_SPEED:
+        case QEI_RIS:
+            READONLY;
+            break;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return;
+    }
+    qei_update(s);
+    qei_schedule(s);
+}
+
+/* Accesses with the module clock gated off answer with a bus fault */
+static MemTxResult tm4c123_qei_read_with_attrs(void *opaque, hwaddr addr, uint64_t *data,
+                                               unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123QEIState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "QEI module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_qei_read(opaque, addr, size);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_qei_write_with_attrs(void *opaque, hwaddr addr, uint64_t val64,
+                                                unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123QEIState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "QEI module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    tm4c123_qei_write(opaque, addr, val64, size);
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps tm4c123_qei_ops = {
+    .read_with_attrs = tm4c123_qei_read_with_attrs,
+    .write_with_attrs = tm4c123_qei_write_with_attrs,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static Property tm4c123_qei_properties[] = {
+    DEFINE_PROP_STRING("profile", TM4C123QEIState, profile),
+    DEFINE_PROP_UINT32("lines", TM4C123QEIState, lines, 1000),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void tm4c123_qei_init(Object *obj)
+{
+    TM4C123QEIState *s = TM4C123_QEI(obj);
+
+    s->clk = qdev_init_clock_in(DEVICE(s), "qei_clock", qei_clock_update, s,
+                                ClockPreUpdate | ClockUpdate);
+    s->timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, qei_tick, s);
+
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    qdev_init_gpio_in_named(DEVICE(obj), qei_pin_in, "pins", QEI_PINS);
+
+    memory_region_init_io(&s->mmio, obj, &tm4c123_qei_ops, s,
+            TYPE_TM4C123_QEI, 0xFFF);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
+}
+
+static void tm4c123_qei_realize(DeviceState *dev, Error **errp)
+{
+    TM4C123QEIState *s = TM4C123_QEI(dev);
+    g_auto(GStrv) items = NULL;
+    TM4C123QEIPoint *p;
+    const char *end;
+    uint64_t ms;
+    double rpm;
+    uint32_t i;
+
+    if (!s->profile) {
+        return;
+    }
+    if (!s->lines) {
+        error_setg(errp, "lines must not be 0");
+        return;
+    }
+
+    items = g_strsplit(s->profile, ",", 0);
+    s->num_points = g_strv_length(items);
+    if (!s->num_points) {
+        error_setg(errp, "profile holds no points");
+        return;
+    }
+    s->points = g_new0(TM4C123QEIPoint, s->num_points);
+    for (i = 0; i < s->num_points; i++) {
+        p = &s->points[i];
+        if (qemu_strtou64(g_strstrip(items[i]), &end, 10, &ms) || *end != ':' ||
+            qemu_strtod(end + 1, &end, &rpm) || *end) {
+            error_setg(errp, "profile point \"%s\" is not ms:rpm", items[i]);
+            return;
+        }
+        if (ms > INT64_MAX / SCALE_MS || (i && ms * SCALE_MS <= p[-1].ns)) {
+            error_setg(errp, "profile times must increase");
+            return;
+        }
+        p->ns = ms * SCALE_MS;
+        /* Revolutions per minute to quadrature edges per ns */
+        p->v = rpm / 60 * qei_rev_edges(s) / NANOSECONDS_PER_SECOND;
+        p->e = i ? p[-1].e + (p[-1].v + p->v) / 2 * (p->ns - p[-1].ns) : p->v * p->ns;
+    }
+}
+
+static const VMStateDescription vmstate_tm4c123_qei = {
+    .name = TYPE_TM4C123_QEI,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(qei_ctl, TM4C123QEIState),
+        VMSTATE_UINT32(qei_stat, TM4C123QEIState),
+        VMSTATE_UINT32(qei_pos, TM4C123QEIState),
+        VMSTATE_UINT32(qei_maxpos, TM4C123QEIState),
+        VMSTATE_UINT32(qei_load, TM4C123QEIState),
+        VMSTATE_UINT32(qei_speed, TM4C123QEIState),
+        VMSTATE_UINT32(qei_inten, TM4C123QEIState),
+        VMSTATE_UINT32(qei_ris, TM4C123QEIState),
+        VMSTATE_UINT32(vel_edges, TM4C123QEIState),
+        VMSTATE_INT64(vel_next_ns, TM4C123QEIState),
+        VMSTATE_UINT32(pins, TM4C123QEIState),
+        VMSTATE_INT64(gen_q, TM4C123QEIState),
+        VMSTATE_INT64(gen_ns, TM4C123QEIState),
+        VMSTATE_TIMER_PTR(timer, TM4C123QEIState),
+        VMSTATE_CLOCK(clk, TM4C123QEIState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void tm4c123_qei_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = tm4c123_qei_reset;
+    dc->vmsd = &vmstate_tm4c123_qei;
+    device_class_set_props(dc, tm4c123_qei_properties);
+    dc->realize = tm4c123_qei_realize;
+}
+
+static const TypeInfo tm4c123_qei_info = {
+    .name          = TYPE_TM4C123_QEI,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(TM4C123QEIState),
+    .instance_init = tm4c123_qei_init,
+    .class_init    = tm4c123_qei_class_init,
+};
+
+static void tm4c123_qei_register_types(void)
+{
+    type_register_static(&tm4c123_qei_info);
+}
+
+type_init(tm4c123_qei_register_types)
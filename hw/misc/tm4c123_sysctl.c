@@ -24,136 +24,322 @@
 
 #include "qemu/osdep.h"
 #include "hw/misc/tm4c123_sysctl.h"
+#include "hw/qdev-properties.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "migration/vmstate.h"
 #include "trace.h"
 
 #define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
 #define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
 
-static void tm4c123_sysctl_update_system_clock(void *opaque)
+/* Crystal frequencies selected by RCC.XTAL */
+static const uint32_t tm4c123_xtal_hz[] = {
+    1000000, 1843200, 2000000, 2457600, 3579545, 3686400, 4000000, 4096000,
+    4915200, 5000000, 5120000, 6000000, 6144000, 7372800, 8000000, 8192000,
+    10000000, 12000000, 12288000, 13560000, 14318180, 16000000, 16384000, 18000000,
+    20000000, 24000000, 25000000,
+};
+
+/*
+ * Peripheral clock outputs, one per RCGC bit. Each is the module clock
+ * behind its run mode gate, so a gated module sees a stopped clock.
+ */
+typedef struct {
+    const char *name;
+    hwaddr rcgc;
+    int count;
+    /* Instances clocked from the PIOSC instead of the system clock */
+    uint32_t piosc;
+} TM4C123PeriphClockInfo;
+
+static const TM4C123PeriphClockInfo tm4c123_periph_clocks[] = {
+    { "wdt",    SYSCTL_RCGCWD,     2, 1 << 1 },
+    { "timer",  SYSCTL_RCGCTIMER,  6 },
+    { "gpio",   SYSCTL_RCGCGPIO,   6 },
+    { "udma",   SYSCTL_RCGCDMA,    1 },
+    { "hib",    SYSCTL_RCGCHIB,    1 },
+    { "uart",   SYSCTL_RCGCUART,   8 },
+    { "ssi",    SYSCTL_RCGCSSI,    4 },
+    { "i2c",    SYSCTL_RCGCI2C,    4 },
+    { "usb",    SYSCTL_RCGCUSB,    1 },
+    { "can",    SYSCTL_RCGCCAN,    2 },
+    { "adc",    SYSCTL_RCGCADC,    2 },
+    { "acmp",   SYSCTL_RCGCACMP,   1 },
+    { "pwm",    SYSCTL_RCGCPWM,    2 },
+    { "qei",    SYSCTL_RCGCQEI,    2 },
+    { "eeprom", SYSCTL_RCGCEEPROM, 1 },
+    { "wtimer", SYSCTL_RCGCWTIMER, 6 },
+};
+
+static inline int tm4c123_sysctl_rcgc_index(hwaddr rcgc)
 {
-    TM4C123SysCtlState *s = opaque;
+    return (rcgc - SYSCTL_RCGCWD) / 4;
+}
 
-    uint32_t RCC_Val = s->sysctl_rcc;
-    uint32_t RCC2_Val = s->sysctl_rcc2;
-
-    uint32_t __CORE_CLK_PRE;
-    uint32_t __CORE_CLK;
-
-    if (RCC2_Val & (1UL << 31)) {  /* is rcc2 used? */
-        if (RCC2_Val & (1UL << 11)) {  /* check BYPASS */
-            if (((RCC2_Val >> 4) & 0x07) == 0x0) {
-                if (((RCC_Val >> 6) & 0x1F) == 0x0) {
-                    __CORE_CLK_PRE = 1000000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x1) {
-                    __CORE_CLK_PRE = 1843200UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x2) {
-                    __CORE_CLK_PRE = 2000000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x3) {
-                    __CORE_CLK_PRE = 2457600UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x4) {
-                    __CORE_CLK_PRE = 3579545UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x5) {
-                    __CORE_CLK_PRE = 3686400UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x6) {
-                    __CORE_CLK_PRE = 4000000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x7) {
-                    __CORE_CLK_PRE = 4096000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x8) {
-                    __CORE_CLK_PRE = 4915200UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x9) {
-                    __CORE_CLK_PRE = 5000000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0xA) {
-                    __CORE_CLK_PRE = 5120000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0xB) {
-                    __CORE_CLK_PRE = 6000000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0xC) {
-                    __CORE_CLK_PRE = 6144000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0xD) {
-                    __CORE_CLK_PRE = 7372800UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0xE) {
-                    __CORE_CLK_PRE = 8000000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0xF) {
-                    __CORE_CLK_PRE = 8192000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x10) {
-                    __CORE_CLK_PRE = 10000000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x11) {
-                    __CORE_CLK_PRE = 12000000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x12) {
-                    __CORE_CLK_PRE = 12288000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x13) {
-                    __CORE_CLK_PRE = 13560000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x14) {
-                    __CORE_CLK_PRE = 14318180UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x15) {
-                    __CORE_CLK_PRE = 16000000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x16) {
-                    __CORE_CLK_PRE = 16384000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x17) {
-                    __CORE_CLK_PRE = 18000000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x18) {
-                    __CORE_CLK_PRE = 20000000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x19) {
-                    __CORE_CLK_PRE = 24000000UL;
-                } else if (((RCC_Val >> 6) & 0x1F) == 0x1A) {
-                    __CORE_CLK_PRE = 25000000UL;
-                } else {
-                    __CORE_CLK_PRE = 0UL;
-                }
-                __CORE_CLK = __CORE_CLK_PRE / 2UL;  /* divide by 2 since BYPASS is set */
-            } else {  /* PLL is used */
-                uint32_t __PLL_MULT = ((RCC2_Val >> 4) & 0x1F) + 2;
-                uint32_t __PLL_DIV = ((RCC2_Val >> 0) & 0x3F) + 1;
-                uint32_t __PLL_SOURCE = ((RCC2_Val >> 13) & 0x01);
-                if (__PLL_SOURCE == 0) {  /* source is XTAL */
-                    __CORE_CLK_PRE = (XTALI * __PLL_MULT) / __PLL_DIV;
-                } else {  /* source is internal oscillator */
-                    __CORE_CLK_PRE = (16000000UL * __PLL_MULT) / __PLL_DIV;  /* internal oscillator frequency is 16MHz */
-                }
-                __CORE_CLK = __CORE_CLK_PRE / 2UL;  /* divide by 2 since BYPASS is set */
-            }
-        } else {  /* BYPASS is not set */
-            uint32_t __SYS_DIV = ((RCC2_Val >> 22) & 0x7F) + 1;
-            uint32_t __PLL_MULT = ((RCC2_Val >> 4) & 0x1F) + 2;
-            uint32_t __PLL_DIV = ((RCC2_Val >> 0) & 0x3F) + 1;
-            uint32_t __PLL_SOURCE = ((RCC2_Val >> 13) & 0x01);
-            if (__PLL_SOURCE == 0) {  /* source is XTAL */
-                __CORE_CLK_PRE = (XTALI * __PLL_MULT) / __PLL_DIV;
-            } else {  /* source is internal oscillator */
-                __CORE_CLK_PRE = (16000000UL * __PLL_MULT) / __PLL_DIV;  /* internal oscillator frequency is 16MHz */
-            }
-            __CORE_CLK = __CORE_CLK_PRE / __SYS_DIV;
+/* Oscillator picked by OSCSRC (RCC) or OSCSRC2 (RCC2), 0 if reserved */
+static uint32_t tm4c123_sysctl_osc_hz(TM4C123SysCtlState *s, unsigned oscsrc)
+{
+    unsigned xtal = extract32(s->sysctl_rcc, 6, 5);
+
+    switch (oscsrc) {
+        case SYSCTL_OSCSRC_MOSC:
+            return xtal < ARRAY_SIZE(tm4c123_xtal_hz) ? tm4c123_xtal_hz[xtal] : 0;
+        case SYSCTL_OSCSRC_PIOSC:
+            return XTALI;
+        case SYSCTL_OSCSRC_PIOSC_4:
+            return XTALI / 4;
+        case SYSCTL_OSCSRC_LFIOSC:
+            return XTAL30K;
+        case SYSCTL_OSCSRC_32K:
+            return XTAL32K;
+    }
+    return 0;
+}
+
+/*
+ * System clock as selected by RCC, or by RCC2 when USERCC2 is set. The
+ * PLL runs at 400 MHz and is divided by 2 ahead of SYSDIV, unless RCC2
+ * asks for DIV400 with the extra SYSDIV2LSB bit.
+ */
+static uint32_t tm4c123_sysctl_sysclk_hz(TM4C123SysCtlState *s)
+{
+    uint32_t rcc = s->sysctl_rcc;
+    uint32_t rcc2 = s->sysctl_rcc2;
+    bool use_rcc2 = rcc2 & SYSCTL_RCC2_USERCC2;
+    unsigned oscsrc = use_rcc2 ? extract32(rcc2, 4, 3) : extract32(rcc, 4, 2);
+    bool bypass = use_rcc2 ? rcc2 & SYSCTL_RCC2_BYPASS2 : rcc & SYSCTL_RCC_BYPASS;
+    bool pwrdn = use_rcc2 ? rcc2 & SYSCTL_RCC2_PWRDN2 : rcc & SYSCTL_RCC_PWRDN;
+    uint32_t sysdiv = use_rcc2 ? extract32(rcc2, 23, 6) : extract32(rcc, 23, 4);
+
+    if (!bypass && oscsrc <= SYSCTL_OSCSRC_PIOSC && !pwrdn) {
+        if (use_rcc2 && (rcc2 & SYSCTL_RCC2_DIV400)) {
+            return PLL_CLK / (((sysdiv << 1) | extract32(rcc2, 22, 1)) + 1);
         }
-    } else {  /* rcc2 is not used */
-        if (((RCC_Val >> 16) & 0x01) == 0x01) {  /* check USESYSCLK */
-            if (((RCC_Val >> 23) & 0x01) == 0x01) {  /* check BYPASS */
-                __CORE_CLK_PRE = XTALI;
-            } else {  /* PLL is used */
-                uint32_t __PLL_MULT = ((RCC_Val >> 18) & 0x1F) + 2;
-                uint32_t __PLL_DIV = ((RCC_Val >> 12) & 0x3F) + 1;
-                uint32_t __PLL_SOURCE = ((RCC_Val >> 16) & 0x01);
-                if (__PLL_SOURCE == 0) {  /* source is XTAL */
-                    __CORE_CLK_PRE = (XTALI * __PLL_MULT) / __PLL_DIV;
-                } else {  /* source is internal oscillator */
-                    __CORE_CLK_PRE = (16000000UL * __PLL_MULT) / __PLL_DIV;  /* internal oscillator frequency is 16MHz */
+        return PLL_CLK / 2 / (sysdiv + 1);
+    }
+    if (!bypass) {
+        LOG(LOG_GUEST_ERROR, "PLL selected but not running, using the oscillator\n");
+    }
+    if (!(rcc & SYSCTL_RCC_USESYSDIV)) {
+        sysdiv = 0;
+    }
+    return tm4c123_sysctl_osc_hz(s, oscsrc) / (sysdiv + 1);
+}
+
+/* Gate register at @rcgc, which may also be an SCGC or DCGC register */
+static uint32_t *tm4c123_sysctl_rcgc(TM4C123SysCtlState *s, hwaddr rcgc)
+{
+    switch (rcgc) {
+        case SYSCTL_RCGCWD:
+            return &s->sysctl_rcgcwd;
+        case SYSCTL_RCGCTIMER:
+            return &s->sysctl_rcgctimer;
+        case SYSCTL_RCGCGPIO:
+            return &s->sysctl_rcgcgpio;
+        case SYSCTL_RCGCDMA:
+            return &s->sysctl_rcgcdma;
+        case SYSCTL_RCGCHIB:
+            return &s->sysctl_rcgchib;
+        case SYSCTL_RCGCUART:
+            return &s->sysctl_rcgcuart;
+        case SYSCTL_RCGCSSI:
+            return &s->sysctl_rcgcssi;
+        case SYSCTL_RCGCI2C:
+            return &s->sysctl_rcgci2c;
+        case SYSCTL_RCGCUSB:
+            return &s->sysctl_rcgcusb;
+        case SYSCTL_RCGCCAN:
+            return &s->sysctl_rcgccan;
+        case SYSCTL_RCGCADC:
+            return &s->sysctl_rcgcadc;
+        case SYSCTL_RCGCACMP:
+            return &s->sysctl_rcgcacmp;
+        case SYSCTL_RCGCPWM:
+            return &s->sysctl_rcgcpwm;
+        case SYSCTL_RCGCQEI:
+            return &s->sysctl_rcgcqei;
+        case SYSCTL_RCGCEEPROM:
+            return &s->sysctl_rcgceeprom;
+        case SYSCTL_RCGCWTIMER:
+            return &s->sysctl_rcgcwtimer;
+        case SYSCTL_SCGCWD:
+            return &s->sysctl_scgcwd;
+        case SYSCTL_SCGCTIMER:
+            return &s->sysctl_scgctimer;
+        case SYSCTL_SCGCGPIO:
+            return &s->sysctl_scgcgpio;
+        case SYSCTL_SCGCDMA:
+            return &s->sysctl_scgcdma;
+        case SYSCTL_SCGCHIB:
+            return &s->sysctl_scgchib;
+        case SYSCTL_SCGCUART:
+            return &s->sysctl_scgcuart;
+        case SYSCTL_SCGCSSI:
+            return &s->sysctl_scgcssi;
+        case SYSCTL_SCGCI2C:
+            return &s->sysctl_scgci2c;
+        case SYSCTL_SCGCUSB:
+            return &s->sysctl_scgcusb;
+        case SYSCTL_SCGCCAN:
+            return &s->sysctl_scgccan;
+        case SYSCTL_SCGCADC:
+            return &s->sysctl_scgcadc;
+        case SYSCTL_SCGCACMP:
+            return &s->sysctl_scgcacmp;
+        case SYSCTL_SCGCPWM:
+            return &s->sysctl_scgcpwm;
+        case SYSCTL_SCGCQEI:
+            return &s->sysctl_scgcqei;
+        case SYSCTL_SCGCEEPROM:
+            return &s->sysctl_scgceeprom;
+        case SYSCTL_SCGCWTIMER:
+            return &s->sysctl_scgcwtimer;
+        case SYSCTL_DCGCWD:
+            return &s->sysctl_dcgcwd;
+        case SYSCTL_DCGCTIMER:
+            return &s->sysctl_dcgctimer;
+        case SYSCTL_DCGCGPIO:
+            return &s->sysctl_dcgcgpio;
+        case SYSCTL_DCGCDMA:
+            return &s->sysctl_dcgcdma;
+        case SYSCTL_DCGCHIB:
+            return &s->sysctl_dcgchib;
+        case SYSCTL_DCGCUART:
+            return &s->sysctl_dcgcuart;
+        case SYSCTL_DCGCSSI:
+            return &s->sysctl_dcgcssi;
+        case SYSCTL_DCGCI2C:
+            return &s->sysctl_dcgci2c;
+        case SYSCTL_DCGCUSB:
+            return &s->sysctl_dcgcusb;
+        case SYSCTL_DCGCCAN:
+            return &s->sysctl_dcgccan;
+        case SYSCTL_DCGCADC:
+            return &s->sysctl_dcgcadc;
+        case SYSCTL_DCGCACMP:
+            return &s->sysctl_dcgcacmp;
+        case SYSCTL_DCGCPWM:
+            return &s->sysctl_dcgcpwm;
+        case SYSCTL_DCGCQEI:
+            return &s->sysctl_dcgcqei;
+        case SYSCTL_DCGCEEPROM:
+            return &s->sysctl_dcgceeprom;
+        case SYSCTL_DCGCWTIME:
+            return &s->sysctl_dcgcwtime;
+    }
+    g_assert_not_reached();
+}
+
+/* Deep-sleep system clock: DSOSCSRC divided by DSDIVORIDE, the PLL is off */
+static uint32_t tm4c123_sysctl_deep_sleep_hz(TM4C123SysCtlState *s)
+{
+    unsigned oscsrc = extract32(s->sysctl_dslpclkcfg, 4, 3);
+    unsigned div = extract32(s->sysctl_dslpclkcfg, 23, 6) + 1;
+
+    return tm4c123_sysctl_osc_hz(s, oscsrc) / div;
+}
+
+/*
+ * Offset from an RCGC register to the one gating the same modules in the
+ * current power mode. Without RCC.ACG the run mode gates stay in charge.
+ */
+static hwaddr tm4c123_sysctl_gate_bank(TM4C123SysCtlState *s)
+{
+    if (!(s->sysctl_rcc & SYSCTL_RCC_ACG)) {
+        return 0;
+    }
+    switch (s->power_mode) {
+        case TM4C123_POWER_SLEEP:
+            return SYSCTL_SCGCWD - SYSCTL_RCGCWD;
+        case TM4C123_POWER_DEEP_SLEEP:
+            return SYSCTL_DCGCWD - SYSCTL_RCGCWD;
+    }
+    return 0;
+}
+
+/*
+ * Recompute the clock tree. Only RCC, RCC2 and the RCGC registers feed
+ * it, so it runs on writes to those and the cached Clocks serve every
+ * consumer in between. With @propagate clear (after migration) only the
+ * periods are restored; the consumers carry their own copies.
+ */
+static void tm4c123_sysctl_update_clocks(TM4C123SysCtlState *s, bool propagate)
+{
+    uint32_t hz = s->power_mode == TM4C123_POWER_DEEP_SLEEP ?
+                  tm4c123_sysctl_deep_sleep_hz(s) : tm4c123_sysctl_sysclk_hz(s);
+    uint64_t sysclk = CLOCK_PERIOD_FROM_HZ(hz);
+    hwaddr bank = tm4c123_sysctl_gate_bank(s);
+    uint64_t piosc = CLOCK_PERIOD_FROM_HZ(XTALI);
+    uint64_t pwmclk = sysclk;
+    int i;
+    int j;
+
+    trace_tm4c123_sysctl_update_system_clock(hz);
+    if (propagate) {
+        clock_update(s->mainclk, sysclk);
+    } else {
+        clock_set(s->mainclk, sysclk);
+        clock_set(s->outclk, sysclk);
+    }
+
+    /* USEPWMDIV divides the system clock by 2 to 64 for the PWM modules */
+    if (s->sysctl_rcc & SYSCTL_RCC_USEPWMDIV) {
+        pwmclk = sysclk * (2 << MIN(extract32(s->sysctl_rcc, 17, 3), 5));
+    }
+
+    for (i = 0; i < ARRAY_SIZE(tm4c123_periph_clocks); i++) {
+        const TM4C123PeriphClockInfo *info = &tm4c123_periph_clocks[i];
+        int idx = tm4c123_sysctl_rcgc_index(info->rcgc);
+        uint32_t gates = *tm4c123_sysctl_rcgc(s, info->rcgc + bank);
+
+        for (j = 0; j < info->count; j++) {
+            uint64_t period = 0;
+
+            if (extract32(gates, j, 1)) {
+                period = extract32(info->piosc, j, 1) ? piosc : sysclk;
+                if (info->rcgc == SYSCTL_RCGCPWM) {
+                    period = pwmclk;
                 }
             }
-        } else {  /* USESYSCLK bit is not set */
-            __CORE_CLK_PRE = 16000000UL;  /* default to internal oscillator frequency */
+            if (propagate) {
+                clock_update(s->periph_clk[idx][j], period);
+            } else {
+                clock_set(s->periph_clk[idx][j], period);
+            }
         }
-        __CORE_CLK = __CORE_CLK_PRE / 1UL;  /* no division needed since BYPASS is not set */
     }
-    trace_tm4c123_sysctl_update_system_clock(__CORE_CLK);
-    clock_update_hz(s->mainclk, __CORE_CLK);
+}
+
+/*
+ * The core went to sleep or woke up. Deep sleep runs the system clock from
+ * DSLPCLKCFG, and with RCC.ACG set the SCGC or DCGC registers take over
+ * the module gates until the core is back in run mode.
+ */
+void tm4c123_sysctl_set_power_mode(TM4C123SysCtlState *s, TM4C123PowerMode mode)
+{
+    if (s->power_mode == mode) {
+        return;
+    }
+    trace_tm4c123_sysctl_power_mode(mode);
+    s->power_mode = mode;
+    tm4c123_sysctl_update_clocks(s, true);
+}
+
+/* Module clock of bit @bit of the RCGC register at @rcgc */
+Clock *tm4c123_sysctl_clock(TM4C123SysCtlState *s, hwaddr rcgc, int bit)
+{
+    Clock *clk = s->periph_clk[tm4c123_sysctl_rcgc_index(rcgc)][bit];
+
+    assert(clk);
+    return clk;
 }
 
 static void tm4c123_sysctl_reset(DeviceState *dev)
 {
     TM4C123SysCtlState *s = TM4C123_SYSCTL(dev);
 
-    s->sysctl_did0 = 0x00000000;
-    s->sysctl_did1 = 0x10A1606E;
+    s->power_mode = TM4C123_POWER_RUN;
     s->sysctl_pborctl = 0x00000000;
     s->sysctl_ris = 0x00000000;
     s->sysctl_imc = 0x00000000;
@@ -177,22 +363,6 @@ static void tm4c123_sysctl_reset(DeviceState *dev)
     s->sysctl_ldodpctl = 0x00000012;
     s->sysctl_ldodpcal = 0x00001212;
     s->sysctl_sdpmst = 0x00000000;
-    s->sysctl_ppwd = 0x00000003;
-    s->sysctl_pptimer = 0x0000003F;
-    s->sysctl_ppgpio = 0x0000003F;
-    s->sysctl_ppdma = 0x00000001;
-    s->sysctl_pphib = 0x00000001;
-    s->sysctl_ppuart = 0x000000FF;
-    s->sysctl_ppsi = 0x0000000F;
-    s->sysctl_ppi2c = 0x0000000F;
-    s->sysctl_ppusb = 0x00000001;
-    s->sysctl_ppcan = 0x00000003;
-    s->sysctl_ppadc = 0x00000003;
-    s->sysctl_ppacmp = 0x00000001;
-    s->sysctl_pppwm = 0x00000003;
-    s->sysctl_ppqei = 0x00000003;
-    s->sysctl_ppeeprom = 0x00000001;
-    s->sysctl_ppwtimer = 0x0000003F;
     s->sysctl_srwd = 0x00000000;
     s->sysctl_srtimer = 0x00000000;
     s->sysctl_srgpio = 0x00000000;
@@ -273,6 +443,7 @@ static void tm4c123_sysctl_reset(DeviceState *dev)
     s->sysctl_prqei = 0x00000000;
     s->sysctl_preeprom = 0x00000000;
     s->sysctl_prwtimer = 0x00000000;
+    tm4c123_sysctl_update_clocks(s, true);
 }
 
 static void tm4c123_sysctl_write(void *opaque, hwaddr addr, uint64_t val64, unsigned int size)
@@ -316,7 +487,7 @@ static void tm4c123_sysctl_write(void *opaque, hwaddr addr, uint64_t val64, unsi
             if (s->sysctl_rcc & SYSCTL_RCC_PWRDN && !(s->sysctl_rcc2 & SYSCTL_RCC2_USERCC2)) {
                 s->sysctl_ris |= SYSCTL_RIS_PLLRIS;
             }
-            tm4c123_sysctl_update_system_clock(s);
+            tm4c123_sysctl_update_clocks(s, true);
             break;
         case SYSCTL_GPIOHBCTL:
             s->sysctl_gpiohbctl = val32;
@@ -329,7 +500,7 @@ static void tm4c123_sysctl_write(void *opaque, hwaddr addr, uint64_t val64, unsi
             if (s->sysctl_rcc2 & SYSCTL_RCC2_USERCC2 && !(s->sysctl_rcc2 & SYSCTL_RCC2_PWRDN2)) {
                 s->sysctl_ris |= SYSCTL_RIS_PLLRIS;
             }
-            tm4c123_sysctl_update_system_clock(s);
+            tm4c123_sysctl_update_clocks(s, true);
             break;
         case SYSCTL_MOSCCTL:
             s->sysctl_moscctl = val32;
@@ -682,6 +853,10 @@ static void tm4c123_sysctl_write(void *opaque, hwaddr addr, uint64_t val64, unsi
             LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
             break;
     }
+
+    if (addr >= SYSCTL_RCGCWD && addr <= SYSCTL_RCGCWTIMER) {
+        tm4c123_sysctl_update_clocks(s, true);
+    }
 }
 
 static uint64_t tm4c123_sysctl_read(void *opaque, hwaddr addr, unsigned int size)
@@ -949,11 +1124,27 @@ static const MemoryRegionOps tm4c123_sysctl_ops = {
 static void tm4c123_sysctl_init(Object *obj)
 {
     TM4C123SysCtlState *s = TM4C123_SYSCTL(obj);
+    int i;
+    int j;
 
     s->mainclk = clock_new(OBJECT(s), "main-clk");
     clock_set_hz(s->mainclk, 1000 * 1000);
     s->outclk = qdev_init_clock_out(DEVICE(s), "outclk");
     clock_set_source(s->outclk, s->mainclk);
+    /* SysTick's reference clock is the PIOSC divided by 4 */
+    s->refclk = qdev_init_clock_out(DEVICE(s), "refclk");
+    clock_set_hz(s->refclk, XTALI / 4);
+
+    for (i = 0; i < ARRAY_SIZE(tm4c123_periph_clocks); i++) {
+        const TM4C123PeriphClockInfo *info = &tm4c123_periph_clocks[i];
+        int idx = tm4c123_sysctl_rcgc_index(info->rcgc);
+
+        for (j = 0; j < info->count; j++) {
+            g_autofree char *name = g_strdup_printf("%s%d", info->name, j);
+
+            s->periph_clk[idx][j] = qdev_init_clock_out(DEVICE(s), name);
+        }
+    }
 
     memory_region_init_io(&s->mmio, obj, &tm4c123_sysctl_ops, s, TYPE_TM4C123_SYSCTL, 0xFFF);
     sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
@@ -962,15 +1153,180 @@ static void tm4c123_sysctl_init(Object *obj)
 static void tm4c123_sysctl_realize(DeviceState *dev, Error **errp)
 {
     TM4C123SysCtlState *s = TM4C123_SYSCTL(dev);
-    tm4c123_sysctl_update_system_clock(s);
+    tm4c123_sysctl_update_clocks(s, true);
+
+}
 
+static int tm4c123_sysctl_post_load(void *opaque, int version_id)
+{
+    tm4c123_sysctl_update_clocks(opaque, false);
+    return 0;
 }
 
+static const VMStateDescription vmstate_tm4c123_sysctl = {
+    .name = TYPE_TM4C123_SYSCTL,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = tm4c123_sysctl_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(sysctl_did0, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_did1, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_pborctl, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ris, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_imc, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_misc, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_resc, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcc, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_gpiohbctl, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcc2, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_moscctl, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dslpclkcfg, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_sysprop, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_piosccal, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_pioscstat, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_pllfreq0, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_pllfreq1, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_pllstat, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_slppwrcfg, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dslppwrcfg, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ldospctl, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ldospcal, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ldodpctl, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ldodpcal, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_sdpmst, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppwd, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_pptimer, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppgpio, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppdma, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_pphib, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppuart, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppsi, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppi2c, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppusb, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppcan, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppadc, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppacmp, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_pppwm, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppqei, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppeeprom, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_ppwtimer, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_srwd, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_srtimer, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_srgpio, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_srdma, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_srhib, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_sruart, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_srssi, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_sri2c, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_srusb, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_srcan, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_sradc, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_sracmp, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_srpwm, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_srqei, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_sreeprom, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_srwtimer, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgcwd, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgctimer, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgcgpio, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgcdma, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgchib, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgcuart, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgcssi, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgci2c, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgcusb, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgccan, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgcadc, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgcacmp, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgcpwm, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgcqei, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgceeprom, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_rcgcwtimer, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgcwd, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgctimer, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgcgpio, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgcdma, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgchib, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgcuart, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgcssi, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgci2c, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgcusb, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgccan, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgcadc, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgcacmp, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgcpwm, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgcqei, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgceeprom, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_scgcwtimer, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgcwd, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgctimer, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgcgpio, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgcdma, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgchib, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgcuart, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgcssi, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgci2c, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgcusb, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgccan, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgcadc, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgcacmp, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgcpwm, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgcqei, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgceeprom, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_dcgcwtime, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_prwd, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_prtimer, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_prgpio, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_prdma, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_prhib, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_pruart, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_prssi, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_pri2c, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_prusb, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_prcan, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_pradc, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_pracmp, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_prpwm, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_prqei, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_preeprom, TM4C123SysCtlState),
+        VMSTATE_UINT32(sysctl_prwtimer, TM4C123SysCtlState),
+        VMSTATE_UINT32(power_mode, TM4C123SysCtlState),
+        VMSTATE_CLOCK(mainclk, TM4C123SysCtlState),
+        VMSTATE_CLOCK(outclk, TM4C123SysCtlState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+/* The part's identity and the modules it has, as the SoC describes them */
+static Property tm4c123_sysctl_properties[] = {
+    DEFINE_PROP_UINT32("did0", TM4C123SysCtlState, sysctl_did0, 0x10050101),
+    DEFINE_PROP_UINT32("did1", TM4C123SysCtlState, sysctl_did1, 0x10A1606E),
+    DEFINE_PROP_UINT32("ppwd", TM4C123SysCtlState, sysctl_ppwd, 0x00000003),
+    DEFINE_PROP_UINT32("pptimer", TM4C123SysCtlState, sysctl_pptimer, 0x0000003F),
+    DEFINE_PROP_UINT32("ppgpio", TM4C123SysCtlState, sysctl_ppgpio, 0x0000003F),
+    DEFINE_PROP_UINT32("ppdma", TM4C123SysCtlState, sysctl_ppdma, 0x00000001),
+    DEFINE_PROP_UINT32("pphib", TM4C123SysCtlState, sysctl_pphib, 0x00000001),
+    DEFINE_PROP_UINT32("ppuart", TM4C123SysCtlState, sysctl_ppuart, 0x000000FF),
+    DEFINE_PROP_UINT32("ppssi", TM4C123SysCtlState, sysctl_ppsi, 0x0000000F),
+    DEFINE_PROP_UINT32("ppi2c", TM4C123SysCtlState, sysctl_ppi2c, 0x0000000F),
+    DEFINE_PROP_UINT32("ppusb", TM4C123SysCtlState, sysctl_ppusb, 0x00000001),
+    DEFINE_PROP_UINT32("ppcan", TM4C123SysCtlState, sysctl_ppcan, 0x00000003),
+    DEFINE_PROP_UINT32("ppadc", TM4C123SysCtlState, sysctl_ppadc, 0x00000003),
+    DEFINE_PROP_UINT32("ppacmp", TM4C123SysCtlState, sysctl_ppacmp, 0x00000001),
+    DEFINE_PROP_UINT32("pppwm", TM4C123SysCtlState, sysctl_pppwm, 0x00000003),
+    DEFINE_PROP_UINT32("ppqei", TM4C123SysCtlState, sysctl_ppqei, 0x00000003),
+    DEFINE_PROP_UINT32("ppeeprom", TM4C123SysCtlState, sysctl_ppeeprom, 0x00000001),
+    DEFINE_PROP_UINT32("ppwtimer", TM4C123SysCtlState, sysctl_ppwtimer, 0x0000003F),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
 static void tm4c123_sysctl_class_init(ObjectClass *kclass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(kclass);
     dc->reset = tm4c123_sysctl_reset;
     dc->realize = tm4c123_sysctl_realize;
+    dc->vmsd = &vmstate_tm4c123_sysctl;
+    device_class_set_props(dc, tm4c123_sysctl_properties);
 }
 
 static const TypeInfo tm4c123_sysctl_info = {
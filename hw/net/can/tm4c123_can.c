@@ -0,0 +1,845 @@
+/*
+ * TM4C123 CAN
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "hw/net/tm4c123_can.h"
+#include "hw/irq.h"
+#include "hw/qdev-properties.h"
+#include "hw/qdev-clock.h"
+#include "qemu/bitops.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "migration/vmstate.h"
+#include "trace.h"
+
+#define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
+#define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
+
+/* Bit 29 of a filter key holds XTD, under the 29-bit arbitration field */
+#define CAN_KEY_XTD (1 << 29)
+/* Standard identifiers sit in ID[28:18] of the arbitration field */
+#define CAN_STD_SHIFT 18
+#define CAN_STD_UNUSED ((1 << CAN_STD_SHIFT) - 1)
+
+static uint32_t can_obj_key(TM4C123CANObject *o)
+{
+    uint32_t key = ((o->arb2 & 0x1FFF) << 16) | o->arb1;
+
+    return o->arb2 & CAN_ARB2_XTD ? key | CAN_KEY_XTD : key;
+}
+
+/* ID bits that take part in acceptance filtering, with XTD as bit 29 */
+static uint32_t can_obj_mask(TM4C123CANObject *o)
+{
+    uint32_t mask = QEMU_CAN_EFF_MASK | CAN_KEY_XTD;
+
+    if (o->mctl & CAN_MCTL_UMASK) {
+        mask = ((o->msk2 & 0x1FFF) << 16) | o->msk1;
+        if (o->msk2 & CAN_MSK2_MXTD) {
+            mask |= CAN_KEY_XTD;
+        }
+    }
+    if (!(o->arb2 & CAN_ARB2_XTD)) {
+        mask &= ~CAN_STD_UNUSED;
+    }
+    return mask;
+}
+
+typedef struct {
+    uint8_t filter;
+    uint32_t key;
+    uint32_t obj;
+} CANIndexEntry;
+
+static int can_index_entry_cmp(const void *a, const void *b)
+{
+    const CANIndexEntry *ea = a;
+    const CANIndexEntry *eb = b;
+
+    if (ea->filter != eb->filter) {
+        return ea->filter < eb->filter ? -1 : 1;
+    }
+    if (ea->key != eb->key) {
+        return ea->key < eb->key ? -1 : 1;
+    }
+    return 0;
+}
+
+/*
+ * Group the valid objects of one direction by acceptance mask, and sort
+ * each group by masked identifier. A frame then costs one binary search
+ * per distinct mask rather than a comparison per object.
+ */
+static void can_index_build(TM4C123CANState *s, TM4C123CANIndex *idx, bool dir)
+{
+    CANIndexEntry ent[CAN_OBJECTS];
+    TM4C123CANObject *o;
+    TM4C123CANFilter *f;
+    uint32_t mask;
+    int n = 0;
+    int c = 0;
+    int i;
+    int j;
+
+    idx->num_filters = 0;
+    for (i = 0; i < CAN_OBJECTS; i++) {
+        o = &s->objs[i];
+        if (!(o->arb2 & CAN_ARB2_MSGVAL) || !!(o->arb2 & CAN_ARB2_DIR) != dir) {
+            continue;
+        }
+        mask = can_obj_mask(o);
+        for (j = 0; j < idx->num_filters; j++) {
+            if (idx->filters[j].mask == mask) {
+                break;
+            }
+        }
+        if (j == idx->num_filters) {
+            idx->filters[j].mask = mask;
+            idx->filters[j].count = 0;
+            idx->num_filters++;
+        }
+        ent[n++] = (CANIndexEntry) {j, can_obj_key(o) & mask, 1u << i};
+    }
+
+    qsort(ent, n, sizeof(ent[0]), can_index_entry_cmp);
+    for (i = 0; i < n; i++) {
+        f = &idx->filters[ent[i].filter];
+        if (i && ent[i].filter == ent[i - 1].filter && ent[i].key == ent[i - 1].key) {
+            idx->objs[c - 1] |= ent[i].obj;
+            continue;
+        }
+        if (!f->count) {
+            f->first = c;
+        }
+        f->count++;
+        idx->keys[c] = ent[i].key;
+        idx->objs[c] = ent[i].obj;
+        c++;
+    }
+}
+
+/* Objects of @idx that accept @key */
+static uint32_t can_index_lookup(TM4C123CANIndex *idx, uint32_t key)
+{
+    TM4C123CANFilter *f;
+    uint32_t match = 0;
+    uint32_t k;
+    int lo, hi, mid;
+    int i;
+
+    for (i = 0; i < idx->num_filters; i++) {
+        f = &idx->filters[i];
+        k = key & f->mask;
+        lo = f->first;
+        hi = f->first + f->count;
+        while (lo < hi) {
+            mid = (lo + hi) / 2;
+            if (idx->keys[mid] < k) {
+                lo = mid + 1;
+            } else {
+                hi = mid;
+            }
+        }
+        if (lo < f->first + f->count && idx->keys[lo] == k) {
+            match |= idx->objs[lo];
+        }
+    }
+    return match;
+}
+
+static void can_index_refresh(TM4C123CANState *s)
+{
+    if (s->index_dirty) {
+        can_index_build(s, &s->rx_index, false);
+        can_index_build(s, &s->rmt_index, true);
+        s->index_dirty = false;
+    }
+}
+
+static uint32_t can_int_id(TM4C123CANState *s)
+{
+    int i;
+
+    if (s->status_int) {
+        return CAN_INT_STATUS;
+    }
+    for (i = 0; i < CAN_OBJECTS; i++) {
+        if (s->objs[i].mctl & CAN_MCTL_INTPND) {
+            return i + 1;
+        }
+    }
+    return 0;
+}
+
+static void can_update(TM4C123CANState *s)
+{
+    qemu_set_irq(s->irq, (s->can_ctl & CAN_CTL_IE) && can_int_id(s));
+}
+
+/* A frame went out or came in without error */
+static void can_status(TM4C123CANState *s, uint32_t ok)
+{
+    s->can_sts = (s->can_sts & ~0x7) | ok;
+    if (s->can_ctl & CAN_CTL_SIE) {
+        s->status_int = true;
+    }
+}
+
+static bool can_test_mode(TM4C123CANState *s, uint32_t mode)
+{
+    return (s->can_ctl & CAN_CTL_TEST) && (s->can_tst & mode);
+}
+
+static void can_store(TM4C123CANObject *o, const qemu_can_frame *frame, uint32_t key)
+{
+    int i;
+
+    o->arb1 = key & 0xFFFF;
+    o->arb2 = (o->arb2 & ~(CAN_ARB2_XTD | 0x1FFF)) | ((key >> 16) & 0x1FFF);
+    if (key & CAN_KEY_XTD) {
+        o->arb2 |= CAN_ARB2_XTD;
+    }
+    for (i = 0; i < 4; i++) {
+        o->data[i] = frame->data[2 * i] | (frame->data[2 * i + 1] << 8);
+    }
+    if (o->mctl & CAN_MCTL_NEWDAT) {
+        o->mctl |= CAN_MCTL_MSGLST;
+    }
+    o->mctl = (o->mctl & ~CAN_MCTL_DLC) | MIN(frame->can_dlc, 8) | CAN_MCTL_NEWDAT;
+    if (o->mctl & CAN_MCTL_RXIE) {
+        o->mctl |= CAN_MCTL_INTPND;
+    }
+}
+
+static void can_transmit(TM4C123CANState *s);
+
+static void can_receive_frame(TM4C123CANState *s, const qemu_can_frame *frame)
+{
+    bool eff = frame->can_id & QEMU_CAN_EFF_FLAG;
+    uint32_t key;
+    uint32_t match;
+    int n = -1;
+    int i;
+
+    if (frame->flags & QEMU_CAN_FRMF_TYPE_FD) {
+        return;
+    }
+    key = eff ? (frame->can_id & QEMU_CAN_EFF_MASK) | CAN_KEY_XTD
+              : (frame->can_id & QEMU_CAN_SFF_MASK) << CAN_STD_SHIFT;
+
+    can_index_refresh(s);
+    if (frame->can_id & QEMU_CAN_RTR_FLAG) {
+        /* The lowest matching transmit object answers, if RMTEN allows */
+        match = can_index_lookup(&s->rmt_index, key);
+        if (match) {
+            n = ctz32(match);
+            if (s->objs[n].mctl & CAN_MCTL_RMTEN) {
+                s->objs[n].mctl |= CAN_MCTL_TXRQST;
+            }
+        }
+    } else {
+        /*
+         * A FIFO buffer is a run of objects with EOB clear up to one with
+         * EOB set: each frame goes to the first of them still empty.
+         */
+        match = can_index_lookup(&s->rx_index, key);
+        while (match) {
+            i = ctz32(match);
+            match &= match - 1;
+            n = i;
+            if (!(s->objs[i].mctl & CAN_MCTL_NEWDAT) || (s->objs[i].mctl & CAN_MCTL_EOB)) {
+                break;
+            }
+        }
+        if (n >= 0) {
+            can_store(&s->objs[n], frame, key);
+        }
+    }
+
+    trace_tm4c123_can_rx(frame->can_id, frame->can_dlc, n + 1);
+    if (n >= 0) {
+        can_status(s, CAN_STS_RXOK);
+    }
+    can_transmit(s);
+    can_update(s);
+}
+
+/* Send every pending transmit request, lowest object first */
+static void can_transmit(TM4C123CANState *s)
+{
+    TM4C123CANObject *o;
+    qemu_can_frame frame;
+    uint32_t key;
+    int n;
+    int i;
+
+    if (s->transmitting) {
+        return;
+    }
+    s->transmitting = true;
+
+    while (!(s->can_ctl & CAN_CTL_INIT) && clock_is_enabled(s->clk)) {
+        /* Silent mode cannot drive the bus, so only loopback completes */
+        if (can_test_mode(s, CAN_TST_SILENT) && !can_test_mode(s, CAN_TST_LBACK)) {
+            break;
+        }
+        for (n = 0; n < CAN_OBJECTS; n++) {
+            o = &s->objs[n];
+            if ((o->mctl & CAN_MCTL_TXRQST) && (o->arb2 & CAN_ARB2_MSGVAL)) {
+                break;
+            }
+        }
+        if (n == CAN_OBJECTS) {
+            break;
+        }
+
+        memset(&frame, 0, sizeof(frame));
+        key = can_obj_key(o);
+        if (key & CAN_KEY_XTD) {
+            frame.can_id = (key & QEMU_CAN_EFF_MASK) | QEMU_CAN_EFF_FLAG;
+        } else {
+            frame.can_id = (key >> CAN_STD_SHIFT) & QEMU_CAN_SFF_MASK;
+        }
+        frame.can_dlc = MIN(o->mctl & CAN_MCTL_DLC, 8);
+        if (o->arb2 & CAN_ARB2_DIR) {
+            for (i = 0; i < 4; i++) {
+                frame.data[2 * i] = o->data[i];
+                frame.data[2 * i + 1] = o->data[i] >> 8;
+            }
+            o->mctl &= ~CAN_MCTL_NEWDAT;
+        } else {
+            /* A receive object with TXRQST asks for its data remotely */
+            frame.can_id |= QEMU_CAN_RTR_FLAG;
+        }
+        o->mctl &= ~CAN_MCTL_TXRQST;
+        if (o->mctl & CAN_MCTL_TXIE) {
+            o->mctl |= CAN_MCTL_INTPND;
+        }
+        can_status(s, CAN_STS_TXOK);
+        trace_tm4c123_can_tx(frame.can_id, frame.can_dlc, n + 1);
+
+        if (s->canbus && !can_test_mode(s, CAN_TST_SILENT)) {
+            can_bus_client_send(&s->bus_client, &frame, 1);
+        }
+        /* Requests this raises are picked up by the loop, not nested */
+        if (can_test_mode(s, CAN_TST_LBACK)) {
+            can_receive_frame(s, &frame);
+        }
+    }
+
+    s->transmitting = false;
+    can_update(s);
+}
+
+/* Move a message object to or from an interface register set */
+static void can_if_transfer(TM4C123CANState *s, TM4C123CANIF *cif, uint32_t num)
+{
+    TM4C123CANObject *o;
+    TM4C123CANObject *r = &cif->regs;
+    uint32_t cmsk = cif->cmsk;
+
+    if (num < 1 || num > CAN_OBJECTS) {
+        LOG(LOG_GUEST_ERROR, "Bad message object number %u\n", num);
+        return;
+    }
+    o = &s->objs[num - 1];
+
+    if (cmsk & CAN_CMSK_WRNRD) {
+        if (cmsk & CAN_CMSK_MASK) {
+            o->msk1 = r->msk1;
+            o->msk2 = r->msk2;
+        }
+        if (cmsk & CAN_CMSK_ARB) {
+            o->arb1 = r->arb1;
+            o->arb2 = r->arb2;
+        }
+        if (cmsk & CAN_CMSK_CONTROL) {
+            o->mctl = r->mctl;
+        }
+        if (cmsk & CAN_CMSK_DATAA) {
+            o->data[0] = r->data[0];
+            o->data[1] = r->data[1];
+        }
+        if (cmsk & CAN_CMSK_DATAB) {
+            o->data[2] = r->data[2];
+            o->data[3] = r->data[3];
+        }
+        if (cmsk & CAN_CMSK_NEWDAT) {
+            o->mctl |= CAN_MCTL_TXRQST;
+        }
+        if (cmsk & (CAN_CMSK_MASK | CAN_CMSK_ARB | CAN_CMSK_CONTROL)) {
+            s->index_dirty = true;
+        }
+        can_transmit(s);
+    } else {
+        if (cmsk & CAN_CMSK_MASK) {
+            r->msk1 = o->msk1;
+            r->msk2 = o->msk2;
+        }
+        if (cmsk & CAN_CMSK_ARB) {
+            r->arb1 = o->arb1;
+            r->arb2 = o->arb2;
+        }
+        if (cmsk & CAN_CMSK_CONTROL) {
+            r->mctl = o->mctl;
+        }
+        if (cmsk & CAN_CMSK_DATAA) {
+            r->data[0] = o->data[0];
+            r->data[1] = o->data[1];
+        }
+        if (cmsk & CAN_CMSK_DATAB) {
+            r->data[2] = o->data[2];
+            r->data[3] = o->data[3];
+        }
+        /* The interface keeps the flags as they were before clearing */
+        if (cmsk & CAN_CMSK_CLRINTPND) {
+            o->mctl &= ~CAN_MCTL_INTPND;
+        }
+        if (cmsk & CAN_CMSK_NEWDAT) {
+            o->mctl &= ~CAN_MCTL_NEWDAT;
+        }
+    }
+}
+
+static uint64_t can_if_read(TM4C123CANIF *cif, hwaddr reg)
+{
+    switch (reg) {
+        case CAN_IF_CRQ:
+            return cif->crq;
+        case CAN_IF_CMSK:
+            return cif->cmsk;
+        case CAN_IF_MSK1:
+            return cif->regs.msk1;
+        case CAN_IF_MSK2:
+            return cif->regs.msk2;
+        case CAN_IF_ARB1:
+            return cif->regs.arb1;
+        case CAN_IF_ARB2:
+            return cif->regs.arb2;
+        case CAN_IF_MCTL:
+            return cif->regs.mctl;
+        case CAN_IF_DA1:
+        case CAN_IF_DA2:
+        case CAN_IF_DB1:
+        case CAN_IF_DB2:
+            return cif->regs.data[(reg - CAN_IF_DA1) / 4];
+        default:
+            return 0;
+    }
+}
+
+static void can_if_write(TM4C123CANState *s, TM4C123CANIF *cif, hwaddr reg, uint32_t val32)
+{
+    switch (reg) {
+        case CAN_IF_CRQ:
+            /* Transfers complete at once, BUSY never shows */
+            cif->crq = val32 & 0x3F;
+            can_if_transfer(s, cif, cif->crq);
+            break;
+        case CAN_IF_CMSK:
+            cif->cmsk = val32 & 0xFF;
+            break;
+        case CAN_IF_MSK1:
+            cif->regs.msk1 = val32;
+            break;
+        case CAN_IF_MSK2:
+            cif->regs.msk2 = val32 & 0xDFFF;
+            break;
+        case CAN_IF_ARB1:
+            cif->regs.arb1 = val32;
+            break;
+        case CAN_IF_ARB2:
+            cif->regs.arb2 = val32;
+            break;
+        case CAN_IF_MCTL:
+            cif->regs.mctl = val32 & 0xFF8F;
+            break;
+        case CAN_IF_DA1:
+        case CAN_IF_DA2:
+        case CAN_IF_DB1:
+        case CAN_IF_DB2:
+            cif->regs.data[(reg - CAN_IF_DA1) / 4] = val32;
+            break;
+    }
+}
+
+static uint32_t can_obj_bits(TM4C123CANState *s, int first, bool (*test)(TM4C123CANObject *))
+{
+    uint32_t bits = 0;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        if (test(&s->objs[first + i])) {
+            bits |= 1 << i;
+        }
+    }
+    return bits;
+}
+
+static bool can_obj_txrqst(TM4C123CANObject *o)
+{
+    return o->mctl & CAN_MCTL_TXRQST;
+}
+
+static bool can_obj_newdat(TM4C123CANObject *o)
+{
+    return o->mctl & CAN_MCTL_NEWDAT;
+}
+
+static bool can_obj_intpnd(TM4C123CANObject *o)
+{
+    return o->mctl & CAN_MCTL_INTPND;
+}
+
+static bool can_obj_msgval(TM4C123CANObject *o)
+{
+    return o->arb2 & CAN_ARB2_MSGVAL;
+}
+
+static bool tm4c123_can_can_receive(CanBusClientState *client)
+{
+    TM4C123CANState *s = container_of(client, TM4C123CANState, bus_client);
+
+    return !(s->can_ctl & CAN_CTL_INIT) && clock_is_enabled(s->clk);
+}
+
+static ssize_t tm4c123_can_receive(CanBusClientState *client,
+                                   const qemu_can_frame *frames, size_t frames_cnt)
+{
+    TM4C123CANState *s = container_of(client, TM4C123CANState, bus_client);
+    size_t i;
+
+    for (i = 0; i < frames_cnt; i++) {
+        can_receive_frame(s, &frames[i]);
+    }
+    return 1;
+}
+
+static CanBusClientInfo tm4c123_can_bus_client_info = {
+    .can_receive = tm4c123_can_can_receive,
+    .receive = tm4c123_can_receive,
+};
+
+static void tm4c123_can_reset(DeviceState *dev)
+{
+    TM4C123CANState *s = TM4C123_CAN(dev);
+    int i;
+
+    s->can_ctl = 0x00000001;
+    s->can_sts = 0x00000000;
+    s->can_bit = 0x00002301;
+    s->can_tst = 0x00000000;
+    s->can_brpe = 0x00000000;
+    s->status_int = false;
+
+    for (i = 0; i < CAN_INTERFACES; i++) {
+        s->ifs[i] = (TM4C123CANIF) {
+            .crq = 0x1,
+            .regs = { .msk1 = 0xFFFF, .msk2 = 0xFFFF },
+        };
+    }
+    memset(s->objs, 0, sizeof(s->objs));
+    s->index_dirty = true;
+
+    can_update(s);
+}
+
+static uint64_t tm4c123_can_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    TM4C123CANState *s = opaque;
+    uint32_t sts;
+
+    trace_tm4c123_can_read(addr);
+
+    if (addr >= CAN_IF1 && addr < CAN_IF1 + CAN_IF_SIZE) {
+        return can_if_read(&s->ifs[0], addr - CAN_IF1);
+    }
+    if (addr >= CAN_IF2 && addr < CAN_IF2 + CAN_IF_SIZE) {
+        return can_if_read(&s->ifs[1], addr - CAN_IF2);
+    }
+
+    switch (addr) {
+        case CAN_CTL:
+            return s->can_ctl;
+        case CAN_STS:
+            /* Reading the status ends the status interrupt */
+            sts = s->can_sts;
+            if (s->status_int) {
+                s->status_int = false;
+                can_update(s);
+            }
+            return sts;
+        case CAN_ERR:
+            return 0;
+        case CAN_BIT:
+            return s->can_bit;
+        case CAN_INT:
+            return can_int_id(s);
+        case CAN_TST:
+            /* CANnRX idles recessive */
+            return s->can_tst | CAN_TST_RX;
+        case CAN_BRPE:
+            return s->can_brpe;
+        case CAN_TXRQ1:
+            return can_obj_bits(s, 0, can_obj_txrqst);
+        case CAN_TXRQ2:
+            return can_obj_bits(s, 16, can_obj_txrqst);
+        case CAN_NWDA1:
+            return can_obj_bits(s, 0, can_obj_newdat);
+        case CAN_NWDA2:
+            return can_obj_bits(s, 16, can_obj_newdat);
+        case CAN_MSG1INT:
+            return can_obj_bits(s, 0, can_obj_intpnd);
+        case CAN_MSG2INT:
+            return can_obj_bits(s, 16, can_obj_intpnd);
+        case CAN_MSG1VAL:
+            return can_obj_bits(s, 0, can_obj_msgval);
+        case CAN_MSG2VAL:
+            return can_obj_bits(s, 16, can_obj_msgval);
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return 0;
+    }
+
+    return 0;
+}
+
+static void tm4c123_can_write(void *opaque, hwaddr addr, uint64_t val64, unsigned int size)
+{
+    TM4C123CANState *s = opaque;
+    uint32_t val32 = val64;
+
+    trace_tm4c123_can_write(addr, val32);
+
+    if (addr >= CAN_IF1 && addr < CAN_IF1 + CAN_IF_SIZE) {
+        can_if_write(s, &s->ifs[0], addr - CAN_IF1, val32);
+        can_update(s);
+        return;
+    }
+    if (addr >= CAN_IF2 && addr < CAN_IF2 + CAN_IF_SIZE) {
+        can_if_write(s, &s->ifs[1], addr - CAN_IF2, val32);
+        can_update(s);
+        return;
+    }
+
+    switch (addr) {
+        case CAN_CTL:
+            s->can_ctl = val32 & 0xEF;
+            if (!(s->can_ctl & CAN_CTL_TEST)) {
+                s->can_tst = 0;
+            }
+            /* Leaving initialization sends what was queued meanwhile */
+            can_transmit(s);
+            break;
+        case CAN_STS:
+            s->can_sts = (s->can_sts & ~0x1F) | (val32 & 0x1F);
+            break;
+        case CAN_BIT:
+            if ((s->can_ctl & (CAN_CTL_INIT | CAN_CTL_CCE)) == (CAN_CTL_INIT | CAN_CTL_CCE)) {
+                s->can_bit = val32 & 0x7FFF;
+            }
+            break;
+        case CAN_BRPE:
+            if ((s->can_ctl & (CAN_CTL_INIT | CAN_CTL_CCE)) == (CAN_CTL_INIT | CAN_CTL_CCE)) {
+                s->can_brpe = val32 & 0xF;
+            }
+            break;
+        case CAN_TST:
+            if (s->can_ctl & CAN_CTL_TEST) {
+                s->can_tst = val32 & 0x7C;
+                can_transmit(s);
+            }
+            break;
+        case CAN_ERR:
+        case CAN_INT:
+        case CAN_TXRQ1:
+        case CAN_TXRQ2:
+        case CAN_NWDA1:
+        case CAN_NWDA2:
+        case CAN_MSG1INT:
+        case CAN_MSG2INT:
+        case CAN_MSG1VAL:
+        case CAN_MSG2VAL:
+            READONLY;
+            break;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return;
+    }
+    can_update(s);
+}
+
+/* Accesses with the module clock gated off answer with a bus fault */
+static MemTxResult tm4c123_can_read_with_attrs(void *opaque, hwaddr addr, uint64_t *data,
+                                               unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123CANState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "CAN module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_can_read(opaque, addr, size);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_can_write_with_attrs(void *opaque, hwaddr addr, uint64_t val64,
+                                                unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123CANState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "CAN module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    tm4c123_can_write(opaque, addr, val64, size);
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps tm4c123_can_ops = {
+    .read_with_attrs = tm4c123_can_read_with_attrs,
+    .write_with_attrs = tm4c123_can_write_with_attrs,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static void can_clock_update(void *opaque, ClockEvent event)
+{
+    /* Requests queued while the clock was off go out when it returns */
+    can_transmit(opaque);
+}
+
+static Property tm4c123_can_properties[] = {
+    DEFINE_PROP_LINK("canbus", TM4C123CANState, canbus, TYPE_CAN_BUS,
+                     CanBusState *),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void tm4c123_can_init(Object *obj)
+{
+    TM4C123CANState *s = TM4C123_CAN(obj);
+
+    s->clk = qdev_init_clock_in(DEVICE(s), "can_clock", can_clock_update, s, ClockUpdate);
+
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+
+    memory_region_init_io(&s->mmio, obj, &tm4c123_can_ops, s,
+            TYPE_TM4C123_CAN, 0xFFF);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
+}
+
+static void tm4c123_can_realize(DeviceState *dev, Error **errp)
+{
+    TM4C123CANState *s = TM4C123_CAN(dev);
+
+    if (!s->canbus) {
+        return;
+    }
+    s->bus_client.info = &tm4c123_can_bus_client_info;
+    if (can_bus_insert_client(s->canbus, &s->bus_client) < 0) {
+        error_setg(errp, "cannot connect to the CAN bus");
+    }
+}
+
+static int tm4c123_can_post_load(void *opaque, int version_id)
+{
+    TM4C123CANState *s = opaque;
+
+    s->index_dirty = true;
+    return 0;
+}
+
+static const VMStateDescription vmstate_tm4c123_can_object = {
+    .name = "tm4c123-can-object",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT16(msk1, TM4C123CANObject),
+        VMSTATE_UINT16(msk2, TM4C123CANObject),
+        VMSTATE_UINT16(arb1, TM4C123CANObject),
+        VMSTATE_UINT16(arb2, TM4C123CANObject),
+        VMSTATE_UINT16(mctl, TM4C123CANObject),
+        VMSTATE_UINT16_ARRAY(data, TM4C123CANObject, 4),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const VMStateDescription vmstate_tm4c123_can_if = {
+    .name = "tm4c123-can-if",
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT16(crq, TM4C123CANIF),
+        VMSTATE_UINT16(cmsk, TM4C123CANIF),
+        VMSTATE_STRUCT(regs, TM4C123CANIF, 1, vmstate_tm4c123_can_object,
+                       TM4C123CANObject),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static const VMStateDescription vmstate_tm4c123_can = {
+    .name = TYPE_TM4C123_CAN,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = tm4c123_can_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(can_ctl, TM4C123CANState),
+        VMSTATE_UINT32(can_sts, TM4C123CANState),
+        VMSTATE_UINT32(can_bit, TM4C123CANState),
+        VMSTATE_UINT32(can_tst, TM4C123CANState),
+        VMSTATE_UINT32(can_brpe, TM4C123CANState),
+        VMSTATE_BOOL(status_int, TM4C123CANState),
+        VMSTATE_STRUCT_ARRAY(ifs, TM4C123CANState, CAN_INTERFACES, 1,
+                             vmstate_tm4c123_can_if, TM4C123CANIF),
+        VMSTATE_STRUCT_ARRAY(objs, TM4C123CANState, CAN_OBJECTS, 1,
+                             vmstate_tm4c123_can_object, TM4C123CANObject),
+        VMSTATE_CLOCK(clk, TM4C123CANState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void tm4c123_can_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = tm4c123_can_reset;
+    dc->vmsd = &vmstate_tm4c123_can;
+    device_class_set_props(dc, tm4c123_can_properties);
+    dc->realize = tm4c123_can_realize;
+}
+
+static const TypeInfo tm4c123_can_info = {
+    .name          = TYPE_TM4C123_CAN,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(TM4C123CANState),
+    .instance_init = tm4c123_can_init,
+    .class_init    = tm4c123_can_class_init,
+};
+
+static void tm4c123_can_register_types(void)
+{
+    type_register_static(&tm4c123_can_info);
+}
+
+type_init(tm4c123_can_register_types)
@@ -0,0 +1,585 @@
+/*
+ * TM4C123 EEPROM
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "hw/nvram/tm4c123_eeprom.h"
+#include "hw/irq.h"
+#include "hw/qdev-properties.h"
+#include "hw/qdev-properties-system.h"
+#include "hw/qdev-clock.h"
+#include "qemu/bswap.h"
+#include "qemu/error-report.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "migration/vmstate.h"
+#include "trace.h"
+
+#define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
+#define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
+
+/* Typical word program and mass erase times from the datasheet */
+#define EEPROM_PROGRAM_NS (110 * SCALE_US)
+#define EEPROM_ERASE_NS (8 * SCALE_MS)
+/* How long changes may gather in RAM before they are written back */
+#define EEPROM_FLUSH_DELAY_MS 100
+
+#define EEPROM_META_PASS_LEN_SHIFT 16
+
+static uint32_t eeprom_meta_offset(uint32_t block, int word)
+{
+    return EEPROM_SIZE + block * 16 + word * 4;
+}
+
+/* The trailer is kept inverted, so an erased image has no protection */
+static uint32_t eeprom_meta(TM4C123EEPROMState *s, uint32_t block, int word)
+{
+    return ~ldl_le_p(&s->image[eeprom_meta_offset(block, word)]);
+}
+
+static void eeprom_touch(TM4C123EEPROMState *s, uint32_t offset, uint32_t len)
+{
+    if (s->dirty_lo >= s->dirty_hi) {
+        s->dirty_lo = offset;
+        s->dirty_hi = offset + len;
+        if (s->blk) {
+            timer_mod(s->flush_timer, qemu_clock_get_ms(QEMU_CLOCK_REALTIME) +
+                      EEPROM_FLUSH_DELAY_MS);
+        }
+    } else {
+        s->dirty_lo = MIN(s->dirty_lo, offset);
+        s->dirty_hi = MAX(s->dirty_hi, offset + len);
+    }
+}
+
+static void eeprom_set_meta(TM4C123EEPROMState *s, uint32_t block, int word, uint32_t val)
+{
+    uint32_t offset = eeprom_meta_offset(block, word);
+
+    stl_le_p(&s->image[offset], ~val);
+    eeprom_touch(s, offset, 4);
+}
+
+static uint32_t eeprom_pass_len(TM4C123EEPROMState *s, uint32_t block)
+{
+    return MIN(extract32(eeprom_meta(s, block, 0), EEPROM_META_PASS_LEN_SHIFT, 2), 3);
+}
+
+static uint32_t eeprom_prot(TM4C123EEPROMState *s, uint32_t block)
+{
+    return eeprom_meta(s, block, 0) & (EEPROM_EEPROT_PROT | EEPROM_EEPROT_ACC);
+}
+
+/* Write the unsaved range back in one request */
+static void eeprom_flush(TM4C123EEPROMState *s)
+{
+    uint32_t hi = MIN(s->dirty_hi, s->image_len);
+
+    if (s->blk && !s->blk_ro && s->dirty_lo < hi) {
+        if (blk_pwrite(s->blk, s->dirty_lo, hi - s->dirty_lo,
+                       &s->image[s->dirty_lo], 0) < 0) {
+            error_report("tm4c123-eeprom: cannot write back to %s", blk_name(s->blk));
+        }
+    }
+    s->dirty_lo = s->dirty_hi = 0;
+    timer_del(s->flush_timer);
+}
+
+static void eeprom_flush_timer(void *opaque)
+{
+    eeprom_flush(opaque);
+}
+
+static void eeprom_vm_state_change(void *opaque, bool running, RunState state)
+{
+    if (!running) {
+        eeprom_flush(opaque);
+    }
+}
+
+static bool eeprom_busy(TM4C123EEPROMState *s)
+{
+    return qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) < s->busy_until_ns;
+}
+
+/* Only wake up at the end of an operation when it raises an interrupt */
+static void eeprom_schedule(TM4C123EEPROMState *s)
+{
+    if ((s->eeprom_int & EEPROM_EEINT_INT) && eeprom_busy(s)) {
+        timer_mod(s->done_timer, s->busy_until_ns);
+    } else {
+        timer_del(s->done_timer);
+    }
+}
+
+static void eeprom_done_timer(void *opaque)
+{
+    TM4C123EEPROMState *s = opaque;
+
+    qemu_irq_pulse(s->irq);
+}
+
+/* Start an operation that keeps EEDONE working for @ns */
+static void eeprom_start(TM4C123EEPROMState *s, uint32_t status, int64_t ns)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+
+    s->busy_until_ns = MAX(now, s->busy_until_ns) + ns;
+    s->status = status;
+}
+
+/* An operation refused outright ends at once */
+static void eeprom_refuse(TM4C123EEPROMState *s)
+{
+    s->status = EEPROM_EEDONE_NOPERM;
+    if (s->eeprom_int & EEPROM_EEINT_INT) {
+        qemu_irq_pulse(s->irq);
+    }
+}
+
+static bool eeprom_master_locked(TM4C123EEPROMState *s)
+{
+    return eeprom_pass_len(s, 0) && !s->master_unlocked;
+}
+
+/* Whether the password of @block, if any, has been given */
+static bool eeprom_unlocked(TM4C123EEPROMState *s, uint32_t block)
+{
+    if (eeprom_master_locked(s)) {
+        return false;
+    }
+    if (!block || !eeprom_pass_len(s, block)) {
+        return true;
+    }
+    return s->block_unlocked;
+}
+
+static bool eeprom_can_access(TM4C123EEPROMState *s, uint32_t block, bool write)
+{
+    bool has_pass = eeprom_pass_len(s, block);
+    bool unlocked = eeprom_unlocked(s, block);
+
+    if (eeprom_master_locked(s) || (block && (s->eeprom_hide & (1 << block)))) {
+        return false;
+    }
+    switch (eeprom_prot(s, block) & EEPROM_EEPROT_PROT) {
+        case EEPROM_PROT_RW:
+            return !write || !has_pass || unlocked;
+        case EEPROM_PROT_LOCKED_RW:
+            return !has_pass || unlocked;
+        case EEPROM_PROT_RO:
+            return !write && (!has_pass || unlocked);
+        default:
+            return false;
+    }
+}
+
+static uint32_t eeprom_word_offset(TM4C123EEPROMState *s)
+{
+    return (s->eeprom_block * EEPROM_BLOCK_WORDS + s->eeprom_offset) * 4;
+}
+
+static uint32_t eeprom_read_word(TM4C123EEPROMState *s)
+{
+    if (!eeprom_can_access(s, s->eeprom_block, false)) {
+        LOG(LOG_GUEST_ERROR, "Block %u is not readable\n", s->eeprom_block);
+        return 0;
+    }
+    return ldl_le_p(&s->image[eeprom_word_offset(s)]);
+}
+
+static void eeprom_write_word(TM4C123EEPROMState *s, uint32_t val)
+{
+    uint32_t offset = eeprom_word_offset(s);
+
+    if (!eeprom_can_access(s, s->eeprom_block, true)) {
+        LOG(LOG_GUEST_ERROR, "Block %u is not writable\n", s->eeprom_block);
+        eeprom_refuse(s);
+        return;
+    }
+    stl_le_p(&s->image[offset], val);
+    eeprom_touch(s, offset, 4);
+    eeprom_start(s, 0, EEPROM_PROGRAM_NS);
+}
+
+static void eeprom_mass_erase(TM4C123EEPROMState *s)
+{
+    memset(s->image, 0xFF, sizeof(s->image));
+    eeprom_touch(s, 0, EEPROM_IMAGE_SIZE);
+    s->master_unlocked = false;
+    s->block_unlocked = false;
+    s->unlock_count = 0;
+    eeprom_start(s, 0, EEPROM_ERASE_NS);
+}
+
+/*
+ * Password words gather until there are as many as the block has; the
+ * master password of block 0 is asked for first.
+ */
+static void eeprom_unlock(TM4C123EEPROMState *s, uint32_t val)
+{
+    uint32_t block = eeprom_master_locked(s) ? 0 : s->eeprom_block;
+    uint32_t len = eeprom_pass_len(s, block);
+    uint32_t i;
+
+    if (!len) {
+        return;
+    }
+    s->unlock_words[s->unlock_count++] = val;
+    if (s->unlock_count < len) {
+        return;
+    }
+    s->unlock_count = 0;
+    for (i = 0; i < len; i++) {
+        if (s->unlock_words[i] != eeprom_meta(s, block, 1 + i)) {
+            return;
+        }
+    }
+    if (block) {
+        s->block_unlocked = true;
+    } else {
+        s->master_unlocked = true;
+    }
+}
+
+static void tm4c123_eeprom_reset(DeviceState *dev)
+{
+    TM4C123EEPROMState *s = TM4C123_EEPROM(dev);
+
+    s->eeprom_block = 0x00000000;
+    s->eeprom_offset = 0x00000000;
+    s->eeprom_int = 0x00000000;
+    s->eeprom_hide = 0x00000000;
+    s->status = 0;
+    s->busy_until_ns = 0;
+    s->unlock_count = 0;
+    s->master_unlocked = false;
+    s->block_unlocked = false;
+
+    timer_del(s->done_timer);
+}
+
+static uint64_t tm4c123_eeprom_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    TM4C123EEPROMState *s = opaque;
+    uint32_t val;
+
+    trace_tm4c123_eeprom_read(addr);
+
+    switch (addr) {
+        case EEPROM_EESIZE:
+            return (EEPROM_BLOCKS << 16) | EEPROM_WORDS;
+        case EEPROM_EEBLOCK:
+            return s->eeprom_block;
+        case EEPROM_EEOFFSET:
+            return s->eeprom_offset;
+        case EEPROM_EERDWR:
+            return eeprom_read_word(s);
+        case EEPROM_EERDWRINC:
+            val = eeprom_read_word(s);
+            s->eeprom_offset = (s->eeprom_offset + 1) % EEPROM_BLOCK_WORDS;
+            return val;
+        case EEPROM_EEDONE:
+            if (eeprom_busy(s)) {
+                return EEPROM_EEDONE_WORKING |
+                       (s->status & (EEPROM_EEDONE_WKERASE | EEPROM_EEDONE_WRBUSY));
+            }
+            return s->status & EEPROM_EEDONE_NOPERM;
+        case EEPROM_EESUPP:
+            return 0;
+        case EEPROM_EEUNLOCK:
+            return eeprom_unlocked(s, eeprom_master_locked(s) ? 0 : s->eeprom_block);
+        case EEPROM_EEPROT:
+            return eeprom_prot(s, s->eeprom_block);
+        case EEPROM_EEPASS0:
+        case EEPROM_EEPASS1:
+        case EEPROM_EEPASS2:
+            /* Passwords never read back, only whether the word is set */
+            return (addr - EEPROM_EEPASS0) / 4 < eeprom_pass_len(s, s->eeprom_block);
+        case EEPROM_EEINT:
+            return s->eeprom_int;
+        case EEPROM_EEHIDE:
+            return s->eeprom_hide;
+        case EEPROM_EEDBGME:
+            return 0;
+        case EEPROM_PP:
+            return 0x1F;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return 0;
+    }
+
+    return 0;
+}
+
+static void tm4c123_eeprom_write(void *opaque, hwaddr addr, uint64_t val64, unsigned int size)
+{
+    TM4C123EEPROMState *s = opaque;
+    uint32_t val32 = val64;
+    uint32_t block = s->eeprom_block;
+    uint32_t meta;
+    uint32_t len;
+
+    trace_tm4c123_eeprom_write(addr, val32);
+
+    if (eeprom_busy(s) && addr != EEPROM_EEINT) {
+        LOG(LOG_GUEST_ERROR, "EEPROM is busy, write to 0x%"HWADDR_PRIx" dropped\n", addr);
+        return;
+    }
+
+    switch (addr) {
+        case EEPROM_EEBLOCK:
+            if ((val32 & 0xFFFF) >= EEPROM_BLOCKS) {
+                LOG(LOG_GUEST_ERROR, "Bad block %u\n", val32 & 0xFFFF);
+                break;
+            }
+            /* Moving to another block locks the one that was unlocked */
+            s->eeprom_block = val32 & 0xFFFF;
+            s->block_unlocked = false;
+            s->unlock_count = 0;
+            break;
+        case EEPROM_EEOFFSET:
+            s->eeprom_offset = val32 & 0xF;
+            break;
+        case EEPROM_EERDWR:
+            eeprom_write_word(s, val32);
+            break;
+        case EEPROM_EERDWRINC:
+            eeprom_write_word(s, val32);
+            s->eeprom_offset = (s->eeprom_offset + 1) % EEPROM_BLOCK_WORDS;
+            break;
+        case EEPROM_EEUNLOCK:
+            eeprom_unlock(s, val32);
+            break;
+        case EEPROM_EEPROT:
+            if (!eeprom_unlocked(s, block)) {
+                eeprom_refuse(s);
+                break;
+            }
+            meta = eeprom_meta(s, block, 0);
+            meta = (meta & ~(EEPROM_EEPROT_PROT | EEPROM_EEPROT_ACC)) |
+                   (val32 & (EEPROM_EEPROT_PROT | EEPROM_EEPROT_ACC));
+            eeprom_set_meta(s, block, 0, meta);
+            eeprom_start(s, 0, EEPROM_PROGRAM_NS);
+            break;
+        case EEPROM_EEPASS0:
+        case EEPROM_EEPASS1:
+        case EEPROM_EEPASS2:
+            /* Words are set in order, once; only a mass erase clears them */
+            len = eeprom_pass_len(s, block);
+            if ((addr - EEPROM_EEPASS0) / 4 != len || !eeprom_unlocked(s, block)) {
+                eeprom_refuse(s);
+                break;
+            }
+            eeprom_set_meta(s, block, 1 + len, val32);
+            meta = deposit32(eeprom_meta(s, block, 0), EEPROM_META_PASS_LEN_SHIFT, 2, len + 1);
+            eeprom_set_meta(s, block, 0, meta);
+            /* Whoever sets the password holds the block unlocked */
+            if (block) {
+                s->block_unlocked = true;
+            } else {
+                s->master_unlocked = true;
+            }
+            eeprom_start(s, 0, EEPROM_PROGRAM_NS);
+            break;
+        case EEPROM_EEINT:
+            s->eeprom_int = val32 & EEPROM_EEINT_INT;
+            break;
+        case EEPROM_EEHIDE:
+            /* Hidden blocks stay hidden until reset; block 0 cannot hide */
+            s->eeprom_hide |= val32 & ~1u;
+            break;
+        case EEPROM_EESUPP:
+            break;
+        case EEPROM_EEDBGME:
+            if ((val32 & 0xFFFF0000) == EEPROM_EEDBGME_KEY && (val32 & EEPROM_EEDBGME_ME)) {
+                eeprom_mass_erase(s);
+                s->status = EEPROM_EEDONE_WKERASE;
+            }
+            break;
+        case EEPROM_EESIZE:
+        case EEPROM_EEDONE:
+        case EEPROM_PP:
+            READONLY;
+            break;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return;
+    }
+    eeprom_schedule(s);
+}
+
+/* Accesses with the module clock gated off answer with a bus fault */
+static MemTxResult tm4c123_eeprom_read_with_attrs(void *opaque, hwaddr addr, uint64_t *data,
+                                                  unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123EEPROMState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "EEPROM module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_eeprom_read(opaque, addr, size);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_eeprom_write_with_attrs(void *opaque, hwaddr addr, uint64_t val64,
+                                                   unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123EEPROMState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "EEPROM module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    tm4c123_eeprom_write(opaque, addr, val64, size);
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps tm4c123_eeprom_ops = {
+    .read_with_attrs = tm4c123_eeprom_read_with_attrs,
+    .write_with_attrs = tm4c123_eeprom_write_with_attrs,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static Property tm4c123_eeprom_properties[] = {
+    DEFINE_PROP_DRIVE("drive", TM4C123EEPROMState, blk),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void tm4c123_eeprom_init(Object *obj)
+{
+    TM4C123EEPROMState *s = TM4C123_EEPROM(obj);
+
+    s->clk = qdev_init_clock_in(DEVICE(s), "eeprom_clock", NULL, NULL, 0);
+    s->flush_timer = timer_new_ms(QEMU_CLOCK_REALTIME, eeprom_flush_timer, s);
+    s->done_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, eeprom_done_timer, s);
+
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+
+    memory_region_init_io(&s->mmio, obj, &tm4c123_eeprom_ops, s,
+            TYPE_TM4C123_EEPROM, 0xFFF);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
+}
+
+static void tm4c123_eeprom_realize(DeviceState *dev, Error **errp)
+{
+    TM4C123EEPROMState *s = TM4C123_EEPROM(dev);
+    int64_t len;
+
+    /* Erased cells read as ones */
+    memset(s->image, 0xFF, sizeof(s->image));
+    s->dirty_lo = s->dirty_hi = 0;
+    s->image_len = 0;
+
+    if (!s->blk) {
+        return;
+    }
+    len = blk_getlength(s->blk);
+    if (len < EEPROM_SIZE) {
+        error_setg(errp, "EEPROM image %s holds %" PRId64 " bytes, needs %d",
+                   blk_name(s->blk), len, EEPROM_SIZE);
+        return;
+    }
+    /* A read-only drive keeps its contents, writes only reach the image */
+    s->blk_ro = !blk_supports_write_perm(s->blk);
+    if (blk_set_perm(s->blk, BLK_PERM_CONSISTENT_READ | (s->blk_ro ? 0 : BLK_PERM_WRITE),
+                     BLK_PERM_ALL, errp) < 0) {
+        return;
+    }
+    s->image_len = MIN(len, EEPROM_IMAGE_SIZE);
+    if (blk_pread(s->blk, 0, s->image_len, s->image, 0) < 0) {
+        error_setg(errp, "cannot read EEPROM image %s", blk_name(s->blk));
+        return;
+    }
+    s->vmstate_change = qemu_add_vm_change_state_handler(eeprom_vm_state_change, s);
+}
+
+static void tm4c123_eeprom_unrealize(DeviceState *dev)
+{
+    TM4C123EEPROMState *s = TM4C123_EEPROM(dev);
+
+    eeprom_flush(s);
+    if (s->vmstate_change) {
+        qemu_del_vm_change_state_handler(s->vmstate_change);
+    }
+}
+
+static int tm4c123_eeprom_post_load(void *opaque, int version_id)
+{
+    TM4C123EEPROMState *s = opaque;
+
+    /* The incoming contents replace whatever the drive holds */
+    eeprom_touch(s, 0, EEPROM_IMAGE_SIZE);
+    return 0;
+}
+
+static const VMStateDescription vmstate_tm4c123_eeprom = {
+    .name = TYPE_TM4C123_EEPROM,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = tm4c123_eeprom_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(eeprom_block, TM4C123EEPROMState),
+        VMSTATE_UINT32(eeprom_offset, TM4C123EEPROMState),
+        VMSTATE_UINT32(eeprom_int, TM4C123EEPROMState),
+        VMSTATE_UINT32(eeprom_hide, TM4C123EEPROMState),
+        VMSTATE_UINT32(status, TM4C123EEPROMState),
+        VMSTATE_INT64(busy_until_ns, TM4C123EEPROMState),
+        VMSTATE_UINT32_ARRAY(unlock_words, TM4C123EEPROMState, 3),
+        VMSTATE_UINT32(unlock_count, TM4C123EEPROMState),
+        VMSTATE_BOOL(master_unlocked, TM4C123EEPROMState),
+        VMSTATE_BOOL(block_unlocked, TM4C123EEPROMState),
+        VMSTATE_UINT8_ARRAY(image, TM4C123EEPROMState, EEPROM_IMAGE_SIZE),
+        VMSTATE_TIMER_PTR(done_timer, TM4C123EEPROMState),
+        VMSTATE_CLOCK(clk, TM4C123EEPROMState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void tm4c123_eeprom_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = tm4c123_eeprom_reset;
+    dc->vmsd = &vmstate_tm4c123_eeprom;
+    device_class_set_props(dc, tm4c123_eeprom_properties);
+    dc->realize = tm4c123_eeprom_realize;
+    dc->unrealize = tm4c123_eeprom_unrealize;
+}
+
+static const TypeInfo tm4c123_eeprom_info = {
+    .name          = TYPE_TM4C123_EEPROM,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(TM4C123EEPROMState),
+    .instance_init = tm4c123_eeprom_init,
+    .class_init    = tm4c123_eeprom_class_init,
+};
+
+static void tm4c123_eeprom_register_types(void)
+{
+    type_register_static(&tm4c123_eeprom_info);
+}
+
+type_init(tm4c123_eeprom_register_types)
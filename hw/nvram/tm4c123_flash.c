@@ -0,0 +1,822 @@
+/*
+ * TM4C123 Flash memory controller
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "hw/nvram/tm4c123_flash.h"
+#include "hw/irq.h"
+#include "hw/qdev-properties.h"
+#include "hw/qdev-properties-system.h"
+#include "qemu/bswap.h"
+#include "qemu/error-report.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "qemu/units.h"
+#include "migration/vmstate.h"
+#include "elf.h"
+#include "trace.h"
+
+#define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
+#define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
+
+/* Typical program and erase times from the datasheet */
+#define FLASH_PROGRAM_NS (50 * SCALE_US)
+#define FLASH_ERASE_NS (12 * SCALE_MS)
+#define FLASH_MERASE_NS (16 * SCALE_MS)
+/* How long changed pages may gather before they are written back */
+#define FLASH_FLUSH_DELAY_MS 100
+
+static uint32_t flash_pages(TM4C123FlashState *s)
+{
+    return s->size / FLASH_PAGE_SIZE;
+}
+
+/* Write the dirty pages back, one request per run of them */
+static void flash_flush(TM4C123FlashState *s)
+{
+    unsigned long first;
+    unsigned long end;
+
+    timer_del(s->flush_timer);
+    if (!s->blk || s->blk_ro) {
+        bitmap_zero(s->dirty, FLASH_MAX_PAGES);
+        return;
+    }
+    first = find_first_bit(s->dirty, flash_pages(s));
+    while (first < flash_pages(s)) {
+        end = find_next_zero_bit(s->dirty, flash_pages(s), first);
+        if (blk_pwrite(s->blk, first * FLASH_PAGE_SIZE, (end - first) * FLASH_PAGE_SIZE,
+                       s->storage + first * FLASH_PAGE_SIZE, 0) < 0) {
+            error_report("tm4c123-flash: cannot write back to %s", blk_name(s->blk));
+        }
+        bitmap_clear(s->dirty, first, end - first);
+        first = find_next_bit(s->dirty, flash_pages(s), end);
+    }
+}
+
+static void flash_flush_timer(void *opaque)
+{
+    flash_flush(opaque);
+}
+
+static void flash_vm_state_change(void *opaque, bool running, RunState state)
+{
+    if (!running) {
+        flash_flush(opaque);
+    }
+}
+
+/* The array changed at @offset: refresh the TCG view and queue a write back */
+static void flash_touch(TM4C123FlashState *s, uint32_t offset, uint32_t len)
+{
+    memory_region_flush_rom_device(&s->flash, offset, len);
+    s->image_dirty = true;
+    if (!s->blk || s->blk_ro) {
+        return;
+    }
+    if (bitmap_empty(s->dirty, FLASH_MAX_PAGES)) {
+        timer_mod(s->flush_timer, qemu_clock_get_ms(QEMU_CLOCK_REALTIME) +
+                  FLASH_FLUSH_DELAY_MS);
+    }
+    bitmap_set(s->dirty, offset / FLASH_PAGE_SIZE,
+               DIV_ROUND_UP(offset + len, FLASH_PAGE_SIZE) - offset / FLASH_PAGE_SIZE);
+}
+
+#ifdef CONFIG_POSIX
+static void flash_image_add(TM4C123FlashState *s, uint32_t addr, uint32_t len,
+                            uint64_t offset)
+{
+    s->image_segs = g_renew(TM4C123FlashSegment, s->image_segs, s->image_nsegs + 1);
+    s->image_segs[s->image_nsegs++] = (TM4C123FlashSegment) {
+        .addr = addr,
+        .len = len,
+        .offset = offset,
+    };
+}
+
+/* Find what goes where: the whole file for a raw image, PT_LOAD for an ELF */
+static bool flash_image_open(TM4C123FlashState *s, Error **errp)
+{
+    Elf32_Ehdr ehdr;
+    Elf32_Phdr phdr;
+    struct stat st;
+    int i;
+
+    s->image_fd = qemu_open(s->image, O_RDONLY, errp);
+    if (s->image_fd < 0) {
+        return false;
+    }
+    if (fstat(s->image_fd, &st) < 0) {
+        error_setg_errno(errp, errno, "cannot stat flash image %s", s->image);
+        return false;
+    }
+
+    if (pread(s->image_fd, &ehdr, sizeof(ehdr), 0) != sizeof(ehdr) ||
+        memcmp(ehdr.e_ident, ELFMAG, SELFMAG)) {
+        if (st.st_size > s->size) {
+            error_setg(errp, "flash image %s holds %" PRId64 " bytes, flash is %u",
+                       s->image, (int64_t)st.st_size, s->size);
+            return false;
+        }
+        flash_image_add(s, 0, st.st_size, 0);
+        return true;
+    }
+
+    if (ehdr.e_ident[EI_CLASS] != ELFCLASS32 || ehdr.e_ident[EI_DATA] != ELFDATA2LSB ||
+        le16_to_cpu(ehdr.e_machine) != EM_ARM) {
+        error_setg(errp, "flash image %s is not a 32-bit little-endian ARM ELF",
+                   s->image);
+        return false;
+    }
+    for (i = 0; i < le16_to_cpu(ehdr.e_phnum); i++) {
+        uint64_t off = le32_to_cpu(ehdr.e_phoff) + i * le16_to_cpu(ehdr.e_phentsize);
+        uint32_t addr, len;
+
+        if (pread(s->image_fd, &phdr, sizeof(phdr), off) != sizeof(phdr)) {
+            error_setg(errp, "flash image %s is truncated", s->image);
+            return false;
+        }
+        addr = le32_to_cpu(phdr.p_paddr);
+        len = le32_to_cpu(phdr.p_filesz);
+        if (le32_to_cpu(phdr.p_type) != PT_LOAD || !len) {
+            continue;
+        }
+        if (addr >= s->size || len > s->size - addr) {
+            error_setg(errp, "flash image %s loads 0x%x bytes at 0x%x, outside the flash",
+                       s->image, len, addr);
+            error_append_hint(errp, "Use -kernel for images that load into SRAM.\n");
+            return false;
+        }
+        if (le32_to_cpu(phdr.p_offset) + (uint64_t)len > st.st_size) {
+            error_setg(errp, "flash image %s is truncated", s->image);
+            return false;
+        }
+        flash_image_add(s, addr, len, le32_to_cpu(phdr.p_offset));
+    }
+    return true;
+}
+
+/*
+ * Lay the image over the array. Host pages that lie wholly inside a segment
+ * whose file offset is page-congruent with its address become a private
+ * mapping of the file, so they are only read in when the guest first touches
+ * them and a program or erase only copies the page it changes. The remaining
+ * pages are filled in by hand: erased, then patched with the segment bytes
+ * that fall in them.
+ */
+static bool flash_image_map(TM4C123FlashState *s, Error **errp)
+{
+    size_t page = qemu_real_host_page_size();
+    size_t npages = DIV_ROUND_UP(s->size, page);
+    g_autofree unsigned long *mapped = bitmap_new(npages);
+    size_t start, end, lo, hi, p;
+    int i;
+
+    for (i = 0; i < s->image_nsegs; i++) {
+        TM4C123FlashSegment *seg = &s->image_segs[i];
+
+        if ((seg->offset - seg->addr) % page) {
+            continue;
+        }
+        start = ROUND_UP(seg->addr, page);
+        end = ROUND_DOWN(seg->addr + seg->len, page);
+        if (end <= start ||
+            mmap(s->storage + start, end - start, PROT_READ | PROT_WRITE,
+                 MAP_PRIVATE | MAP_FIXED, s->image_fd,
+                 seg->offset + start - seg->addr) == MAP_FAILED) {
+            continue;
+        }
+        bitmap_set(mapped, start / page, (end - start) / page);
+    }
+
+    for (p = find_first_zero_bit(mapped, npages); p < npages;
+         p = find_next_zero_bit(mapped, npages, p + 1)) {
+        lo = p * page;
+        hi = MIN(lo + page, s->size);
+        /* Erased cells read as ones */
+        memset(s->storage + lo, 0xFF, hi - lo);
+        for (i = 0; i < s->image_nsegs; i++) {
+            TM4C123FlashSegment *seg = &s->image_segs[i];
+
+            start = MAX(lo, seg->addr);
+            end = MIN(hi, seg->addr + seg->len);
+            if (start < end &&
+                pread(s->image_fd, s->storage + start, end - start,
+                      seg->offset + start - seg->addr) != end - start) {
+                error_setg_errno(errp, errno, "cannot read flash image %s", s->image);
+                return false;
+            }
+        }
+    }
+    s->image_dirty = false;
+    return true;
+}
+#else
+static bool flash_image_open(TM4C123FlashState *s, Error **errp)
+{
+    error_setg(errp, "flash images need a POSIX host");
+    return false;
+}
+
+static bool flash_image_map(TM4C123FlashState *s, Error **errp)
+{
+    g_assert_not_reached();
+}
+#endif
+
+static bool flash_busy(TM4C123FlashState *s)
+{
+    return qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) < s->busy_until_ns;
+}
+
+/* Finish an operation whose time is up: the command bits drop, PRIS rises */
+static void flash_sync(TM4C123FlashState *s)
+{
+    if ((s->busy_fmc || s->busy_fmc2) && !flash_busy(s)) {
+        s->busy_fmc = 0;
+        s->busy_fmc2 = 0;
+        s->flash_fcris |= FLASH_INT_PROGRAM;
+    }
+}
+
+static void flash_update(TM4C123FlashState *s)
+{
+    qemu_set_irq(s->irq, s->flash_fcris & s->flash_fcim);
+}
+
+/* Only wake up at the end of an operation when it raises an interrupt */
+static void flash_schedule(TM4C123FlashState *s)
+{
+    if ((s->busy_fmc || s->busy_fmc2) && (s->flash_fcim & FLASH_INT_PROGRAM)) {
+        timer_mod(s->done_timer, s->busy_until_ns);
+    } else {
+        timer_del(s->done_timer);
+    }
+}
+
+static void flash_done_timer(void *opaque)
+{
+    TM4C123FlashState *s = opaque;
+
+    flash_sync(s);
+    flash_update(s);
+}
+
+static void flash_start(TM4C123FlashState *s, uint32_t *busy, uint32_t cmd, int64_t ns)
+{
+    *busy = cmd;
+    s->busy_until_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + ns;
+}
+
+static bool flash_protected(TM4C123FlashState *s, uint32_t offset)
+{
+    uint32_t block = offset / FLASH_PROT_BLOCK;
+
+    return !extract32(s->fmppe[block / 32], block % 32, 1);
+}
+
+/* NOR cells only go from 1 to 0 when programmed */
+static void flash_program_word(TM4C123FlashState *s, uint32_t offset, uint32_t val)
+{
+    uint32_t old;
+
+    if (offset >= s->size || flash_protected(s, offset)) {
+        LOG(LOG_GUEST_ERROR, "Cannot program 0x%x\n", offset);
+        s->flash_fcris |= FLASH_INT_ACCESS;
+        return;
+    }
+    old = ldl_le_p(s->storage + offset);
+    if ((old & val) != val) {
+        s->flash_fcris |= FLASH_INT_INVDATA;
+    }
+    stl_le_p(s->storage + offset, old & val);
+    flash_touch(s, offset, 4);
+}
+
+static void flash_erase_page(TM4C123FlashState *s, uint32_t offset)
+{
+    offset &= ~(FLASH_PAGE_SIZE - 1);
+    if (offset >= s->size || flash_protected(s, offset)) {
+        LOG(LOG_GUEST_ERROR, "Cannot erase 0x%x\n", offset);
+        s->flash_fcris |= FLASH_INT_ACCESS;
+        return;
+    }
+    memset(s->storage + offset, 0xFF, FLASH_PAGE_SIZE);
+    flash_touch(s, offset, FLASH_PAGE_SIZE);
+}
+
+/* FMA picks the register to make permanent */
+static void flash_commit(TM4C123FlashState *s)
+{
+    uint32_t fma = s->flash_fma;
+
+    if (fma < 2 * FLASH_PROT_REGS) {
+        if (fma & 1) {
+            s->fmppe_nv[fma / 2] = s->fmppe[fma / 2];
+        } else {
+            s->fmpre_nv[fma / 2] = s->fmpre[fma / 2];
+        }
+    } else if (fma == 0x75100000) {
+        s->bootcfg_nv = s->bootcfg;
+    } else if (fma >= 0x80000000 && fma <= 0x8000000C && !(fma & 3)) {
+        s->user_reg_nv[(fma - 0x80000000) / 4] = s->user_reg[(fma - 0x80000000) / 4];
+    } else {
+        LOG(LOG_GUEST_ERROR, "Nothing to commit at FMA 0x%x\n", fma);
+    }
+}
+
+static uint32_t flash_key(TM4C123FlashState *s)
+{
+    return s->bootcfg & FLASH_BOOTCFG_KEY ? FLASH_KEY : FLASH_KEY_LEGACY;
+}
+
+static void flash_fmc_write(TM4C123FlashState *s, uint32_t val32)
+{
+    uint32_t cmd = val32 & (FLASH_FMC_WRITE | FLASH_FMC_ERASE | FLASH_FMC_MERASE |
+                            FLASH_FMC_COMT);
+    uint32_t offset;
+
+    if ((val32 >> 16) != flash_key(s) || !cmd) {
+        return;
+    }
+    switch (cmd) {
+        case FLASH_FMC_WRITE:
+            flash_program_word(s, s->flash_fma & ~3, s->flash_fmd);
+            flash_start(s, &s->busy_fmc, cmd, FLASH_PROGRAM_NS);
+            break;
+        case FLASH_FMC_ERASE:
+            flash_erase_page(s, s->flash_fma);
+            flash_start(s, &s->busy_fmc, cmd, FLASH_ERASE_NS);
+            break;
+        case FLASH_FMC_MERASE:
+            /* Protected blocks are skipped */
+            for (offset = 0; offset < s->size; offset += FLASH_PAGE_SIZE) {
+                if (!flash_protected(s, offset)) {
+                    memset(s->storage + offset, 0xFF, FLASH_PAGE_SIZE);
+                    flash_touch(s, offset, FLASH_PAGE_SIZE);
+                }
+            }
+            flash_start(s, &s->busy_fmc, cmd, FLASH_MERASE_NS);
+            break;
+        case FLASH_FMC_COMT:
+            flash_commit(s);
+            flash_start(s, &s->busy_fmc, cmd, FLASH_PROGRAM_NS);
+            break;
+        default:
+            LOG(LOG_GUEST_ERROR, "Several commands at once: 0x%x\n", cmd);
+            return;
+    }
+}
+
+/* Program the FWBVAL words of the 32-word row FMA falls in */
+static void flash_fmc2_write(TM4C123FlashState *s, uint32_t val32)
+{
+    uint32_t base = s->flash_fma & ~(FLASH_FWB_WORDS * 4 - 1);
+    int count = 0;
+    int i;
+
+    if ((val32 >> 16) != flash_key(s) || !(val32 & FLASH_FMC2_WRBUF)) {
+        return;
+    }
+    for (i = 0; i < FLASH_FWB_WORDS; i++) {
+        if (s->flash_fwbval & (1u << i)) {
+            flash_program_word(s, base + 4 * i, s->flash_fwb[i]);
+            count++;
+        }
+    }
+    s->flash_fwbval = 0;
+    flash_start(s, &s->busy_fmc2, FLASH_FMC2_WRBUF, count * FLASH_PROGRAM_NS);
+}
+
+static void tm4c123_flash_reset(DeviceState *dev)
+{
+    TM4C123FlashState *s = TM4C123_FLASH(dev);
+
+    s->flash_fma = 0x00000000;
+    s->flash_fmd = 0x00000000;
+    s->flash_fcris = 0x00000000;
+    s->flash_fcim = 0x00000000;
+    s->flash_fwbval = 0x00000000;
+    memset(s->flash_fwb, 0, sizeof(s->flash_fwb));
+
+    s->bootcfg = s->bootcfg_nv;
+    memcpy(s->user_reg, s->user_reg_nv, sizeof(s->user_reg));
+    memcpy(s->fmpre, s->fmpre_nv, sizeof(s->fmpre));
+    memcpy(s->fmppe, s->fmppe_nv, sizeof(s->fmppe));
+
+    s->busy_fmc = 0;
+    s->busy_fmc2 = 0;
+    s->busy_until_ns = 0;
+
+    timer_del(s->done_timer);
+    flash_update(s);
+
+    /* Like -kernel, an image comes back afresh; a remap drops the changes */
+    if (s->image && s->image_dirty) {
+        Error *err = NULL;
+
+        if (!flash_image_map(s, &err)) {
+            error_report_err(err);
+        }
+        memory_region_flush_rom_device(&s->flash, 0, s->size);
+    }
+}
+
+static uint64_t tm4c123_flash_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    TM4C123FlashState *s = opaque;
+
+    trace_tm4c123_flash_read(addr);
+    flash_sync(s);
+
+    if (addr >= FLASH_FWB0 && addr <= FLASH_FWB31) {
+        return s->flash_fwb[(addr - FLASH_FWB0) / 4];
+    }
+
+    switch (addr) {
+        case FLASH_FMA:
+            return s->flash_fma;
+        case FLASH_FMD:
+            return s->flash_fmd;
+        case FLASH_FMC:
+            return s->busy_fmc;
+        case FLASH_FCRIS:
+            return s->flash_fcris;
+        case FLASH_FCIM:
+            return s->flash_fcim;
+        case FLASH_FCMISC:
+            return s->flash_fcris & s->flash_fcim;
+        case FLASH_FMC2:
+            return s->busy_fmc2;
+        case FLASH_FWBVAL:
+            return s->flash_fwbval;
+        case FLASH_FSIZE:
+            return s->size / FLASH_PROT_BLOCK - 1;
+        case FLASH_SSIZE:
+            return s->sram_size / 256 - 1;
+        case FLASH_ROMSWMAP:
+            return 0;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return 0;
+    }
+
+    return 0;
+}
+
+static void tm4c123_flash_write(void *opaque, hwaddr addr, uint64_t val64, unsigned int size)
+{
+    TM4C123FlashState *s = opaque;
+    uint32_t val32 = val64;
+
+    trace_tm4c123_flash_write(addr, val32);
+    flash_sync(s);
+
+    if (addr >= FLASH_FWB0 && addr <= FLASH_FWB31) {
+        /* Loading a buffer word marks it valid */
+        s->flash_fwb[(addr - FLASH_FWB0) / 4] = val32;
+        s->flash_fwbval |= 1u << ((addr - FLASH_FWB0) / 4);
+        return;
+    }
+
+    switch (addr) {
+        case FLASH_FMA:
+            s->flash_fma = val32 & 0x3FFFF;
+            /* The commit addresses lie outside the array */
+            if (val32 == 0x75100000 || (val32 & 0xFFFFFFF0) == 0x80000000) {
+                s->flash_fma = val32;
+            }
+            break;
+        case FLASH_FMD:
+            s->flash_fmd = val32;
+            break;
+        case FLASH_FMC:
+            if (s->busy_fmc || s->busy_fmc2) {
+                LOG(LOG_GUEST_ERROR, "Flash is busy, command dropped\n");
+                break;
+            }
+            flash_fmc_write(s, val32);
+            break;
+        case FLASH_FCIM:
+            s->flash_fcim = val32 & FLASH_INT_MASK;
+            break;
+        case FLASH_FCMISC:
+            s->flash_fcris &= ~(val32 & FLASH_INT_MASK);
+            break;
+        case FLASH_FMC2:
+            if (s->busy_fmc || s->busy_fmc2) {
+                LOG(LOG_GUEST_ERROR, "Flash is busy, command dropped\n");
+                break;
+            }
+            flash_fmc2_write(s, val32);
+            break;
+        case FLASH_FWBVAL:
+            s->flash_fwbval = val32;
+            break;
+        case FLASH_FCRIS:
+        case FLASH_FSIZE:
+        case FLASH_SSIZE:
+        case FLASH_ROMSWMAP:
+            READONLY;
+            break;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return;
+    }
+    flash_update(s);
+    flash_schedule(s);
+}
+
+static const MemoryRegionOps tm4c123_flash_ops = {
+    .read = tm4c123_flash_read,
+    .write = tm4c123_flash_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static uint64_t tm4c123_flash_sysctl_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    TM4C123FlashState *s = opaque;
+
+    addr += FLASH_SYSCTL_REGS;
+    if (addr >= FLASH_SYSCTL_USER_REG0 && addr <= FLASH_SYSCTL_USER_REG3) {
+        return s->user_reg[(addr - FLASH_SYSCTL_USER_REG0) / 4];
+    }
+    if (addr >= FLASH_SYSCTL_FMPRE0 && addr <= FLASH_SYSCTL_FMPRE3) {
+        return s->fmpre[(addr - FLASH_SYSCTL_FMPRE0) / 4];
+    }
+    if (addr == FLASH_SYSCTL_BOOTCFG) {
+        return s->bootcfg;
+    }
+    LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+    return 0;
+}
+
+/*
+ * Until committed these only ever clear bits, and BOOTCFG/USER_REGn
+ * not at all once their NW bit is clear
+ */
+static void tm4c123_flash_sysctl_write(void *opaque, hwaddr addr, uint64_t val64,
+                                       unsigned int size)
+{
+    TM4C123FlashState *s = opaque;
+    uint32_t val32 = val64;
+    uint32_t *reg;
+    bool once = true;
+
+    addr += FLASH_SYSCTL_REGS;
+    if (addr >= FLASH_SYSCTL_USER_REG0 && addr <= FLASH_SYSCTL_USER_REG3) {
+        reg = &s->user_reg[(addr - FLASH_SYSCTL_USER_REG0) / 4];
+    } else if (addr >= FLASH_SYSCTL_FMPRE0 && addr <= FLASH_SYSCTL_FMPRE3) {
+        reg = &s->fmpre[(addr - FLASH_SYSCTL_FMPRE0) / 4];
+        once = false;
+    } else if (addr == FLASH_SYSCTL_BOOTCFG) {
+        reg = &s->bootcfg;
+    } else {
+        LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+        return;
+    }
+    if (once && !(*reg & FLASH_BOOTCFG_NW)) {
+        LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is already committed\n", addr);
+        return;
+    }
+    *reg &= val32;
+}
+
+static const MemoryRegionOps tm4c123_flash_sysctl_ops = {
+    .read = tm4c123_flash_sysctl_read,
+    .write = tm4c123_flash_sysctl_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static uint64_t tm4c123_flash_fmppe_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    TM4C123FlashState *s = opaque;
+
+    return s->fmppe[addr / 4];
+}
+
+static void tm4c123_flash_fmppe_write(void *opaque, hwaddr addr, uint64_t val64,
+                                      unsigned int size)
+{
+    TM4C123FlashState *s = opaque;
+
+    s->fmppe[addr / 4] &= val64;
+}
+
+static const MemoryRegionOps tm4c123_flash_fmppe_ops = {
+    .read = tm4c123_flash_fmppe_read,
+    .write = tm4c123_flash_fmppe_write,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+    .valid.min_access_size = 4,
+    .valid.max_access_size = 4,
+};
+
+static uint64_t tm4c123_flash_array_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    /* The array stays in ROMD mode, so reads never leave RAM */
+    g_assert_not_reached();
+}
+
+/* The array is only written through the controller */
+static MemTxResult tm4c123_flash_array_write(void *opaque, hwaddr addr, uint64_t val64,
+                                             unsigned int size, MemTxAttrs attrs)
+{
+    LOG(LOG_GUEST_ERROR, "Store to flash at 0x%"HWADDR_PRIx"\n", addr);
+    return MEMTX_ERROR;
+}
+
+static const MemoryRegionOps tm4c123_flash_array_ops = {
+    .read = tm4c123_flash_array_read,
+    .write_with_attrs = tm4c123_flash_array_write,
+    .endianness = DEVICE_LITTLE_ENDIAN,
+};
+
+static void flash_eeprom_done(void *opaque, int line, int level)
+{
+    TM4C123FlashState *s = opaque;
+
+    if (level) {
+        s->flash_fcris |= FLASH_INT_EEPROM;
+        flash_update(s);
+    }
+}
+
+static Property tm4c123_flash_properties[] = {
+    DEFINE_PROP_UINT32("size", TM4C123FlashState, size, 256 * KiB),
+    DEFINE_PROP_UINT32("sram-size", TM4C123FlashState, sram_size, 32 * KiB),
+    DEFINE_PROP_DRIVE("drive", TM4C123FlashState, blk),
+    DEFINE_PROP_STRING("image", TM4C123FlashState, image),
+    DEFINE_PROP_STRING("ram-name", TM4C123FlashState, ram_name),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+static void tm4c123_flash_init(Object *obj)
+{
+    TM4C123FlashState *s = TM4C123_FLASH(obj);
+    int i;
+
+    s->flush_timer = timer_new_ms(QEMU_CLOCK_REALTIME, flash_flush_timer, s);
+    s->done_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, flash_done_timer, s);
+
+    /* Blank non-volatile registers: nothing protected, BOOTCFG keys 0xA442 */
+    s->bootcfg_nv = 0xFFFFFFFE;
+    for (i = 0; i < 4; i++) {
+        s->user_reg_nv[i] = 0xFFFFFFFF;
+    }
+    for (i = 0; i < FLASH_PROT_REGS; i++) {
+        s->fmpre_nv[i] = 0xFFFFFFFF;
+        s->fmppe_nv[i] = 0xFFFFFFFF;
+    }
+
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    qdev_init_gpio_in_named(DEVICE(obj), flash_eeprom_done, "eeprom-done", 1);
+
+    memory_region_init_io(&s->mmio, obj, &tm4c123_flash_ops, s,
+            TYPE_TM4C123_FLASH, 0xFFF);
+    memory_region_init_io(&s->sysctl_mmio, obj, &tm4c123_flash_sysctl_ops, s,
+            TYPE_TM4C123_FLASH "-sysctl", FLASH_SYSCTL_REGS_SIZE);
+    memory_region_init_io(&s->fmppe_mmio, obj, &tm4c123_flash_fmppe_ops, s,
+            TYPE_TM4C123_FLASH "-fmppe", FLASH_SYSCTL_FMPPE_SIZE);
+}
+
+static void tm4c123_flash_realize(DeviceState *dev, Error **errp)
+{
+    TM4C123FlashState *s = TM4C123_FLASH(dev);
+    Error *err = NULL;
+    int64_t len;
+
+    if (!s->size || s->size % FLASH_PROT_BLOCK ||
+        s->size > FLASH_MAX_PAGES * FLASH_PAGE_SIZE) {
+        error_setg(errp, "flash size must be a multiple of %d up to %d",
+                   FLASH_PROT_BLOCK, FLASH_MAX_PAGES * FLASH_PAGE_SIZE);
+        return;
+    }
+    if (s->image && s->blk) {
+        error_setg(errp, "flash image and drive cannot be used together");
+        return;
+    }
+    memory_region_init_rom_device(&s->flash, OBJECT(dev), &tm4c123_flash_array_ops, s,
+                                  s->ram_name ?: "TM4C123GH6PM.flash", s->size, &err);
+    if (err) {
+        error_propagate(errp, err);
+        return;
+    }
+    s->storage = memory_region_get_ram_ptr(&s->flash);
+
+    sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->mmio);
+    sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->flash);
+    sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->sysctl_mmio);
+    sysbus_init_mmio(SYS_BUS_DEVICE(dev), &s->fmppe_mmio);
+
+    if (s->image) {
+        if (flash_image_open(s, errp)) {
+            flash_image_map(s, errp);
+        }
+        return;
+    }
+    /* Erased cells read as ones */
+    memset(s->storage, 0xFF, s->size);
+
+    if (!s->blk) {
+        return;
+    }
+    len = blk_getlength(s->blk);
+    if (len < s->size) {
+        error_setg(errp, "flash image %s holds %" PRId64 " bytes, needs %u",
+                   blk_name(s->blk), len, s->size);
+        return;
+    }
+    s->blk_ro = !blk_supports_write_perm(s->blk);
+    if (blk_set_perm(s->blk, BLK_PERM_CONSISTENT_READ | (s->blk_ro ? 0 : BLK_PERM_WRITE),
+                     BLK_PERM_ALL, errp) < 0) {
+        return;
+    }
+    if (blk_pread(s->blk, 0, s->size, s->storage, 0) < 0) {
+        error_setg(errp, "cannot read flash image %s", blk_name(s->blk));
+        return;
+    }
+    s->vmstate_change = qemu_add_vm_change_state_handler(flash_vm_state_change, s);
+}
+
+static int tm4c123_flash_post_load(void *opaque, int version_id)
+{
+    TM4C123FlashState *s = opaque;
+
+    /* The incoming array replaces whatever the drive holds */
+    flash_touch(s, 0, s->size);
+    return 0;
+}
+
+static const VMStateDescription vmstate_tm4c123_flash = {
+    .name = TYPE_TM4C123_FLASH,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = tm4c123_flash_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(flash_fma, TM4C123FlashState),
+        VMSTATE_UINT32(flash_fmd, TM4C123FlashState),
+        VMSTATE_UINT32(flash_fcris, TM4C123FlashState),
+        VMSTATE_UINT32(flash_fcim, TM4C123FlashState),
+        VMSTATE_UINT32(flash_fwbval, TM4C123FlashState),
+        VMSTATE_UINT32_ARRAY(flash_fwb, TM4C123FlashState, FLASH_FWB_WORDS),
+        VMSTATE_UINT32(bootcfg, TM4C123FlashState),
+        VMSTATE_UINT32_ARRAY(user_reg, TM4C123FlashState, 4),
+        VMSTATE_UINT32_ARRAY(fmpre, TM4C123FlashState, FLASH_PROT_REGS),
+        VMSTATE_UINT32_ARRAY(fmppe, TM4C123FlashState, FLASH_PROT_REGS),
+        VMSTATE_UINT32(bootcfg_nv, TM4C123FlashState),
+        VMSTATE_UINT32_ARRAY(user_reg_nv, TM4C123FlashState, 4),
+        VMSTATE_UINT32_ARRAY(fmpre_nv, TM4C123FlashState, FLASH_PROT_REGS),
+        VMSTATE_UINT32_ARRAY(fmppe_nv, TM4C123FlashState, FLASH_PROT_REGS),
+        VMSTATE_UINT32(busy_fmc, TM4C123FlashState),
+        VMSTATE_UINT32(busy_fmc2, TM4C123FlashState),
+        VMSTATE_INT64(busy_until_ns, TM4C123FlashState),
+        VMSTATE_TIMER_PTR(done_timer, TM4C123FlashState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void tm4c123_flash_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = tm4c123_flash_reset;
+    dc->vmsd = &vmstate_tm4c123_flash;
+    device_class_set_props(dc, tm4c123_flash_properties);
+    dc->realize = tm4c123_flash_realize;
+}
+
+static const TypeInfo tm4c123_flash_info = {
+    .name          = TYPE_TM4C123_FLASH,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(TM4C123FlashState),
+    .instance_init = tm4c123_flash_init,
+    .class_init    = tm4c123_flash_class_init,
+};
+
+static void tm4c123_flash_register_types(void)
+{
+    type_register_static(&tm4c123_flash_info);
+}
+
+type_init(tm4c123_flash_register_types)
@@ -0,0 +1,454 @@
+/*
+ * TM4C123 Hibernation module
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "hw/rtc/tm4c123_hib.h"
+#include "hw/irq.h"
+#include "hw/core/cpu.h"
+#include "hw/qdev-clock.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "sysemu/cpu-timers.h"
+#include "sysemu/runstate.h"
+#include "migration/vmstate.h"
+#include "trace.h"
+
+#define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
+#define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
+
+static bool hib_rtc_running(TM4C123HibState *s)
+{
+    return (s->hib_ctl & (HIB_CTL_RTCEN | HIB_CTL_CLK32EN)) ==
+           (HIB_CTL_RTCEN | HIB_CTL_CLK32EN);
+}
+
+/* RTCC and RTCSS.RTCSSC side by side; the seconds wrap is not modelled */
+static uint64_t hib_rtc_ticks(TM4C123HibState *s, int64_t now)
+{
+    if (!hib_rtc_running(s)) {
+        return s->base_ticks;
+    }
+    return s->base_ticks + muldiv64(now - s->base_ns, HIB_RTC_HZ,
+                                     NANOSECONDS_PER_SECOND);
+}
+
+/* When the RTC reaches @ticks, rounded up to the first whole ns */
+static int64_t hib_rtc_ns(TM4C123HibState *s, uint64_t ticks)
+{
+    uint64_t ns = muldiv64(ticks - s->base_ticks, NANOSECONDS_PER_SECOND, HIB_RTC_HZ);
+
+    if (muldiv64(ns, HIB_RTC_HZ, NANOSECONDS_PER_SECOND) < ticks - s->base_ticks) {
+        ns++;
+    }
+    return s->base_ns + ns;
+}
+
+static uint64_t hib_rtc_match(TM4C123HibState *s)
+{
+    return ((uint64_t)s->hib_rtcm0 << HIB_RTC_SUBSEC_BITS) | s->hib_rtcssm;
+}
+
+/* Restart the RTC from @ticks, forgetting matches it jumps over */
+static void hib_rtc_set(TM4C123HibState *s, uint64_t ticks, int64_t now)
+{
+    s->base_ticks = ticks;
+    s->base_ns = now;
+    s->checked_ticks = ticks;
+}
+
+/* Catch up with the RTC: a match passed since the last look raises RTCALT0 */
+static void hib_sync(TM4C123HibState *s)
+{
+    uint64_t now_ticks = hib_rtc_ticks(s, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL));
+    uint64_t match = hib_rtc_match(s);
+
+    if (match > s->checked_ticks && match <= now_ticks) {
+        s->hib_ris |= HIB_INT_RTCALT0;
+    }
+    s->checked_ticks = now_ticks;
+}
+
+static void hib_update(TM4C123HibState *s)
+{
+    qemu_set_irq(s->irq, s->hib_ris & s->hib_im);
+}
+
+static bool hib_rtc_wakes(TM4C123HibState *s)
+{
+    return s->hibernating && (s->hib_ctl & HIB_CTL_RTCWEN);
+}
+
+/* Only wake up for a match that raises an interrupt or ends hibernation */
+static void hib_schedule(TM4C123HibState *s)
+{
+    uint64_t match = hib_rtc_match(s);
+
+    if (hib_rtc_running(s) && match > s->checked_ticks &&
+        ((s->hib_im & HIB_INT_RTCALT0) || hib_rtc_wakes(s))) {
+        timer_mod(s->rtc_timer, hib_rtc_ns(s, match));
+    } else {
+        timer_del(s->rtc_timer);
+    }
+}
+
+/* Power comes back: the core starts over from reset */
+static void hib_wake(TM4C123HibState *s, uint32_t cause)
+{
+    trace_tm4c123_hib_wake(cause);
+    s->hib_ris |= cause;
+    s->hibernating = false;
+    s->hib_ctl &= ~HIB_CTL_HIBREQ;
+    qemu_set_irq(s->hibernate, 0);
+    if (qemu_irq_is_connected(s->reset)) {
+        qemu_irq_pulse(s->reset);
+    } else {
+        qemu_system_reset_request(SHUTDOWN_CAUSE_GUEST_RESET);
+    }
+}
+
+static void hib_rtc_timer(void *opaque)
+{
+    TM4C123HibState *s = opaque;
+
+    hib_sync(s);
+    if (hib_rtc_wakes(s) && (s->hib_ris & HIB_INT_RTCALT0)) {
+        hib_wake(s, HIB_INT_RTCALT0);
+        return;
+    }
+    hib_update(s);
+    hib_schedule(s);
+}
+
+/*
+ * How far the clock may jump while this core is powered down. The cores
+ * of other boards must all be waiting for an interrupt, and then the
+ * jump stops at their next timer; otherwise idle=skip is left to it.
+ */
+static int64_t hib_skip_limit(int64_t delta)
+{
+    int64_t deadline;
+    bool others = false;
+    CPUState *cpu;
+
+    CPU_FOREACH(cpu) {
+        if (cpu == current_cpu) {
+            continue;
+        }
+        if (!qatomic_read(&cpu->halted)) {
+            return 0;
+        }
+        others = true;
+    }
+    if (others) {
+        deadline = qemu_clock_deadline_ns_all(QEMU_CLOCK_VIRTUAL, QEMU_TIMER_ATTR_ALL);
+        if (deadline >= 0) {
+            delta = MIN(delta, deadline);
+        }
+    }
+    return delta;
+}
+
+/*
+ * Power the core down. Nothing runs until a wake event, so when the RTC
+ * is the only one left the virtual clock can go straight to it.
+ */
+static void hib_hibernate(TM4C123HibState *s)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    uint64_t match = hib_rtc_match(s);
+
+    if (!(s->hib_ctl & HIB_CTL_CLK32EN)) {
+        LOG(LOG_GUEST_ERROR, "Cannot hibernate without the 32 kHz clock\n");
+        s->hib_ctl &= ~HIB_CTL_HIBREQ;
+        return;
+    }
+    trace_tm4c123_hib_hibernate(s->hib_ctl);
+    s->hibernating = true;
+    qemu_set_irq(s->hibernate, 1);
+    hib_schedule(s);
+
+    if (hib_rtc_wakes(s) && !(s->hib_ctl & HIB_CTL_PINWEN) &&
+        hib_rtc_running(s) && match > s->checked_ticks) {
+        cpu_clock_advance(hib_skip_limit(hib_rtc_ns(s, match) - now));
+    }
+}
+
+static void hib_ctl_write(TM4C123HibState *s, uint32_t val32)
+{
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+    uint64_t ticks = hib_rtc_ticks(s, now);
+    bool was_running = hib_rtc_running(s);
+
+    /* The battery is always good, so a check ends at once */
+    s->hib_ctl = val32 & HIB_CTL_MASK & ~HIB_CTL_BATCHK;
+    if (was_running != hib_rtc_running(s)) {
+        hib_rtc_set(s, ticks, now);
+    }
+    if ((val32 & HIB_CTL_HIBREQ) && !s->hibernating) {
+        hib_hibernate(s);
+    }
+}
+
+static void hib_wake_pin(void *opaque, int line, int level)
+{
+    TM4C123HibState *s = opaque;
+    bool asserted = !s->wake_pin && level;
+
+    s->wake_pin = level;
+    if (!asserted || !(s->hib_ctl & HIB_CTL_PINWEN)) {
+        return;
+    }
+    if (s->hibernating) {
+        hib_wake(s, HIB_INT_EXTW);
+        return;
+    }
+    s->hib_ris |= HIB_INT_EXTW;
+    hib_update(s);
+}
+
+/* Only the part outside the battery domain comes out of reset */
+static void tm4c123_hib_reset(DeviceState *dev)
+{
+    TM4C123HibState *s = TM4C123_HIB(dev);
+
+    s->hib_im = 0x00000000;
+    s->hibernating = false;
+    s->hib_ctl &= ~HIB_CTL_HIBREQ;
+    qemu_set_irq(s->hibernate, 0);
+
+    hib_sync(s);
+    hib_update(s);
+    hib_schedule(s);
+}
+
+static uint64_t tm4c123_hib_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    TM4C123HibState *s = opaque;
+    uint64_t ticks;
+
+    trace_tm4c123_hib_read(addr);
+    hib_sync(s);
+    ticks = s->checked_ticks;
+
+    if (addr >= HIB_DATA && addr <= HIB_DATA_END) {
+        return s->hib_data[(addr - HIB_DATA) / 4];
+    }
+
+    switch (addr) {
+        case HIB_RTCC:
+            return (uint32_t)(ticks >> HIB_RTC_SUBSEC_BITS);
+        case HIB_RTCM0:
+            return s->hib_rtcm0;
+        case HIB_RTCLD:
+            return s->hib_rtcld;
+        case HIB_CTL:
+            /* Writes land at once, so WRC always reads ready */
+            return s->hib_ctl | HIB_CTL_WRC;
+        case HIB_IM:
+            return s->hib_im;
+        case HIB_RIS:
+            return s->hib_ris;
+        case HIB_MIS:
+            return s->hib_ris & s->hib_im;
+        case HIB_RTCT:
+            return s->hib_rtct;
+        case HIB_RTCSS:
+            return (s->hib_rtcssm << 16) | (ticks & HIB_RTCSS_RTCSSC);
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return 0;
+    }
+
+    return 0;
+}
+
+static void tm4c123_hib_write(void *opaque, hwaddr addr, uint64_t val64, unsigned int size)
+{
+    TM4C123HibState *s = opaque;
+    uint32_t val32 = val64;
+    int64_t now = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+
+    trace_tm4c123_hib_write(addr, val32);
+    hib_sync(s);
+
+    if (addr >= HIB_DATA && addr <= HIB_DATA_END) {
+        s->hib_data[(addr - HIB_DATA) / 4] = val32;
+        s->hib_ris |= HIB_INT_WC;
+        hib_update(s);
+        return;
+    }
+
+    switch (addr) {
+        case HIB_RTCM0:
+            s->hib_rtcm0 = val32;
+            break;
+        case HIB_RTCLD:
+            s->hib_rtcld = val32;
+            hib_rtc_set(s, (uint64_t)val32 << HIB_RTC_SUBSEC_BITS, now);
+            break;
+        case HIB_CTL:
+            hib_ctl_write(s, val32);
+            break;
+        case HIB_IM:
+            s->hib_im = val32 & HIB_INT_MASK;
+            break;
+        case HIB_IC:
+            s->hib_ris &= ~(val32 & HIB_INT_MASK);
+            break;
+        case HIB_RTCT:
+            /* Kept for the guest; the RTC runs at exactly 32.768 kHz */
+            s->hib_rtct = val32 & 0xFFFF;
+            break;
+        case HIB_RTCSS:
+            s->hib_rtcssm = (val32 & HIB_RTCSS_RTCSSM) >> 16;
+            break;
+        case HIB_RTCC:
+        case HIB_RIS:
+        case HIB_MIS:
+            READONLY;
+            return;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return;
+    }
+    /* Registers in the battery domain report each completed write */
+    if (addr != HIB_IM && addr != HIB_IC) {
+        s->hib_ris |= HIB_INT_WC;
+    }
+    hib_update(s);
+    hib_schedule(s);
+}
+
+/* Accesses with the module clock gated off answer with a bus fault */
+static MemTxResult tm4c123_hib_read_with_attrs(void *opaque, hwaddr addr, uint64_t *data,
+                                               unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123HibState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "Hibernation module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_hib_read(opaque, addr, size);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_hib_write_with_attrs(void *opaque, hwaddr addr, uint64_t val64,
+                                                unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123HibState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "Hibernation module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    tm4c123_hib_write(opaque, addr, val64, size);
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps tm4c123_hib_ops = {
+    .read_with_attrs = tm4c123_hib_read_with_attrs,
+    .write_with_attrs = tm4c123_hib_write_with_attrs,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static void tm4c123_hib_init(Object *obj)
+{
+    TM4C123HibState *s = TM4C123_HIB(obj);
+
+    s->clk = qdev_init_clock_in(DEVICE(s), "hib_clock", NULL, NULL, 0);
+    s->rtc_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, hib_rtc_timer, s);
+
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    qdev_init_gpio_in_named(DEVICE(obj), hib_wake_pin, "wake", 1);
+    qdev_init_gpio_out_named(DEVICE(obj), &s->hibernate, "hibernate", 1);
+    qdev_init_gpio_out_named(DEVICE(obj), &s->reset, "reset", 1);
+
+    memory_region_init_io(&s->mmio, obj, &tm4c123_hib_ops, s,
+            TYPE_TM4C123_HIB, 0xFFF);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
+}
+
+/* Power-on values of the battery domain */
+static void tm4c123_hib_realize(DeviceState *dev, Error **errp)
+{
+    TM4C123HibState *s = TM4C123_HIB(dev);
+
+    s->hib_ctl = 0x00002000;
+    s->hib_rtct = 0x00007FFF;
+    s->hib_rtcm0 = 0xFFFFFFFF;
+    s->hib_rtcld = 0x00000000;
+    s->hib_ris = 0x00000000;
+    s->hib_rtcssm = 0x00000000;
+    memset(s->hib_data, 0, sizeof(s->hib_data));
+    hib_rtc_set(s, 0, 0);
+}
+
+static const VMStateDescription vmstate_tm4c123_hib = {
+    .name = TYPE_TM4C123_HIB,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(hib_rtcm0, TM4C123HibState),
+        VMSTATE_UINT32(hib_rtcld, TM4C123HibState),
+        VMSTATE_UINT32(hib_ctl, TM4C123HibState),
+        VMSTATE_UINT32(hib_im, TM4C123HibState),
+        VMSTATE_UINT32(hib_ris, TM4C123HibState),
+        VMSTATE_UINT32(hib_rtct, TM4C123HibState),
+        VMSTATE_UINT32(hib_rtcssm, TM4C123HibState),
+        VMSTATE_UINT32_ARRAY(hib_data, TM4C123HibState, HIB_DATA_WORDS),
+        VMSTATE_UINT64(base_ticks, TM4C123HibState),
+        VMSTATE_INT64(base_ns, TM4C123HibState),
+        VMSTATE_UINT64(checked_ticks, TM4C123HibState),
+        VMSTATE_BOOL(hibernating, TM4C123HibState),
+        VMSTATE_BOOL(wake_pin, TM4C123HibState),
+        VMSTATE_TIMER_PTR(rtc_timer, TM4C123HibState),
+        VMSTATE_CLOCK(clk, TM4C123HibState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void tm4c123_hib_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = tm4c123_hib_reset;
+    dc->vmsd = &vmstate_tm4c123_hib;
+    dc->realize = tm4c123_hib_realize;
+}
+
+static const TypeInfo tm4c123_hib_info = {
+    .name          = TYPE_TM4C123_HIB,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(TM4C123HibState),
+    .instance_init = tm4c123_hib_init,
+    .class_init    = tm4c123_hib_class_init,
+};
+
+static void tm4c123_hib_register_types(void)
+{
+    type_register_static(&tm4c123_hib_info);
+}
+
+type_init(tm4c123_hib_register_types)
@@ -0,0 +1,566 @@
+/*
+ * TM4C123 SSI
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "hw/ssi/tm4c123_ssi.h"
+#include "hw/irq.h"
+#include "hw/qdev-properties.h"
+#include "hw/qdev-clock.h"
+#include "qemu/timer.h"
+#include "qemu/host-utils.h"
+#include "qemu/bitops.h"
+#include "qemu/log.h"
+#include "qemu/module.h"
+#include "migration/vmstate.h"
+#include "trace.h"
+
+#define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
+#define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
+
+/* The RX and TX interrupts and burst requests fire at half the FIFO */
+#define SSI_FIFO_HALF (SSI_FIFO_DEPTH / 2)
+/* Bit periods without a new frame before the receive time-out */
+#define SSI_RX_TIMEOUT_BITS 32
+
+static uint32_t tm4c123_ssi_frame_bits(TM4C123SSIState *s)
+{
+    /* DSS values below 3 are reserved, treat them as the 4-bit minimum */
+    return MAX(extract32(s->ssi_cr0, 0, 4), 3) + 1;
+}
+
+static bool tm4c123_ssi_running(TM4C123SSIState *s)
+{
+    return (s->ssi_cr1 & SSI_CR1_SSE) && !(s->ssi_cr1 & SSI_CR1_MS) &&
+           clock_is_enabled(s->clk);
+}
+
+/*
+ * Duration of one SSInClk period: the baud clock divided by CPSDVSR and
+ * SCR + 1. 0 means frames complete instantly, which is how the "fast"
+ * timing mode and an unprogrammed prescaler behave.
+ */
+static uint64_t tm4c123_ssi_bit_time_ns(TM4C123SSIState *s)
+{
+    uint64_t clk_hz;
+    uint32_t cpsdvsr = s->ssi_cpsr & 0xFE;
+    uint32_t scr = extract32(s->ssi_cr0, 8, 8);
+
+    if (s->fast_timing) {
+        return 0;
+    }
+
+    if ((s->ssi_cc & 0xF) == SSI_CC_CS_PIOSC) {
+        clk_hz = XTALI;
+    } else {
+        clk_hz = clock_get_hz(s->clk);
+    }
+
+    if (!clk_hz || !cpsdvsr) {
+        return 0;
+    }
+    return muldiv64(cpsdvsr * (1 + scr), NANOSECONDS_PER_SECOND, clk_hz);
+}
+
+static uint64_t tm4c123_ssi_frame_time_ns(TM4C123SSIState *s)
+{
+    return tm4c123_ssi_frame_bits(s) * tm4c123_ssi_bit_time_ns(s);
+}
+
+/*
+ * Shift the first @n frames of the TX FIFO out, and the replies into the
+ * RX FIFO. A reply with the RX FIFO full is lost and flags an overrun.
+ */
+static void tm4c123_ssi_shift(TM4C123SSIState *s, uint32_t n)
+{
+    uint64_t frame_ns = tm4c123_ssi_frame_time_ns(s);
+    uint32_t mask = MAKE_64BIT_MASK(0, tm4c123_ssi_frame_bits(s));
+    uint32_t val;
+    uint32_t i;
+
+    for (i = 0; i < n; i++) {
+        val = s->tx_fifo[i];
+        if (!(s->ssi_cr1 & SSI_CR1_LBM)) {
+            val = ssi_transfer(s->bus, val);
+        }
+        trace_tm4c123_ssi_xfer(s->tx_fifo[i], val & mask);
+
+        if (s->rx_count < SSI_FIFO_DEPTH) {
+            s->rx_fifo[s->rx_count++] = val & mask;
+        } else {
+            s->ssi_ris |= SSI_INT_ROR;
+        }
+        s->rx_last_ns = s->tx_start_ns + (i + 1) * frame_ns;
+        s->rx_timeout_armed = true;
+    }
+
+    s->tx_count -= n;
+    s->tx_start_ns += n * frame_ns;
+    memmove(s->tx_fifo, s->tx_fifo + n, s->tx_count * sizeof(s->tx_fifo[0]));
+}
+
+/*
+ * Bring the line up to the current virtual time: every frame whose last
+ * bit has gone out by now is transferred. Nothing is polled per frame;
+ * register reads and the wake-ups below catch up in one go.
+ */
+static void tm4c123_ssi_sync(TM4C123SSIState *s)
+{
+    uint64_t frame_ns = tm4c123_ssi_frame_time_ns(s);
+    int64_t elapsed;
+    uint32_t n;
+
+    if (!tm4c123_ssi_running(s) || !s->tx_count) {
+        return;
+    }
+
+    if (!frame_ns) {
+        n = s->tx_count;
+    } else {
+        elapsed = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - s->tx_start_ns;
+        n = elapsed > 0 ? MIN(elapsed / frame_ns, s->tx_count) : 0;
+    }
+    if (n) {
+        tm4c123_ssi_shift(s, n);
+    }
+}
+
+/*
+ * Wake up on the next frame that changes something the guest or the
+ * uDMA can see: a FIFO crossing its half level, the RX FIFO overrunning,
+ * the TX FIFO draining. With DMA enabled every frame moves a request.
+ */
+static void tm4c123_ssi_schedule(TM4C123SSIState *s)
+{
+    uint64_t frame_ns = tm4c123_ssi_frame_time_ns(s);
+    uint32_t target = s->tx_count;
+
+    if (!frame_ns || !tm4c123_ssi_running(s) || !s->tx_count) {
+        timer_del(s->tx_timer);
+        return;
+    }
+
+    if (s->tx_count > SSI_FIFO_HALF) {
+        target = MIN(target, s->tx_count - SSI_FIFO_HALF);
+    }
+    if (s->rx_count < SSI_FIFO_HALF) {
+        target = MIN(target, SSI_FIFO_HALF - s->rx_count);
+    }
+    target = MIN(target, SSI_FIFO_DEPTH - s->rx_count + 1);
+    if (s->ssi_dma_ctl) {
+        target = 1;
+    }
+    timer_mod(s->tx_timer, s->tx_start_ns + target * frame_ns);
+}
+
+/* Restart the frame in flight, e.g. after a bit rate change */
+static void tm4c123_ssi_retime(TM4C123SSIState *s)
+{
+    s->tx_start_ns = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL);
+}
+
+static void tm4c123_ssi_update(TM4C123SSIState *s)
+{
+    bool rx_dma = s->ssi_dma_ctl & SSI_DMACTL_RXDMAE;
+    bool tx_dma = s->ssi_dma_ctl & SSI_DMACTL_TXDMAE;
+    bool tx_int;
+    int64_t deadline;
+
+    s->ssi_sr = 0;
+    s->ssi_sr |= s->tx_count ? SSI_SR_BSY : SSI_SR_TFE;
+    s->ssi_sr |= (s->tx_count < SSI_FIFO_DEPTH) ? SSI_SR_TNF : 0;
+    s->ssi_sr |= s->rx_count ? SSI_SR_RNE : 0;
+    s->ssi_sr |= (s->rx_count == SSI_FIFO_DEPTH) ? SSI_SR_RFF : 0;
+
+    /* The receive time-out fires once per frame received and left unread */
+    if (!s->rx_count) {
+        s->rx_timeout_armed = false;
+    }
+    if (s->rx_timeout_armed) {
+        deadline = s->rx_last_ns + SSI_RX_TIMEOUT_BITS * tm4c123_ssi_bit_time_ns(s);
+        if (deadline <= qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL)) {
+            s->ssi_ris |= SSI_INT_RT;
+            s->rx_timeout_armed = false;
+            timer_del(s->rx_timeout);
+        } else {
+            timer_mod(s->rx_timeout, deadline);
+        }
+    } else {
+        timer_del(s->rx_timeout);
+    }
+
+    /* EOT moves the TX interrupt from half empty to the end of the transfer */
+    if (s->ssi_cr1 & SSI_CR1_EOT) {
+        tx_int = !s->tx_count;
+    } else {
+        tx_int = s->tx_count <= SSI_FIFO_HALF;
+    }
+    s->ssi_ris &= SSI_INT_ROR | SSI_INT_RT;
+    s->ssi_ris |= tx_int ? SSI_INT_TX : 0;
+    s->ssi_ris |= (s->rx_count >= SSI_FIFO_HALF) ? SSI_INT_RX : 0;
+    s->ssi_mis = s->ssi_ris & s->ssi_im;
+    qemu_set_irq(s->irq, s->ssi_mis != 0);
+
+    qemu_set_irq(s->fss, !(tm4c123_ssi_running(s) && s->tx_count));
+
+    qemu_set_irq(s->dma_req[SSI_DMA_RX], rx_dma && s->rx_count >= SSI_FIFO_HALF);
+    qemu_set_irq(s->dma_sreq[SSI_DMA_RX], rx_dma && s->rx_count);
+    qemu_set_irq(s->dma_req[SSI_DMA_TX], tx_dma && s->tx_count <= SSI_FIFO_HALF);
+    qemu_set_irq(s->dma_sreq[SSI_DMA_TX], tx_dma && s->tx_count < SSI_FIFO_DEPTH);
+
+    tm4c123_ssi_schedule(s);
+}
+
+static void tm4c123_ssi_tick(void *opaque)
+{
+    TM4C123SSIState *s = opaque;
+
+    tm4c123_ssi_sync(s);
+    tm4c123_ssi_update(s);
+}
+
+static void tm4c123_ssi_tx_push(TM4C123SSIState *s, uint16_t val)
+{
+    tm4c123_ssi_sync(s);
+    if (s->tx_count >= SSI_FIFO_DEPTH) {
+        LOG(LOG_GUEST_ERROR, "TX FIFO overflow, dropping 0x%04x\n", val);
+        return;
+    }
+    if (!s->tx_count) {
+        /* The line is idle, this frame starts shifting now */
+        tm4c123_ssi_retime(s);
+    }
+    s->tx_fifo[s->tx_count++] = val;
+    tm4c123_ssi_sync(s);
+    tm4c123_ssi_update(s);
+}
+
+static uint16_t tm4c123_ssi_rx_pop(TM4C123SSIState *s)
+{
+    uint16_t val;
+
+    tm4c123_ssi_sync(s);
+    if (!s->rx_count) {
+        return 0;
+    }
+    val = s->rx_fifo[0];
+    s->rx_count--;
+    memmove(s->rx_fifo, s->rx_fifo + 1, s->rx_count * sizeof(s->rx_fifo[0]));
+    tm4c123_ssi_update(s);
+    return val;
+}
+
+static void tm4c123_ssi_reset(DeviceState *dev)
+{
+    TM4C123SSIState *s = TM4C123_SSI(dev);
+
+    s->ssi_cr0 = 0x00000000;
+    s->ssi_cr1 = 0x00000000;
+    s->ssi_cpsr = 0x00000000;
+    s->ssi_im = 0x00000000;
+    s->ssi_ris = 0x00000000;
+    s->ssi_dma_ctl = 0x00000000;
+    s->ssi_cc = 0x00000000;
+
+    s->tx_count = 0;
+    s->rx_count = 0;
+    s->rx_timeout_armed = false;
+    timer_del(s->tx_timer);
+    timer_del(s->rx_timeout);
+
+    tm4c123_ssi_update(s);
+}
+
+static uint64_t tm4c123_ssi_read(void *opaque, hwaddr addr, unsigned int size)
+{
+    TM4C123SSIState *s = opaque;
+
+    trace_tm4c123_ssi_read(addr);
+
+    switch (addr) {
+        case SSI_CR0:
+            return s->ssi_cr0;
+        case SSI_CR1:
+            return s->ssi_cr1;
+        case SSI_DR:
+            return tm4c123_ssi_rx_pop(s);
+        case SSI_SR:
+            tm4c123_ssi_sync(s);
+            tm4c123_ssi_update(s);
+            return s->ssi_sr;
+        case SSI_CPSR:
+            return s->ssi_cpsr;
+        case SSI_IM:
+            return s->ssi_im;
+        case SSI_RIS:
+            tm4c123_ssi_sync(s);
+            tm4c123_ssi_update(s);
+            return s->ssi_ris;
+        case SSI_MIS:
+            tm4c123_ssi_sync(s);
+            tm4c123_ssi_update(s);
+            return s->ssi_mis;
+        case SSI_DMA_CTL:
+            return s->ssi_dma_ctl;
+        case SSI_CC:
+            return s->ssi_cc;
+        case SSI_PER_ID4:
+        case SSI_PER_ID5:
+        case SSI_PER_ID6:
+        case SSI_PER_ID7:
+            return 0x00;
+        case SSI_PER_ID0:
+            return 0x22;
+        case SSI_PER_ID1:
+            return 0x00;
+        case SSI_PER_ID2:
+            return 0x18;
+        case SSI_PER_ID3:
+            return 0x01;
+        case SSI_PCELL_ID0:
+            return 0x0D;
+        case SSI_PCELL_ID1:
+            return 0xF0;
+        case SSI_PCELL_ID2:
+            return 0x05;
+        case SSI_PCELL_ID3:
+            return 0xB1;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return 0;
+    }
+
+    return 0;
+}
+
+static void tm4c123_ssi_write(void *opaque, hwaddr addr, uint64_t val64, unsigned int size)
+{
+    TM4C123SSIState *s = opaque;
+    uint32_t val32 = val64;
+
+    trace_tm4c123_ssi_write(addr, val32);
+
+    switch (addr) {
+        case SSI_CR0:
+            tm4c123_ssi_sync(s);
+            s->ssi_cr0 = val32 & 0xFFFF;
+            tm4c123_ssi_retime(s);
+            break;
+        case SSI_CR1:
+            tm4c123_ssi_sync(s);
+            if ((val32 & (SSI_CR1_SSE | SSI_CR1_MS)) == (SSI_CR1_SSE | SSI_CR1_MS)) {
+                LOG(LOG_UNIMP, "slave mode is not implemented\n");
+            }
+            s->ssi_cr1 = val32 & 0x1F;
+            tm4c123_ssi_retime(s);
+            break;
+        case SSI_DR:
+            tm4c123_ssi_tx_push(s, val32 & 0xFFFF);
+            return;
+        case SSI_CPSR:
+            tm4c123_ssi_sync(s);
+            s->ssi_cpsr = val32 & 0xFF;
+            tm4c123_ssi_retime(s);
+            break;
+        case SSI_IM:
+            s->ssi_im = val32 & 0xF;
+            break;
+        case SSI_ICR:
+            /* Only the overrun and time-out interrupts latch */
+            s->ssi_ris &= ~(val32 & (SSI_INT_ROR | SSI_INT_RT));
+            break;
+        case SSI_DMA_CTL:
+            s->ssi_dma_ctl = val32 & 0x3;
+            break;
+        case SSI_CC:
+            tm4c123_ssi_sync(s);
+            s->ssi_cc = val32 & 0xF;
+            tm4c123_ssi_retime(s);
+            break;
+        case SSI_SR:
+        case SSI_RIS:
+        case SSI_MIS:
+        case SSI_PER_ID4:
+        case SSI_PER_ID5:
+        case SSI_PER_ID6:
+        case SSI_PER_ID7:
+        case SSI_PER_ID0:
+        case SSI_PER_ID1:
+        case SSI_PER_ID2:
+        case SSI_PER_ID3:
+        case SSI_PCELL_ID0:
+        case SSI_PCELL_ID1:
+        case SSI_PCELL_ID2:
+        case SSI_PCELL_ID3:
+            READONLY;
+            return;
+        default:
+            LOG(LOG_GUEST_ERROR, "Bad address 0x%"HWADDR_PRIx"\n", addr);
+            return;
+    }
+    tm4c123_ssi_sync(s);
+    tm4c123_ssi_update(s);
+}
+
+/* Accesses with the module clock gated off answer with a bus fault */
+static MemTxResult tm4c123_ssi_read_with_attrs(void *opaque, hwaddr addr, uint64_t *data,
+                                               unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123SSIState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "SSI module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_ssi_read(opaque, addr, size);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_ssi_write_with_attrs(void *opaque, hwaddr addr, uint64_t val64,
+                                                unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123SSIState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "SSI module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    tm4c123_ssi_write(opaque, addr, val64, size);
+    return MEMTX_OK;
+}
+
+static const MemoryRegionOps tm4c123_ssi_ops = {
+    .read_with_attrs = tm4c123_ssi_read_with_attrs,
+    .write_with_attrs = tm4c123_ssi_write_with_attrs,
+    .endianness = DEVICE_NATIVE_ENDIAN,
+};
+
+static Property tm4c123_ssi_properties[] = {
+    DEFINE_PROP_BOOL("fast-timing", TM4C123SSIState, fast_timing, false),
+    DEFINE_PROP_END_OF_LIST(),
+};
+
+/* Frames already on the line finish at the old rate, the rest at the new one */
+static void tm4c123_ssi_clock_update(void *opaque, ClockEvent event)
+{
+    TM4C123SSIState *s = opaque;
+
+    if (event == ClockPreUpdate) {
+        tm4c123_ssi_sync(s);
+    } else {
+        tm4c123_ssi_retime(s);
+        tm4c123_ssi_update(s);
+    }
+}
+
+static void tm4c123_ssi_init(Object *obj)
+{
+    TM4C123SSIState *s = TM4C123_SSI(obj);
+
+    s->clk = qdev_init_clock_in(DEVICE(s), "ssi_clock", tm4c123_ssi_clock_update, s,
+                                ClockPreUpdate | ClockUpdate);
+    s->tx_timer = timer_new_ns(QEMU_CLOCK_VIRTUAL, tm4c123_ssi_tick, s);
+    s->rx_timeout = timer_new_ns(QEMU_CLOCK_VIRTUAL, tm4c123_ssi_tick, s);
+
+    sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    qdev_init_gpio_out_named(DEVICE(obj), &s->fss, "fss", 1);
+    qdev_init_gpio_out_named(DEVICE(obj), s->dma_req, "dma-req", 2);
+    qdev_init_gpio_out_named(DEVICE(obj), s->dma_sreq, "dma-sreq", 2);
+
+    memory_region_init_io(&s->mmio, obj, &tm4c123_ssi_ops, s,
+            TYPE_TM4C123_SSI, 0xFFF);
+    sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
+}
+
+static void tm4c123_ssi_realize(DeviceState *dev, Error **errp)
+{
+    TM4C123SSIState *s = TM4C123_SSI(dev);
+
+    /* Unnamed, so the controllers get ssi.0 to ssi.3 in creation order */
+    s->bus = ssi_create_bus(dev, NULL);
+}
+
+static int tm4c123_ssi_post_load(void *opaque, int version_id)
+{
+    TM4C123SSIState *s = opaque;
+
+    if (s->tx_count > SSI_FIFO_DEPTH || s->rx_count > SSI_FIFO_DEPTH) {
+        return -1;
+    }
+    return 0;
+}
+
+static const VMStateDescription vmstate_tm4c123_ssi = {
+    .name = TYPE_TM4C123_SSI,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .post_load = tm4c123_ssi_post_load,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(ssi_cr0, TM4C123SSIState),
+        VMSTATE_UINT32(ssi_cr1, TM4C123SSIState),
+        VMSTATE_UINT32(ssi_sr, TM4C123SSIState),
+        VMSTATE_UINT32(ssi_cpsr, TM4C123SSIState),
+        VMSTATE_UINT32(ssi_im, TM4C123SSIState),
+        VMSTATE_UINT32(ssi_ris, TM4C123SSIState),
+        VMSTATE_UINT32(ssi_mis, TM4C123SSIState),
+        VMSTATE_UINT32(ssi_dma_ctl, TM4C123SSIState),
+        VMSTATE_UINT32(ssi_cc, TM4C123SSIState),
+        VMSTATE_UINT16_ARRAY(tx_fifo, TM4C123SSIState, SSI_FIFO_DEPTH),
+        VMSTATE_UINT32(tx_count, TM4C123SSIState),
+        VMSTATE_INT64(tx_start_ns, TM4C123SSIState),
+        VMSTATE_UINT16_ARRAY(rx_fifo, TM4C123SSIState, SSI_FIFO_DEPTH),
+        VMSTATE_UINT32(rx_count, TM4C123SSIState),
+        VMSTATE_INT64(rx_last_ns, TM4C123SSIState),
+        VMSTATE_BOOL(rx_timeout_armed, TM4C123SSIState),
+        VMSTATE_TIMER_PTR(tx_timer, TM4C123SSIState),
+        VMSTATE_TIMER_PTR(rx_timeout, TM4C123SSIState),
+        VMSTATE_CLOCK(clk, TM4C123SSIState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
+static void tm4c123_ssi_class_init(ObjectClass *klass, void *data)
+{
+    DeviceClass *dc = DEVICE_CLASS(klass);
+
+    dc->reset = tm4c123_ssi_reset;
+    dc->realize = tm4c123_ssi_realize;
+    dc->vmsd = &vmstate_tm4c123_ssi;
+    device_class_set_props(dc, tm4c123_ssi_properties);
+}
+
+static const TypeInfo tm4c123_ssi_info = {
+    .name          = TYPE_TM4C123_SSI,
+    .parent        = TYPE_SYS_BUS_DEVICE,
+    .instance_size = sizeof(TM4C123SSIState),
+    .instance_init = tm4c123_ssi_init,
+    .class_init    = tm4c123_ssi_class_init,
+};
+
+static void tm4c123_ssi_register_types(void)
+{
+    type_register_static(&tm4c123_ssi_info);
+}
+
+type_init(tm4c123_ssi_register_types)
@@ -24,179 +24,697 @@
 
 #include "hw/timer/tm4c123_gptm.h"
 #include "hw/irq.h"
+#include "hw/qdev-properties.h"
+#include "migration/vmstate.h"
 #include "trace.h"
 #include "qemu/timer.h"
-#include <time.h>
+#include "qemu/host-utils.h"
 
 #define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
 #define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
 
-static uint64_t ns_to_ticks(void *opaque, uint64_t ns, uint32_t prescaler)
+/* Register layout of one half */
+typedef struct {
+    uint32_t en;
+    int event_shift;
+    uint32_t pwml;
+    /* TnOTE: the time-out also triggers the ADC */
+    uint32_t ote;
+    uint32_t to_int;
+    uint32_t cm_int;
+    uint32_t ce_int;
+    uint32_t m_int;
+} GPTMHalfInfo;
+
+static const GPTMHalfInfo gptm_half[2] = {
+    [GPTM_A] = {
+        .en = GPTM_TACTL_EN, .event_shift = 2, .pwml = 1 << 6, .ote = 1 << 5,
+        .to_int = GPTM_INT_TATO, .cm_int = GPTM_INT_CAM,
+        .ce_int = GPTM_INT_CAE, .m_int = GPTM_INT_TAM,
+    },
+    [GPTM_B] = {
+        .en = GPTM_TBCTL_EN, .event_shift = 10, .pwml = 1 << 14, .ote = 1 << 13,
+        .to_int = GPTM_INT_TBTO, .cm_int = GPTM_INT_CBM,
+        .ce_int = GPTM_INT_CBE, .m_int = GPTM_INT_TBM,
+    },
+};
+
+/* What each mode needs from the time base */
+typedef struct {
+    const char *name;
+    /* Counts the timer clock (the RTC counts seconds instead) */
+    bool timed;
+    /* Starts over at the time-out instead of stopping */
+    bool reloads;
+    /* In the split configuration the prescaler extends the counter */
+    bool extended;
+} GPTMModeInfo;
+
+static const GPTMModeInfo gptm_modes[GPTM_MODE_COUNT] = {
+    [GPTM_MODE_OFF]        = { "off",        false, false, false },
+    [GPTM_MODE_ONESHOT]    = { "one-shot",   true,  false, false },
+    [GPTM_MODE_PERIODIC]   = { "periodic",   true,  true,  false },
+    [GPTM_MODE_RTC]        = { "rtc",        true,  true,  false },
+    [GPTM_MODE_EDGE_COUNT] = { "edge-count", false, false, true  },
+    [GPTM_MODE_EDGE_TIME]  = { "edge-time",  true,  true,  true  },
+    [GPTM_MODE_PWM]        = { "pwm",        true,  true,  true  },
+};
+
+/* Counter width of one half in the current configuration, in bits */
+static unsigned gptm_width(TM4C123GPTMState *s)
 {
-    TM4C123GPTMState *s = opaque;
+    if (s->gptm_cfg == GPTM_CFG_SPLIT) {
+        return s->wide ? 32 : 16;
+    }
+    return s->wide ? 64 : 32;
+}
 
-    uint32_t freq = clock_get_hz(s->clk) / prescaler;
-    float sec = (float)ns / (float)NANOSECONDS_PER_SECOND;
-    return sec * freq;
+static uint32_t gptm_mr(TM4C123GPTMState *s, int ch)
+{
+    return ch == GPTM_A ? s->gptm_amr : s->gptm_bmr;
 }
 
-static unsigned long ticks_to_time_ns(void *opaque, uint64_t ticks, uint32_t prescaler)
+static TM4C123GPTMMode gptm_decode_mode(TM4C123GPTMState *s, int ch)
 {
-    TM4C123GPTMState *s = opaque;
-    uint32_t freq = clock_get_hz(s->clk) / prescaler;
-    return ((float)ticks / (float)freq) * NANOSECONDS_PER_SECOND;
+    uint32_t mr = gptm_mr(s, ch);
+    bool split = s->gptm_cfg == GPTM_CFG_SPLIT;
+
+    if (s->gptm_cfg == GPTM_CFG_RTC) {
+        return ch == GPTM_A ? GPTM_MODE_RTC : GPTM_MODE_OFF;
+    }
+    if (!split && (s->gptm_cfg != GPTM_CFG_32_64 || ch == GPTM_B)) {
+        return GPTM_MODE_OFF;
+    }
+
+    if (mr & GPTM_TNMR_AMS) {
+        return split ? GPTM_MODE_PWM : GPTM_MODE_OFF;
+    }
+    switch (mr & GPTM_TNMR_MODE_MASK) {
+        case GPTM_TNMR_ONESHOT:
+            return GPTM_MODE_ONESHOT;
+        case GPTM_TNMR_PERIODIC:
+            return GPTM_MODE_PERIODIC;
+        case GPTM_TNMR_CAPTURE:
+            if (!split) {
+                return GPTM_MODE_OFF;
+            }
+            return mr & GPTM_TNMR_CMR ? GPTM_MODE_EDGE_TIME : GPTM_MODE_EDGE_COUNT;
+    }
+    return GPTM_MODE_OFF;
 }
 
-static uint16_t get_timer_width(void *opaque)
+/*
+ * Build a half's view of a register pair: the concatenated modes use both
+ * halves, and the split capture/PWM modes extend the 16 or 32-bit value
+ * with the prescaler register.
+ */
+static uint64_t gptm_combine(TM4C123GPTMState *s, int ch,
+                             uint32_t a, uint32_t b, uint32_t pa, uint32_t pb)
 {
-    TM4C123GPTMState *s = opaque;
-    switch (s->mmio.addr) {
-        case TIMER0_32...TIMER5_32:
-            return TIMER_WIDTH_32;
-        case TIMER0_64...TIMER5_64:
-            return TIMER_WIDTH_64;
+    unsigned width = gptm_width(s);
+    uint64_t value;
+
+    if (s->gptm_cfg != GPTM_CFG_SPLIT) {
+        return width == 64 ? deposit64(a, 32, 32, b) : a;
     }
-    return 0;
+    value = extract64(ch == GPTM_A ? a : b, 0, width);
+    if (gptm_modes[s->mode[ch]].extended) {
+        value = deposit64(value, width, width / 2, ch == GPTM_A ? pa : pb);
+    }
+    return value;
 }
 
-static uint64_t build_interval_value(void *opaque)
+static uint64_t gptm_load_value(TM4C123GPTMState *s, int ch)
 {
-    TM4C123GPTMState *s = opaque;
-    uint16_t timer_width = get_timer_width(s);
-    uint64_t interval_value = 0;
-    if (timer_width == TIMER_WIDTH_32) {
-        /* timer is in 32 bit mode or 32bit rtc*/
-        uint16_t upper16 = extract32(s->gptm_talir, 16, 16);
-        uint16_t lower16 = extract32(s->gptm_tblir, 0, 16);
-        interval_value = ((uint32_t)lower16 << 16) + upper16;
-    } else if (timer_width == TIMER_WIDTH_64) {
-        interval_value = ((uint64_t)s->gptm_talir << 32) + s->gptm_tblir;
+    if (s->mode[ch] == GPTM_MODE_RTC) {
+        /* The RTC free-runs and wraps at the counter width */
+        return MAKE_64BIT_MASK(0, gptm_width(s));
     }
+    return gptm_combine(s, ch, s->gptm_talir, s->gptm_tblir, s->gptm_tapr, s->gptm_tbpr);
+}
 
-    trace_tm4c123_gptm_build_interval_value(s->gptm_talir, s->gptm_tblir, interval_value);
-    return interval_value;
+static uint64_t gptm_match_value(TM4C123GPTMState *s, int ch)
+{
+    return gptm_combine(s, ch, s->gptm_tamatchr, s->gptm_tbmatchr,
+                        s->gptm_tapmr, s->gptm_tbpmr);
 }
 
-static void set_timers(void *opaque)
+/*
+ * The prescaler only divides the individual halves of the timed modes; it
+ * is 8 bits wide on the 16/32-bit timers and 16 bits wide on the 32/64-bit
+ * ones.
+ */
+static uint32_t gptm_prescale_value(TM4C123GPTMState *s, int ch)
 {
-    TM4C123GPTMState *s = opaque;
-    uint64_t interval_value;
-    uint16_t timer_width;
-    if (s->gptm_ctl & GPTM_TACTL_EN) {
-        timer_width = get_timer_width(s);
-        if (timer_width == TIMER_WIDTH_32) {
-            /* What is the mode of the timer? 16/32 */
-            if (s->gptm_cfg == 0x4) {
-                /* 16 bit mode */
-                interval_value = extract32(s->gptm_talir, 0, 16);
-                /* Start the timer? */
-                timer_mod(s->a, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + ticks_to_time_ns(s, interval_value, s->gptm_tapr));
-            } else if (s->gptm_cfg == 0x1) {
-                /* 32 bit mode rtc */
-                interval_value = build_interval_value(s);
-                timer_mod(s->a, qemu_clock_get_ns(QEMU_CLOCK_REALTIME) + ticks_to_time_ns(s, interval_value, s->gptm_tapr));
-            } else if (s->gptm_cfg == 0x0) {
-                /* 32 bit mode rtc */
-                interval_value = build_interval_value(s);
-                timer_mod(s->a, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + ticks_to_time_ns(s, interval_value, s->gptm_tapr));
-            }
-        } else if (timer_width == TIMER_WIDTH_64) {
-            /* What is the mode of the timer? 32/64 */
-            if (s->gptm_cfg == 0) {
-                /* 64 bit mode */
-                interval_value = build_interval_value(s);
-                timer_mod(s->a, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + ticks_to_time_ns(s, interval_value, s->gptm_tapr));
-            } else if (s->gptm_cfg == 0x1) {
-                /* 64 bit mode */
-                interval_value = build_interval_value(s);
-                timer_mod(s->a, qemu_clock_get_ns(QEMU_CLOCK_REALTIME) + ticks_to_time_ns(s, interval_value, s->gptm_tapr));
-            } else if (s->gptm_cfg == 0x4) {
-                interval_value = s->gptm_talir;
-                timer_mod(s->a, qemu_clock_get_ns(QEMU_CLOCK_REALTIME) + ticks_to_time_ns(s, interval_value, s->gptm_tapr));
-            }
-        }
-    } else if (s->gptm_ctl & GPTM_TBCTL_EN) {
-        timer_width = get_timer_width(s);
-        if (timer_width == TIMER_WIDTH_32) {
-            /* What is the mode of the timer? 16/32 */
-            if (s->gptm_cfg == 0x4) {
-                /* 16 bit mode */
-                interval_value = extract32(s->gptm_tblir, 0, 16);
-                /* Start the timer? */
-                timer_mod(s->b, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + ticks_to_time_ns(s, interval_value, s->gptm_tbpr));
-            } else if (s->gptm_cfg == 0x01) {
-                /* 32 bit mode rtc */
-                interval_value = build_interval_value(s);
-                timer_mod(s->b,
-                        qemu_clock_get_ns(QEMU_CLOCK_REALTIME) + ticks_to_time_ns(s, interval_value, s->gptm_tbpr));
-            } else if (s->gptm_cfg == 0x00) {
-                /* 32 bit mode rtc */
-                interval_value = build_interval_value(s);
-                timer_mod(s->b,
-                        qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + ticks_to_time_ns(s, interval_value, s->gptm_tbpr));
-            }
-        } else if (timer_width == TIMER_WIDTH_64) {
-            /* What is the mode of the timer? 32/64 */
-            if (s->gptm_cfg == 0) {
-                /* 64 bit mode */
-                interval_value = build_interval_value(s);
-                timer_mod(s->b,
-                        qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) + ticks_to_time_ns(s, interval_value, s->gptm_tbpr));
-            } else if (s->gptm_cfg == 0x1) {
-                /* 64 bit mode */
-                interval_value = build_interval_value(s);
-                timer_mod(s->b,
-                        qemu_clock_get_ns(QEMU_CLOCK_REALTIME) + ticks_to_time_ns(s, interval_value, s->gptm_tbpr));
-            } else if (s->gptm_cfg == 0x4) {
-                interval_value = s->gptm_tblir;
-                timer_mod(s->b,
-                        qemu_clock_get_ns(QEMU_CLOCK_REALTIME) + ticks_to_time_ns(s, interval_value, s->gptm_tbpr));
-            }
-        }
+    uint32_t pr = ch == GPTM_A ? s->gptm_tapr : s->gptm_tbpr;
+
+    if (s->gptm_cfg != GPTM_CFG_SPLIT || gptm_modes[s->mode[ch]].extended) {
+        return 1;
     }
+    return extract32(pr, 0, gptm_width(s) / 2) + 1;
 }
 
-static bool gptm_clock_enabled(TM4C123SysCtlState *s, hwaddr addr)
+/* Latch the mode and counter geometry of a half from its registers */
+static void gptm_configure(TM4C123GPTMState *s, int ch)
 {
-    switch (addr) {
-        case TIMER0_32:
-            return test_bit(0, (const unsigned long *)&s->sysctl_rcgctimer);
+    s->mode[ch] = gptm_decode_mode(s, ch);
+    switch (s->mode[ch]) {
+        case GPTM_MODE_RTC:
+            s->up[ch] = true;
             break;
-        case TIMER1_32:
-            return test_bit(1, (const unsigned long *)&s->sysctl_rcgctimer);
+        case GPTM_MODE_PWM:
+            s->up[ch] = false;
             break;
-        case TIMER2_32:
-            return test_bit(2, (const unsigned long *)&s->sysctl_rcgctimer);
+        default:
+            s->up[ch] = gptm_mr(s, ch) & GPTM_TNMR_CDIR;
             break;
-        case TIMER3_32:
-            return test_bit(3, (const unsigned long *)&s->sysctl_rcgctimer);
+    }
+    s->load[ch] = gptm_load_value(s, ch);
+    s->prescale[ch] = gptm_prescale_value(s, ch);
+}
+
+static bool gptm_running(TM4C123GPTMState *s, int ch)
+{
+    return (s->gptm_ctl & gptm_half[ch].en) && gptm_modes[s->mode[ch]].timed;
+}
+
+/* Time taken by @ticks counts of a half, saturating on overflow */
+static uint64_t gptm_ticks_to_ns(TM4C123GPTMState *s, int ch, uint64_t ticks)
+{
+    uint64_t ns;
+
+    if (s->mode[ch] == GPTM_MODE_RTC) {
+        return umul64_overflow(ticks, NANOSECONDS_PER_SECOND, &ns) ? INT64_MAX : ns;
+    }
+    if (umul64_overflow(ticks, s->prescale[ch], &ns)) {
+        return INT64_MAX;
+    }
+    return clock_ticks_to_ns(s->clk, ns);
+}
+
+static uint64_t gptm_ns_to_ticks(TM4C123GPTMState *s, int ch, uint64_t ns)
+{
+    if (s->mode[ch] == GPTM_MODE_RTC) {
+        return ns / NANOSECONDS_PER_SECOND;
+    }
+    return clock_ns_to_ticks(s->clk, ns) / s->prescale[ch];
+}
+
+/* The RTC counts its own 32.768 kHz input; the rest stop with the timer clock */
+static bool gptm_frozen(TM4C123GPTMState *s, int ch)
+{
+    return s->mode[ch] != GPTM_MODE_RTC && !clock_is_enabled(s->clk);
+}
+
+static uint64_t gptm_period(TM4C123GPTMState *s, int ch)
+{
+    return s->load[ch] == UINT64_MAX ? UINT64_MAX : s->load[ch] + 1;
+}
+
+/* Instant of tick @offset into period @n of a running half */
+static int64_t gptm_deadline(TM4C123GPTMState *s, int ch, uint64_t n, uint64_t offset)
+{
+    uint64_t ticks;
+    uint64_t ns;
+
+    if (umul64_overflow(n, gptm_period(s, ch), &ticks) ||
+        uadd64_overflow(ticks, offset, &ticks)) {
+        return INT64_MAX;
+    }
+    ns = gptm_ticks_to_ns(s, ch, ticks);
+    if (ns >= INT64_MAX - s->start_ns[ch]) {
+        return INT64_MAX;
+    }
+    return s->start_ns[ch] + ns;
+}
+
+/* Counter value a stopped half resumes from */
+static uint64_t gptm_stopped_value(TM4C123GPTMState *s, int ch)
+{
+    if (s->count[ch] != GPTM_COUNT_RELOAD) {
+        return s->count[ch];
+    }
+    if (!(s->gptm_ctl & gptm_half[ch].en)) {
+        gptm_configure(s, ch);
+    }
+    return s->up[ch] ? 0 : s->load[ch];
+}
+
+/* Current count of a half, without any floating point or per-read rounding */
+static uint64_t gptm_value(TM4C123GPTMState *s, int ch)
+{
+    uint64_t pos;
+
+    if (!gptm_running(s, ch) || gptm_frozen(s, ch)) {
+        return gptm_stopped_value(s, ch);
+    }
+
+    pos = gptm_ns_to_ticks(s, ch, qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - s->start_ns[ch]);
+    if (gptm_modes[s->mode[ch]].reloads) {
+        /* Also right while a late time-out callback is still pending */
+        pos %= gptm_period(s, ch);
+    } else {
+        pos = MIN(pos, s->load[ch]);
+    }
+    return s->up[ch] ? pos : s->load[ch] - pos;
+}
+
+/* PWM events only matter when someone looks at the output or its edges */
+static bool gptm_pwm_observed(TM4C123GPTMState *s, int ch)
+{
+    return s->ccp_out[ch] || (gptm_mr(s, ch) & GPTM_TNMR_PWMIE);
+}
+
+static bool gptm_timeout_wanted(TM4C123GPTMState *s, int ch)
+{
+    switch (s->mode[ch]) {
+        case GPTM_MODE_ONESHOT:
+        case GPTM_MODE_PERIODIC:
+            return true;
+        case GPTM_MODE_PWM:
+            return gptm_pwm_observed(s, ch);
+        default:
+            return false;
+    }
+}
+
+static bool gptm_match_wanted(TM4C123GPTMState *s, int ch)
+{
+    switch (s->mode[ch]) {
+        case GPTM_MODE_ONESHOT:
+        case GPTM_MODE_PERIODIC:
+            return gptm_mr(s, ch) & GPTM_TNMR_MIE;
+        case GPTM_MODE_PWM:
+            return gptm_pwm_observed(s, ch);
+        case GPTM_MODE_RTC:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static void gptm_arm_match(TM4C123GPTMState *s, int ch)
+{
+    uint64_t match = gptm_match_value(s, ch);
+    uint64_t offset;
+    int64_t deadline;
+
+    if (!gptm_running(s, ch) || !gptm_match_wanted(s, ch) || match > s->load[ch]) {
+        timer_del(s->match[ch]);
+        return;
+    }
+
+    offset = s->up[ch] ? match : s->load[ch] - match;
+    deadline = gptm_deadline(s, ch, s->periods[ch], offset);
+    if (deadline < qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL)) {
+        /* Already past it in this period */
+        if (!gptm_modes[s->mode[ch]].reloads) {
+            timer_del(s->match[ch]);
+            return;
+        }
+        deadline = gptm_deadline(s, ch, s->periods[ch] + 1, offset);
+    }
+    timer_mod(s->match[ch], deadline);
+}
+
+/*
+ * Only the events that have a visible effect get a QEMUTimer; everything
+ * else (the counter, edge-time captures) is computed from the time base.
+ */
+static void gptm_arm(TM4C123GPTMState *s, int ch)
+{
+    if (!gptm_running(s, ch) || gptm_frozen(s, ch)) {
+        timer_del(s->timer[ch]);
+        timer_del(s->match[ch]);
+        return;
+    }
+
+    if (gptm_timeout_wanted(s, ch)) {
+        timer_mod(s->timer[ch], gptm_deadline(s, ch, s->periods[ch], gptm_period(s, ch)));
+    } else {
+        timer_del(s->timer[ch]);
+    }
+    gptm_arm_match(s, ch);
+}
+
+/* Start counting from @value now */
+static void gptm_start(TM4C123GPTMState *s, int ch, uint64_t value)
+{
+    uint64_t pos;
+
+    value = MIN(value, s->load[ch]);
+    s->periods[ch] = 0;
+    if (gptm_frozen(s, ch)) {
+        s->count[ch] = value;
+        gptm_arm(s, ch);
+        return;
+    }
+    pos = s->up[ch] ? value : s->load[ch] - value;
+    s->start_ns[ch] = qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - gptm_ticks_to_ns(s, ch, pos);
+    s->count[ch] = GPTM_COUNT_RELOAD;
+    gptm_arm(s, ch);
+}
+
+/* Reload value of a half, where a sync or a new interval starts from */
+static uint64_t gptm_initial(TM4C123GPTMState *s, int ch)
+{
+    return s->up[ch] ? 0 : s->load[ch];
+}
+
+/* Keep counting from the current value with a new load or prescale */
+static void gptm_retime(TM4C123GPTMState *s, int ch)
+{
+    uint64_t value = gptm_value(s, ch);
+
+    s->load[ch] = gptm_load_value(s, ch);
+    s->prescale[ch] = gptm_prescale_value(s, ch);
+    gptm_start(s, ch, value);
+}
+
+/*
+ * Start the next period. Deadlines stay relative to the original start so
+ * periodic timers do not drift; an interval load or prescale written with
+ * TnILD set is picked up here.
+ */
+static void gptm_reload(TM4C123GPTMState *s, int ch)
+{
+    uint64_t load = gptm_load_value(s, ch);
+    uint32_t prescale = gptm_prescale_value(s, ch);
+
+    if (load != s->load[ch] || prescale != s->prescale[ch]) {
+        s->start_ns[ch] = gptm_deadline(s, ch, s->periods[ch], gptm_period(s, ch));
+        s->load[ch] = load;
+        s->prescale[ch] = prescale;
+        s->periods[ch] = 0;
+    } else {
+        s->periods[ch]++;
+    }
+    gptm_arm(s, ch);
+}
+
+static void gptm_update(TM4C123GPTMState *s)
+{
+    s->gptm_mis = s->gptm_ris & s->gptm_imr;
+    qemu_set_irq(s->irq_a, s->gptm_mis & GPTM_INT_A_MASK);
+    qemu_set_irq(s->irq_b, s->gptm_mis & GPTM_INT_B_MASK);
+}
+
+/* Store a captured or snapshot value in GPTMTnR */
+static void gptm_latch(TM4C123GPTMState *s, int ch, uint64_t value)
+{
+    if (ch == GPTM_B) {
+        s->gptm_tbr = value;
+    } else if (s->gptm_cfg == GPTM_CFG_SPLIT) {
+        s->gptm_tar = value;
+    } else {
+        s->gptm_tar = value;
+        s->gptm_tbr = value >> (gptm_width(s) / 2);
+    }
+}
+
+static bool gptm_edge_selected(TM4C123GPTMState *s, int ch, bool level)
+{
+    switch (extract32(s->gptm_ctl, gptm_half[ch].event_shift, 2)) {
+        case 0:
+            return level;
+        case 1:
+            return !level;
+        case 3:
+            return true;
+    }
+    return false;
+}
+
+/* The PWM output asserts at the reload and deasserts at the match */
+static void gptm_pwm_edge(TM4C123GPTMState *s, int ch, bool asserted)
+{
+    bool level = asserted ^ !!(s->gptm_ctl & gptm_half[ch].pwml);
+
+    qemu_set_irq(s->ccp_out[ch], level);
+    if ((gptm_mr(s, ch) & GPTM_TNMR_PWMIE) && gptm_edge_selected(s, ch, level)) {
+        s->gptm_ris |= gptm_half[ch].ce_int;
+    }
+}
+
+static void gptm_timeout(TM4C123GPTMState *s, int ch)
+{
+    uint32_t mr = gptm_mr(s, ch);
+
+    trace_tm4c123_gptm_timeout('A' + ch, gptm_modes[s->mode[ch]].name);
+
+    switch (s->mode[ch]) {
+        case GPTM_MODE_ONESHOT:
+        case GPTM_MODE_PERIODIC:
+            if (!(mr & GPTM_TNMR_CINTD)) {
+                s->gptm_ris |= gptm_half[ch].to_int;
+            }
+            if (mr & GPTM_TNMR_SNAPS) {
+                gptm_latch(s, ch, s->up[ch] ? s->load[ch] : 0);
+            }
+            qemu_irq_pulse(s->dma_req[ch]);
+            if (s->gptm_ctl & gptm_half[ch].ote) {
+                qemu_irq_pulse(s->adc_trigger);
+            }
             break;
-        case TIMER4_32:
-            return test_bit(4, (const unsigned long *)&s->sysctl_rcgctimer);
+        case GPTM_MODE_PWM:
+            gptm_pwm_edge(s, ch, true);
             break;
-        case TIMER5_32:
-            return test_bit(5, (const unsigned long *)&s->sysctl_rcgctimer);
+        default:
             break;
-        case TIMER0_64:
-            return test_bit(0, (const unsigned long *)&s->sysctl_rcgcwtimer);
+    }
+
+    if (gptm_modes[s->mode[ch]].reloads) {
+        gptm_reload(s, ch);
+    } else {
+        /* One-shot: back to the reload value, and TnEN clears itself */
+        s->gptm_ctl &= ~gptm_half[ch].en;
+        s->count[ch] = GPTM_COUNT_RELOAD;
+        gptm_arm(s, ch);
+    }
+    gptm_update(s);
+}
+
+static void gptm_match(TM4C123GPTMState *s, int ch)
+{
+    switch (s->mode[ch]) {
+        case GPTM_MODE_ONESHOT:
+        case GPTM_MODE_PERIODIC:
+            s->gptm_ris |= gptm_half[ch].m_int;
             break;
-        case TIMER1_64:
-            return test_bit(1, (const unsigned long *)&s->sysctl_rcgcwtimer);
+        case GPTM_MODE_RTC:
+            s->gptm_ris |= GPTM_INT_RTC;
             break;
-        case TIMER2_64:
-            return test_bit(2, (const unsigned long *)&s->sysctl_rcgcwtimer);
+        case GPTM_MODE_PWM:
+            gptm_pwm_edge(s, ch, false);
             break;
-        case TIMER3_64:
-            return test_bit(3, (const unsigned long *)&s->sysctl_rcgcwtimer);
+        default:
             break;
-        case TIMER4_64:
-            return test_bit(4, (const unsigned long *)&s->sysctl_rcgcwtimer);
+    }
+    /* The time-out re-arms the match of the next period */
+    gptm_update(s);
+}
+
+static void gptm_count_edge(TM4C123GPTMState *s, int ch)
+{
+    uint64_t value = gptm_stopped_value(s, ch);
+
+    if (s->up[ch]) {
+        value = value >= s->load[ch] ? 0 : value + 1;
+    } else {
+        value = value ? value - 1 : s->load[ch];
+    }
+
+    if (value == gptm_match_value(s, ch)) {
+        /* Reaching the match stops the counter and reloads it */
+        s->gptm_ris |= gptm_half[ch].cm_int;
+        s->gptm_ctl &= ~gptm_half[ch].en;
+        value = GPTM_COUNT_RELOAD;
+    }
+    s->count[ch] = value;
+}
+
+/* Edges on the CCP pins feed the capture modes */
+static void gptm_ccp_in(void *opaque, int ch, int level)
+{
+    TM4C123GPTMState *s = opaque;
+
+    if (s->ccp_level[ch] == !!level) {
+        return;
+    }
+    s->ccp_level[ch] = level;
+
+    if (!(s->gptm_ctl & gptm_half[ch].en) || !gptm_edge_selected(s, ch, level)) {
+        return;
+    }
+
+    switch (s->mode[ch]) {
+        case GPTM_MODE_EDGE_COUNT:
+            gptm_count_edge(s, ch);
             break;
-        case TIMER5_64:
-            return test_bit(5, (const unsigned long *)&s->sysctl_rcgcwtimer);
+        case GPTM_MODE_EDGE_TIME:
+            gptm_latch(s, ch, gptm_value(s, ch));
+            s->gptm_ris |= gptm_half[ch].ce_int;
             break;
+        default:
+            return;
+    }
+    gptm_update(s);
+}
+
+static void gptm_enable(TM4C123GPTMState *s, int ch)
+{
+    uint64_t value;
+
+    gptm_configure(s, ch);
+    if (s->mode[ch] == GPTM_MODE_OFF) {
+        if (ch == GPTM_A || s->gptm_cfg == GPTM_CFG_SPLIT) {
+            LOG(LOG_GUEST_ERROR, "Timer %c: invalid mode, CFG 0x%"PRIx32" MR 0x%"PRIx32"\n",
+                'A' + ch, s->gptm_cfg, gptm_mr(s, ch));
+        }
+        return;
+    }
+
+    trace_tm4c123_gptm_enable('A' + ch, gptm_modes[s->mode[ch]].name,
+                              s->load[ch], s->prescale[ch]);
+
+    value = gptm_stopped_value(s, ch);
+    if (s->mode[ch] == GPTM_MODE_PWM) {
+        /* The output starts out asserted, which is not an edge yet */
+        qemu_set_irq(s->ccp_out[ch], !(s->gptm_ctl & gptm_half[ch].pwml));
+    }
+    if (gptm_modes[s->mode[ch]].timed) {
+        gptm_start(s, ch, value);
+    }
+}
+
+static void gptm_write_ctl(TM4C123GPTMState *s, uint32_t val)
+{
+    uint32_t old = s->gptm_ctl;
+    int ch;
+
+    for (ch = 0; ch < 2; ch++) {
+        if (gptm_running(s, ch) && !(val & gptm_half[ch].en)) {
+            s->count[ch] = gptm_value(s, ch);
+        }
+    }
+
+    s->gptm_ctl = val;
+
+    for (ch = 0; ch < 2; ch++) {
+        if (!(old & gptm_half[ch].en) && (val & gptm_half[ch].en)) {
+            gptm_enable(s, ch);
+        } else {
+            gptm_arm(s, ch);
+        }
+    }
+}
+
+/* Register writes to either half of a concatenated timer land in A */
+static int gptm_reg_half(TM4C123GPTMState *s, int ch)
+{
+    return s->gptm_cfg == GPTM_CFG_SPLIT ? ch : GPTM_A;
+}
+
+static void gptm_write_load(TM4C123GPTMState *s, int ch)
+{
+    ch = gptm_reg_half(s, ch);
+
+    if (!gptm_running(s, ch)) {
+        if (!(s->gptm_ctl & gptm_half[ch].en)) {
+            gptm_configure(s, ch);
+        }
+        if (s->mode[ch] == GPTM_MODE_RTC) {
+            /* The RTC is loaded through the interval register */
+            s->count[ch] = gptm_combine(s, ch, s->gptm_talir, s->gptm_tblir, 0, 0);
+        } else if (s->mode[ch] != GPTM_MODE_EDGE_COUNT) {
+            s->count[ch] = GPTM_COUNT_RELOAD;
+        }
+        return;
+    }
+
+    if (s->mode[ch] == GPTM_MODE_RTC) {
+        gptm_start(s, ch, gptm_combine(s, ch, s->gptm_talir, s->gptm_tblir, 0, 0));
+    } else if (!(gptm_mr(s, ch) & GPTM_TNMR_ILD)) {
+        if (s->up[ch]) {
+            gptm_retime(s, ch);
+        } else {
+            s->load[ch] = gptm_load_value(s, ch);
+            gptm_start(s, ch, s->load[ch]);
+        }
+    }
+}
+
+static void gptm_write_value(TM4C123GPTMState *s, int reg_ch, uint32_t val)
+{
+    int ch = gptm_reg_half(s, reg_ch);
+    uint64_t value = val;
+
+    if (ch != reg_ch) {
+        /* GPTMTBV holds the upper half of a concatenated counter */
+        value = deposit64(gptm_value(s, ch), gptm_width(s) / 2, gptm_width(s) / 2, val);
+    } else if (s->gptm_cfg != GPTM_CFG_SPLIT && gptm_width(s) == 64) {
+        value = deposit64(gptm_value(s, ch), 0, 32, val);
+    }
+
+    if (gptm_running(s, ch)) {
+        gptm_start(s, ch, value);
+    } else {
+        s->count[ch] = value;
     }
-    return false;
+}
+
+/* GPTMSYNC of timer 0 restarts the selected halves of all timers at once */
+static void gptm_write_sync(TM4C123GPTMState *s, uint32_t val)
+{
+    int i, ch;
+
+    for (i = 0; i < GPTM_SYNC_TIMERS; i++) {
+        TM4C123GPTMState *peer = s->sync_peer[i];
+        uint32_t halves = extract32(val, i * 2, 2);
+
+        if (!peer) {
+            continue;
+        }
+        for (ch = 0; ch < 2; ch++) {
+            if ((halves & (1 << ch)) && gptm_running(peer, ch)) {
+                gptm_start(peer, ch, gptm_initial(peer, ch));
+            }
+        }
+    }
+}
+
+/* Counter as seen through GPTMTnV and GPTMTnR */
+static uint32_t gptm_read_value(TM4C123GPTMState *s, int reg_ch)
+{
+    int ch = gptm_reg_half(s, reg_ch);
+    uint64_t value = gptm_value(s, ch);
+
+    if (ch != reg_ch) {
+        return value >> (gptm_width(s) / 2);
+    }
+    return value;
+}
+
+static uint32_t gptm_read_tnr(TM4C123GPTMState *s, int reg_ch)
+{
+    int ch = gptm_reg_half(s, reg_ch);
+
+    if (s->mode[ch] == GPTM_MODE_EDGE_TIME || (gptm_mr(s, ch) & GPTM_TNMR_SNAPS)) {
+        return reg_ch == GPTM_A ? s->gptm_tar : s->gptm_tbr;
+    }
+    return gptm_read_value(s, reg_ch);
+}
+
+/* The RTC predivider counts down the 32.768 kHz ticks of each second */
+static uint32_t gptm_read_rtcpd(TM4C123GPTMState *s)
+{
+    uint64_t ns;
+
+    if (s->mode[GPTM_A] != GPTM_MODE_RTC || !gptm_running(s, GPTM_A)) {
+        return s->gptm_rtcpd;
+    }
+    ns = (qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL) - s->start_ns[GPTM_A]) % NANOSECONDS_PER_SECOND;
+    return 0x7FFF - muldiv64(ns, 32768, NANOSECONDS_PER_SECOND);
 }
 
 static void tm4c123_gptm_reset(DeviceState *dev)
@@ -230,16 +748,24 @@ static void tm4c123_gptm_reset(DeviceState *dev)
     s->gptm_tapv = 0x00000000;
     s->gptm_tbpv = 0x00000000;
     s->gptm_pp = 0x00000000;
+
+    for (int i = 0; i < 2; i++) {
+        timer_del(s->timer[i]);
+        timer_del(s->match[i]);
+        s->mode[i] = GPTM_MODE_OFF;
+        s->up[i] = false;
+        s->start_ns[i] = 0;
+        s->load[i] = 0;
+        s->periods[i] = 0;
+        s->prescale[i] = 1;
+        s->count[i] = GPTM_COUNT_RELOAD;
+    }
 }
 
 static uint64_t tm4c123_gptm_read(void *opaque, hwaddr addr, unsigned int size)
 {
     TM4C123GPTMState *s = opaque;
 
-    if (!gptm_clock_enabled(s->sysctl, s->mmio.addr)) {
-        hw_error("GPTM module clock is not enabled");
-    }
-
     trace_tm4c123_gptm_read(addr);
 
     switch (addr) {
@@ -278,27 +804,15 @@ static uint64_t tm4c123_gptm_read(void *opaque, hwaddr addr, unsigned int size)
         case GPTM_TBPMR:
             return s->gptm_tbpmr;
         case GPTM_TAR:
-            return s->gptm_tar;
+            return gptm_read_tnr(s, GPTM_A);
         case GPTM_TBR:
-            return s->gptm_tbr;
+            return gptm_read_tnr(s, GPTM_B);
         case GPTM_TAV:
-            if (get_timer_width(s) == TIMER_WIDTH_64 && s->gptm_cfg == 0) {
-                return extract64(
-                        ns_to_ticks(s, s->a->expire_time - qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL), s->gptm_tapr),
-                        0, 31);
-            } else {
-                return ns_to_ticks(s, s->a->expire_time - qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL), s->gptm_tapr);
-            }
+            return gptm_read_value(s, GPTM_A);
         case GPTM_TBV:
-            if (get_timer_width(s) == TIMER_WIDTH_64 && s->gptm_cfg == 0) {
-                return extract64(
-                        ns_to_ticks(s, s->a->expire_time - qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL), s->gptm_tapr),
-                        32, 64);
-            } else {
-                return ns_to_ticks(s, s->b->expire_time - qemu_clock_get_ns(QEMU_CLOCK_VIRTUAL), s->gptm_tapr);
-            }
+            return gptm_read_value(s, GPTM_B);
         case GPTM_RTCPD:
-            return s->gptm_rtcpd;
+            return gptm_read_rtcpd(s);
         case GPTM_TAPS:
             return s->gptm_taps;
         case GPTM_TBPS:
@@ -321,65 +835,78 @@ static void tm4c123_gptm_write(void *opaque, hwaddr addr, uint64_t val64, unsign
     TM4C123GPTMState *s = opaque;
     uint32_t val32 = val64;
 
-    if (!gptm_clock_enabled(s->sysctl, s->mmio.addr)) {
-        hw_error("GPTM module clock is not enabled");
-    }
-
     trace_tm4c123_gptm_write(addr, val32);
 
     switch (addr) {
         case GPTM_CFG:
             s->gptm_cfg = val32;
+            s->count[GPTM_A] = GPTM_COUNT_RELOAD;
+            s->count[GPTM_B] = GPTM_COUNT_RELOAD;
             break;
         case GPTM_AMR:
             s->gptm_amr = val32;
+            gptm_arm(s, GPTM_A);
             break;
         case GPTM_BMR:
             s->gptm_bmr = val32;
+            gptm_arm(s, GPTM_B);
             break;
         case GPTM_CTL:
-            s->gptm_ctl = val32;
-            set_timers(s);
+            gptm_write_ctl(s, val32);
             break;
         case GPTM_SYNC:
             s->gptm_sync = val32;
+            gptm_write_sync(s, val32);
             break;
         case GPTM_IMR:
             s->gptm_imr = val32;
+            gptm_update(s);
             break;
         case GPTM_RIS:
             READONLY;
             break;
         case GPTM_MIS:
-            s->gptm_mis = val32;
+            READONLY;
             break;
         case GPTM_ICR:
             s->gptm_ris &= ~val32;
-            s->gptm_mis &= ~val32;
+            gptm_update(s);
             break;
         case GPTM_TALIR:
             s->gptm_talir = val32;
+            gptm_write_load(s, GPTM_A);
             break;
         case GPTM_TBLIR:
             s->gptm_tblir = val32;
+            gptm_write_load(s, GPTM_B);
             break;
         case GPTM_TAMATCHR:
             s->gptm_tamatchr = val32;
+            gptm_arm_match(s, gptm_reg_half(s, GPTM_A));
             break;
         case GPTM_TBMATCHR:
             s->gptm_tbmatchr = val32;
+            gptm_arm_match(s, gptm_reg_half(s, GPTM_B));
             break;
         case GPTM_TAPR:
             s->gptm_tapr = val32;
+            if (gptm_running(s, GPTM_A)) {
+                gptm_retime(s, GPTM_A);
+            }
             break;
         case GPTM_TBPR:
             s->gptm_tbpr = val32;
+            if (gptm_running(s, GPTM_B)) {
+                gptm_retime(s, GPTM_B);
+            }
             break;
         case GPTM_TAPMR:
             s->gptm_tapmr = val32;
+            gptm_arm_match(s, GPTM_A);
             break;
         case GPTM_TBPMR:
             s->gptm_tbpmr = val32;
+            gptm_arm_match(s, GPTM_B);
             break;
         case GPTM_TAR:
             READONLY;
@@ -388,10 +915,10 @@ static void tm4c123_gptm_write(void *opaque, hwaddr addr, uint64_t val64, unsign
             READONLY;
             break;
         case GPTM_TAV:
-            s->gptm_tav = val32;
+            gptm_write_value(s, GPTM_A, val32);
             break;
         case GPTM_TBV:
-            s->gptm_tbv = val32;
+            gptm_write_value(s, GPTM_B, val32);
             break;
         case GPTM_RTCPD:
             READONLY;
@@ -416,67 +943,159 @@ static void tm4c123_gptm_write(void *opaque, hwaddr addr, uint64_t val64, unsign
     }
 }
 
+/* Accesses with the module clock gated off answer with a bus fault */
+static MemTxResult tm4c123_gptm_read_with_attrs(void *opaque, hwaddr addr, uint64_t *data,
+                                              unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123GPTMState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "GPTM module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_gptm_read(opaque, addr, size);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_gptm_write_with_attrs(void *opaque, hwaddr addr, uint64_t val64,
+                                               unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123GPTMState *s = opaque;
+
+    if (!clock_is_enabled(s->clk)) {
+        LOG(LOG_GUEST_ERROR, "GPTM module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    tm4c123_gptm_write(opaque, addr, val64, size);
+    return MEMTX_OK;
+}
+
 static const MemoryRegionOps tm4c123_gptm_ops = {
-    .read = tm4c123_gptm_read,
-    .write = tm4c123_gptm_write,
+    .read_with_attrs = tm4c123_gptm_read_with_attrs,
+    .write_with_attrs = tm4c123_gptm_write_with_attrs,
     .endianness = DEVICE_NATIVE_ENDIAN,
 };
 
 static void timer_a_callback(void *opaque)
 {
-    TM4C123GPTMState *s = opaque;
-
-    if (test_bit(0, (unsigned long *)&s->gptm_imr)) {
-        qemu_irq_pulse(s->irq_a);
-        set_bit(0, (unsigned long *)&s->gptm_mis);
-    }
-    set_bit(0, (unsigned long *)&s->gptm_ris);
-    if ((s->gptm_amr & 0x0000000F) == 0x2) {
-        set_timers(s);
-    }
+    gptm_timeout(opaque, GPTM_A);
 }
 
 static void timer_b_callback(void *opaque)
+{
+    gptm_timeout(opaque, GPTM_B);
+}
+
+static void match_a_callback(void *opaque)
+{
+    gptm_match(opaque, GPTM_A);
+}
+
+static void match_b_callback(void *opaque)
+{
+    gptm_match(opaque, GPTM_B);
+}
+
+/*
+ * A change of the timer clock (a new system clock, or the module gate)
+ * freezes every counting half at its current value and restarts it from
+ * there at the new rate. A gated half stays frozen until the clock returns.
+ */
+static void gptm_clock_update(void *opaque, ClockEvent event)
 {
     TM4C123GPTMState *s = opaque;
+    int ch;
 
-    if (test_bit(8, (unsigned long *)&s->gptm_imr)) {
-        qemu_irq_pulse(s->irq_b);
-        set_bit(8, (unsigned long *)&s->gptm_mis);
-    }
-    set_bit(8, (unsigned long *)&s->gptm_ris);
-    if ((s->gptm_bmr & 0x0000000F) == 0x2) {
-        set_timers(s);
+    for (ch = GPTM_A; ch <= GPTM_B; ch++) {
+        if (!gptm_running(s, ch) || s->mode[ch] == GPTM_MODE_RTC) {
+            continue;
+        }
+        if (event == ClockPreUpdate) {
+            s->count[ch] = gptm_value(s, ch);
+        } else {
+            gptm_start(s, ch, s->count[ch]);
+        }
     }
 }
 
 static void tm4c123_gptm_init(Object *obj)
 {
     TM4C123GPTMState *s = TM4C123_GPTM(obj);
-    s->clk = qdev_init_clock_in(DEVICE(s), "gptm_clock", NULL, NULL, 0);
-    s->a = timer_new_ns(QEMU_CLOCK_VIRTUAL, timer_a_callback, s);
-    s->b = timer_new_ns(QEMU_CLOCK_VIRTUAL, timer_b_callback, s);
-    timer_init_ns(s->a, QEMU_CLOCK_VIRTUAL, timer_a_callback, s);
-    timer_init_ns(s->b, QEMU_CLOCK_VIRTUAL, timer_b_callback, s);
+    s->clk = qdev_init_clock_in(DEVICE(s), "gptm_clock", gptm_clock_update, s,
+                                ClockPreUpdate | ClockUpdate);
+    s->timer[GPTM_A] = timer_new_ns(QEMU_CLOCK_VIRTUAL, timer_a_callback, s);
+    s->timer[GPTM_B] = timer_new_ns(QEMU_CLOCK_VIRTUAL, timer_b_callback, s);
+    s->match[GPTM_A] = timer_new_ns(QEMU_CLOCK_VIRTUAL, match_a_callback, s);
+    s->match[GPTM_B] = timer_new_ns(QEMU_CLOCK_VIRTUAL, match_b_callback, s);
 
     sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq_a);
     sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq_b);
+    qdev_init_gpio_in_named(DEVICE(obj), gptm_ccp_in, "ccp-in", 2);
+    qdev_init_gpio_out_named(DEVICE(obj), s->ccp_out, "ccp-out", 2);
+    qdev_init_gpio_out_named(DEVICE(obj), s->dma_req, "dma-req", 2);
+    qdev_init_gpio_out_named(DEVICE(obj), &s->adc_trigger, "adc-trigger", 1);
     memory_region_init_io(&s->mmio, obj, &tm4c123_gptm_ops, s, TYPE_TM4C123_GPTM, 0xFFF);
     sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
 }
 
-static void tm4c123_gptm_realize(DeviceState *dev, Error **errp)
-{
-    TM4C123GPTMState *s = TM4C123_GPTM(dev);
-    qdev_connect_clock_in(dev, "gptm_clock", qdev_get_clock_out(DEVICE(s->sysctl), "outclk"));
+static const VMStateDescription vmstate_tm4c123_gptm = {
+    .name = TYPE_TM4C123_GPTM,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(gptm_cfg, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_amr, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_bmr, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_ctl, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_sync, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_imr, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_ris, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_mis, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_icr, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_talir, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tblir, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tamatchr, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tbmatchr, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tapr, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tbpr, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tapmr, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tbpmr, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tar, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tbr, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tav, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tbv, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_rtcpd, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_taps, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tbps, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tapv, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_tbpv, TM4C123GPTMState),
+        VMSTATE_UINT32(gptm_pp, TM4C123GPTMState),
+        VMSTATE_UINT8_ARRAY(mode, TM4C123GPTMState, 2),
+        VMSTATE_BOOL_ARRAY(up, TM4C123GPTMState, 2),
+        VMSTATE_INT64_ARRAY(start_ns, TM4C123GPTMState, 2),
+        VMSTATE_UINT64_ARRAY(load, TM4C123GPTMState, 2),
+        VMSTATE_UINT64_ARRAY(periods, TM4C123GPTMState, 2),
+        VMSTATE_UINT32_ARRAY(prescale, TM4C123GPTMState, 2),
+        VMSTATE_UINT64_ARRAY(count, TM4C123GPTMState, 2),
+        VMSTATE_BOOL_ARRAY(ccp_level, TM4C123GPTMState, 2),
+        VMSTATE_TIMER_PTR_ARRAY(timer, TM4C123GPTMState, 2),
+        VMSTATE_TIMER_PTR_ARRAY(match, TM4C123GPTMState, 2),
+        VMSTATE_CLOCK(clk, TM4C123GPTMState),
+        VMSTATE_END_OF_LIST()
+    }
+};
 
-}
+static Property tm4c123_gptm_properties[] = {
+    DEFINE_PROP_BOOL("wide", TM4C123GPTMState, wide, false),
+    DEFINE_PROP_END_OF_LIST(),
+};
 
 static void tm4c123_gptm_class_init(ObjectClass *kclass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(kclass);
     dc->reset = tm4c123_gptm_reset;
-    dc->realize = tm4c123_gptm_realize;
+    dc->vmsd = &vmstate_tm4c123_gptm;
+    device_class_set_props(dc, tm4c123_gptm_properties);
 }
 
 static const TypeInfo tm4c123_gptm_info = {
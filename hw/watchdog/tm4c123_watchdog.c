@@ -31,13 +31,12 @@
 #include "qemu/log.h"
 #include "qemu/module.h"
 #include "hw/nmi.h"
+#include "migration/vmstate.h"
 #include "trace.h"
 
 #define LOG(mask, fmt, args...) qemu_log_mask(mask, "%s: " fmt, __func__, ## args)
 #define READONLY LOG(LOG_GUEST_ERROR, "0x%"HWADDR_PRIx" is a readonly field\n.", addr)
 
-static bool locked;
-
 static void tm4c123_wdt_expired(void *opaque)
 {
     TM4C123WatchdogState *s = opaque;
@@ -47,28 +46,20 @@ static void tm4c123_wdt_expired(void *opaque)
         nmi_monitor_handle(0, NULL);
         qemu_irq_pulse(s->irq);
     } else {
-        if (test_bit(1, (const unsigned long *)&s->wdt_ctl))
-            qemu_system_reset_request(SHUTDOWN_CAUSE_GUEST_RESET);
-        else {
+        if (test_bit(1, (const unsigned long *)&s->wdt_ctl)) {
+            /* The SoC resets its own board; on its own, reset the system */
+            if (qemu_irq_is_connected(s->reset)) {
+                qemu_irq_pulse(s->reset);
+            } else {
+                qemu_system_reset_request(SHUTDOWN_CAUSE_GUEST_RESET);
+            }
+        } else {
             nmi_monitor_handle(0, NULL);
             qemu_irq_pulse(s->irq);
         }
     }
 }
 
-static bool wdt_clock_enabled(TM4C123SysCtlState *s, hwaddr addr)
-{
-    switch (addr) {
-        case WDT_0:
-            return s->sysctl_rcgcwd & (1 << 0);
-            break;
-        case WDT_1:
-            return s->sysctl_rcgcwd & (1 << 1);
-            break;
-    }
-    return false;
-}
-
 static void tm4c123_wdt_reset(DeviceState *dev)
 {
     TM4C123WatchdogState *s = TM4C123_WATCHDOG(dev);
@@ -93,16 +84,13 @@ static void tm4c123_wdt_reset(DeviceState *dev)
     s->wdt_pcell_id1 = 0x000000F0;
     s->wdt_pcell_id2 = 0x00000006;
     s->wdt_pcell_id3 = 0x000000B1;
+    s->locked = false;
 }
 
 static uint64_t tm4c123_wdt_read(void *opaque, hwaddr addr, unsigned int size)
 {
     TM4C123WatchdogState *s = opaque;
 
-    if (!wdt_clock_enabled(s->sysctl, s->mmio.addr)) {
-        hw_error("Watchdog timer module clock is not enabled");
-    }
-
     switch (addr) {
         case WDT_LOAD:
             return s->wdt_load;
@@ -156,14 +144,11 @@ static void tm4c123_wdt_write(void *opaque, hwaddr addr, uint64_t val64, unsigne
     uint32_t val32 = val64;
 
     trace_tm4c123_wdt_write(addr, val64);
-    if (!wdt_clock_enabled(s->sysctl, s->mmio.addr)) {
-        hw_error("Watchdog module clock is not enabled");
-    }
 
     switch (addr) {
         case WDT_LOAD:
             s->wdt_load = val32;
-            locked = true;
+            s->locked = true;
             s->wdt_ctl |= WDT_CTL_INTEN;
             ptimer_transaction_begin(s->timer);
             ptimer_set_count(s->timer, s->wdt_load);
@@ -197,7 +182,7 @@ static void tm4c123_wdt_write(void *opaque, hwaddr addr, uint64_t val64, unsigne
         case WDT_LOCK:
             /* The actual hardware never locks the module */
             if (val32 == UNLOCK_VALUE) {
-                locked = false;
+                s->locked = false;
                 s->wdt_lock = 0;
             }
             break;
@@ -242,19 +227,65 @@ static void tm4c123_wdt_write(void *opaque, hwaddr addr, uint64_t val64, unsigne
     }
 }
 
+/* Accesses with the module clock gated off answer with a bus fault */
+static MemTxResult tm4c123_wdt_read_with_attrs(void *opaque, hwaddr addr, uint64_t *data,
+                                              unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123WatchdogState *s = opaque;
+
+    if (!clock_is_enabled(s->wdt_clock)) {
+        LOG(LOG_GUEST_ERROR, "Watchdog timer module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    *data = tm4c123_wdt_read(opaque, addr, size);
+    return MEMTX_OK;
+}
+
+static MemTxResult tm4c123_wdt_write_with_attrs(void *opaque, hwaddr addr, uint64_t val64,
+                                               unsigned int size, MemTxAttrs attrs)
+{
+    TM4C123WatchdogState *s = opaque;
+
+    if (!clock_is_enabled(s->wdt_clock)) {
+        LOG(LOG_GUEST_ERROR, "Watchdog timer module clock is not enabled\n");
+        return MEMTX_ERROR;
+    }
+    tm4c123_wdt_write(opaque, addr, val64, size);
+    return MEMTX_OK;
+}
+
 const struct MemoryRegionOps tm4c123_wdt_ops = {
-    .read = tm4c123_wdt_read,
-    .write = tm4c123_wdt_write,
+    .read_with_attrs = tm4c123_wdt_read_with_attrs,
+    .write_with_attrs = tm4c123_wdt_write_with_attrs,
     .endianness = DEVICE_NATIVE_ENDIAN,
 };
 
+/* The counter holds its value while the module clock is gated off */
+static void tm4c123_wdt_clock_update(void *opaque, ClockEvent event)
+{
+    TM4C123WatchdogState *s = opaque;
+
+    ptimer_transaction_begin(s->timer);
+    if (clock_is_enabled(s->wdt_clock)) {
+        ptimer_set_period_from_clock(s->timer, s->wdt_clock, 1);
+        if (s->wdt_ctl & WDT_CTL_INTEN) {
+            ptimer_run(s->timer, 0);
+        }
+    } else {
+        ptimer_stop(s->timer);
+    }
+    ptimer_transaction_commit(s->timer);
+}
+
 static void tm4c123_wdt_init(Object *obj)
 {
     TM4C123WatchdogState *s = TM4C123_WATCHDOG(obj);
 
-    s->wdt_clock = qdev_init_clock_in(DEVICE(s), "wdt_clock", NULL, NULL, 0);
+    s->wdt_clock = qdev_init_clock_in(DEVICE(s), "wdt_clock",
+                                      tm4c123_wdt_clock_update, s, ClockUpdate);
 
     sysbus_init_irq(SYS_BUS_DEVICE(obj), &s->irq);
+    qdev_init_gpio_out_named(DEVICE(obj), &s->reset, "reset", 1);
     memory_region_init_io(&s->mmio, obj, &tm4c123_wdt_ops, s, TYPE_TM4C123_WATCHDOG, 0xFFF);
     sysbus_init_mmio(SYS_BUS_DEVICE(obj), &s->mmio);
 }
@@ -262,7 +293,6 @@ static void tm4c123_wdt_init(Object *obj)
 static void tm4c123_wdt_realize(DeviceState *dev, Error **errp)
 {
     TM4C123WatchdogState *s = TM4C123_WATCHDOG(dev);
-    qdev_connect_clock_in(dev, "wdt_clock", qdev_get_clock_out(DEVICE(s->sysctl), "outclk"));
 
     s->timer = ptimer_init(tm4c123_wdt_expired, s,
                            PTIMER_POLICY_NO_IMMEDIATE_RELOAD |
@@ -274,11 +304,44 @@ static void tm4c123_wdt_realize(DeviceState *dev, Error **errp)
     ptimer_transaction_commit(s->timer);
 }
 
+static const VMStateDescription vmstate_tm4c123_wdt = {
+    .name = TYPE_TM4C123_WATCHDOG,
+    .version_id = 1,
+    .minimum_version_id = 1,
+    .fields = (VMStateField[]) {
+        VMSTATE_UINT32(wdt_load, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_value, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_ctl, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_icr, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_ris, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_mis, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_test, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_lock, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_per_id4, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_per_id5, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_per_id6, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_per_id7, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_per_id0, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_per_id1, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_per_id2, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_per_id3, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_pcell_id0, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_pcell_id1, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_pcell_id2, TM4C123WatchdogState),
+        VMSTATE_UINT32(wdt_pcell_id3, TM4C123WatchdogState),
+        VMSTATE_BOOL(locked, TM4C123WatchdogState),
+        VMSTATE_PTIMER(timer, TM4C123WatchdogState),
+        VMSTATE_CLOCK(wdt_clock, TM4C123WatchdogState),
+        VMSTATE_END_OF_LIST()
+    }
+};
+
 static void tm4c123_wdt_class_init(ObjectClass *kclass, void *data)
 {
     DeviceClass *dc = DEVICE_CLASS(kclass);
     dc->realize = tm4c123_wdt_realize;
     dc->reset = tm4c123_wdt_reset;
+    dc->vmsd = &vmstate_tm4c123_wdt;
 }
 
 static const TypeInfo tm4c123_wdt_info = {
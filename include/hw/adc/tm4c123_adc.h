@@ -0,0 +1,184 @@
+/*
+ * TM4C123 ADC
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * QEMU interface:
+ * + sysbus IRQs 0-3: the sample sequencer interrupts
+ * + sysbus MMIO region 0: the registers
+ * + clock input "adc_clock": the gated clock from the sysctl
+ * + named GPIO input "trigger": one line per EMUXn encoding, a rising
+ *   edge starts every enabled sequencer selecting that source
+ * + named GPIO input "pwm-trigger": PWM module m generator g on line
+ *   m * 4 + g, routed to the PWMg encoding when TSSEL picks module m
+ * + named GPIO outputs "dma-req" (per sequencer) and "dc-trigger" (per
+ *   digital comparator, for the PWM fault and trigger logic)
+ * + properties "ainN-file" and "ainN": the analog inputs. A file holds
+ *   raw little-endian 16-bit samples played back at "sample-rate" and is
+ *   mapped, not read; without a file the pin reads the constant "ainN".
+ *   "temperature" is the die temperature the sensor reports, in degrees C.
+ */
+
+#ifndef HW_ARM_TM4C123_ADC_H
+#define HW_ARM_TM4C123_ADC_H
+
+#include "hw/sysbus.h"
+#include "qom/object.h"
+#include "hw/misc/tm4c123_sysctl.h"
+
+#define ADC_ACTSS           0x000
+#define ADC_RIS             0x004
+#define ADC_IM              0x008
+#define ADC_ISC             0x00C
+#define ADC_OSTAT           0x010
+#define ADC_EMUX            0x014
+#define ADC_USTAT           0x018
+#define ADC_TSSEL           0x01C
+#define ADC_SSPRI           0x020
+#define ADC_SPC             0x024
+#define ADC_PSSI            0x028
+#define ADC_SAC             0x030
+#define ADC_DCISC           0x034
+#define ADC_CTL             0x038
+/* Sample sequencer n registers, 0x20 apart from ADC_SS_BASE */
+#define ADC_SS_BASE         0x040
+#define ADC_SS_STRIDE       0x020
+#define ADC_SSMUX           0x00
+#define ADC_SSCTL           0x04
+#define ADC_SSFIFO          0x08
+#define ADC_SSFSTAT         0x0C
+#define ADC_SSOP            0x10
+#define ADC_SSDC            0x14
+#define ADC_DCRIC           0xD00
+#define ADC_DCCTL0          0xE00
+#define ADC_DCCMP0          0xE40
+#define ADC_PP              0xFC0
+#define ADC_PC              0xFC4
+#define ADC_CC              0xFC8
+
+#define ADC_SEQUENCERS 4
+#define ADC_CHANNELS 12
+#define ADC_COMPARATORS 8
+#define ADC_MAX_STEPS 8
+
+#define ADC_ACTSS_BUSY (1 << 16)
+#define ADC_RIS_INRDC (1 << 16)
+#define ADC_PSSI_GSYNC (1u << 31)
+#define ADC_PSSI_SYNCWAIT (1 << 27)
+
+/* SSCTLn, per step */
+#define ADC_SSCTL_D (1 << 0)
+#define ADC_SSCTL_END (1 << 1)
+#define ADC_SSCTL_IE (1 << 2)
+#define ADC_SSCTL_TS (1 << 3)
+
+#define ADC_SSFSTAT_EMPTY (1 << 8)
+#define ADC_SSFSTAT_FULL (1 << 12)
+
+/* EMUXn trigger sources */
+#define ADC_EMUX_PROCESSOR 0x0
+#define ADC_EMUX_GPIO 0x4
+#define ADC_EMUX_TIMER 0x5
+#define ADC_EMUX_PWM0 0x6
+#define ADC_EMUX_ALWAYS 0xF
+#define ADC_TRIGGERS 16
+#define ADC_PWM_TRIGGERS 8
+
+#define ADC_DCCTL_CIE (1 << 4)
+#define ADC_DCCTL_CTE (1 << 12)
+
+#define TYPE_TM4C123_ADC "tm4c123-adc"
+
+OBJECT_DECLARE_SIMPLE_TYPE(TM4C123ADCState, TM4C123_ADC)
+
+typedef struct {
+    uint32_t mux;
+    uint32_t ctl;
+    uint32_t op;
+    uint32_t dc;
+    /* The FIFO, read at head, written at head + count */
+    uint16_t fifo[ADC_MAX_STEPS];
+    uint32_t head;
+    uint32_t count;
+} TM4C123ADCSequencer;
+
+/* Where a comparator's interrupt or trigger logic stands */
+typedef struct {
+    uint8_t band;
+    bool fired;
+    bool armed;
+} TM4C123ADCCompareState;
+
+struct TM4C123ADCState {
+    SysBusDevice parent_obj;
+    MemoryRegion mmio;
+
+    uint32_t adc_actss;
+    uint32_t adc_ris;
+    uint32_t adc_im;
+    uint32_t adc_ostat;
+    uint32_t adc_emux;
+    uint32_t adc_ustat;
+    uint32_t adc_tssel;
+    uint32_t adc_sspri;
+    uint32_t adc_spc;
+    uint32_t adc_sac;
+    uint32_t adc_dcisc;
+    uint32_t adc_ctl;
+    uint32_t adc_dcctl[ADC_COMPARATORS];
+    uint32_t adc_dccmp[ADC_COMPARATORS];
+    uint32_t adc_pc;
+    uint32_t adc_cc;
+    TM4C123ADCSequencer ss[ADC_SEQUENCERS];
+    TM4C123ADCCompareState dc_int[ADC_COMPARATORS];
+    TM4C123ADCCompareState dc_trig[ADC_COMPARATORS];
+
+    /* Triggered sequencers waiting for the converter, and the one it runs */
+    uint32_t pending;
+    int32_t running;
+    int64_t start_ns;
+    int64_t done_ns;
+    /* Level of each trigger input, to find the rising edges */
+    uint32_t trigger_level;
+
+    /* Analog inputs */
+    char *ain_file[ADC_CHANNELS];
+    uint16_t ain_value[ADC_CHANNELS];
+    uint32_t sample_rate;
+    int32_t temperature;
+    GMappedFile *ain_map[ADC_CHANNELS];
+    const uint8_t *ain_data[ADC_CHANNELS];
+    uint64_t ain_samples[ADC_CHANNELS];
+
+    /* "fast-timing": a triggered sequence converts at once, not at the PC rate */
+    bool fast_timing;
+
+    QEMUTimer *timer;
+    qemu_irq irq[ADC_SEQUENCERS];
+    qemu_irq dma_req[ADC_SEQUENCERS];
+    qemu_irq dc_trigger[ADC_COMPARATORS];
+    Clock *clk;
+    TM4C123SysCtlState *sysctl;
+};
+
+#endif
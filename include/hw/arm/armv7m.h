@@ -29,6 +29,13 @@ struct BitBandState {
     MemoryRegion iomem;
     uint32_t base;
     MemoryRegion *source_memory;
+    /*
+     * Direct host mapping of the RAM at the start of the source window,
+     * dropped whenever the source address space changes.
+     */
+    MemoryRegionCache ram_cache;
+    bool ram_cache_valid;
+    MemoryListener listener;
 };
 
 #define TYPE_ARMV7M "armv7m"
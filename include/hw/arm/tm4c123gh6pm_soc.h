@@ -1,5 +1,5 @@
 /*
- * TM4C123GH6PM SoC
+ * TM4C123 SoC family
  *
  * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
  *
@@ -26,6 +26,8 @@
 #define HW_ARM_TM4C123GH6PM_SOC_H
 
 #include "hw/arm/armv7m.h"
+#include "hw/cpu/cluster.h"
+#include "hw/misc/unimp.h"
 #include "qom/object.h"
 #include "hw/clock.h"
 #include "hw/char/tm4c123_usart.h"
@@ -33,28 +35,142 @@
 #include "hw/gpio/tm4c123_gpio.h"
 #include "hw/watchdog/tm4c123_watchdog.h"
 #include "hw/timer/tm4c123_gptm.h"
+#include "hw/dma/tm4c123_udma.h"
+#include "hw/ssi/tm4c123_ssi.h"
+#include "hw/i2c/tm4c123_i2c.h"
+#include "hw/adc/tm4c123_adc.h"
+#include "hw/misc/tm4c123_pwm.h"
+#include "hw/misc/tm4c123_qei.h"
+#include "hw/net/tm4c123_can.h"
+#include "hw/nvram/tm4c123_eeprom.h"
+#include "hw/nvram/tm4c123_flash.h"
+#include "hw/rtc/tm4c123_hib.h"
+#include "hw/or-irq.h"
+#include "hw/core/split-irq.h"
 
+#define TYPE_TM4C123_SOC "tm4c123-soc"
 #define TYPE_TM4C123GH6PM_SOC "tm4c123gh6pm-soc"
+#define TYPE_TM4C1230C3PM_SOC "tm4c1230c3pm-soc"
 
-OBJECT_DECLARE_SIMPLE_TYPE(TM4C123GH6PMState, TM4C123GH6PM_SOC)
+OBJECT_DECLARE_TYPE(TM4C123SoCState, TM4C123SoCClass, TM4C123_SOC)
 
 #define FLASH_BASE_ADDRESS 0x00000000
-#define FLASH_SIZE (256 * 1024)
 #define SRAM_BASE_ADDRESS 0x20000000
-#define SRAM_SIZE (32 * 1024)
 
 #define SYSCTL_ADDR 0x400FE000
+#define UDMA_ADDR 0x400FF000
+#define EEPROM_ADDR 0x400AF000
+#define FLASH_CTRL_ADDR 0x400FD000
+#define HIB_ADDR 0x400FC000
 
+/* The most instances of each module any part in the family has */
 #define USART_COUNT 8
 #define GPIO_COUNT 6
 #define WDT_COUNT 2
 #define GPTM_COUNT 12
+#define SSI_COUNT 4
+#define I2C_COUNT 4
+#define ADC_COUNT 2
+#define PWM_COUNT 2
+#define QEI_COUNT 2
+#define CAN_COUNT 2
+/* Timers whose time-outs have a uDMA channel assignment */
+#define GPTM_DMA_COUNT 4
 
-struct TM4C123GH6PMState {
+/* uDMA channel and DMACHMAPn encoding of each request source */
+typedef struct {
+    uint8_t ch;
+    uint8_t enc;
+} TM4C123DMAChannel;
+
+/* Where a family puts each module instance, and the interrupts it raises */
+typedef struct TM4C123SoCMap {
+    uint32_t num_irq;
+
+    hwaddr usart_addrs[USART_COUNT];
+    hwaddr gpio_addrs[GPIO_COUNT];
+    hwaddr gpio_ahb_addrs[GPIO_COUNT];
+    hwaddr wdt_addrs[WDT_COUNT];
+    hwaddr gptm_addrs[GPTM_COUNT];
+    hwaddr ssi_addrs[SSI_COUNT];
+    hwaddr i2c_addrs[I2C_COUNT];
+    hwaddr adc_addrs[ADC_COUNT];
+    hwaddr pwm_addrs[PWM_COUNT];
+    hwaddr qei_addrs[QEI_COUNT];
+    hwaddr can_addrs[CAN_COUNT];
+    hwaddr acmp_addr;
+    hwaddr usb_addr;
+
+    uint16_t usart_irqs[USART_COUNT];
+    uint16_t gpio_irqs[GPIO_COUNT];
+    uint16_t wdt_irqs[WDT_COUNT];
+    uint16_t gptm_irqs[GPTM_COUNT * 2];
+    uint16_t ssi_irqs[SSI_COUNT];
+    uint16_t i2c_irqs[I2C_COUNT];
+    uint16_t adc_irqs[ADC_COUNT * ADC_SEQUENCERS];
+    uint16_t pwm_irqs[PWM_COUNT * PWM_GENERATORS];
+    uint16_t pwm_fault_irqs[PWM_COUNT];
+    uint16_t qei_irqs[QEI_COUNT];
+    uint16_t can_irqs[CAN_COUNT];
+    uint16_t udma_irqs[2];
+    /* Flash memory control and EEPROM control */
+    uint16_t flash_irq;
+    uint16_t hib_irq;
+
+    /* UART and SSI receive channels; transmit uses the next channel */
+    TM4C123DMAChannel usart_dma[USART_COUNT];
+    TM4C123DMAChannel ssi_dma[SSI_COUNT];
+    /* Timer A and timer B time-outs */
+    TM4C123DMAChannel gptm_dma[GPTM_DMA_COUNT * 2];
+    /* Sample sequencer 0 of each ADC; sequencer n uses channel + n */
+    TM4C123DMAChannel adc_dma[ADC_COUNT];
+} TM4C123SoCMap;
+
+/*
+ * One part of the family. The PPxx values are what the sysctl reports, and
+ * bit n of each is set when the part has instance n of that module; the
+ * SoC only creates the instances that are present.
+ */
+typedef struct TM4C123PartInfo {
+    const char *name;
+    const TM4C123SoCMap *map;
+    uint32_t flash_size;
+    uint32_t sram_size;
+    uint32_t did0;
+    uint32_t did1;
+    uint32_t ppwd;
+    uint32_t pptimer;
+    uint32_t ppgpio;
+    uint32_t ppdma;
+    uint32_t pphib;
+    uint32_t ppuart;
+    uint32_t ppssi;
+    uint32_t ppi2c;
+    uint32_t ppusb;
+    uint32_t ppcan;
+    uint32_t ppadc;
+    uint32_t ppacmp;
+    uint32_t pppwm;
+    uint32_t ppqei;
+    uint32_t ppeeprom;
+    uint32_t ppwtimer;
+} TM4C123PartInfo;
+
+struct TM4C123SoCClass {
+    SysBusDeviceClass parent_class;
+
+    const TM4C123PartInfo *part;
+};
+
+struct TM4C123SoCState {
     SysBusDevice parent_obj;
 
     char *cpu_type;
+    /* Index of this SoC within a multi-board machine */
+    uint32_t board;
 
+    /* Each board's core gets its own cluster, as it sees its own bus */
+    CPUClusterState cluster;
     ARMv7MState armv7m;
 
     TM4C123USARTState usart[USART_COUNT];
@@ -62,10 +178,51 @@ struct TM4C123GH6PMState {
     TM4C123GPIOState gpio[GPIO_COUNT];
     TM4C123WatchdogState wdt[WDT_COUNT];
     TM4C123GPTMState gptm[GPTM_COUNT];
+    TM4C123UDMAState udma;
+    TM4C123SSIState ssi[SSI_COUNT];
+    TM4C123I2CState i2c[I2C_COUNT];
+    TM4C123ADCState adc[ADC_COUNT];
+    TM4C123PWMState pwm[PWM_COUNT];
+    TM4C123QEIState qei[QEI_COUNT];
+    TM4C123CANState can[CAN_COUNT];
+    TM4C123EEPROMState eeprom;
+    TM4C123FlashState flashctl;
+    TM4C123HibState hib;
+    CanBusState *canbus[CAN_COUNT];
+
+    /* A peripheral interrupt also fires when its uDMA channels complete */
+    OrIRQState usart_irq_orgate[USART_COUNT];
+    OrIRQState ssi_irq_orgate[SSI_COUNT];
+    OrIRQState gptm_irq_orgate[GPTM_DMA_COUNT * 2];
+    OrIRQState adc_irq_orgate[ADC_COUNT * ADC_SEQUENCERS];
+
+    /* Any timer with TnOTE set triggers the sequencers of both ADCs */
+    OrIRQState adc_timer_orgate;
+    SplitIRQ adc_timer_split;
+    /* Each PWM generator triggers both ADCs; ADC0's comparators reach both PWMs */
+    SplitIRQ pwm_adc_split[PWM_COUNT * PWM_GENERATORS];
+    SplitIRQ adc_dc_split[ADC_COMPARATORS];
 
     MemoryRegion sram;
     MemoryRegion alias_region;
-    MemoryRegion flash;
+    /* The SoC's bus; the board maps bus_alias into system memory */
+    MemoryRegion container;
+    MemoryRegion bus_alias;
+    UnimplementedDeviceState acmp;
+    UnimplementedDeviceState usb;
+    UnimplementedDeviceState sys_exc;
+
+    /* Puts the sysctl in sleep or deep-sleep mode while the core waits */
+    Notifier idle_notifier;
+    /* Resets the board from the main loop, away from its vCPU */
+    QEMUBH *reset_bh;
 };
 
+/*
+ * Reset one board, as its reset pin would: the SoC, its peripherals, the
+ * images loaded into its address space and its core. The other boards keep
+ * running. May be called from the board's own vCPU.
+ */
+void tm4c123_soc_reset(TM4C123SoCState *s);
+
 #endif
@@ -61,13 +61,37 @@
 #define USART_PCELL_ID2     0xFF8
 #define USART_PCELL_ID3     0xFFC
 
+#define USART_FIFO_DEPTH 16
+
+#define USART_DR_OE   (1 << 11)
+#define USART_RSR_OE  (1 << 3)
+#define USART_FR_TXFE (1 << 7)
 #define USART_FR_RXFF (1 << 6)
 #define USART_FR_TXFF (1 << 5)
 #define USART_FR_RXFE (1 << 4)
 #define USART_FR_BUSY (1 << 3)
+#define USART_LCRH_STP2 (1 << 3)
+#define USART_LCRH_FEN (1 << 4)
+#define USART_LCRH_PEN (1 << 1)
 #define USART_CR_RXE  (1 << 9)
+#define USART_CR_TXE  (1 << 8)
+#define USART_CR_HSE  (1 << 5)
+#define USART_CR_EOT  (1 << 4)
 #define USART_CR_EN   (1 << 0)
 #define USART_IM_RXIM (1 << 4)
+#define USART_CC_CS_PIOSC 0x5
+
+/* Bits shared by the IM, RIS, MIS and ICR registers */
+#define USART_INT_RX (1 << 4)
+#define USART_INT_TX (1 << 5)
+#define USART_INT_RT (1 << 6)
+#define USART_INT_OE (1 << 10)
+#define USART_DMACTL_RXDMAE (1 << 0)
+#define USART_DMACTL_TXDMAE (1 << 1)
+
+/* uDMA request lines */
+#define USART_DMA_RX 0
+#define USART_DMA_TX 1
 
 #define USART_0 0x4000C000
 #define USART_1 0x4000D000
@@ -116,9 +140,35 @@ struct TM4C123USARTState {
     uint32_t usart_pcell_id2;
     uint32_t usart_pcell_id3;
 
+    /* RX entries carry the data byte plus the DR error bits */
+    uint16_t rx_fifo[USART_FIFO_DEPTH];
+    uint32_t rx_pos;
+    uint32_t rx_count;
+    uint8_t tx_fifo[USART_FIFO_DEPTH];
+    uint32_t tx_count;
+
+    /* Line state: characters shifting in/out, see "fast-timing" */
+    uint8_t rx_line[USART_FIFO_DEPTH];
+    uint32_t rx_line_count;
+    int64_t rx_line_start_ns;
+    uint32_t tx_done;
+    int64_t tx_start_ns;
+    /* "fast-timing": characters move at host speed, not at the baud rate */
+    bool fast_timing;
+
     CharBackend chr;
+    guint watch_tag;
+    QEMUBH *tx_bh;
+    QEMUTimer *tx_timer;
+    QEMUTimer *rx_timer;
+    QEMUTimer *rx_timeout;
     qemu_irq irq;
+    qemu_irq dma_req[2];
+    qemu_irq dma_sreq[2];
+    Clock *clk;
     TM4C123SysCtlState *sysctl;
+    /* A UART on another board wired to this one's TX and RX, if any */
+    TM4C123USARTState *peer;
 };
 
 #endif
@@ -0,0 +1,155 @@
+/*
+ * TM4C123 uDMA
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#ifndef HW_ARM_TM4C123_UDMA_H
+#define HW_ARM_TM4C123_UDMA_H
+
+#include "hw/sysbus.h"
+#include "hw/irq.h"
+#include "qom/object.h"
+#include "exec/memory.h"
+#include "hw/misc/tm4c123_sysctl.h"
+
+#define UDMA_STAT 0x000
+#define UDMA_CFG 0x004
+#define UDMA_CTLBASE 0x008
+#define UDMA_ALTBASE 0x00C
+#define UDMA_WAITSTAT 0x010
+#define UDMA_SWREQ 0x014
+#define UDMA_USEBURSTSET 0x018
+#define UDMA_USEBURSTCLR 0x01C
+#define UDMA_REQMASKSET 0x020
+#define UDMA_REQMASKCLR 0x024
+#define UDMA_ENASET 0x028
+#define UDMA_ENACLR 0x02C
+#define UDMA_ALTSET 0x030
+#define UDMA_ALTCLR 0x034
+#define UDMA_PRIOSET 0x038
+#define UDMA_PRIOCLR 0x03C
+#define UDMA_ERRCLR 0x04C
+#define UDMA_CHASGN 0x500
+#define UDMA_CHIS 0x504
+#define UDMA_CHMAP0 0x510
+#define UDMA_CHMAP1 0x514
+#define UDMA_CHMAP2 0x518
+#define UDMA_CHMAP3 0x51C
+#define UDMA_PER_ID4 0xFD0
+#define UDMA_PER_ID0 0xFE0
+#define UDMA_PER_ID1 0xFE4
+#define UDMA_PER_ID2 0xFE8
+#define UDMA_PER_ID3 0xFEC
+#define UDMA_PCELL_ID0 0xFF0
+#define UDMA_PCELL_ID1 0xFF4
+#define UDMA_PCELL_ID2 0xFF8
+#define UDMA_PCELL_ID3 0xFFC
+
+#define UDMA_CHANNELS 32
+/* Peripherals each channel can be assigned to through DMACHMAPn */
+#define UDMA_ENCODINGS 5
+
+#define UDMA_CFG_MASTEN (1 << 0)
+#define UDMA_CTLBASE_MASK 0xFFFFFC00
+/* The alternate control structures follow the 32 primary ones */
+#define UDMA_ALT_OFFSET 0x200
+
+/* Control structure: end pointers and the channel control word */
+#define UDMA_ENTRY_SIZE 16
+#define UDMA_ENTRY_SRCENDP 0x0
+#define UDMA_ENTRY_DSTENDP 0x4
+#define UDMA_ENTRY_CHCTL 0x8
+
+#define UDMA_MODE_STOP 0
+#define UDMA_MODE_BASIC 1
+#define UDMA_MODE_AUTO 2
+#define UDMA_MODE_PINGPONG 3
+#define UDMA_MODE_MEM_SG 4
+#define UDMA_MODE_MEM_SG_ALT 5
+#define UDMA_MODE_PER_SG 6
+#define UDMA_MODE_PER_SG_ALT 7
+
+#define UDMA_CHCTL_NXTUSEBURST (1 << 3)
+#define UDMA_INC_NONE 3
+
+/*
+ * Request lines "req" (burst) and "sreq" (single), and the "done" outputs,
+ * are numbered per channel and encoding
+ */
+#define UDMA_REQ_LINE(ch, enc) ((ch) * UDMA_ENCODINGS + (enc))
+#define UDMA_REQ_LINES (UDMA_CHANNELS * UDMA_ENCODINGS)
+
+#define TYPE_TM4C123_UDMA "tm4c123-udma"
+
+OBJECT_DECLARE_SIMPLE_TYPE(TM4C123UDMAState, TM4C123_UDMA)
+
+struct TM4C123UDMAState {
+    SysBusDevice parent_obj;
+    MemoryRegion mmio;
+    MemoryRegion *downstream;
+    AddressSpace as;
+    /* uDMA software and uDMA error interrupts */
+    qemu_irq irq_sw;
+    qemu_irq irq_err;
+    /* Completion of a peripheral channel, per channel and encoding */
+    qemu_irq done[UDMA_REQ_LINES];
+    TM4C123SysCtlState *sysctl;
+
+    uint32_t udma_cfg;
+    uint32_t udma_ctlbase;
+    uint32_t udma_useburst;
+    uint32_t udma_reqmask;
+    uint32_t udma_ena;
+    uint32_t udma_alt;
+    uint32_t udma_prio;
+    uint32_t udma_err;
+    uint32_t udma_chasgn;
+    uint32_t udma_chis;
+    uint32_t udma_chmap[4];
+
+    /*
+     * Pending work per channel: a software request, or a latched edge of
+     * a peripheral burst/single request. The live request levels are kept
+     * separately; a line still high after an arbitration asks again.
+     */
+    uint32_t sw_pending;
+    uint32_t burst_pending;
+    uint32_t single_pending;
+    uint32_t burst_level[UDMA_ENCODINGS];
+    uint32_t single_level[UDMA_ENCODINGS];
+    /* Channels whose last transfer was started by software */
+    uint32_t sw_channels;
+
+    /* Completions waiting for the modelled bus time, see "fast-timing" */
+    uint32_t done_pending;
+    /* ... and which of them end the transfer, clearing the enable bit */
+    uint32_t done_last;
+    int64_t done_ns[UDMA_CHANNELS];
+    /* "fast-timing": complete once the data has moved, skip the bus time */
+    bool fast_timing;
+
+    QEMUBH *bh;
+    QEMUTimer *done_timer;
+    Clock *clk;
+};
+
+#endif
@@ -30,7 +30,10 @@
 #include "qom/object.h"
 #include "hw/misc/tm4c123_sysctl.h"
 
-/* #define GPIO_DATA 0x00 */
+/*
+ * GPIODATA is a 256 word window: bits [9:2] of the offset mask the pins a
+ * read returns or a write changes, 0x3FC covers all of them.
+ */
 #define GPIO_DATA 0x3FC
 #define GPIO_DIR 0x400
 #define GPIO_IS 0x404
@@ -68,6 +71,10 @@
 #define GPIO_PCELL_ID2 0xFF8
 #define GPIO_PCELL_ID3 0xFFC
 
+#define GPIO_PINS 8
+/* Ports A to F, the index in RCGCGPIO and GPIOHBCTL */
+#define GPIO_PORTS 6
+
 #define GPIO_A 0x40004000
 #define GPIO_B 0x40005000
 #define GPIO_C 0x40006000
@@ -75,6 +82,14 @@
 #define GPIO_E 0x40024000
 #define GPIO_F 0x40025000
 
+/* The same ports on the AHB aperture, selected per port by GPIOHBCTL */
+#define GPIO_A_AHB 0x40058000
+#define GPIO_B_AHB 0x40059000
+#define GPIO_C_AHB 0x4005A000
+#define GPIO_D_AHB 0x4005B000
+#define GPIO_E_AHB 0x4005C000
+#define GPIO_F_AHB 0x4005D000
+
 #define TYPE_TM4C123_GPIO "tm4c123-gpio"
 
 OBJECT_DECLARE_SIMPLE_TYPE(TM4C123GPIOState, TM4C123_GPIO)
@@ -82,6 +97,7 @@ OBJECT_DECLARE_SIMPLE_TYPE(TM4C123GPIOState, TM4C123_GPIO)
 struct TM4C123GPIOState {
     SysBusDevice parent_obj;
     MemoryRegion mmio;
+    MemoryRegion mmio_ahb;
 
     uint32_t gpio_data;
     uint32_t gpio_dir;
@@ -120,8 +136,21 @@ struct TM4C123GPIOState {
     uint32_t gpio_pcell_id2;
     uint32_t gpio_pcell_id3;
 
+    /* Pins GPIODATA writes can drive: digital outputs not given to a peripheral */
+    uint32_t data_wmask;
+    /* Levels on the input lines, and which of them something has driven */
+    uint32_t in_level;
+    uint32_t in_driven;
+    /* Resolved level of each pad */
+    uint32_t pins;
+
     qemu_irq irq;
+    qemu_irq out[GPIO_PINS];
+    Clock *clk;
     TM4C123SysCtlState *sysctl;
+    /* "port" property: this port's index, and its bit in GPIOHBCTL */
+    uint32_t port;
+    uint32_t port_mask;
 };
 
 #endif
@@ -0,0 +1,153 @@
+/*
+ * TM4C123 I2C
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * QEMU interface:
+ * + sysbus IRQ 0: the combined master and slave interrupt
+ * + sysbus MMIO region 0: the registers
+ * + clock input "i2c_clock": the gated system clock from the sysctl
+ * + I2CBus "i2c": the devices on the SCL/SDA lines
+ */
+
+#ifndef HW_ARM_TM4C123_I2C_H
+#define HW_ARM_TM4C123_I2C_H
+
+#include "hw/sysbus.h"
+#include "hw/i2c/i2c.h"
+#include "qom/object.h"
+#include "hw/misc/tm4c123_sysctl.h"
+
+#define I2C_MSA             0x000
+#define I2C_MCS             0x004
+#define I2C_MDR             0x008
+#define I2C_MTPR            0x00C
+#define I2C_MIMR            0x010
+#define I2C_MRIS            0x014
+#define I2C_MMIS            0x018
+#define I2C_MICR            0x01C
+#define I2C_MCR             0x020
+#define I2C_MCLKOCNT        0x024
+#define I2C_MBMON           0x02C
+#define I2C_MCR2            0x038
+#define I2C_SOAR            0x800
+#define I2C_SCSR            0x804
+#define I2C_SDR             0x808
+#define I2C_SIMR            0x80C
+#define I2C_SRIS            0x810
+#define I2C_SMIS            0x814
+#define I2C_SICR            0x818
+#define I2C_SOAR2           0x81C
+#define I2C_SACKCTL         0x820
+#define I2C_PP              0xFC0
+#define I2C_PC              0xFC4
+
+/* MCS, written: the command */
+#define I2C_MCS_RUN (1 << 0)
+#define I2C_MCS_START (1 << 1)
+#define I2C_MCS_STOP (1 << 2)
+#define I2C_MCS_ACK (1 << 3)
+/* MCS, read: the status */
+#define I2C_MCS_BUSY (1 << 0)
+#define I2C_MCS_ERROR (1 << 1)
+#define I2C_MCS_ADRACK (1 << 2)
+#define I2C_MCS_DATACK (1 << 3)
+#define I2C_MCS_ARBLST (1 << 4)
+#define I2C_MCS_IDLE (1 << 5)
+#define I2C_MCS_BUSBSY (1 << 6)
+
+#define I2C_MCR_LPBK (1 << 0)
+#define I2C_MCR_MFE (1 << 4)
+#define I2C_MCR_SFE (1 << 5)
+#define I2C_MCR_GFE (1 << 6)
+
+#define I2C_MINT_RIS (1 << 0)
+
+/* SCSR, written: device active; read: the requests */
+#define I2C_SCSR_DA (1 << 0)
+#define I2C_SCSR_RREQ (1 << 0)
+#define I2C_SCSR_TREQ (1 << 1)
+#define I2C_SCSR_FBR (1 << 2)
+#define I2C_SCSR_OAR2SEL (1 << 3)
+
+#define I2C_SINT_DATA (1 << 0)
+#define I2C_SINT_START (1 << 1)
+#define I2C_SINT_STOP (1 << 2)
+
+#define I2C_SOAR2_OAR2EN (1 << 7)
+
+#define I2C_SACKCTL_ACKOEN (1 << 0)
+#define I2C_SACKCTL_ACKOVAL (1 << 1)
+
+#define TYPE_TM4C123_I2C "tm4c123-i2c"
+
+OBJECT_DECLARE_SIMPLE_TYPE(TM4C123I2CState, TM4C123_I2C)
+
+struct TM4C123I2CState {
+    SysBusDevice parent_obj;
+    MemoryRegion mmio;
+
+    uint32_t i2c_msa;
+    uint32_t i2c_mcs;
+    uint32_t i2c_mdr;
+    uint32_t i2c_mtpr;
+    uint32_t i2c_mimr;
+    uint32_t i2c_mris;
+    uint32_t i2c_mcr;
+    uint32_t i2c_mclkocnt;
+    uint32_t i2c_mcr2;
+    uint32_t i2c_soar;
+    uint32_t i2c_scsr;
+    uint32_t i2c_sdr;
+    uint32_t i2c_simr;
+    uint32_t i2c_sris;
+    uint32_t i2c_soar2;
+    uint32_t i2c_sackctl;
+    uint32_t i2c_pc;
+    /* Slave side enabled by SCSR.DA; SCSR reads back the requests instead */
+    bool slave_active;
+
+    /*
+     * The master command in progress, completing at busy_until_ns. A
+     * transfer addressed to our own slave module also waits for the
+     * slave side to read or write SDR, like a stretched clock.
+     */
+    uint32_t cmd;
+    int64_t busy_until_ns;
+    bool slave_wait;
+    /* Whether we hold the bus, and whether the transfer goes to our own slave */
+    bool bus_owned;
+    bool to_slave;
+    bool slave_nack;
+
+    /* "fast-timing": commands complete as soon as they are written */
+    bool fast_timing;
+
+    QEMUTimer *timer;
+    qemu_irq irq;
+    I2CBus *bus;
+    Clock *clk;
+    TM4C123SysCtlState *sysctl;
+};
+
+#endif
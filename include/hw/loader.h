@@ -283,6 +283,16 @@ int rom_add_elf_program(const char *name, GMappedFile *mapped_file, void *data,
                         size_t datasize, size_t romsize, hwaddr addr,
                         AddressSpace *as);
 int rom_check_and_register_reset(void);
+
+/**
+ * rom_reset_address_space:
+ * @as: address space the ROMs were loaded into
+ *
+ * Write the ROMs in @as back, as a system reset does for every ROM. For
+ * machines that reset one part of themselves without the others.
+ */
+void rom_reset_address_space(AddressSpace *as);
+
 void rom_set_fw(FWCfgState *f);
 void rom_set_order_override(int order);
 void rom_reset_order_override(void);
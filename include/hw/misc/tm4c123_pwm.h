@@ -0,0 +1,206 @@
+/*
+ * TM4C123 PWM
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * QEMU interface:
+ * + sysbus IRQs 0-3: the generator interrupts
+ * + sysbus IRQ 4: the fault interrupt
+ * + sysbus MMIO region 0: the registers
+ * + clock input "pwm_clock": the gated, PWMDIV divided, clock from the sysctl
+ * + named GPIO output "pwm": the eight MnPWMx pins
+ * + named GPIO output "adc-trigger": one pulse per enabled generator event
+ * + named GPIO input "fault": the MnFAULT0-3 pins
+ * + named GPIO input "dcmp": the ADC digital comparator triggers
+ * + property "module": the module number stamped in the edge log
+ * + property "edge-log": write every pin edge to this file, see below
+ *
+ * The edge log starts with a 16-byte header, "TM4CPWM" and a NUL, then
+ * the format version and the record size as little-endian 32-bit words.
+ * Every record is a little-endian 64-bit word: the virtual time of the
+ * edge in ns in bits 63-8, the module in bits 7-4, the pin in bits 3-1
+ * and the new level in bit 0.
+ *
+ * An existing file is truncated when the machine starts. Both modules
+ * may share one file; each writes its records in batches of
+ * PWM_LOG_ENTRIES, so a module's records are in time order but the two
+ * modules' batches are interleaved; readers sort the records by time.
+ */
+
+#ifndef HW_ARM_TM4C123_PWM_H
+#define HW_ARM_TM4C123_PWM_H
+
+#include "hw/sysbus.h"
+#include "qom/object.h"
+#include "qemu/notify.h"
+#include "hw/misc/tm4c123_sysctl.h"
+
+#define PWM_CTL 0x000
+#define PWM_SYNC 0x004
+#define PWM_ENABLE 0x008
+#define PWM_INVERT 0x00C
+#define PWM_FAULT 0x010
+#define PWM_INTEN 0x014
+#define PWM_RIS 0x018
+#define PWM_ISC 0x01C
+#define PWM_STATUS 0x020
+#define PWM_FAULTVAL 0x024
+#define PWM_ENUPD 0x028
+#define PWM_PP 0xFC0
+
+/* Generator blocks, PWMnCTL onwards */
+#define PWM_GEN_BASE 0x040
+#define PWM_GEN_STRIDE 0x040
+#define PWM_GEN_CTL 0x00
+#define PWM_GEN_INTEN 0x04
+#define PWM_GEN_RIS 0x08
+#define PWM_GEN_ISC 0x0C
+#define PWM_GEN_LOAD 0x10
+#define PWM_GEN_COUNT 0x14
+#define PWM_GEN_CMPA 0x18
+#define PWM_GEN_CMPB 0x1C
+#define PWM_GEN_GENA 0x20
+#define PWM_GEN_GENB 0x24
+#define PWM_GEN_DBCTL 0x28
+#define PWM_GEN_DBRISE 0x2C
+#define PWM_GEN_DBFALL 0x30
+#define PWM_GEN_FLTSRC0 0x34
+#define PWM_GEN_FLTSRC1 0x38
+#define PWM_GEN_MINFLTPER 0x3C
+
+/* Extended fault blocks, PWMnFLTSEN onwards */
+#define PWM_FLT_BASE 0x800
+#define PWM_FLT_STRIDE 0x080
+#define PWM_FLT_SEN 0x00
+#define PWM_FLT_STAT0 0x04
+#define PWM_FLT_STAT1 0x08
+
+#define PWM_GENERATORS 4
+#define PWM_OUTPUTS 8
+#define PWM_FAULTS 4
+#define PWM_DCMPS 8
+
+#define PWM_GEN_CTL_ENABLE (1 << 0)
+#define PWM_GEN_CTL_MODE (1 << 1)
+#define PWM_GEN_CTL_FLTSRC (1 << 16)
+#define PWM_GEN_CTL_MINFLTPER (1 << 17)
+#define PWM_GEN_CTL_LATCH (1 << 18)
+#define PWM_DBCTL_ENABLE (1 << 0)
+
+/* Counter events, in the bit order of PWMnRIS and the PWMnGENx actions */
+#define PWM_EV_ZERO (1 << 0)
+#define PWM_EV_LOAD (1 << 1)
+#define PWM_EV_CMPAU (1 << 2)
+#define PWM_EV_CMPAD (1 << 3)
+#define PWM_EV_CMPBU (1 << 4)
+#define PWM_EV_CMPBD (1 << 5)
+#define PWM_EV_ALL 0x3F
+
+/* Registers that take effect at a counter boundary, see PWMnCTL */
+enum {
+    PWM_SH_LOAD,
+    PWM_SH_CMPA,
+    PWM_SH_CMPB,
+    PWM_SH_GENA,
+    PWM_SH_GENB,
+    PWM_SH_DBCTL,
+    PWM_SH_DBRISE,
+    PWM_SH_DBFALL,
+    PWM_SHADOWED,
+};
+
+#define PWM_LOG_ENTRIES 512
+
+#define TYPE_TM4C123_PWM "tm4c123-pwm"
+
+OBJECT_DECLARE_SIMPLE_TYPE(TM4C123PWMState, TM4C123_PWM)
+
+typedef struct {
+    uint32_t ctl;
+    uint32_t inten;
+    uint32_t ris;
+    uint32_t fltsrc0;
+    uint32_t fltsrc1;
+    uint32_t minfltper;
+    uint32_t fltsen;
+    uint32_t fltstat0;
+    uint32_t fltstat1;
+
+    /* As written, and as used by the counter */
+    uint32_t wr[PWM_SHADOWED];
+    uint32_t act[PWM_SHADOWED];
+
+    /*
+     * The counter in ticks of the module clock since @epoch_ns: the
+     * current period started at tick @period_start, and every event up
+     * to tick @synced has been applied.
+     */
+    int64_t epoch_ns;
+    int64_t period_start;
+    int64_t synced;
+
+    /* Generator outputs, and the dead-band edges still to come */
+    uint8_t raw;
+    uint8_t sig;
+    int64_t db_tick[2];
+
+    /* Faults held for the minimum fault period */
+    bool fault;
+    int64_t fault_until_ns;
+} TM4C123PWMGenerator;
+
+struct TM4C123PWMState {
+    SysBusDevice parent_obj;
+    MemoryRegion mmio;
+    qemu_irq irq[PWM_GENERATORS];
+    qemu_irq irq_fault;
+    qemu_irq out[PWM_OUTPUTS];
+    qemu_irq adc_trigger[PWM_GENERATORS];
+    TM4C123SysCtlState *sysctl;
+
+    uint32_t pwm_ctl;
+    uint32_t pwm_enable;
+    uint32_t pwm_invert;
+    uint32_t pwm_fault;
+    uint32_t pwm_inten;
+    uint32_t pwm_ris;
+    uint32_t pwm_faultval;
+    uint32_t pwm_enupd;
+
+    TM4C123PWMGenerator gen[PWM_GENERATORS];
+    uint32_t fault_level;
+    /* Pin levels as last driven */
+    uint32_t pins;
+
+    uint8_t module;
+    char *edge_log;
+    int log_fd;
+    uint32_t log_len;
+    uint64_t log_buf[PWM_LOG_ENTRIES];
+    Notifier exit_notifier;
+
+    QEMUTimer *timer;
+    Clock *clk;
+};
+
+#endif
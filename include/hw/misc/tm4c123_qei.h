@@ -0,0 +1,127 @@
+/*
+ * TM4C123 QEI
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * QEMU interface:
+ * + sysbus IRQ 0: the QEI interrupt
+ * + sysbus MMIO region 0: the registers
+ * + clock input "qei_clock": the gated system clock from the sysctl
+ * + named GPIO input "pins": PhA, PhB and IDX, see QEI_PIN_*
+ * + property "profile": drive the inputs from a velocity profile instead
+ *   of the pins, as "ms:rpm" points joined by commas. The speed ramps
+ *   linearly between points, holds after the last one, and the shaft
+ *   position is integrated from machine start.
+ * + property "lines": encoder lines per revolution for the profile; the
+ *   index pulses once per revolution
+ */
+
+#ifndef HW_ARM_TM4C123_QEI_H
+#define HW_ARM_TM4C123_QEI_H
+
+#include "hw/sysbus.h"
+#include "qom/object.h"
+#include "hw/misc/tm4c123_sysctl.h"
+
+#define QEI_CTL 0x000
+#define QEI_STAT 0x004
+#define QEI_POS 0x008
+#define QEI_MAXPOS 0x00C
+#define QEI_LOAD 0x010
+#define QEI_TIME 0x014
+/* QEICOUNT, the velocity counter; QEI_COUNT is the SoC module count */
+#define QEI_CNT 0x018
+#define QEI_SPEED 0x01C
+#define QEI_INTEN 0x020
+#define QEI_RIS 0x024
+#define QEI_ISC 0x028
+
+#define QEI_CTL_ENABLE (1 << 0)
+#define QEI_CTL_SWAP (1 << 1)
+#define QEI_CTL_SIGMODE (1 << 2)
+#define QEI_CTL_CAPMODE (1 << 3)
+#define QEI_CTL_RESMODE (1 << 4)
+#define QEI_CTL_VELEN (1 << 5)
+#define QEI_CTL_INVA (1 << 9)
+#define QEI_CTL_INVB (1 << 10)
+#define QEI_CTL_INVI (1 << 11)
+
+#define QEI_STAT_DIRECTION (1 << 1)
+
+#define QEI_INT_INDEX (1 << 0)
+#define QEI_INT_TIMER (1 << 1)
+#define QEI_INT_DIR (1 << 2)
+#define QEI_INT_ERROR (1 << 3)
+
+#define QEI_PIN_PHA 0
+#define QEI_PIN_PHB 1
+#define QEI_PIN_IDX 2
+#define QEI_PINS 3
+
+#define TYPE_TM4C123_QEI "tm4c123-qei"
+
+OBJECT_DECLARE_SIMPLE_TYPE(TM4C123QEIState, TM4C123_QEI)
+
+/* A profile point: time, speed in edges per ns, and edges travelled so far */
+typedef struct {
+    int64_t ns;
+    double v;
+    double e;
+} TM4C123QEIPoint;
+
+struct TM4C123QEIState {
+    SysBusDevice parent_obj;
+    MemoryRegion mmio;
+    qemu_irq irq;
+    TM4C123SysCtlState *sysctl;
+
+    uint32_t qei_ctl;
+    uint32_t qei_stat;
+    uint32_t qei_pos;
+    uint32_t qei_maxpos;
+    uint32_t qei_load;
+    uint32_t qei_speed;
+    uint32_t qei_inten;
+    uint32_t qei_ris;
+
+    /* Edges seen in the running velocity period, before VELDIV */
+    uint32_t vel_edges;
+    /* Next velocity timer expiry */
+    int64_t vel_next_ns;
+
+    /* Pin levels as driven, before INVx and SWAP */
+    uint32_t pins;
+
+    /* Profile input: the quadrature state reached, and when */
+    char *profile;
+    uint32_t lines;
+    TM4C123QEIPoint *points;
+    uint32_t num_points;
+    int64_t gen_q;
+    int64_t gen_ns;
+
+    QEMUTimer *timer;
+    Clock *clk;
+};
+
+#endif
@@ -164,11 +164,34 @@
 #define SYSCTL_PRWTIMER 0xA5C
 
 
+#define SYSCTL_RCC_BYPASS (1 << 11)
 #define SYSCTL_RCC_PWRDN (1 << 13)
+#define SYSCTL_RCC_USEPWMDIV (1 << 20)
+#define SYSCTL_RCC_USESYSDIV (1 << 22)
+#define SYSCTL_RCC_ACG (1 << 27)
+#define SYSCTL_RCC2_BYPASS2 (1 << 11)
 #define SYSCTL_RCC2_PWRDN2 (1 << 13)
+#define SYSCTL_RCC2_DIV400 (1 << 30)
 #define SYSCTL_RCC2_USERCC2 (1 << 31)
 #define SYSCTL_RIS_PLLRIS (1 << 6)
 
+#define SYSCTL_OSCSRC_MOSC 0
+#define SYSCTL_OSCSRC_PIOSC 1
+#define SYSCTL_OSCSRC_PIOSC_4 2
+#define SYSCTL_OSCSRC_LFIOSC 3
+#define SYSCTL_OSCSRC_32K 7
+
+/* RCGCWD through RCGCWTIMER, up to 8 modules each */
+#define SYSCTL_RCGC_COUNT ((SYSCTL_RCGCWTIMER - SYSCTL_RCGCWD) / 4 + 1)
+#define SYSCTL_RCGC_BITS 8
+
+/* What the core is doing, which picks the system clock and module gates */
+typedef enum {
+    TM4C123_POWER_RUN,
+    TM4C123_POWER_SLEEP,
+    TM4C123_POWER_DEEP_SLEEP,
+} TM4C123PowerMode;
+
 #define TYPE_TM4C123_SYSCTL "tm4c123-sysctl"
 OBJECT_DECLARE_SIMPLE_TYPE(TM4C123SysCtlState, TM4C123_SYSCTL)
 
@@ -299,9 +322,15 @@ struct TM4C123SysCtlState {
     uint32_t sysctl_preeprom;
     uint32_t sysctl_prwtimer;
 
+    uint32_t power_mode;
+
     Clock* mainclk;
     Clock* outclk;
-
+    Clock* refclk;
+    Clock* periph_clk[SYSCTL_RCGC_COUNT][SYSCTL_RCGC_BITS];
 };
 
+Clock *tm4c123_sysctl_clock(TM4C123SysCtlState *s, hwaddr rcgc, int bit);
+void tm4c123_sysctl_set_power_mode(TM4C123SysCtlState *s, TM4C123PowerMode mode);
+
 #endif
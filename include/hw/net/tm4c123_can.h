@@ -0,0 +1,196 @@
+/*
+ * TM4C123 CAN
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * QEMU interface:
+ * + sysbus IRQ 0: the CAN interrupt
+ * + sysbus MMIO region 0: the registers
+ * + clock input "can_clock": the gated system clock from the sysctl
+ * + link property "canbus": the QEMU CAN bus the controller sits on.
+ *   Without one, only the loopback test mode moves frames.
+ *
+ * Frames go out whole as soon as a transmit request is seen; bit timing
+ * is accepted but not modelled, and there are no bus errors.
+ */
+
+#ifndef HW_ARM_TM4C123_CAN_H
+#define HW_ARM_TM4C123_CAN_H
+
+#include "hw/sysbus.h"
+#include "qom/object.h"
+#include "net/can_emu.h"
+#include "hw/misc/tm4c123_sysctl.h"
+
+#define CAN_CTL 0x000
+#define CAN_STS 0x004
+#define CAN_ERR 0x008
+#define CAN_BIT 0x00C
+#define CAN_INT 0x010
+#define CAN_TST 0x014
+#define CAN_BRPE 0x018
+#define CAN_IF1 0x020
+#define CAN_IF2 0x080
+#define CAN_TXRQ1 0x100
+#define CAN_TXRQ2 0x104
+#define CAN_NWDA1 0x120
+#define CAN_NWDA2 0x124
+#define CAN_MSG1INT 0x140
+#define CAN_MSG2INT 0x144
+#define CAN_MSG1VAL 0x160
+#define CAN_MSG2VAL 0x164
+
+/* Interface register set, relative to CAN_IF1 or CAN_IF2 */
+#define CAN_IF_CRQ 0x00
+#define CAN_IF_CMSK 0x04
+#define CAN_IF_MSK1 0x08
+#define CAN_IF_MSK2 0x0C
+#define CAN_IF_ARB1 0x10
+#define CAN_IF_ARB2 0x14
+#define CAN_IF_MCTL 0x18
+#define CAN_IF_DA1 0x1C
+#define CAN_IF_DA2 0x20
+#define CAN_IF_DB1 0x24
+#define CAN_IF_DB2 0x28
+#define CAN_IF_SIZE 0x2C
+
+#define CAN_CTL_INIT (1 << 0)
+#define CAN_CTL_IE (1 << 1)
+#define CAN_CTL_SIE (1 << 2)
+#define CAN_CTL_EIE (1 << 3)
+#define CAN_CTL_DAR (1 << 5)
+#define CAN_CTL_CCE (1 << 6)
+#define CAN_CTL_TEST (1 << 7)
+
+#define CAN_STS_TXOK (1 << 3)
+#define CAN_STS_RXOK (1 << 4)
+
+#define CAN_TST_BASIC (1 << 2)
+#define CAN_TST_SILENT (1 << 3)
+#define CAN_TST_LBACK (1 << 4)
+#define CAN_TST_RX (1 << 7)
+
+#define CAN_INT_STATUS 0x8000
+
+#define CAN_CMSK_DATAB (1 << 0)
+#define CAN_CMSK_DATAA (1 << 1)
+#define CAN_CMSK_NEWDAT (1 << 2)
+#define CAN_CMSK_CLRINTPND (1 << 3)
+#define CAN_CMSK_CONTROL (1 << 4)
+#define CAN_CMSK_ARB (1 << 5)
+#define CAN_CMSK_MASK (1 << 6)
+#define CAN_CMSK_WRNRD (1 << 7)
+
+#define CAN_MSK2_MXTD (1 << 15)
+#define CAN_MSK2_MDIR (1 << 14)
+
+#define CAN_ARB2_MSGVAL (1 << 15)
+#define CAN_ARB2_XTD (1 << 14)
+#define CAN_ARB2_DIR (1 << 13)
+
+#define CAN_MCTL_NEWDAT (1 << 15)
+#define CAN_MCTL_MSGLST (1 << 14)
+#define CAN_MCTL_INTPND (1 << 13)
+#define CAN_MCTL_UMASK (1 << 12)
+#define CAN_MCTL_TXIE (1 << 11)
+#define CAN_MCTL_RXIE (1 << 10)
+#define CAN_MCTL_RMTEN (1 << 9)
+#define CAN_MCTL_TXRQST (1 << 8)
+#define CAN_MCTL_EOB (1 << 7)
+#define CAN_MCTL_DLC 0xF
+
+#define CAN_OBJECTS 32
+#define CAN_INTERFACES 2
+
+#define TYPE_TM4C123_CAN "tm4c123-can"
+
+OBJECT_DECLARE_SIMPLE_TYPE(TM4C123CANState, TM4C123_CAN)
+
+/* Message object, or interface register set: MSK1 to DB2 as 16-bit words */
+typedef struct TM4C123CANObject {
+    uint16_t msk1;
+    uint16_t msk2;
+    uint16_t arb1;
+    uint16_t arb2;
+    uint16_t mctl;
+    uint16_t data[4];
+} TM4C123CANObject;
+
+typedef struct TM4C123CANIF {
+    uint16_t crq;
+    uint16_t cmsk;
+    TM4C123CANObject regs;
+} TM4C123CANIF;
+
+/*
+ * Objects sharing an acceptance mask, looked up by identifier. Keys are
+ * the 29-bit arbitration field with XTD in bit 29, masked; the entries
+ * of a filter sit sorted in keys[first .. first + count).
+ */
+typedef struct TM4C123CANFilter {
+    uint32_t mask;
+    uint8_t first;
+    uint8_t count;
+} TM4C123CANFilter;
+
+typedef struct TM4C123CANIndex {
+    uint8_t num_filters;
+    TM4C123CANFilter filters[CAN_OBJECTS];
+    uint32_t keys[CAN_OBJECTS];
+    /* Objects whose key this is, bit n for object n + 1 */
+    uint32_t objs[CAN_OBJECTS];
+} TM4C123CANIndex;
+
+struct TM4C123CANState {
+    SysBusDevice parent_obj;
+    MemoryRegion mmio;
+    qemu_irq irq;
+    TM4C123SysCtlState *sysctl;
+
+    CanBusState *canbus;
+    CanBusClientState bus_client;
+
+    uint32_t can_ctl;
+    uint32_t can_sts;
+    uint32_t can_bit;
+    uint32_t can_tst;
+    uint32_t can_brpe;
+    /* A status change is pending in CANINT until CANSTS is read */
+    bool status_int;
+
+    TM4C123CANIF ifs[CAN_INTERFACES];
+    TM4C123CANObject objs[CAN_OBJECTS];
+
+    /*
+     * Acceptance filtering for received data frames and for remote
+     * frames, rebuilt from the message objects when one changes
+     */
+    TM4C123CANIndex rx_index;
+    TM4C123CANIndex rmt_index;
+    bool index_dirty;
+    bool transmitting;
+
+    Clock *clk;
+};
+
+#endif
@@ -0,0 +1,131 @@
+/*
+ * TM4C123 EEPROM
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * QEMU interface:
+ * + sysbus IRQ 0: pulsed when an operation ends with EEINT.INT set; the
+ *   flash controller latches it in FCRIS.ERIS
+ * + sysbus MMIO region 0: the registers
+ * + clock input "eeprom_clock": the gated system clock from the sysctl
+ * + property "drive": a raw image holding the EEPROM contents, e.g.
+ *   -drive if=none,id=ee,format=raw,file=ee.bin
+ *   -global tm4c123-eeprom.drive=ee
+ *   It must hold at least the 2 KB of data. Passwords and protection
+ *   follow in a 512-byte trailer and only persist if the image has room
+ *   for it. Without a drive the contents last for the run only.
+ *
+ * Writes land in a RAM copy at once and reach the drive in batches, a
+ * while after the first unsaved change and whenever the VM stops.
+ */
+
+#ifndef HW_ARM_TM4C123_EEPROM_H
+#define HW_ARM_TM4C123_EEPROM_H
+
+#include "hw/sysbus.h"
+#include "qom/object.h"
+#include "qemu/timer.h"
+#include "sysemu/block-backend.h"
+#include "sysemu/runstate.h"
+#include "hw/misc/tm4c123_sysctl.h"
+
+#define EEPROM_EESIZE 0x000
+#define EEPROM_EEBLOCK 0x004
+#define EEPROM_EEOFFSET 0x008
+#define EEPROM_EERDWR 0x010
+#define EEPROM_EERDWRINC 0x014
+#define EEPROM_EEDONE 0x018
+#define EEPROM_EESUPP 0x01C
+#define EEPROM_EEUNLOCK 0x020
+#define EEPROM_EEPROT 0x030
+#define EEPROM_EEPASS0 0x034
+#define EEPROM_EEPASS1 0x038
+#define EEPROM_EEPASS2 0x03C
+#define EEPROM_EEINT 0x040
+#define EEPROM_EEHIDE 0x050
+#define EEPROM_EEDBGME 0x080
+#define EEPROM_PP 0xFC0
+
+#define EEPROM_BLOCKS 32
+#define EEPROM_BLOCK_WORDS 16
+#define EEPROM_WORDS (EEPROM_BLOCKS * EEPROM_BLOCK_WORDS)
+#define EEPROM_SIZE (EEPROM_WORDS * 4)
+/* Per block: protection, then three password words, all stored inverted */
+#define EEPROM_META_SIZE (EEPROM_BLOCKS * 16)
+#define EEPROM_IMAGE_SIZE (EEPROM_SIZE + EEPROM_META_SIZE)
+
+#define EEPROM_EEDONE_WORKING (1 << 0)
+#define EEPROM_EEDONE_WKERASE (1 << 2)
+#define EEPROM_EEDONE_NOPERM (1 << 4)
+#define EEPROM_EEDONE_WRBUSY (1 << 5)
+
+#define EEPROM_EEPROT_PROT 0x7
+#define EEPROM_EEPROT_ACC (1 << 3)
+#define EEPROM_PROT_RW 0x0
+#define EEPROM_PROT_LOCKED_RW 0x1
+#define EEPROM_PROT_RO 0x2
+
+#define EEPROM_EEINT_INT (1 << 0)
+#define EEPROM_EEDBGME_KEY 0xE37B0000
+#define EEPROM_EEDBGME_ME (1 << 0)
+
+#define TYPE_TM4C123_EEPROM "tm4c123-eeprom"
+
+OBJECT_DECLARE_SIMPLE_TYPE(TM4C123EEPROMState, TM4C123_EEPROM)
+
+struct TM4C123EEPROMState {
+    SysBusDevice parent_obj;
+    MemoryRegion mmio;
+    qemu_irq irq;
+    TM4C123SysCtlState *sysctl;
+
+    uint32_t eeprom_block;
+    uint32_t eeprom_offset;
+    uint32_t eeprom_int;
+    uint32_t eeprom_hide;
+    /* Result of the last operation, reported in EEDONE once it is over */
+    uint32_t status;
+    int64_t busy_until_ns;
+
+    /* Password words written to EEUNLOCK so far */
+    uint32_t unlock_words[3];
+    uint32_t unlock_count;
+    bool master_unlocked;
+    bool block_unlocked;
+
+    /* The contents as stored on the drive, data words little endian */
+    uint8_t image[EEPROM_IMAGE_SIZE];
+    /* Byte range of image[] not written back yet */
+    uint32_t dirty_lo;
+    uint32_t dirty_hi;
+    uint32_t image_len;
+    bool blk_ro;
+
+    BlockBackend *blk;
+    QEMUTimer *flush_timer;
+    QEMUTimer *done_timer;
+    VMChangeStateEntry *vmstate_change;
+    Clock *clk;
+};
+
+#endif
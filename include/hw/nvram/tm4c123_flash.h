@@ -0,0 +1,177 @@
+/*
+ * TM4C123 Flash memory controller
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * QEMU interface:
+ * + sysbus IRQ 0: the flash memory control interrupt
+ * + sysbus MMIO region 0: the controller registers
+ * + sysbus MMIO region 1: the flash array. Reads go straight to RAM,
+ *   only stores trap.
+ * + sysbus MMIO regions 2 and 3: BOOTCFG, USER_REGn, FMPREn, and FMPPEn,
+ *   which sit in the system control block at FLASH_SYSCTL_REGS and
+ *   FLASH_SYSCTL_FMPPE
+ * + named GPIO input "eeprom-done": the EEPROM's done pulse, latched in
+ *   FCRIS.ERIS
+ * + property "size", "sram-size": the array size, and the SRAM size that
+ *   SSIZE reports
+ * + property "drive": a block backend holding the array. Pages changed
+ *   by the guest are written back in batches, page by page, so a qcow2
+ *   overlay on a shared pristine image only ever holds the dirty pages:
+ *     qemu-img create -f qcow2 -b pristine.bin -F raw worker.qcow2
+ *   A read-only drive keeps the changes for the run only.
+ * + property "image": a raw or ELF flash image, used instead of "drive".
+ *   It is mapped privately into the array, so pages are read in on first
+ *   use, and mapped afresh at reset once the guest has changed any.
+ * + property "ram-name": the array's RAM block name, which must differ
+ *   between the flashes of one machine
+ */
+
+#ifndef HW_ARM_TM4C123_FLASH_H
+#define HW_ARM_TM4C123_FLASH_H
+
+#include "hw/sysbus.h"
+#include "qom/object.h"
+#include "qemu/bitops.h"
+#include "qemu/timer.h"
+#include "sysemu/block-backend.h"
+#include "sysemu/runstate.h"
+
+#define FLASH_FMA 0x000
+#define FLASH_FMD 0x004
+#define FLASH_FMC 0x008
+#define FLASH_FCRIS 0x00C
+#define FLASH_FCIM 0x010
+#define FLASH_FCMISC 0x014
+#define FLASH_FMC2 0x020
+#define FLASH_FWBVAL 0x030
+#define FLASH_FWB0 0x100
+#define FLASH_FWB31 0x17C
+#define FLASH_FSIZE 0xFC0
+#define FLASH_SSIZE 0xFC4
+#define FLASH_ROMSWMAP 0xFCC
+
+/* Registers in the system control block, as offsets from its base */
+#define FLASH_SYSCTL_REGS 0x1D0
+#define FLASH_SYSCTL_REGS_SIZE 0x40
+#define FLASH_SYSCTL_BOOTCFG 0x1D0
+#define FLASH_SYSCTL_USER_REG0 0x1E0
+#define FLASH_SYSCTL_USER_REG3 0x1EC
+#define FLASH_SYSCTL_FMPRE0 0x200
+#define FLASH_SYSCTL_FMPRE3 0x20C
+#define FLASH_SYSCTL_FMPPE 0x400
+#define FLASH_SYSCTL_FMPPE_SIZE 0x10
+
+#define FLASH_FMC_WRITE (1 << 0)
+#define FLASH_FMC_ERASE (1 << 1)
+#define FLASH_FMC_MERASE (1 << 2)
+#define FLASH_FMC_COMT (1 << 3)
+#define FLASH_FMC2_WRBUF (1 << 0)
+
+#define FLASH_INT_ACCESS (1 << 0)
+#define FLASH_INT_PROGRAM (1 << 1)
+#define FLASH_INT_EEPROM (1 << 2)
+#define FLASH_INT_VOLT (1 << 9)
+#define FLASH_INT_INVDATA (1 << 10)
+#define FLASH_INT_ERVERIFY (1 << 11)
+#define FLASH_INT_PROGVERIFY (1 << 13)
+#define FLASH_INT_MASK 0x2E07
+
+#define FLASH_BOOTCFG_KEY (1 << 4)
+#define FLASH_BOOTCFG_NW (1u << 31)
+/* FMC/FMC2 write keys, picked by BOOTCFG.KEY */
+#define FLASH_KEY 0xA442
+#define FLASH_KEY_LEGACY 0x71D5
+
+/* Erase granularity, and the 2 KB blocks the FMPxEn bits protect */
+#define FLASH_PAGE_SIZE 1024
+#define FLASH_PROT_BLOCK 2048
+#define FLASH_FWB_WORDS 32
+#define FLASH_MAX_PAGES 512
+#define FLASH_PROT_REGS 4
+
+#define TYPE_TM4C123_FLASH "tm4c123-flash"
+
+OBJECT_DECLARE_SIMPLE_TYPE(TM4C123FlashState, TM4C123_FLASH)
+
+/* @len bytes at @offset in the image file belong at @addr in the array */
+typedef struct TM4C123FlashSegment {
+    uint32_t addr;
+    uint32_t len;
+    uint64_t offset;
+} TM4C123FlashSegment;
+
+struct TM4C123FlashState {
+    SysBusDevice parent_obj;
+    MemoryRegion mmio;
+    MemoryRegion sysctl_mmio;
+    MemoryRegion fmppe_mmio;
+    MemoryRegion flash;
+    uint8_t *storage;
+    qemu_irq irq;
+
+    uint32_t flash_fma;
+    uint32_t flash_fmd;
+    uint32_t flash_fcris;
+    uint32_t flash_fcim;
+    uint32_t flash_fwbval;
+    uint32_t flash_fwb[FLASH_FWB_WORDS];
+
+    /*
+     * BOOTCFG, USER_REGn, FMPREn and FMPPEn as in use, and as committed
+     * to the non-volatile copy that they reload from at reset
+     */
+    uint32_t bootcfg;
+    uint32_t user_reg[4];
+    uint32_t fmpre[FLASH_PROT_REGS];
+    uint32_t fmppe[FLASH_PROT_REGS];
+    uint32_t bootcfg_nv;
+    uint32_t user_reg_nv[4];
+    uint32_t fmpre_nv[FLASH_PROT_REGS];
+    uint32_t fmppe_nv[FLASH_PROT_REGS];
+
+    /* The FMC/FMC2 command bits that stay set until the operation ends */
+    uint32_t busy_fmc;
+    uint32_t busy_fmc2;
+    int64_t busy_until_ns;
+
+    /* Pages not written back to the drive yet */
+    unsigned long dirty[BITS_TO_LONGS(FLASH_MAX_PAGES)];
+    bool blk_ro;
+
+    uint32_t size;
+    uint32_t sram_size;
+    BlockBackend *blk;
+    char *image;
+    char *ram_name;
+    int image_fd;
+    TM4C123FlashSegment *image_segs;
+    int image_nsegs;
+    /* The array no longer matches the image */
+    bool image_dirty;
+    QEMUTimer *flush_timer;
+    QEMUTimer *done_timer;
+    VMChangeStateEntry *vmstate_change;
+};
+
+#endif
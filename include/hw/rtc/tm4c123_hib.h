@@ -0,0 +1,119 @@
+/*
+ * TM4C123 Hibernation module
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+/*
+ * QEMU interface:
+ * + sysbus IRQ 0: the hibernation module interrupt
+ * + sysbus MMIO region 0: the registers
+ * + clock input "hib_clock": the gated system clock from the sysctl
+ * + named GPIO input "wake": high while the WAKE pin is asserted (low)
+ * + named GPIO output "hibernate": high while the core is powered down
+ * + named GPIO output "reset": pulsed on wake-up to reset the chip
+ *
+ * The module sits in the battery-backed domain, so only power-on sets
+ * its registers; a reset leaves the RTC, HIBDATA and HIBCTL alone.
+ * Waking from hibernation resets the chip through "reset", or the whole
+ * system when nothing is connected to it. While hibernating with only the
+ * RTC to wait for, and no other board's core running, the virtual clock
+ * jumps straight to the match.
+ */
+
+#ifndef HW_ARM_TM4C123_HIB_H
+#define HW_ARM_TM4C123_HIB_H
+
+#include "hw/sysbus.h"
+#include "qom/object.h"
+#include "qemu/timer.h"
+#include "hw/misc/tm4c123_sysctl.h"
+
+#define HIB_RTCC 0x000
+#define HIB_RTCM0 0x004
+#define HIB_RTCLD 0x00C
+#define HIB_CTL 0x010
+#define HIB_IM 0x014
+#define HIB_RIS 0x018
+#define HIB_MIS 0x01C
+#define HIB_IC 0x020
+#define HIB_RTCT 0x024
+#define HIB_RTCSS 0x028
+#define HIB_DATA 0x030
+#define HIB_DATA_END 0x06F
+
+#define HIB_DATA_WORDS 16
+
+#define HIB_CTL_RTCEN (1 << 0)
+#define HIB_CTL_HIBREQ (1 << 1)
+#define HIB_CTL_RTCWEN (1 << 3)
+#define HIB_CTL_PINWEN (1 << 4)
+#define HIB_CTL_CLK32EN (1 << 6)
+#define HIB_CTL_BATCHK (1 << 10)
+#define HIB_CTL_WRC (1u << 31)
+#define HIB_CTL_MASK 0x000367DB
+
+#define HIB_INT_RTCALT0 (1 << 0)
+#define HIB_INT_LOWBAT (1 << 2)
+#define HIB_INT_EXTW (1 << 3)
+#define HIB_INT_WC (1 << 4)
+#define HIB_INT_MASK 0x1D
+
+#define HIB_RTCSS_RTCSSC 0x7FFF
+#define HIB_RTCSS_RTCSSM 0x7FFF0000
+
+/* The RTC counts a 32.768 kHz clock; RTCC holds seconds, RTCSS the rest */
+#define HIB_RTC_HZ 32768
+#define HIB_RTC_SUBSEC_BITS 15
+
+#define TYPE_TM4C123_HIB "tm4c123-hib"
+
+OBJECT_DECLARE_SIMPLE_TYPE(TM4C123HibState, TM4C123_HIB)
+
+struct TM4C123HibState {
+    SysBusDevice parent_obj;
+    MemoryRegion mmio;
+    qemu_irq irq;
+    qemu_irq hibernate;
+    qemu_irq reset;
+
+    uint32_t hib_rtcm0;
+    uint32_t hib_rtcld;
+    uint32_t hib_ctl;
+    uint32_t hib_im;
+    uint32_t hib_ris;
+    uint32_t hib_rtct;
+    uint32_t hib_rtcssm;
+    uint32_t hib_data[HIB_DATA_WORDS];
+
+    /* The RTC read base_ticks 32.768 kHz ticks at base_ns */
+    uint64_t base_ticks;
+    int64_t base_ns;
+    /* Ticks up to which matches have been looked for */
+    uint64_t checked_ticks;
+
+    bool hibernating;
+    bool wake_pin;
+
+    QEMUTimer *rtc_timer;
+    Clock *clk;
+};
+
+#endif
@@ -0,0 +1,139 @@
+/*
+ * TM4C123 SSI
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/*
+ * The SSI modules are ARM PrimeCell PL022 derivatives: the same register
+ * layout, plus DMA control and a baud clock source select.
+ *
+ * QEMU interface:
+ * + sysbus IRQ 0: SSI interrupt
+ * + sysbus MMIO region 0: the registers
+ * + clock input "ssi_clock": the gated system clock from the sysctl
+ * + SSIBus "ssi": the devices on the SSInTx/SSInRx lines
+ * + named GPIO output "fss": SSInFss, low while a transfer is running
+ * + named GPIO outputs "dma-req" and "dma-sreq": RX and TX uDMA requests
+ */
+
+#ifndef HW_ARM_TM4C123_SSI_H
+#define HW_ARM_TM4C123_SSI_H
+
+#include "hw/sysbus.h"
+#include "hw/ssi/ssi.h"
+#include "qom/object.h"
+#include "hw/misc/tm4c123_sysctl.h"
+
+#define SSI_CR0             0x000
+#define SSI_CR1             0x004
+#define SSI_DR              0x008
+#define SSI_SR              0x00C
+#define SSI_CPSR            0x010
+#define SSI_IM              0x014
+#define SSI_RIS             0x018
+#define SSI_MIS             0x01C
+#define SSI_ICR             0x020
+#define SSI_DMA_CTL         0x024
+#define SSI_CC              0xFC8
+#define SSI_PER_ID4         0xFD0
+#define SSI_PER_ID5         0xFD4
+#define SSI_PER_ID6         0xFD8
+#define SSI_PER_ID7         0xFDC
+#define SSI_PER_ID0         0xFE0
+#define SSI_PER_ID1         0xFE4
+#define SSI_PER_ID2         0xFE8
+#define SSI_PER_ID3         0xFEC
+#define SSI_PCELL_ID0       0xFF0
+#define SSI_PCELL_ID1       0xFF4
+#define SSI_PCELL_ID2       0xFF8
+#define SSI_PCELL_ID3       0xFFC
+
+#define SSI_FIFO_DEPTH 8
+
+#define SSI_CR1_LBM (1 << 0)
+#define SSI_CR1_SSE (1 << 1)
+#define SSI_CR1_MS (1 << 2)
+#define SSI_CR1_EOT (1 << 4)
+
+#define SSI_SR_TFE (1 << 0)
+#define SSI_SR_TNF (1 << 1)
+#define SSI_SR_RNE (1 << 2)
+#define SSI_SR_RFF (1 << 3)
+#define SSI_SR_BSY (1 << 4)
+
+#define SSI_INT_ROR (1 << 0)
+#define SSI_INT_RT (1 << 1)
+#define SSI_INT_RX (1 << 2)
+#define SSI_INT_TX (1 << 3)
+
+#define SSI_DMACTL_RXDMAE (1 << 0)
+#define SSI_DMACTL_TXDMAE (1 << 1)
+
+#define SSI_CC_CS_PIOSC 0x5
+
+/* uDMA request lines */
+#define SSI_DMA_RX 0
+#define SSI_DMA_TX 1
+
+#define TYPE_TM4C123_SSI "tm4c123-ssi"
+
+OBJECT_DECLARE_SIMPLE_TYPE(TM4C123SSIState, TM4C123_SSI)
+
+struct TM4C123SSIState {
+    SysBusDevice parent_obj;
+    MemoryRegion mmio;
+
+    uint32_t ssi_cr0;
+    uint32_t ssi_cr1;
+    uint32_t ssi_sr;
+    uint32_t ssi_cpsr;
+    uint32_t ssi_im;
+    uint32_t ssi_ris;
+    uint32_t ssi_mis;
+    uint32_t ssi_dma_ctl;
+    uint32_t ssi_cc;
+
+    /* Frames in flight leave the TX FIFO head first, tx_start_ns is when the head started */
+    uint16_t tx_fifo[SSI_FIFO_DEPTH];
+    uint32_t tx_count;
+    int64_t tx_start_ns;
+    uint16_t rx_fifo[SSI_FIFO_DEPTH];
+    uint32_t rx_count;
+    /* Arrival of the last received frame, for the receive time-out */
+    int64_t rx_last_ns;
+    bool rx_timeout_armed;
+
+    /* "fast-timing": frames complete as soon as they are written */
+    bool fast_timing;
+
+    QEMUTimer *tx_timer;
+    QEMUTimer *rx_timeout;
+    qemu_irq irq;
+    qemu_irq fss;
+    qemu_irq dma_req[2];
+    qemu_irq dma_sreq[2];
+    SSIBus *bus;
+    Clock *clk;
+    TM4C123SysCtlState *sysctl;
+};
+
+#endif
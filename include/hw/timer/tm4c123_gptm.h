@@ -34,23 +34,6 @@
 #include "hw/irq.h"
 #include "qom/object.h"
 
-#define TIMER_WIDTH_32 0x32B
-#define TIMER_WIDTH_64 0x64B
-
-#define TIMER0_32 0x40030000
-#define TIMER1_32 0x40031000
-#define TIMER2_32 0x40032000
-#define TIMER3_32 0x40033000
-#define TIMER4_32 0x40034000
-#define TIMER5_32 0x40035000
-
-#define TIMER0_64 0x40036000
-#define TIMER1_64 0x40037000
-#define TIMER2_64 0x4003C000
-#define TIMER3_64 0x4003D000
-#define TIMER4_64 0x4003E000
-#define TIMER5_64 0x4003F000
-
 #define GPTM_CFG 0x000
 #define GPTM_AMR 0x004
 #define GPTM_BMR 0x008
@@ -79,11 +62,60 @@
 #define GPTM_TBPV 0x068
 #define GPTM_PP 0xFC0
 
+#define GPTM_CFG_32_64 0x0
+#define GPTM_CFG_RTC 0x1
+#define GPTM_CFG_SPLIT 0x4
+
+/* GPTMTnMR, identical for both halves */
+#define GPTM_TNMR_MODE_MASK 0x3
+#define GPTM_TNMR_ONESHOT 0x1
+#define GPTM_TNMR_PERIODIC 0x2
+#define GPTM_TNMR_CAPTURE 0x3
+#define GPTM_TNMR_CMR (1 << 2)
+#define GPTM_TNMR_AMS (1 << 3)
+#define GPTM_TNMR_CDIR (1 << 4)
+#define GPTM_TNMR_MIE (1 << 5)
+#define GPTM_TNMR_SNAPS (1 << 7)
+#define GPTM_TNMR_ILD (1 << 8)
+#define GPTM_TNMR_PWMIE (1 << 9)
+#define GPTM_TNMR_CINTD (1 << 12)
+
 #define GPTM_TACTL_EN (1 << 0)
 #define GPTM_TBCTL_EN (1 << 8)
-#define GPTM_TAM_CD   (1 << 4)
-#define GPTM_TAM_MODE_ONESHOT (1 << 1)
-#define GPTM_TAM_PERIODIC (1 << 2)
+
+/* GPTMIMR, GPTMRIS and GPTMMIS */
+#define GPTM_INT_TATO (1 << 0)
+#define GPTM_INT_CAM (1 << 1)
+#define GPTM_INT_CAE (1 << 2)
+#define GPTM_INT_RTC (1 << 3)
+#define GPTM_INT_TAM (1 << 4)
+#define GPTM_INT_TBTO (1 << 8)
+#define GPTM_INT_CBM (1 << 9)
+#define GPTM_INT_CBE (1 << 10)
+#define GPTM_INT_TBM (1 << 11)
+#define GPTM_INT_A_MASK 0x0001001F
+#define GPTM_INT_B_MASK 0x00000F00
+
+/* Indices of the two halves in the per-channel arrays */
+#define GPTM_A 0
+#define GPTM_B 1
+
+/* Timers whose counters GPTMSYNC of timer 0 can reload, two bits each */
+#define GPTM_SYNC_TIMERS 12
+
+/* count[] value meaning "start from the reload value" */
+#define GPTM_COUNT_RELOAD UINT64_MAX
+
+typedef enum {
+    GPTM_MODE_OFF,
+    GPTM_MODE_ONESHOT,
+    GPTM_MODE_PERIODIC,
+    GPTM_MODE_RTC,
+    GPTM_MODE_EDGE_COUNT,
+    GPTM_MODE_EDGE_TIME,
+    GPTM_MODE_PWM,
+    GPTM_MODE_COUNT,
+} TM4C123GPTMMode;
 
 #define TYPE_TM4C123_GPTM "tm4c123-gptm"
 
@@ -94,7 +126,16 @@ struct TM4C123GPTMState {
     MemoryRegion mmio;
     qemu_irq irq_a;
     qemu_irq irq_b;
+    qemu_irq ccp_out[2];
+    /* uDMA request of each half, pulsed on a time-out */
+    qemu_irq dma_req[2];
+    /* ADC trigger, pulsed on a time-out of a half with TnOTE set */
+    qemu_irq adc_trigger;
     TM4C123SysCtlState *sysctl;
+    /* "wide" property: a 32/64-bit wide timer rather than a 16/32-bit one */
+    bool wide;
+    /* Only set on timer 0, which owns GPTMSYNC */
+    TM4C123GPTMState *sync_peer[GPTM_SYNC_TIMERS];
 
     uint32_t gptm_cfg;
     uint32_t gptm_amr;
@@ -123,8 +164,25 @@ struct TM4C123GPTMState {
     uint32_t gptm_tapv;
     uint32_t gptm_tbpv;
     uint32_t gptm_pp;
-    QEMUTimer *a;
-    QEMUTimer *b;
+
+    /*
+     * Mode each half was enabled in. A running half counts with the time
+     * base below: its period of load[] + 1 ticks began at start_ns[] and
+     * has elapsed periods[] times since. Counter reads and deadlines are
+     * derived from this with integer clock maths. A stopped half (and an
+     * edge counter) keeps its counter in count[].
+     */
+    uint8_t mode[2];
+    bool up[2];
+    int64_t start_ns[2];
+    uint64_t load[2];
+    uint64_t periods[2];
+    uint32_t prescale[2];
+    uint64_t count[2];
+    bool ccp_level[2];
+
+    QEMUTimer *timer[2];
+    QEMUTimer *match[2];
     Clock* clk;
 };
 
@@ -67,6 +67,8 @@ struct TM4C123WatchdogState {
     SysBusDevice parent_obj;
     MemoryRegion mmio;
     qemu_irq irq;
+    /* Pulsed when the second time-out resets the chip */
+    qemu_irq reset;
     struct ptimer_state *timer;
     TM4C123SysCtlState* sysctl;
 
@@ -90,6 +92,7 @@ struct TM4C123WatchdogState {
     uint32_t wdt_pcell_id1;
     uint32_t wdt_pcell_id2;
     uint32_t wdt_pcell_id3;
+    bool locked;
 
     Clock* wdt_clock;
 };
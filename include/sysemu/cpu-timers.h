@@ -82,6 +82,9 @@ int64_t cpu_get_ticks(void);
  */
 int64_t cpu_get_clock(void);
 
+/* Skip QEMU_CLOCK_VIRTUAL ahead by @delta ns. Caller must hold BQL */
+void cpu_clock_advance(int64_t delta);
+
 void qemu_timer_notify_cb(void *opaque, QEMUClockType type);
 
 /* get the VIRTUAL clock and VM elapsed ticks via the cpus accel interface */
@@ -1,6 +1,7 @@
 #ifndef QEMU_CPUS_H
 #define QEMU_CPUS_H
 
+#include "qemu/notify.h"
 #include "sysemu/accel-ops.h"
 
 /* register accel-specific operations */
@@ -30,8 +31,20 @@ void cpu_thread_signal_created(CPUState *cpu);
 void cpu_thread_signal_destroyed(CPUState *cpu);
 void cpu_handle_guest_debug(CPUState *cpu);
 
+void cpus_notify_idle(CPUState *cpu, bool idle);
+
 /* end interface for cpus accelerator threads */
 
+/* Passed to cpu idle notifiers when a vCPU halts or resumes */
+typedef struct CPUIdleEvent {
+    CPUState *cpu;
+    bool idle;
+} CPUIdleEvent;
+
+void qemu_add_cpu_idle_notifier(Notifier *notifier);
+/* Jump the virtual clock to the next timer whenever all vCPUs are halted */
+void cpus_set_idle_skip(bool enable);
+
 bool qemu_in_vcpu_thread(void);
 void qemu_init_cpu_loop(void);
 void resume_all_vcpus(void);
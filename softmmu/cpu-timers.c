@@ -36,6 +36,7 @@
 #include "hw/core/cpu.h"
 #include "sysemu/cpu-timers.h"
 #include "sysemu/cpu-throttle.h"
+#include "sysemu/qtest.h"
 #include "timers-state.h"
 
 /* clock and ticks */
@@ -135,6 +136,31 @@ void cpu_disable_ticks(void)
                          &timers_state.vm_clock_lock);
 }
 
+/*
+ * Move QEMU_CLOCK_VIRTUAL forward by @delta ns at once, as if the guest
+ * had been idle that long.  Boards use this to skip a sleep they know
+ * nothing but a timer can end.  Under qtest the test owns the clock and
+ * under record/replay the log does, so neither is touched.
+ * Caller must hold BQL which serves as mutex for vm_clock_seqlock.
+ */
+void cpu_clock_advance(int64_t delta)
+{
+    if (delta <= 0 || qtest_enabled() || replay_mode != REPLAY_MODE_NONE) {
+        return;
+    }
+    seqlock_write_lock(&timers_state.vm_clock_seqlock,
+                       &timers_state.vm_clock_lock);
+    if (icount_enabled()) {
+        qatomic_set_i64(&timers_state.qemu_icount_bias,
+                        timers_state.qemu_icount_bias + delta);
+    } else {
+        timers_state.cpu_clock_offset += delta;
+    }
+    seqlock_write_unlock(&timers_state.vm_clock_seqlock,
+                         &timers_state.vm_clock_lock);
+    qemu_clock_notify(QEMU_CLOCK_VIRTUAL);
+}
+
 static bool icount_state_needed(void *opaque)
 {
     return icount_enabled();
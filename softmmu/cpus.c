@@ -111,6 +111,73 @@ bool all_cpu_threads_idle(void)
     return true;
 }
 
+static NotifierList cpu_idle_notifiers =
+    NOTIFIER_LIST_INITIALIZER(cpu_idle_notifiers);
+static bool idle_skip;
+static Notifier idle_skip_notifier;
+
+void qemu_add_cpu_idle_notifier(Notifier *notifier)
+{
+    notifier_list_add(&cpu_idle_notifiers, notifier);
+}
+
+/*
+ * @cpu halted to wait for an interrupt, or runs again.  Boards listen to
+ * switch to their sleep clocks; with idle skipping on, the main loop is
+ * woken so that it can look for a timer to skip ahead to.  Reporting
+ * the state @cpu is already in does nothing.
+ * Caller must hold BQL.
+ */
+void cpus_notify_idle(CPUState *cpu, bool idle)
+{
+    CPUIdleEvent event = { .cpu = cpu, .idle = idle };
+
+    if (cpu->idle == idle) {
+        return;
+    }
+    cpu->idle = idle;
+    notifier_list_notify(&cpu_idle_notifiers, &event);
+    if (idle && idle_skip) {
+        qemu_notify_event();
+    }
+}
+
+/*
+ * Just before the main loop sleeps: with every vCPU waiting for an
+ * interrupt, nothing can happen in the guest before the next
+ * QEMU_CLOCK_VIRTUAL timer, so move the clock there and let the main
+ * loop run the timer at once instead of waiting for it in real time.
+ */
+static void cpus_idle_skip(Notifier *notifier, void *data)
+{
+    MainLoopPoll *mlpoll = data;
+    int64_t deadline;
+
+    if (mlpoll->state != MAIN_LOOP_POLL_FILL || !runstate_is_running() ||
+        !all_cpu_threads_idle()) {
+        return;
+    }
+    deadline = qemu_clock_deadline_ns_all(QEMU_CLOCK_VIRTUAL,
+                                          QEMU_TIMER_ATTR_ALL);
+    if (deadline > 0) {
+        cpu_clock_advance(deadline);
+    }
+}
+
+void cpus_set_idle_skip(bool enable)
+{
+    if (enable == idle_skip) {
+        return;
+    }
+    idle_skip = enable;
+    if (enable) {
+        idle_skip_notifier.notify = cpus_idle_skip;
+        main_loop_poll_add_notifier(&idle_skip_notifier);
+    } else {
+        main_loop_poll_remove_notifier(&idle_skip_notifier);
+    }
+}
+
 /***********************************************************/
 void hw_error(const char *fmt, ...)
 {
@@ -415,14 +482,22 @@ void qemu_wait_io_event_common(CPUState *cpu)
 void qemu_wait_io_event(CPUState *cpu)
 {
     bool slept = false;
+    bool halted = false;
 
     while (cpu_thread_is_idle(cpu)) {
         if (!slept) {
             slept = true;
             qemu_plugin_vcpu_idle_cb(cpu);
+            if (cpu->halted) {
+                halted = true;
+                cpus_notify_idle(cpu, true);
+            }
         }
         qemu_cond_wait(cpu->halt_cond, &qemu_global_mutex);
     }
+    if (halted) {
+        cpus_notify_idle(cpu, false);
+    }
     if (slept) {
         qemu_plugin_vcpu_resume_cb(cpu);
     }
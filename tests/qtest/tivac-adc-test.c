@@ -0,0 +1,293 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) ADCs
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "libqtest-single.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_RCGCTIMER 0x604
+#define SYSCTL_RCGCADC 0x638
+
+#define ADC_0_BASE 0x40038000
+#define ADC_ACTSS 0x000
+#define ADC_RIS 0x004
+#define ADC_IM 0x008
+#define ADC_ISC 0x00C
+#define ADC_OSTAT 0x010
+#define ADC_EMUX 0x014
+#define ADC_USTAT 0x018
+#define ADC_PSSI 0x028
+#define ADC_SAC 0x030
+#define ADC_DCISC 0x034
+#define ADC_DCCTL0 0xE00
+#define ADC_DCCMP0 0xE40
+
+#define ADC_SS(n) (0x040 + (n) * 0x20)
+#define ADC_SSMUX 0x0
+#define ADC_SSCTL 0x4
+#define ADC_SSFIFO 0x8
+#define ADC_SSFSTAT 0xC
+#define ADC_SSOP 0x10
+
+#define SSCTL_END 0x2
+#define SSCTL_IE 0x4
+#define SSCTL_TS 0x8
+#define SSFSTAT_EMPTY (1 << 8)
+#define SSFSTAT_FULL (1 << 12)
+
+#define GPTM_0_BASE 0x40030000
+#define GPTM_CFG 0x000
+#define GPTM_AMR 0x004
+#define GPTM_CTL 0x00C
+#define GPTM_TAILR 0x028
+
+/* Constant level on AIN3, and a ramp of 1 µs samples on AIN1 */
+#define AIN3_LEVEL 0x5A5
+#define RAMP_SAMPLES 2048
+
+/* One conversion at the reset rate of 1 Msps */
+#define CONV_NS 1000
+#define TICK_NS 62.5
+#define TICKS_NS(n) ((int64_t)((n) * TICK_NS))
+
+static uint32_t adc_readl(uint64_t reg)
+{
+    return readl(ADC_0_BASE + reg);
+}
+
+static void adc_writel(uint64_t reg, uint32_t val)
+{
+    writel(ADC_0_BASE + reg, val);
+}
+
+/* Disable every sequencer and clear what the last test left behind */
+static void adc_setup(void)
+{
+    int n;
+
+    writel(SYSCTL_BASE + SYSCTL_RCGCADC, 0x1);
+    adc_writel(ADC_ACTSS, 0);
+    adc_writel(ADC_EMUX, 0);
+    adc_writel(ADC_IM, 0);
+    adc_writel(ADC_SAC, 0);
+    for (n = 0; n < 4; n++) {
+        while (!(adc_readl(ADC_SS(n) + ADC_SSFSTAT) & SSFSTAT_EMPTY)) {
+            adc_readl(ADC_SS(n) + ADC_SSFIFO);
+        }
+        adc_writel(ADC_SS(n) + ADC_SSOP, 0);
+    }
+    adc_writel(ADC_ISC, 0xF);
+    adc_writel(ADC_OSTAT, 0xF);
+    adc_writel(ADC_USTAT, 0xF);
+    adc_writel(ADC_DCISC, 0xFF);
+}
+
+static void test_processor_trigger(void)
+{
+    adc_setup();
+    adc_writel(ADC_SS(3) + ADC_SSMUX, 3);
+    adc_writel(ADC_SS(3) + ADC_SSCTL, SSCTL_END | SSCTL_IE);
+    adc_writel(ADC_ACTSS, 1 << 3);
+
+    adc_writel(ADC_PSSI, 1 << 3);
+    g_assert_cmphex(adc_readl(ADC_RIS) & 0xF, ==, 0);
+    g_assert_cmphex(adc_readl(ADC_ACTSS) & (1 << 16), ==, 1 << 16);
+
+    clock_step(CONV_NS);
+    g_assert_cmphex(adc_readl(ADC_RIS) & 0xF, ==, 1 << 3);
+    g_assert_cmphex(adc_readl(ADC_ACTSS) & (1 << 16), ==, 0);
+    g_assert_cmphex(adc_readl(ADC_SS(3) + ADC_SSFSTAT) & SSFSTAT_FULL, ==, SSFSTAT_FULL);
+    g_assert_cmphex(adc_readl(ADC_SS(3) + ADC_SSFIFO), ==, AIN3_LEVEL);
+    g_assert_cmphex(adc_readl(ADC_SS(3) + ADC_SSFSTAT) & SSFSTAT_EMPTY, ==, SSFSTAT_EMPTY);
+
+    /* Masked off, the raw status does not reach ISC */
+    g_assert_cmphex(adc_readl(ADC_ISC), ==, 0);
+    adc_writel(ADC_ISC, 1 << 3);
+    g_assert_cmphex(adc_readl(ADC_RIS) & 0xF, ==, 0);
+}
+
+static void test_fifo_status(void)
+{
+    int i;
+
+    adc_setup();
+    /* SS1 holds four samples; each sequence converts two */
+    adc_writel(ADC_SS(1) + ADC_SSMUX, 0x33);
+    adc_writel(ADC_SS(1) + ADC_SSCTL, (SSCTL_END | SSCTL_IE) << 4);
+    adc_writel(ADC_ACTSS, 1 << 1);
+
+    for (i = 0; i < 3; i++) {
+        adc_writel(ADC_PSSI, 1 << 1);
+        clock_step(2 * CONV_NS);
+    }
+    g_assert_cmphex(adc_readl(ADC_OSTAT), ==, 1 << 1);
+    g_assert_cmphex(adc_readl(ADC_SS(1) + ADC_SSFSTAT), ==, SSFSTAT_FULL);
+
+    for (i = 0; i < 4; i++) {
+        g_assert_cmphex(adc_readl(ADC_SS(1) + ADC_SSFIFO), ==, AIN3_LEVEL);
+    }
+    g_assert_cmphex(adc_readl(ADC_USTAT), ==, 0);
+    adc_readl(ADC_SS(1) + ADC_SSFIFO);
+    g_assert_cmphex(adc_readl(ADC_USTAT), ==, 1 << 1);
+}
+
+static void test_temperature(void)
+{
+    adc_setup();
+    adc_writel(ADC_SS(3) + ADC_SSCTL, SSCTL_TS | SSCTL_END | SSCTL_IE);
+    adc_writel(ADC_ACTSS, 1 << 3);
+    adc_writel(ADC_PSSI, 1 << 3);
+    clock_step(CONV_NS);
+
+    /* 25 degrees: (147.5 - 25) * 4096 / (75 * 3.3) */
+    g_assert_cmphex(adc_readl(ADC_SS(3) + ADC_SSFIFO), ==, 2027);
+}
+
+static void test_ain_file(void)
+{
+    int64_t now;
+    uint32_t idx;
+
+    adc_setup();
+    adc_writel(ADC_SS(3) + ADC_SSMUX, 1);
+    adc_writel(ADC_SS(3) + ADC_SSCTL, SSCTL_END | SSCTL_IE);
+    adc_writel(ADC_ACTSS, 1 << 3);
+
+    /* The sample under the current time */
+    now = clock_step(1);
+    g_assert_cmpint(now, <, (RAMP_SAMPLES - 8) * CONV_NS);
+    idx = now / CONV_NS;
+    adc_writel(ADC_PSSI, 1 << 3);
+    clock_step(CONV_NS);
+    g_assert_cmphex(adc_readl(ADC_SS(3) + ADC_SSFIFO), ==, idx);
+
+    /* x4 averaging takes the next three samples too */
+    adc_writel(ADC_SAC, 2);
+    now = clock_step(1);
+    idx = now / CONV_NS;
+    adc_writel(ADC_PSSI, 1 << 3);
+    clock_step(4 * CONV_NS);
+    g_assert_cmphex(adc_readl(ADC_SS(3) + ADC_SSFIFO), ==, idx + 1);
+    adc_writel(ADC_SAC, 0);
+
+    /* Past the end of the file the last sample holds */
+    clock_step(RAMP_SAMPLES * CONV_NS);
+    adc_writel(ADC_PSSI, 1 << 3);
+    clock_step(CONV_NS);
+    g_assert_cmphex(adc_readl(ADC_SS(3) + ADC_SSFIFO), ==, RAMP_SAMPLES - 1);
+}
+
+static void test_comparator(void)
+{
+    adc_setup();
+    /* AIN3 in the high band of comparator 0 */
+    adc_writel(ADC_DCCMP0, (0x400 << 16) | 0x100);
+    adc_writel(ADC_DCCTL0, (1 << 4) | (2 << 2));
+    adc_writel(ADC_SS(2) + ADC_SSMUX, 3);
+    adc_writel(ADC_SS(2) + ADC_SSCTL, SSCTL_END);
+    adc_writel(ADC_SS(2) + ADC_SSOP, 1);
+    adc_writel(ADC_IM, 1 << 18);
+    adc_writel(ADC_ACTSS, 1 << 2);
+
+    adc_writel(ADC_PSSI, 1 << 2);
+    clock_step(CONV_NS);
+    g_assert_cmphex(adc_readl(ADC_DCISC), ==, 1);
+    g_assert_cmphex(adc_readl(ADC_RIS), ==, 1 << 16);
+    g_assert_cmphex(adc_readl(ADC_ISC), ==, 1 << 18);
+    g_assert_cmphex(adc_readl(ADC_SS(2) + ADC_SSFSTAT) & SSFSTAT_EMPTY, ==, SSFSTAT_EMPTY);
+
+    adc_writel(ADC_DCISC, 1);
+    g_assert_cmphex(adc_readl(ADC_RIS), ==, 0);
+    g_assert_cmphex(adc_readl(ADC_ISC), ==, 0);
+    adc_writel(ADC_DCCTL0, 0);
+}
+
+static void test_timer_trigger(void)
+{
+    adc_setup();
+    adc_writel(ADC_SS(3) + ADC_SSMUX, 3);
+    adc_writel(ADC_SS(3) + ADC_SSCTL, SSCTL_END | SSCTL_IE);
+    adc_writel(ADC_EMUX, 0x5 << 12);
+    adc_writel(ADC_ACTSS, 1 << 3);
+
+    /* Timer 0A time-outs, with the ADC trigger enabled, every 1000 ticks */
+    writel(SYSCTL_BASE + SYSCTL_RCGCTIMER, 0x01);
+    writel(GPTM_0_BASE + GPTM_CTL, 0);
+    writel(GPTM_0_BASE + GPTM_CFG, 0);
+    writel(GPTM_0_BASE + GPTM_AMR, 0x2);
+    writel(GPTM_0_BASE + GPTM_TAILR, 999);
+    writel(GPTM_0_BASE + GPTM_CTL, (1 << 5) | 1);
+
+    clock_step(TICKS_NS(500));
+    g_assert_cmphex(adc_readl(ADC_RIS), ==, 0);
+    clock_step(TICKS_NS(1000));
+    g_assert_cmphex(adc_readl(ADC_RIS), ==, 1 << 3);
+    g_assert_cmphex(adc_readl(ADC_SS(3) + ADC_SSFIFO), ==, AIN3_LEVEL);
+    adc_writel(ADC_ISC, 1 << 3);
+
+    /* Without TAOTE the time-outs leave the ADC alone */
+    writel(GPTM_0_BASE + GPTM_CTL, 1);
+    clock_step(TICKS_NS(1000));
+    g_assert_cmphex(adc_readl(ADC_RIS), ==, 0);
+    writel(GPTM_0_BASE + GPTM_CTL, 0);
+}
+
+int main(int argc, char **argv)
+{
+    g_autofree char *ramp_path = NULL;
+    g_autofree char *args = NULL;
+    uint16_t ramp[RAMP_SAMPLES];
+    int ret;
+    int fd;
+    int i;
+
+    g_test_init(&argc, &argv, NULL);
+
+    for (i = 0; i < RAMP_SAMPLES; i++) {
+        ramp[i] = cpu_to_le16(i);
+    }
+    fd = g_file_open_tmp("tivac-adc-ramp-XXXXXX", &ramp_path, NULL);
+    g_assert(fd >= 0);
+    g_assert(write(fd, ramp, sizeof(ramp)) == sizeof(ramp));
+    close(fd);
+
+    qtest_add_func("/tivac/adc/ain-file", test_ain_file);
+    qtest_add_func("/tivac/adc/processor-trigger", test_processor_trigger);
+    qtest_add_func("/tivac/adc/fifo-status", test_fifo_status);
+    qtest_add_func("/tivac/adc/temperature", test_temperature);
+    qtest_add_func("/tivac/adc/comparator", test_comparator);
+    qtest_add_func("/tivac/adc/timer-trigger", test_timer_trigger);
+
+    args = g_strdup_printf("-machine tivac "
+                           "-global tm4c123-adc.ain3=%d "
+                           "-global tm4c123-adc.ain1-file=%s",
+                           AIN3_LEVEL, ramp_path);
+    qtest_start(args);
+    ret = g_test_run();
+    qtest_end();
+    unlink(ramp_path);
+
+    return ret;
+}
@@ -0,0 +1,161 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) bit-band aliases
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+#define SRAM_BASE 0x20000000
+#define SRAM_ALIAS 0x22000000
+#define PERIPH_BASE 0x40000000
+#define PERIPH_ALIAS 0x42000000
+
+#define SYSCTL_RCGCGPIO 0x400FE608
+#define GPIO_F_DIR 0x40025400
+
+/* Board N's bus is mapped at N << 32 */
+#define BOARD(n) ((uint64_t)(n) << 32)
+
+/* The alias word of bit @bit of the byte at @addr */
+#define SRAM_BIT(addr, bit) (SRAM_ALIAS + ((addr) - SRAM_BASE) * 32 + (bit) * 4)
+#define PERIPH_BIT(addr, bit) (PERIPH_ALIAS + ((addr) - PERIPH_BASE) * 32 + (bit) * 4)
+
+#define WORD (SRAM_BASE + 0x100)
+
+/* Bits set and cleared through the alias land in SRAM */
+static void test_sram_write(void)
+{
+    QTestState *qts = qtest_init("-machine tivac");
+    int i;
+
+    qtest_writel(qts, WORD, 0);
+    qtest_writel(qts, SRAM_BIT(WORD, 3), 1);
+    qtest_writel(qts, SRAM_BIT(WORD + 2, 7), 0xFFFFFFFF);
+    g_assert_cmphex(qtest_readl(qts, WORD), ==, 0x00800008);
+
+    /* Only bit 0 of the value counts */
+    qtest_writel(qts, SRAM_BIT(WORD, 3), 2);
+    g_assert_cmphex(qtest_readl(qts, WORD), ==, 0x00800000);
+
+    qtest_writel(qts, WORD, 0xFFFFFFFF);
+    for (i = 0; i < 32; i += 2) {
+        qtest_writel(qts, SRAM_BIT(WORD, i), 0);
+    }
+    g_assert_cmphex(qtest_readl(qts, WORD), ==, 0xAAAAAAAA);
+
+    qtest_quit(qts);
+}
+
+/* Stores to SRAM show through the alias, one bit per word */
+static void test_sram_read(void)
+{
+    QTestState *qts = qtest_init("-machine tivac");
+    uint32_t val = 0xA5C3F00F;
+    int i;
+
+    qtest_writel(qts, WORD, val);
+    for (i = 0; i < 32; i++) {
+        g_assert_cmphex(qtest_readl(qts, SRAM_BIT(WORD, i)), ==, (val >> i) & 1);
+    }
+
+    qtest_writeb(qts, WORD + 1, 0x01);
+    g_assert_cmphex(qtest_readl(qts, SRAM_BIT(WORD, 8)), ==, 1);
+    g_assert_cmphex(qtest_readl(qts, SRAM_BIT(WORD, 12)), ==, 0);
+
+    qtest_quit(qts);
+}
+
+/* Byte and halfword alias accesses reach the same bit as word ones */
+static void test_sram_sizes(void)
+{
+    QTestState *qts = qtest_init("-machine tivac");
+
+    qtest_writel(qts, WORD, 0);
+    qtest_writeb(qts, SRAM_BIT(WORD, 1), 1);
+    qtest_writew(qts, SRAM_BIT(WORD + 1, 1), 1);
+    qtest_writel(qts, SRAM_BIT(WORD + 3, 6), 1);
+    g_assert_cmphex(qtest_readl(qts, WORD), ==, 0x40000202);
+
+    g_assert_cmphex(qtest_readb(qts, SRAM_BIT(WORD, 1)), ==, 1);
+    g_assert_cmphex(qtest_readw(qts, SRAM_BIT(WORD + 1, 1)), ==, 1);
+    g_assert_cmphex(qtest_readl(qts, SRAM_BIT(WORD + 3, 6)), ==, 1);
+    g_assert_cmphex(qtest_readb(qts, SRAM_BIT(WORD + 3, 5)), ==, 0);
+    g_assert_cmphex(qtest_readw(qts, SRAM_BIT(WORD + 2, 0)), ==, 0);
+
+    qtest_writew(qts, SRAM_BIT(WORD + 1, 1), 0);
+    qtest_writeb(qts, SRAM_BIT(WORD + 3, 6), 0);
+    g_assert_cmphex(qtest_readl(qts, WORD), ==, 0x00000002);
+
+    qtest_quit(qts);
+}
+
+/* The peripheral alias reaches the registers, so the device sees the store */
+static void test_periph(void)
+{
+    QTestState *qts = qtest_init("-machine tivac");
+
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_RCGCGPIO), ==, 0);
+    qtest_writel(qts, PERIPH_BIT(SYSCTL_RCGCGPIO, 5), 1);
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_RCGCGPIO), ==, 0x20);
+    g_assert_cmphex(qtest_readl(qts, PERIPH_BIT(SYSCTL_RCGCGPIO, 5)), ==, 1);
+
+    /* Port F now has its clock, so its registers take stores */
+    qtest_writel(qts, PERIPH_BIT(GPIO_F_DIR, 2), 1);
+    g_assert_cmphex(qtest_readl(qts, GPIO_F_DIR), ==, 0x04);
+
+    qtest_writel(qts, PERIPH_BIT(SYSCTL_RCGCGPIO, 5), 0);
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_RCGCGPIO), ==, 0);
+
+    qtest_quit(qts);
+}
+
+/* Each board's alias is backed by that board's own SRAM */
+static void test_boards(void)
+{
+    QTestState *qts = qtest_init("-machine tivac -smp 2");
+
+    qtest_writel(qts, BOARD(0) + WORD, 0);
+    qtest_writel(qts, BOARD(1) + WORD, 0);
+    qtest_writel(qts, BOARD(1) + SRAM_BIT(WORD, 4), 1);
+    g_assert_cmphex(qtest_readl(qts, BOARD(0) + WORD), ==, 0);
+    g_assert_cmphex(qtest_readl(qts, BOARD(1) + WORD), ==, 0x10);
+
+    qtest_writel(qts, BOARD(0) + WORD, 0x80000000);
+    g_assert_cmphex(qtest_readl(qts, BOARD(0) + SRAM_BIT(WORD, 31)), ==, 1);
+    g_assert_cmphex(qtest_readl(qts, BOARD(1) + SRAM_BIT(WORD, 31)), ==, 0);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/bitband/sram-write", test_sram_write);
+    qtest_add_func("/tivac/bitband/sram-read", test_sram_read);
+    qtest_add_func("/tivac/bitband/sram-sizes", test_sram_sizes);
+    qtest_add_func("/tivac/bitband/periph", test_periph);
+    qtest_add_func("/tivac/bitband/boards", test_boards);
+
+    return g_test_run();
+}
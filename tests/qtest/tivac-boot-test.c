@@ -0,0 +1,232 @@
+/*
+ * QTest testcase and startup benchmark for TM4C123 (tivac) flash images
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "libqtest.h"
+#include "elf.h"
+
+#define FLASH_CTRL_BASE 0x400FD000
+#define FMA 0x000
+#define FMD 0x004
+#define FMC 0x008
+#define FMC_WRITE 0xA4420001
+#define PROGRAM_NS 50000
+
+#define FLASH_SIZE (256 * 1024)
+
+/* Word n of every test image holds n ^ SEED */
+#define SEED 0x5A5A0000
+
+/* How many machines each startup benchmark starts */
+#define STARTUP_RUNS 50
+
+typedef struct {
+    uint32_t addr;
+    uint32_t len;
+    uint32_t offset;
+} ImageSegment;
+
+static void fill(uint8_t *buf, uint32_t addr, uint32_t len)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i += 4) {
+        stl_le_p(buf + i, ((addr + i) / 4) ^ SEED);
+    }
+}
+
+static char *write_raw(uint32_t len)
+{
+    g_autofree uint8_t *buf = g_malloc(len);
+    char *path;
+    int fd;
+
+    fd = g_file_open_tmp("tivac-raw-XXXXXX", &path, NULL);
+    g_assert(fd >= 0);
+    fill(buf, 0, len);
+    g_assert_cmpint(write(fd, buf, len), ==, len);
+    close(fd);
+    return path;
+}
+
+/* An ELF whose PT_LOAD segments hold the test pattern at their addresses */
+static char *write_elf(const ImageSegment *segs, int nsegs)
+{
+    Elf32_Ehdr ehdr = {
+        .e_ident = { ELFMAG0, ELFMAG1, ELFMAG2, ELFMAG3,
+                     ELFCLASS32, ELFDATA2LSB, EV_CURRENT },
+        .e_type = cpu_to_le16(ET_EXEC),
+        .e_machine = cpu_to_le16(EM_ARM),
+        .e_version = cpu_to_le32(EV_CURRENT),
+        .e_phoff = cpu_to_le32(sizeof(Elf32_Ehdr)),
+        .e_ehsize = cpu_to_le16(sizeof(Elf32_Ehdr)),
+        .e_phentsize = cpu_to_le16(sizeof(Elf32_Phdr)),
+        .e_phnum = cpu_to_le16(nsegs),
+    };
+    char *path;
+    int fd, i;
+
+    fd = g_file_open_tmp("tivac-elf-XXXXXX", &path, NULL);
+    g_assert(fd >= 0);
+    g_assert_cmpint(pwrite(fd, &ehdr, sizeof(ehdr), 0), ==, sizeof(ehdr));
+    for (i = 0; i < nsegs; i++) {
+        Elf32_Phdr phdr = {
+            .p_type = cpu_to_le32(PT_LOAD),
+            .p_offset = cpu_to_le32(segs[i].offset),
+            .p_vaddr = cpu_to_le32(segs[i].addr),
+            .p_paddr = cpu_to_le32(segs[i].addr),
+            .p_filesz = cpu_to_le32(segs[i].len),
+            .p_memsz = cpu_to_le32(segs[i].len),
+            .p_flags = cpu_to_le32(PF_R | PF_X),
+            .p_align = cpu_to_le32(4),
+        };
+        g_autofree uint8_t *buf = g_malloc(segs[i].len);
+
+        g_assert_cmpint(pwrite(fd, &phdr, sizeof(phdr),
+                               sizeof(ehdr) + i * sizeof(phdr)), ==, sizeof(phdr));
+        fill(buf, segs[i].addr, segs[i].len);
+        g_assert_cmpint(pwrite(fd, buf, segs[i].len, segs[i].offset), ==, segs[i].len);
+    }
+    close(fd);
+    return path;
+}
+
+static QTestState *boot_image(const char *path)
+{
+    return qtest_initf("-machine tivac,flash-image=%s", path);
+}
+
+static void assert_pattern(QTestState *qts, uint32_t addr)
+{
+    g_assert_cmphex(qtest_readl(qts, addr), ==, (addr / 4) ^ SEED);
+}
+
+static void assert_erased(QTestState *qts, uint32_t addr)
+{
+    g_assert_cmphex(qtest_readl(qts, addr), ==, 0xFFFFFFFF);
+}
+
+/* A raw image fills the flash from address 0; the rest reads as erased */
+static void test_raw(void)
+{
+    g_autofree char *path = write_raw(6000);
+    QTestState *qts = boot_image(path);
+
+    assert_pattern(qts, 0);
+    assert_pattern(qts, 4096);
+    assert_pattern(qts, 5996);
+    assert_erased(qts, 6000);
+    assert_erased(qts, FLASH_SIZE - 4);
+
+    qtest_quit(qts);
+    unlink(path);
+}
+
+/* One page-aligned segment gets mapped, one unaligned one gets copied */
+static void test_elf(void)
+{
+    static const ImageSegment segs[] = {
+        { 0x0000, 0x2100, 0x1000 },
+        { 0x3010, 0x0100, 0x3500 },
+    };
+    g_autofree char *path = write_elf(segs, ARRAY_SIZE(segs));
+    QTestState *qts = boot_image(path);
+
+    assert_pattern(qts, 0);
+    assert_pattern(qts, 0x1FFC);
+    assert_pattern(qts, 0x20FC);
+    assert_erased(qts, 0x2100);
+    assert_erased(qts, 0x300C);
+    assert_pattern(qts, 0x3010);
+    assert_pattern(qts, 0x310C);
+    assert_erased(qts, 0x3110);
+
+    qtest_quit(qts);
+    unlink(path);
+}
+
+/* Programmed words last until reset, which maps the image afresh */
+static void test_reset(void)
+{
+    g_autofree char *path = write_raw(8192);
+    QTestState *qts = boot_image(path);
+
+    qtest_writel(qts, FLASH_CTRL_BASE + FMA, 0x1000);
+    qtest_writel(qts, FLASH_CTRL_BASE + FMD, 0);
+    qtest_writel(qts, FLASH_CTRL_BASE + FMC, FMC_WRITE);
+    qtest_clock_step(qts, PROGRAM_NS);
+    g_assert_cmphex(qtest_readl(qts, 0x1000), ==, 0);
+    assert_pattern(qts, 0x1004);
+
+    qtest_qmp_assert_success(qts, "{'execute': 'system_reset'}");
+    qtest_qmp_eventwait(qts, "RESET");
+    assert_pattern(qts, 0x1000);
+    assert_pattern(qts, 0x1004);
+
+    qtest_quit(qts);
+    unlink(path);
+}
+
+static void startup(const char *what, const char *args)
+{
+    double elapsed;
+    int i;
+
+    g_test_timer_start();
+    for (i = 0; i < STARTUP_RUNS; i++) {
+        QTestState *qts = qtest_init(args);
+
+        qtest_readl(qts, 0);
+        qtest_quit(qts);
+    }
+    elapsed = g_test_timer_elapsed();
+    g_test_message("%s: %.2f ms per start", what, elapsed * 1000 / STARTUP_RUNS);
+}
+
+/* Start the same full-size ELF with -kernel and as a mapped flash image */
+static void perf_startup(void)
+{
+    static const ImageSegment seg = { 0, FLASH_SIZE, 0x10000 };
+    g_autofree char *path = write_elf(&seg, 1);
+    g_autofree char *kernel = g_strdup_printf("-machine tivac -kernel %s", path);
+    g_autofree char *image = g_strdup_printf("-machine tivac,flash-image=%s", path);
+
+    startup("-kernel", kernel);
+    startup("flash-image", image);
+    unlink(path);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/boot/raw", test_raw);
+    qtest_add_func("/tivac/boot/elf", test_elf);
+    qtest_add_func("/tivac/boot/reset", test_reset);
+    if (g_test_perf()) {
+        qtest_add_func("/tivac/boot/perf/startup", perf_startup);
+    }
+
+    return g_test_run();
+}
@@ -0,0 +1,232 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) CAN controllers
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest-single.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_RCGCCAN 0x634
+
+#define CAN_0_BASE 0x40040000
+#define CAN_1_BASE 0x40041000
+#define CAN_CTL 0x000
+#define CAN_STS 0x004
+#define CAN_INT 0x010
+#define CAN_TST 0x014
+#define CAN_IF1 0x020
+#define CAN_IF2 0x080
+#define CAN_NWDA1 0x120
+#define CAN_MSG1INT 0x140
+#define CAN_MSG1VAL 0x160
+
+#define IF_CRQ 0x00
+#define IF_CMSK 0x04
+#define IF_MSK1 0x08
+#define IF_MSK2 0x0C
+#define IF_ARB1 0x10
+#define IF_ARB2 0x14
+#define IF_MCTL 0x18
+#define IF_DA1 0x1C
+#define IF_DA2 0x20
+
+#define CTL_INIT 0x01
+#define CTL_IE 0x02
+#define CTL_TEST 0x80
+#define TST_LBACK 0x10
+#define STS_TXOK 0x08
+#define STS_RXOK 0x10
+
+#define CMSK_DATAB 0x01
+#define CMSK_DATAA 0x02
+#define CMSK_NEWDAT 0x04
+#define CMSK_CLRINTPND 0x08
+#define CMSK_CONTROL 0x10
+#define CMSK_ARB 0x20
+#define CMSK_MASK 0x40
+#define CMSK_WRNRD 0x80
+#define CMSK_ALL (CMSK_DATAB | CMSK_DATAA | CMSK_CONTROL | CMSK_ARB | CMSK_MASK)
+
+#define ARB2_MSGVAL 0x8000
+#define ARB2_XTD 0x4000
+#define ARB2_DIR 0x2000
+#define ARB2_STD(id) ((id) << 2)
+
+#define MCTL_NEWDAT 0x8000
+#define MCTL_UMASK 0x1000
+#define MCTL_TXIE 0x0800
+#define MCTL_RXIE 0x0400
+#define MCTL_RMTEN 0x0200
+#define MCTL_TXRQST 0x0100
+#define MCTL_EOB 0x0080
+
+typedef struct {
+    uint16_t msk1, msk2, arb1, arb2, mctl, da1, da2;
+} CANObject;
+
+static void can_write_object(QTestState *qts, uint64_t base, int num, CANObject o)
+{
+    qtest_writel(qts, base + CAN_IF1 + IF_CMSK, CMSK_WRNRD | CMSK_ALL);
+    qtest_writel(qts, base + CAN_IF1 + IF_MSK1, o.msk1);
+    qtest_writel(qts, base + CAN_IF1 + IF_MSK2, o.msk2);
+    qtest_writel(qts, base + CAN_IF1 + IF_ARB1, o.arb1);
+    qtest_writel(qts, base + CAN_IF1 + IF_ARB2, o.arb2);
+    qtest_writel(qts, base + CAN_IF1 + IF_MCTL, o.mctl);
+    qtest_writel(qts, base + CAN_IF1 + IF_DA1, o.da1);
+    qtest_writel(qts, base + CAN_IF1 + IF_DA2, o.da2);
+    qtest_writel(qts, base + CAN_IF1 + IF_CRQ, num);
+}
+
+/* Read an object through IF2, acknowledging its data and interrupt */
+static CANObject can_read_object(QTestState *qts, uint64_t base, int num)
+{
+    CANObject o;
+
+    qtest_writel(qts, base + CAN_IF2 + IF_CMSK, CMSK_ALL | CMSK_NEWDAT | CMSK_CLRINTPND);
+    qtest_writel(qts, base + CAN_IF2 + IF_CRQ, num);
+    o.msk1 = qtest_readl(qts, base + CAN_IF2 + IF_MSK1);
+    o.msk2 = qtest_readl(qts, base + CAN_IF2 + IF_MSK2);
+    o.arb1 = qtest_readl(qts, base + CAN_IF2 + IF_ARB1);
+    o.arb2 = qtest_readl(qts, base + CAN_IF2 + IF_ARB2);
+    o.mctl = qtest_readl(qts, base + CAN_IF2 + IF_MCTL);
+    o.da1 = qtest_readl(qts, base + CAN_IF2 + IF_DA1);
+    o.da2 = qtest_readl(qts, base + CAN_IF2 + IF_DA2);
+    return o;
+}
+
+/*
+ * Loopback on CAN0 without a bus: object 1 sends 0x123, object 2 takes
+ * anything in 0x120-0x12F through its mask.
+ */
+static void test_loopback(void)
+{
+    QTestState *qts = global_qtest;
+    CANObject o;
+
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCCAN, 0x1);
+    qtest_writel(qts, CAN_0_BASE + CAN_CTL, CTL_INIT | CTL_TEST);
+    qtest_writel(qts, CAN_0_BASE + CAN_TST, TST_LBACK);
+
+    can_write_object(qts, CAN_0_BASE, 1, (CANObject) {
+        .arb2 = ARB2_MSGVAL | ARB2_DIR | ARB2_STD(0x123),
+        .mctl = MCTL_TXIE | MCTL_TXRQST | MCTL_EOB | 4,
+        .da1 = 0x2211, .da2 = 0x4433,
+    });
+    can_write_object(qts, CAN_0_BASE, 2, (CANObject) {
+        .msk2 = ARB2_STD(0x7F0),
+        .arb2 = ARB2_MSGVAL | ARB2_STD(0x120),
+        .mctl = MCTL_UMASK | MCTL_RXIE | MCTL_EOB | 8,
+    });
+    g_assert_cmphex(qtest_readl(qts, CAN_0_BASE + CAN_MSG1VAL), ==, 0x3);
+    g_assert_cmphex(qtest_readl(qts, CAN_0_BASE + CAN_NWDA1), ==, 0);
+
+    /* Nothing goes out during initialization */
+    qtest_writel(qts, CAN_0_BASE + CAN_CTL, CTL_TEST | CTL_IE);
+    g_assert_cmphex(qtest_readl(qts, CAN_0_BASE + CAN_NWDA1), ==, 0x2);
+    g_assert_cmphex(qtest_readl(qts, CAN_0_BASE + CAN_MSG1INT), ==, 0x3);
+    g_assert_cmpuint(qtest_readl(qts, CAN_0_BASE + CAN_INT), ==, 1);
+    g_assert_cmphex(qtest_readl(qts, CAN_0_BASE + CAN_STS) & 0x18, ==,
+                    STS_TXOK | STS_RXOK);
+
+    o = can_read_object(qts, CAN_0_BASE, 2);
+    g_assert_cmphex(o.arb2, ==, ARB2_MSGVAL | ARB2_STD(0x123));
+    g_assert_cmphex(o.mctl & (MCTL_NEWDAT | 0xF), ==, MCTL_NEWDAT | 4);
+    g_assert_cmphex(o.da1, ==, 0x2211);
+    g_assert_cmphex(o.da2, ==, 0x4433);
+    g_assert_cmphex(qtest_readl(qts, CAN_0_BASE + CAN_NWDA1), ==, 0);
+    g_assert_cmphex(qtest_readl(qts, CAN_0_BASE + CAN_MSG1INT), ==, 0x1);
+
+    qtest_writel(qts, CAN_0_BASE + CAN_CTL, CTL_INIT);
+}
+
+/*
+ * CAN0 and CAN1 on one bus. CAN1 accepts extended 0x1ABCDE in object 5
+ * only, and answers remote frames for 0x55 from object 7.
+ */
+static void test_bus(void)
+{
+    QTestState *qts;
+    CANObject o;
+
+    qts = qtest_init("-object can-bus,id=canbus "
+                     "-machine tivac,canbus0=canbus,canbus1=canbus");
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCCAN, 0x3);
+    qtest_writel(qts, CAN_1_BASE + CAN_CTL, CTL_INIT);
+
+    can_write_object(qts, CAN_1_BASE, 3, (CANObject) {
+        .arb1 = 0xCDEF, .arb2 = ARB2_MSGVAL | ARB2_XTD | 0x1A,
+        .mctl = MCTL_EOB | 8,
+    });
+    can_write_object(qts, CAN_1_BASE, 5, (CANObject) {
+        .arb1 = 0xBCDE, .arb2 = ARB2_MSGVAL | ARB2_XTD | 0x1A,
+        .mctl = MCTL_EOB | 8,
+    });
+    can_write_object(qts, CAN_1_BASE, 7, (CANObject) {
+        .arb2 = ARB2_MSGVAL | ARB2_DIR | ARB2_STD(0x55),
+        .mctl = MCTL_RMTEN | MCTL_EOB | 2,
+        .da1 = 0xBEEF,
+    });
+    qtest_writel(qts, CAN_1_BASE + CAN_CTL, 0);
+
+    qtest_writel(qts, CAN_0_BASE + CAN_CTL, CTL_INIT);
+    can_write_object(qts, CAN_0_BASE, 1, (CANObject) {
+        .arb1 = 0xBCDE, .arb2 = ARB2_MSGVAL | ARB2_DIR | ARB2_XTD | 0x1A,
+        .mctl = MCTL_TXRQST | MCTL_EOB | 3,
+        .da1 = 0x0201, .da2 = 0x0003,
+    });
+    /* A receive object with TXRQST sends a remote frame */
+    can_write_object(qts, CAN_0_BASE, 2, (CANObject) {
+        .arb2 = ARB2_MSGVAL | ARB2_STD(0x55),
+        .mctl = MCTL_TXRQST | MCTL_EOB | 2,
+    });
+    qtest_writel(qts, CAN_0_BASE + CAN_CTL, 0);
+
+    g_assert_cmphex(qtest_readl(qts, CAN_1_BASE + CAN_NWDA1), ==, 1 << 4);
+    o = can_read_object(qts, CAN_1_BASE, 5);
+    g_assert_cmphex(o.mctl & 0xF, ==, 3);
+    g_assert_cmphex(o.da1, ==, 0x0201);
+    g_assert_cmphex(o.da2, ==, 0x0003);
+
+    g_assert_cmphex(qtest_readl(qts, CAN_0_BASE + CAN_NWDA1), ==, 1 << 1);
+    o = can_read_object(qts, CAN_0_BASE, 2);
+    g_assert_cmphex(o.mctl & (MCTL_NEWDAT | 0xF), ==, MCTL_NEWDAT | 2);
+    g_assert_cmphex(o.da1, ==, 0xBEEF);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/can/loopback", test_loopback);
+    qtest_add_func("/tivac/can/bus", test_bus);
+
+    qtest_start("-machine tivac");
+    ret = g_test_run();
+    qtest_end();
+
+    return ret;
+}
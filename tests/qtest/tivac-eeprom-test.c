@@ -0,0 +1,193 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) EEPROM
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "libqtest-single.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_RCGCEEPROM 0x658
+
+#define EEPROM_BASE 0x400AF000
+#define EESIZE 0x000
+#define EEBLOCK 0x004
+#define EEOFFSET 0x008
+#define EERDWR 0x010
+#define EERDWRINC 0x014
+#define EEDONE 0x018
+#define EEUNLOCK 0x020
+#define EEPROT 0x030
+#define EEPASS0 0x034
+#define EEDBGME 0x080
+
+#define EEDONE_WORKING 0x01
+#define EEDONE_NOPERM 0x10
+
+#define PROGRAM_NS 110000
+#define ERASE_NS 8000000
+
+#define IMAGE_SIZE (2048 + 512)
+
+static uint32_t eeprom_readl(QTestState *qts, uint64_t reg)
+{
+    return qtest_readl(qts, EEPROM_BASE + reg);
+}
+
+static void eeprom_writel(QTestState *qts, uint64_t reg, uint32_t val)
+{
+    qtest_writel(qts, EEPROM_BASE + reg, val);
+}
+
+/* Program through @reg and wait for the word program to finish */
+static void eeprom_program(QTestState *qts, uint64_t reg, uint32_t val)
+{
+    eeprom_writel(qts, reg, val);
+    g_assert_cmphex(eeprom_readl(qts, EEDONE), ==, EEDONE_WORKING);
+    qtest_clock_step(qts, PROGRAM_NS);
+    g_assert_cmphex(eeprom_readl(qts, EEDONE), ==, 0);
+}
+
+static void test_read_write(void)
+{
+    QTestState *qts = global_qtest;
+
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCEEPROM, 0x1);
+    g_assert_cmphex(eeprom_readl(qts, EESIZE), ==, 0x00200200);
+
+    /* Erased words read as ones */
+    eeprom_writel(qts, EEBLOCK, 2);
+    eeprom_writel(qts, EEOFFSET, 14);
+    g_assert_cmphex(eeprom_readl(qts, EERDWR), ==, 0xFFFFFFFF);
+
+    /* The offset wraps within the block */
+    eeprom_program(qts, EERDWRINC, 0x11111111);
+    eeprom_program(qts, EERDWRINC, 0x22222222);
+    eeprom_program(qts, EERDWRINC, 0x33333333);
+    g_assert_cmpuint(eeprom_readl(qts, EEOFFSET), ==, 1);
+
+    eeprom_writel(qts, EEOFFSET, 14);
+    g_assert_cmphex(eeprom_readl(qts, EERDWRINC), ==, 0x11111111);
+    g_assert_cmphex(eeprom_readl(qts, EERDWRINC), ==, 0x22222222);
+    g_assert_cmphex(eeprom_readl(qts, EERDWRINC), ==, 0x33333333);
+    eeprom_writel(qts, EEBLOCK, 3);
+    eeprom_writel(qts, EEOFFSET, 0);
+    g_assert_cmphex(eeprom_readl(qts, EERDWR), ==, 0xFFFFFFFF);
+}
+
+static void test_protection(void)
+{
+    QTestState *qts = global_qtest;
+
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCEEPROM, 0x1);
+    eeprom_writel(qts, EEBLOCK, 5);
+    eeprom_program(qts, EEPASS0, 0x1234);
+    g_assert_cmpuint(eeprom_readl(qts, EEPASS0), ==, 1);
+    g_assert_cmpuint(eeprom_readl(qts, EEUNLOCK), ==, 1);
+    eeprom_program(qts, EERDWR, 0xA5A5A5A5);
+
+    /* Leaving the block locks it: still readable, not writable */
+    eeprom_writel(qts, EEBLOCK, 4);
+    eeprom_writel(qts, EEBLOCK, 5);
+    g_assert_cmpuint(eeprom_readl(qts, EEUNLOCK), ==, 0);
+    eeprom_writel(qts, EERDWR, 0);
+    g_assert_cmphex(eeprom_readl(qts, EEDONE), ==, EEDONE_NOPERM);
+    g_assert_cmphex(eeprom_readl(qts, EERDWR), ==, 0xA5A5A5A5);
+
+    eeprom_writel(qts, EEUNLOCK, 0x4321);
+    g_assert_cmpuint(eeprom_readl(qts, EEUNLOCK), ==, 0);
+    eeprom_writel(qts, EEUNLOCK, 0x1234);
+    g_assert_cmpuint(eeprom_readl(qts, EEUNLOCK), ==, 1);
+    eeprom_program(qts, EERDWR, 0x5A5A5A5A);
+
+    /* A mass erase clears the data and the password */
+    eeprom_writel(qts, EEDBGME, 0xE37B0001);
+    g_assert_cmphex(eeprom_readl(qts, EEDONE) & EEDONE_WORKING, ==, EEDONE_WORKING);
+    qtest_clock_step(qts, ERASE_NS);
+    g_assert_cmphex(eeprom_readl(qts, EEDONE), ==, 0);
+    g_assert_cmpuint(eeprom_readl(qts, EEPASS0), ==, 0);
+    g_assert_cmphex(eeprom_readl(qts, EERDWR), ==, 0xFFFFFFFF);
+}
+
+static QTestState *eeprom_start_with(const char *path)
+{
+    QTestState *qts;
+
+    qts = qtest_initf("-machine tivac -drive if=none,id=ee,format=raw,file=%s "
+                      "-global tm4c123-eeprom.drive=ee", path);
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCEEPROM, 0x1);
+    return qts;
+}
+
+/* Contents survive into the image and into the next run */
+static void test_persist(void)
+{
+    g_autofree char *path = NULL;
+    g_autofree char *image = g_malloc(IMAGE_SIZE);
+    g_autofree char *back = NULL;
+    QTestState *qts;
+    size_t len;
+    int fd;
+
+    fd = g_file_open_tmp("tivac-eeprom-XXXXXX", &path, NULL);
+    g_assert(fd >= 0);
+    memset(image, 0xFF, IMAGE_SIZE);
+    g_assert_cmpint(write(fd, image, IMAGE_SIZE), ==, IMAGE_SIZE);
+    close(fd);
+
+    qts = eeprom_start_with(path);
+    eeprom_writel(qts, EEBLOCK, 1);
+    eeprom_writel(qts, EEOFFSET, 5);
+    eeprom_program(qts, EERDWR, 0xCAFEF00D);
+    qtest_quit(qts);
+
+    g_assert(g_file_get_contents(path, &back, &len, NULL));
+    g_assert_cmpuint(len, ==, IMAGE_SIZE);
+    g_assert_cmphex(ldl_le_p(back + (16 + 5) * 4), ==, 0xCAFEF00D);
+    g_assert_cmphex(ldl_le_p(back + (16 + 6) * 4), ==, 0xFFFFFFFF);
+
+    qts = eeprom_start_with(path);
+    eeprom_writel(qts, EEBLOCK, 1);
+    eeprom_writel(qts, EEOFFSET, 5);
+    g_assert_cmphex(eeprom_readl(qts, EERDWR), ==, 0xCAFEF00D);
+    qtest_quit(qts);
+
+    unlink(path);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/eeprom/read-write", test_read_write);
+    qtest_add_func("/tivac/eeprom/protection", test_protection);
+    qtest_add_func("/tivac/eeprom/persist", test_persist);
+
+    qtest_start("-machine tivac");
+    ret = g_test_run();
+    qtest_end();
+
+    return ret;
+}
@@ -0,0 +1,246 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) flash memory controller
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "libqtest-single.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_FMPPE0 0x400
+
+#define FLASH_CTRL_BASE 0x400FD000
+#define FMA 0x000
+#define FMD 0x004
+#define FMC 0x008
+#define FCRIS 0x00C
+#define FCIM 0x010
+#define FCMISC 0x014
+#define FMC2 0x020
+#define FWBVAL 0x030
+#define FWB0 0x100
+#define FSIZE 0xFC0
+#define SSIZE 0xFC4
+
+#define FMC_WRITE 0xA4420001
+#define FMC_ERASE 0xA4420002
+#define FMC_COMT 0xA4420008
+#define FMC2_WRBUF 0xA4420001
+
+#define INT_ACCESS 0x0001
+#define INT_PROGRAM 0x0002
+#define INT_INVDATA 0x0400
+
+#define PROGRAM_NS 50000
+#define ERASE_NS 12000000
+
+#define FLASH_SIZE (256 * 1024)
+
+/* NVIC interrupt set-pending register for IRQs 0-31 */
+#define NVIC_ISPR0 0xE000E200
+#define FLASH_IRQ 29
+
+static uint32_t flash_readl(QTestState *qts, uint64_t reg)
+{
+    return qtest_readl(qts, FLASH_CTRL_BASE + reg);
+}
+
+static void flash_writel(QTestState *qts, uint64_t reg, uint32_t val)
+{
+    qtest_writel(qts, FLASH_CTRL_BASE + reg, val);
+}
+
+static void flash_reset(QTestState *qts)
+{
+    qtest_qmp_assert_success(qts, "{'execute': 'system_reset'}");
+    qtest_qmp_eventwait(qts, "RESET");
+}
+
+/* Program one word and wait for the controller to finish */
+static void flash_program(QTestState *qts, uint32_t addr, uint32_t val)
+{
+    flash_writel(qts, FMA, addr);
+    flash_writel(qts, FMD, val);
+    flash_writel(qts, FMC, FMC_WRITE);
+    g_assert_cmphex(flash_readl(qts, FMC), ==, FMC_WRITE & 0xFFFF);
+    qtest_clock_step(qts, PROGRAM_NS);
+    g_assert_cmphex(flash_readl(qts, FMC), ==, 0);
+}
+
+static void flash_erase(QTestState *qts, uint32_t addr)
+{
+    flash_writel(qts, FMA, addr);
+    flash_writel(qts, FMC, FMC_ERASE);
+    qtest_clock_step(qts, ERASE_NS);
+    g_assert_cmphex(flash_readl(qts, FMC), ==, 0);
+}
+
+static void test_program_erase(void)
+{
+    QTestState *qts = global_qtest;
+
+    g_assert_cmphex(flash_readl(qts, FSIZE), ==, 0x7F);
+    g_assert_cmphex(flash_readl(qts, SSIZE), ==, 0x7F);
+
+    /* Stores to the array itself change nothing */
+    g_assert_cmphex(qtest_readl(qts, 0x3F000), ==, 0xFFFFFFFF);
+    qtest_writel(qts, 0x3F000, 0);
+    g_assert_cmphex(qtest_readl(qts, 0x3F000), ==, 0xFFFFFFFF);
+
+    /* Completion is latched in FCRIS and reported through FCMISC */
+    flash_writel(qts, FCIM, INT_PROGRAM);
+    flash_program(qts, 0x3F004, 0x12345678);
+    g_assert_cmphex(qtest_readl(qts, 0x3F004), ==, 0x12345678);
+    g_assert_cmphex(flash_readl(qts, FCRIS), ==, INT_PROGRAM);
+    g_assert_cmphex(flash_readl(qts, FCMISC), ==, INT_PROGRAM);
+    g_assert_cmphex(qtest_readl(qts, NVIC_ISPR0) & (1u << FLASH_IRQ), ==, 1u << FLASH_IRQ);
+    flash_writel(qts, FCMISC, INT_PROGRAM);
+    g_assert_cmphex(flash_readl(qts, FCRIS), ==, 0);
+
+    /* Programming only clears bits */
+    flash_program(qts, 0x3F004, 0xFFFF0000);
+    g_assert_cmphex(qtest_readl(qts, 0x3F004), ==, 0x12340000);
+    g_assert_cmphex(flash_readl(qts, FCRIS), ==, INT_PROGRAM | INT_INVDATA);
+    flash_writel(qts, FCMISC, INT_PROGRAM | INT_INVDATA);
+
+    /* A key that does not match does nothing */
+    flash_writel(qts, FMA, 0x3F008);
+    flash_writel(qts, FMD, 0);
+    flash_writel(qts, FMC, 0x71D50001);
+    g_assert_cmphex(flash_readl(qts, FMC), ==, 0);
+    g_assert_cmphex(qtest_readl(qts, 0x3F008), ==, 0xFFFFFFFF);
+
+    /* An erase covers exactly one 1 KB page */
+    flash_program(qts, 0x3F400, 0);
+    flash_erase(qts, 0x3F010);
+    g_assert_cmphex(qtest_readl(qts, 0x3F004), ==, 0xFFFFFFFF);
+    g_assert_cmphex(qtest_readl(qts, 0x3F400), ==, 0);
+    flash_erase(qts, 0x3F400);
+    flash_writel(qts, FCMISC, INT_PROGRAM);
+    flash_writel(qts, FCIM, 0);
+}
+
+static void test_write_buffer(void)
+{
+    QTestState *qts = global_qtest;
+
+    flash_writel(qts, FMA, 0x3E000);
+    flash_writel(qts, FWB0 + 2 * 4, 0xAAAAAAAA);
+    flash_writel(qts, FWB0 + 31 * 4, 0xBBBBBBBB);
+    g_assert_cmphex(flash_readl(qts, FWBVAL), ==, 0x80000004);
+
+    flash_writel(qts, FMC2, FMC2_WRBUF);
+    g_assert_cmphex(flash_readl(qts, FMC2), ==, 1);
+    qtest_clock_step(qts, 2 * PROGRAM_NS);
+    g_assert_cmphex(flash_readl(qts, FMC2), ==, 0);
+    g_assert_cmphex(flash_readl(qts, FWBVAL), ==, 0);
+
+    g_assert_cmphex(qtest_readl(qts, 0x3E000), ==, 0xFFFFFFFF);
+    g_assert_cmphex(qtest_readl(qts, 0x3E008), ==, 0xAAAAAAAA);
+    g_assert_cmphex(qtest_readl(qts, 0x3E07C), ==, 0xBBBBBBBB);
+    flash_erase(qts, 0x3E000);
+    flash_writel(qts, FCMISC, INT_PROGRAM);
+}
+
+static void test_protection(void)
+{
+    QTestState *qts = global_qtest;
+
+    /* Clearing FMPPE0 bit 1 protects 0x800-0xFFF until reset */
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_FMPPE0, 0xFFFFFFFD);
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_BASE + SYSCTL_FMPPE0), ==, 0xFFFFFFFD);
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_FMPPE0, 0xFFFFFFFF);
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_BASE + SYSCTL_FMPPE0), ==, 0xFFFFFFFD);
+
+    flash_writel(qts, FMA, 0xC00);
+    flash_writel(qts, FMD, 0);
+    flash_writel(qts, FMC, FMC_WRITE);
+    g_assert_cmphex(flash_readl(qts, FCRIS) & INT_ACCESS, ==, INT_ACCESS);
+    qtest_clock_step(qts, PROGRAM_NS);
+    g_assert_cmphex(qtest_readl(qts, 0xC00), ==, 0xFFFFFFFF);
+    flash_writel(qts, FCMISC, 0xFFFF);
+
+    /* Without a commit the protection is gone after a reset */
+    flash_reset(qts);
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_BASE + SYSCTL_FMPPE0), ==, 0xFFFFFFFF);
+
+    /* With one it stays */
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_FMPPE0, 0xFFFFFFFD);
+    flash_writel(qts, FMA, 1);
+    flash_writel(qts, FMC, FMC_COMT);
+    qtest_clock_step(qts, PROGRAM_NS);
+    flash_reset(qts);
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_BASE + SYSCTL_FMPPE0), ==, 0xFFFFFFFD);
+}
+
+/* Programmed words reach the pflash image and come back on the next run */
+static void test_persist(void)
+{
+    g_autofree char *path = NULL;
+    g_autofree char *image = g_malloc(FLASH_SIZE);
+    g_autofree char *back = NULL;
+    QTestState *qts;
+    size_t len;
+    int fd;
+
+    fd = g_file_open_tmp("tivac-flash-XXXXXX", &path, NULL);
+    g_assert(fd >= 0);
+    memset(image, 0xFF, FLASH_SIZE);
+    stl_le_p(image + 0x20000, 0x600DF00D);
+    g_assert_cmpint(write(fd, image, FLASH_SIZE), ==, FLASH_SIZE);
+    close(fd);
+
+    qts = qtest_initf("-machine tivac -drive if=pflash,format=raw,file=%s", path);
+    g_assert_cmphex(qtest_readl(qts, 0x20000), ==, 0x600DF00D);
+    flash_program(qts, 0x20404, 0xCAFEF00D);
+    qtest_quit(qts);
+
+    g_assert(g_file_get_contents(path, &back, &len, NULL));
+    g_assert_cmpuint(len, ==, FLASH_SIZE);
+    g_assert_cmphex(ldl_le_p(back + 0x20000), ==, 0x600DF00D);
+    g_assert_cmphex(ldl_le_p(back + 0x20404), ==, 0xCAFEF00D);
+
+    qts = qtest_initf("-machine tivac -drive if=pflash,format=raw,file=%s", path);
+    g_assert_cmphex(qtest_readl(qts, 0x20404), ==, 0xCAFEF00D);
+    qtest_quit(qts);
+
+    unlink(path);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/flash/program-erase", test_program_erase);
+    qtest_add_func("/tivac/flash/write-buffer", test_write_buffer);
+    qtest_add_func("/tivac/flash/protection", test_protection);
+    qtest_add_func("/tivac/flash/persist", test_persist);
+
+    qtest_start("-machine tivac");
+    ret = g_test_run();
+    qtest_end();
+
+    return ret;
+}
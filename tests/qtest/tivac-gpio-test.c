@@ -0,0 +1,233 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) GPIO ports
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "qemu/osdep.h"
+#include "libqtest-single.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_GPIOHBCTL 0x06C
+#define SYSCTL_RCGCGPIO 0x608
+
+#define GPIO_F_BASE 0x40025000
+#define GPIO_F_AHB_BASE 0x4005D000
+#define GPIO_DATA 0x3FC
+#define GPIO_DIR 0x400
+#define GPIO_IS 0x404
+#define GPIO_IBE 0x408
+#define GPIO_IEV 0x40C
+#define GPIO_IM 0x410
+#define GPIO_RIS 0x414
+#define GPIO_MIS 0x418
+#define GPIO_ICR 0x41C
+#define GPIO_AFSEL 0x420
+#define GPIO_ODR 0x50C
+#define GPIO_PUR 0x510
+#define GPIO_PDR 0x514
+#define GPIO_DEN 0x51C
+
+/* Address of the GPIODATA alias that only covers the pins in @mask */
+#define GPIO_DATA_MASKED(base, mask) ((base) + ((mask) << 2))
+
+static void gpio_setup(void)
+{
+    writel(SYSCTL_BASE + SYSCTL_RCGCGPIO, 0x20);
+    writel(GPIO_F_BASE + GPIO_AFSEL, 0x00);
+    writel(GPIO_F_BASE + GPIO_DIR, 0xFF);
+    writel(GPIO_F_BASE + GPIO_DEN, 0xFF);
+    writel(GPIO_F_BASE + GPIO_ODR, 0x00);
+    writel(GPIO_F_BASE + GPIO_PDR, 0x00);
+    writel(GPIO_F_BASE + GPIO_PUR, 0x00);
+    writel(GPIO_F_BASE + GPIO_IM, 0x00);
+    writel(GPIO_F_BASE + GPIO_IS, 0x00);
+    writel(GPIO_F_BASE + GPIO_IBE, 0x00);
+    writel(GPIO_F_BASE + GPIO_IEV, 0x00);
+    writel(GPIO_F_BASE + GPIO_DATA, 0x00);
+    writel(GPIO_F_BASE + GPIO_ICR, 0xFF);
+}
+
+/* Writes through a masked alias only change the selected pins */
+static void test_masked_write(void)
+{
+    gpio_setup();
+
+    writel(GPIO_DATA_MASKED(GPIO_F_BASE, 0x02), 0xFF);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_DATA), ==, 0x02);
+
+    writel(GPIO_DATA_MASKED(GPIO_F_BASE, 0x0C), 0x04);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_DATA), ==, 0x06);
+
+    writel(GPIO_DATA_MASKED(GPIO_F_BASE, 0x02), 0x00);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_DATA), ==, 0x04);
+
+    /* The zero mask alias changes nothing */
+    writel(GPIO_F_BASE, 0xFF);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_DATA), ==, 0x04);
+}
+
+/* Reads through a masked alias return 0 for the other pins */
+static void test_masked_read(void)
+{
+    gpio_setup();
+
+    writel(GPIO_F_BASE + GPIO_DATA, 0xA5);
+    g_assert_cmphex(readl(GPIO_DATA_MASKED(GPIO_F_BASE, 0x0F)), ==, 0x05);
+    g_assert_cmphex(readl(GPIO_DATA_MASKED(GPIO_F_BASE, 0xF0)), ==, 0xA0);
+    g_assert_cmphex(readl(GPIO_DATA_MASKED(GPIO_F_BASE, 0x00)), ==, 0x00);
+}
+
+/* GPIODATA only drives digital outputs that are not given to a peripheral */
+static void test_write_mask(void)
+{
+    gpio_setup();
+
+    writel(GPIO_F_BASE + GPIO_DIR, 0x0F);
+    writel(GPIO_F_BASE + GPIO_AFSEL, 0x01);
+    writel(GPIO_F_BASE + GPIO_DATA, 0xFF);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_DATA), ==, 0x0E);
+}
+
+/* Undriven inputs and released open drain outputs follow the pulls */
+static void test_pulls(void)
+{
+    gpio_setup();
+
+    writel(GPIO_F_BASE + GPIO_DIR, 0x0F);
+    writel(GPIO_F_BASE + GPIO_ODR, 0x03);
+    writel(GPIO_F_BASE + GPIO_PUR, 0x31);
+    writel(GPIO_F_BASE + GPIO_DATA, 0x0F);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_DATA), ==, 0x3D);
+
+    /* Open drain outputs written 0 pull low */
+    writel(GPIO_F_BASE + GPIO_DATA, 0x0C);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_DATA), ==, 0x3C);
+
+    /* A pull-down replaces the pull-up */
+    writel(GPIO_F_BASE + GPIO_PDR, 0x10);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_PUR), ==, 0x21);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_DATA), ==, 0x2C);
+}
+
+/* Edge detection latches the selected edge until it is cleared */
+static void test_edge_irq(void)
+{
+    gpio_setup();
+
+    writel(GPIO_F_BASE + GPIO_IEV, 0x02);
+    writel(GPIO_F_BASE + GPIO_IBE, 0x04);
+    writel(GPIO_F_BASE + GPIO_IM, 0x06);
+
+    writel(GPIO_DATA_MASKED(GPIO_F_BASE, 0x06), 0x06);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_MIS), ==, 0x06);
+    writel(GPIO_F_BASE + GPIO_ICR, 0x06);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_RIS), ==, 0x00);
+
+    /* Pin 1 only wants rising edges, pin 2 wants both */
+    writel(GPIO_DATA_MASKED(GPIO_F_BASE, 0x06), 0x00);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_RIS), ==, 0x04);
+
+    /* Writing the same value again is not an edge */
+    writel(GPIO_F_BASE + GPIO_ICR, 0x04);
+    writel(GPIO_DATA_MASKED(GPIO_F_BASE, 0x06), 0x00);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_RIS), ==, 0x00);
+}
+
+/* Level detection follows the pad and cannot be cleared while active */
+static void test_level_irq(void)
+{
+    gpio_setup();
+
+    writel(GPIO_F_BASE + GPIO_IS, 0x08);
+    writel(GPIO_F_BASE + GPIO_IEV, 0x08);
+    writel(GPIO_F_BASE + GPIO_IM, 0x08);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_MIS), ==, 0x00);
+
+    writel(GPIO_DATA_MASKED(GPIO_F_BASE, 0x08), 0x08);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_MIS), ==, 0x08);
+    writel(GPIO_F_BASE + GPIO_ICR, 0x08);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_MIS), ==, 0x08);
+
+    writel(GPIO_DATA_MASKED(GPIO_F_BASE, 0x08), 0x00);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_MIS), ==, 0x00);
+}
+
+/* GPIOHBCTL moves a port to the AHB aperture, the APB one goes quiet */
+static void test_ahb_aperture(void)
+{
+    gpio_setup();
+
+    writel(GPIO_F_BASE + GPIO_DATA, 0x11);
+    writel(SYSCTL_BASE + SYSCTL_GPIOHBCTL, 0x20);
+    g_assert_cmphex(readl(GPIO_F_AHB_BASE + GPIO_DATA), ==, 0x11);
+    g_assert_cmphex(readl(GPIO_F_AHB_BASE + GPIO_DIR), ==, 0xFF);
+
+    writel(GPIO_DATA_MASKED(GPIO_F_AHB_BASE, 0x02), 0x02);
+    g_assert_cmphex(readl(GPIO_F_AHB_BASE + GPIO_DATA), ==, 0x13);
+
+    writel(GPIO_F_BASE + GPIO_DATA, 0x00);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_DATA), ==, 0x00);
+    g_assert_cmphex(readl(GPIO_F_AHB_BASE + GPIO_DATA), ==, 0x13);
+
+    writel(SYSCTL_BASE + SYSCTL_GPIOHBCTL, 0x00);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_DATA), ==, 0x13);
+    g_assert_cmphex(readl(GPIO_F_AHB_BASE + GPIO_DATA), ==, 0x00);
+}
+
+/* A gated port faults instead of stopping the machine, and keeps its state */
+static void test_clock_gate(void)
+{
+    gpio_setup();
+
+    writel(GPIO_F_BASE + GPIO_DATA, 0x05);
+    writel(SYSCTL_BASE + SYSCTL_RCGCGPIO, 0x00);
+    writel(GPIO_F_BASE + GPIO_DATA, 0xFA);
+    writel(GPIO_F_BASE + GPIO_DIR, 0x00);
+    readl(GPIO_F_BASE + GPIO_DATA);
+
+    writel(SYSCTL_BASE + SYSCTL_RCGCGPIO, 0x20);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_DIR), ==, 0xFF);
+    g_assert_cmphex(readl(GPIO_F_BASE + GPIO_DATA), ==, 0x05);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/gpio/masked-write", test_masked_write);
+    qtest_add_func("/tivac/gpio/masked-read", test_masked_read);
+    qtest_add_func("/tivac/gpio/write-mask", test_write_mask);
+    qtest_add_func("/tivac/gpio/pulls", test_pulls);
+    qtest_add_func("/tivac/gpio/edge-irq", test_edge_irq);
+    qtest_add_func("/tivac/gpio/level-irq", test_level_irq);
+    qtest_add_func("/tivac/gpio/ahb-aperture", test_ahb_aperture);
+    qtest_add_func("/tivac/gpio/clock-gate", test_clock_gate);
+
+    qtest_start("-machine tivac");
+    ret = g_test_run();
+    qtest_end();
+
+    return ret;
+}
@@ -0,0 +1,300 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) general purpose timers
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "qemu/osdep.h"
+#include "libqtest-single.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_RCC 0x060
+#define SYSCTL_RCC2 0x070
+#define SYSCTL_RCGCTIMER 0x604
+
+#define GPTM_0_BASE 0x40030000
+#define GPTM_1_BASE 0x40031000
+
+#define GPTM_CFG 0x000
+#define GPTM_AMR 0x004
+#define GPTM_BMR 0x008
+#define GPTM_CTL 0x00C
+#define GPTM_SYNC 0x010
+#define GPTM_IMR 0x018
+#define GPTM_RIS 0x01C
+#define GPTM_MIS 0x020
+#define GPTM_ICR 0x024
+#define GPTM_TAILR 0x028
+#define GPTM_TBILR 0x02C
+#define GPTM_TAMATCHR 0x030
+#define GPTM_TBMATCHR 0x034
+#define GPTM_TAPR 0x038
+#define GPTM_TAV 0x050
+
+#define INT_TATO (1 << 0)
+#define INT_RTC (1 << 3)
+#define INT_TAM (1 << 4)
+#define INT_CBE (1 << 10)
+
+/*
+ * RCC2 selecting the 400 MHz PLL output divided by 5, for an 80 MHz
+ * system clock
+ */
+#define RCC2_80MHZ 0xC1000000
+#define TICK_80MHZ_NS 12.5
+
+/* The reset RCC value runs the system clock from the 16 MHz PIOSC */
+#define TICK_NS 62.5
+#define TICKS_NS(n) ((int64_t)((n) * TICK_NS))
+#define SECOND_NS 1000000000LL
+
+static void gptm_setup(uint32_t base)
+{
+    writel(SYSCTL_BASE + SYSCTL_RCC, 0x078E3AD1);
+    writel(SYSCTL_BASE + SYSCTL_RCC2, 0x07C06810);
+    writel(SYSCTL_BASE + SYSCTL_RCGCTIMER, 0x3F);
+    writel(base + GPTM_CTL, 0);
+}
+
+/* A periodic timer keeps firing exactly on its period boundaries */
+static void test_periodic(void)
+{
+    gptm_setup(GPTM_0_BASE);
+    writel(GPTM_0_BASE + GPTM_CFG, 0x0);
+    writel(GPTM_0_BASE + GPTM_AMR, 0x2);
+    writel(GPTM_0_BASE + GPTM_TAILR, 15999);
+    writel(GPTM_0_BASE + GPTM_IMR, INT_TATO);
+    writel(GPTM_0_BASE + GPTM_CTL, 0x1);
+
+    clock_step(TICKS_NS(16000) - 1);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_RIS), ==, 0);
+    clock_step(1);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_MIS), ==, INT_TATO);
+    writel(GPTM_0_BASE + GPTM_ICR, INT_TATO);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_MIS), ==, 0);
+
+    /* One second later, in odd steps, the counter is back at the top */
+    clock_step(333333333);
+    clock_step(666666667 - TICKS_NS(16000));
+    g_assert_cmpuint(readl(GPTM_0_BASE + GPTM_TAV), ==, 15999);
+
+    writel(GPTM_0_BASE + GPTM_ICR, INT_TATO);
+    clock_step(TICKS_NS(16000) - 1);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_RIS), ==, 0);
+    clock_step(1);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_RIS), ==, INT_TATO);
+
+    writel(GPTM_0_BASE + GPTM_CTL, 0);
+}
+
+/* A one-shot timer stops at the time-out and clears its enable bit */
+static void test_oneshot(void)
+{
+    gptm_setup(GPTM_0_BASE);
+    writel(GPTM_0_BASE + GPTM_CFG, 0x0);
+    writel(GPTM_0_BASE + GPTM_AMR, 0x1);
+    writel(GPTM_0_BASE + GPTM_TAILR, 99);
+    writel(GPTM_0_BASE + GPTM_ICR, 0xFFFFFFFF);
+    writel(GPTM_0_BASE + GPTM_CTL, 0x1);
+
+    clock_step(TICKS_NS(50));
+    g_assert_cmpuint(readl(GPTM_0_BASE + GPTM_TAV), ==, 49);
+    clock_step(TICKS_NS(50));
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_RIS), ==, INT_TATO);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_CTL), ==, 0);
+    g_assert_cmpuint(readl(GPTM_0_BASE + GPTM_TAV), ==, 99);
+}
+
+/* The split halves divide by TnPR + 1, including the reset value of 0 */
+static void test_prescaler(void)
+{
+    gptm_setup(GPTM_0_BASE);
+    writel(GPTM_0_BASE + GPTM_CFG, 0x4);
+    writel(GPTM_0_BASE + GPTM_AMR, 0x2);
+    writel(GPTM_0_BASE + GPTM_TAPR, 0);
+    writel(GPTM_0_BASE + GPTM_TAILR, 0xFFFF);
+    writel(GPTM_0_BASE + GPTM_CTL, 0x1);
+
+    clock_step(TICKS_NS(16));
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_TAV), ==, 0xFFFF - 16);
+
+    writel(GPTM_0_BASE + GPTM_TAPR, 1);
+    clock_step(TICKS_NS(16));
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_TAV), ==, 0xFFFF - 24);
+
+    writel(GPTM_0_BASE + GPTM_CTL, 0);
+    writel(GPTM_0_BASE + GPTM_TAPR, 0);
+}
+
+/* The match interrupt fires when the count reaches TnMATCHR */
+static void test_match(void)
+{
+    gptm_setup(GPTM_0_BASE);
+    writel(GPTM_0_BASE + GPTM_CFG, 0x0);
+    writel(GPTM_0_BASE + GPTM_AMR, 0x22);
+    writel(GPTM_0_BASE + GPTM_TAILR, 999);
+    writel(GPTM_0_BASE + GPTM_TAMATCHR, 499);
+    writel(GPTM_0_BASE + GPTM_ICR, 0xFFFFFFFF);
+    writel(GPTM_0_BASE + GPTM_IMR, INT_TAM);
+    writel(GPTM_0_BASE + GPTM_CTL, 0x1);
+
+    clock_step(TICKS_NS(500) - 1);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_MIS), ==, 0);
+    clock_step(1);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_MIS), ==, INT_TAM);
+
+    /* ... and again in the next period */
+    writel(GPTM_0_BASE + GPTM_ICR, INT_TAM);
+    clock_step(TICKS_NS(1000));
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_MIS), ==, INT_TAM);
+
+    writel(GPTM_0_BASE + GPTM_CTL, 0);
+}
+
+/* PWM on timer B reports both output edges when asked to */
+static void test_pwm(void)
+{
+    gptm_setup(GPTM_0_BASE);
+    writel(GPTM_0_BASE + GPTM_CFG, 0x4);
+    writel(GPTM_0_BASE + GPTM_BMR, 0x20A);
+    writel(GPTM_0_BASE + GPTM_TBILR, 999);
+    writel(GPTM_0_BASE + GPTM_TBMATCHR, 250);
+    writel(GPTM_0_BASE + GPTM_ICR, 0xFFFFFFFF);
+    writel(GPTM_0_BASE + GPTM_IMR, INT_CBE);
+    writel(GPTM_0_BASE + GPTM_CTL, 0xC00 | 0x100);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_MIS), ==, 0);
+
+    /* Falling edge at the match */
+    clock_step(TICKS_NS(749));
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_MIS), ==, INT_CBE);
+    writel(GPTM_0_BASE + GPTM_ICR, INT_CBE);
+
+    /* Rising edge at the reload */
+    clock_step(TICKS_NS(1000) - TICKS_NS(749));
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_MIS), ==, INT_CBE);
+
+    writel(GPTM_0_BASE + GPTM_CTL, 0);
+}
+
+/* GPTMSYNC of timer 0 restarts several timers in lock-step */
+static void test_sync(void)
+{
+    gptm_setup(GPTM_0_BASE);
+    gptm_setup(GPTM_1_BASE);
+    writel(GPTM_0_BASE + GPTM_CFG, 0x0);
+    writel(GPTM_1_BASE + GPTM_CFG, 0x0);
+    writel(GPTM_0_BASE + GPTM_AMR, 0x2);
+    writel(GPTM_1_BASE + GPTM_AMR, 0x2);
+    writel(GPTM_0_BASE + GPTM_TAILR, 100000);
+    writel(GPTM_1_BASE + GPTM_TAILR, 100000);
+
+    writel(GPTM_0_BASE + GPTM_CTL, 0x1);
+    clock_step(TICKS_NS(123));
+    writel(GPTM_1_BASE + GPTM_CTL, 0x1);
+    clock_step(TICKS_NS(77));
+    g_assert_cmpuint(readl(GPTM_0_BASE + GPTM_TAV), !=,
+                     readl(GPTM_1_BASE + GPTM_TAV));
+
+    writel(GPTM_0_BASE + GPTM_SYNC, 0x5);
+    clock_step(TICKS_NS(10));
+    g_assert_cmpuint(readl(GPTM_0_BASE + GPTM_TAV), ==, 100000 - 10);
+    g_assert_cmpuint(readl(GPTM_1_BASE + GPTM_TAV), ==, 100000 - 10);
+
+    writel(GPTM_0_BASE + GPTM_CTL, 0);
+    writel(GPTM_1_BASE + GPTM_CTL, 0);
+}
+
+/* The RTC counts seconds up from the loaded value to the match */
+static void test_rtc(void)
+{
+    gptm_setup(GPTM_0_BASE);
+    writel(GPTM_0_BASE + GPTM_CFG, 0x1);
+    writel(GPTM_0_BASE + GPTM_TAILR, 10);
+    writel(GPTM_0_BASE + GPTM_TAMATCHR, 12);
+    writel(GPTM_0_BASE + GPTM_ICR, 0xFFFFFFFF);
+    writel(GPTM_0_BASE + GPTM_IMR, INT_RTC);
+    writel(GPTM_0_BASE + GPTM_CTL, 0x1);
+
+    clock_step(SECOND_NS);
+    g_assert_cmpuint(readl(GPTM_0_BASE + GPTM_TAV), ==, 11);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_MIS), ==, 0);
+    clock_step(SECOND_NS);
+    g_assert_cmpuint(readl(GPTM_0_BASE + GPTM_TAV), ==, 12);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_MIS), ==, INT_RTC);
+
+    writel(GPTM_0_BASE + GPTM_CTL, 0);
+    writel(GPTM_0_BASE + GPTM_IMR, 0);
+}
+
+/* A running timer carries on from its current count at the new clock rate */
+static void test_clock_change(void)
+{
+    gptm_setup(GPTM_0_BASE);
+    writel(GPTM_0_BASE + GPTM_CFG, 0x0);
+    writel(GPTM_0_BASE + GPTM_AMR, 0x2);
+    writel(GPTM_0_BASE + GPTM_TAILR, 15999);
+    writel(GPTM_0_BASE + GPTM_ICR, 0xFFFFFFFF);
+    writel(GPTM_0_BASE + GPTM_CTL, 0x1);
+
+    clock_step(TICKS_NS(8000));
+    writel(SYSCTL_BASE + SYSCTL_RCC2, RCC2_80MHZ);
+    g_assert_cmpuint(readl(GPTM_0_BASE + GPTM_TAV), ==, 7999);
+
+    clock_step((int64_t)(8000 * TICK_80MHZ_NS) - 1);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_RIS), ==, 0);
+    clock_step(1);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_RIS), ==, INT_TATO);
+    writel(GPTM_0_BASE + GPTM_ICR, INT_TATO);
+
+    /* Gating the module clock freezes the count until it comes back */
+    clock_step((int64_t)(4000 * TICK_80MHZ_NS));
+    writel(SYSCTL_BASE + SYSCTL_RCGCTIMER, 0x3E);
+    clock_step(SECOND_NS);
+    writel(SYSCTL_BASE + SYSCTL_RCGCTIMER, 0x3F);
+    g_assert_cmpuint(readl(GPTM_0_BASE + GPTM_TAV), ==, 11999);
+    g_assert_cmphex(readl(GPTM_0_BASE + GPTM_RIS), ==, 0);
+
+    writel(GPTM_0_BASE + GPTM_CTL, 0);
+    writel(SYSCTL_BASE + SYSCTL_RCC2, 0x07C06810);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/gptm/periodic", test_periodic);
+    qtest_add_func("/tivac/gptm/oneshot", test_oneshot);
+    qtest_add_func("/tivac/gptm/prescaler", test_prescaler);
+    qtest_add_func("/tivac/gptm/match", test_match);
+    qtest_add_func("/tivac/gptm/pwm", test_pwm);
+    qtest_add_func("/tivac/gptm/sync", test_sync);
+    qtest_add_func("/tivac/gptm/rtc", test_rtc);
+    qtest_add_func("/tivac/gptm/clock-change", test_clock_change);
+
+    qtest_start("-machine tivac");
+    ret = g_test_run();
+    qtest_end();
+
+    return ret;
+}
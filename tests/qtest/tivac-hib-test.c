@@ -0,0 +1,202 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) hibernation module
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest-single.h"
+
+#define HIB_BASE 0x400FC000
+#define HIBRTCC 0x000
+#define HIBRTCM0 0x004
+#define HIBRTCLD 0x00C
+#define HIBCTL 0x010
+#define HIBIM 0x014
+#define HIBRIS 0x018
+#define HIBMIS 0x01C
+#define HIBIC 0x020
+#define HIBRTCSS 0x028
+#define HIBDATA 0x030
+
+#define HIBCTL_RTCEN 0x001
+#define HIBCTL_HIBREQ 0x002
+#define HIBCTL_RTCWEN 0x008
+#define HIBCTL_PINWEN 0x010
+#define HIBCTL_CLK32EN 0x040
+#define HIBCTL_WRC 0x80000000
+
+#define HIB_RTCALT0 0x01
+#define HIB_EXTW 0x08
+#define HIB_WC 0x10
+
+/* NVIC interrupt set-pending register for IRQs 32-63 */
+#define NVIC_ISPR1 0xE000E204
+#define HIB_IRQ 43
+
+#define SECOND_NS 1000000000LL
+
+#define SYSCTL_RCGCGPIO 0x400FE608
+
+static uint32_t hib_readl(QTestState *qts, uint64_t reg)
+{
+    return qtest_readl(qts, HIB_BASE + reg);
+}
+
+static void hib_writel(QTestState *qts, uint64_t reg, uint32_t val)
+{
+    qtest_writel(qts, HIB_BASE + reg, val);
+}
+
+/*
+ * A wake-up resets the chip alone, with no RESET event, so mark the
+ * sysctl beforehand and wait for the reset to clear it.
+ */
+static void hib_wait_chip_reset(QTestState *qts)
+{
+    int i;
+
+    for (i = 0; i < 1000 && qtest_readl(qts, SYSCTL_RCGCGPIO); i++) {
+        g_usleep(1000);
+    }
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_RCGCGPIO), ==, 0);
+}
+
+static void hib_reset(QTestState *qts)
+{
+    qtest_qmp_assert_success(qts, "{'execute': 'system_reset'}");
+    qtest_qmp_eventwait(qts, "RESET");
+}
+
+static void test_rtc(void)
+{
+    QTestState *qts = global_qtest;
+
+    g_assert_cmphex(hib_readl(qts, HIBCTL), ==, HIBCTL_WRC | 0x2000);
+    hib_writel(qts, HIBCTL, HIBCTL_CLK32EN | HIBCTL_RTCEN);
+    hib_writel(qts, HIBRTCLD, 100);
+    g_assert_cmpuint(hib_readl(qts, HIBRTCC), ==, 100);
+
+    qtest_clock_step(qts, 2 * SECOND_NS + SECOND_NS / 2);
+    g_assert_cmpuint(hib_readl(qts, HIBRTCC), ==, 102);
+    g_assert_cmphex(hib_readl(qts, HIBRTCSS), ==, 0x4000);
+
+    /* Stopping the RTC freezes it */
+    hib_writel(qts, HIBCTL, HIBCTL_CLK32EN);
+    qtest_clock_step(qts, 10 * SECOND_NS);
+    g_assert_cmpuint(hib_readl(qts, HIBRTCC), ==, 102);
+    hib_writel(qts, HIBCTL, HIBCTL_CLK32EN | HIBCTL_RTCEN);
+
+    /* A match with its subsecond part */
+    hib_writel(qts, HIBIC, 0xFF);
+    hib_writel(qts, HIBIM, HIB_RTCALT0);
+    hib_writel(qts, HIBRTCM0, 103);
+    hib_writel(qts, HIBRTCSS, 0x2000 << 16);
+    qtest_clock_step_next(qts);
+    g_assert_cmpuint(hib_readl(qts, HIBRTCC), ==, 103);
+    g_assert_cmphex(hib_readl(qts, HIBRTCSS), ==, 0x20002000);
+    g_assert_cmphex(hib_readl(qts, HIBRIS) & HIB_RTCALT0, ==, HIB_RTCALT0);
+    g_assert_cmphex(hib_readl(qts, HIBMIS), ==, HIB_RTCALT0);
+    g_assert_cmphex(qtest_readl(qts, NVIC_ISPR1) & (1u << (HIB_IRQ - 32)), ==,
+                    1u << (HIB_IRQ - 32));
+
+    hib_writel(qts, HIBIC, 0xFF);
+    hib_writel(qts, HIBIM, 0);
+    g_assert_cmphex(hib_readl(qts, HIBMIS), ==, 0);
+}
+
+/* A system reset leaves the battery-backed domain alone */
+static void test_data(void)
+{
+    QTestState *qts = global_qtest;
+    int i;
+
+    for (i = 0; i < 16; i++) {
+        hib_writel(qts, HIBDATA + 4 * i, 0x1000 + i);
+    }
+    g_assert_cmphex(hib_readl(qts, HIBRIS) & HIB_WC, ==, HIB_WC);
+    hib_reset(qts);
+    for (i = 0; i < 16; i++) {
+        g_assert_cmphex(hib_readl(qts, HIBDATA + 4 * i), ==, 0x1000 + i);
+    }
+    g_assert_cmphex(hib_readl(qts, HIBCTL) & HIBCTL_RTCEN, ==, HIBCTL_RTCEN);
+}
+
+static void test_wake_rtc(void)
+{
+    QTestState *qts = global_qtest;
+    uint32_t now;
+
+    hib_writel(qts, HIBCTL, HIBCTL_CLK32EN | HIBCTL_RTCEN);
+    now = hib_readl(qts, HIBRTCC);
+    hib_writel(qts, HIBRTCM0, now + 8 * 3600);
+    hib_writel(qts, HIBRTCSS, 0);
+    hib_writel(qts, HIBIC, 0xFF);
+    hib_writel(qts, HIBDATA, 0xCAFE);
+    qtest_writel(qts, SYSCTL_RCGCGPIO, 0x1);
+    hib_writel(qts, HIBCTL, HIBCTL_CLK32EN | HIBCTL_RTCEN | HIBCTL_RTCWEN |
+                            HIBCTL_HIBREQ);
+    g_assert_cmphex(hib_readl(qts, HIBCTL) & HIBCTL_HIBREQ, ==, HIBCTL_HIBREQ);
+
+    /* Eight hours in one step, then the wake-up reset */
+    qtest_clock_step_next(qts);
+    hib_wait_chip_reset(qts);
+    g_assert_cmphex(hib_readl(qts, HIBCTL) & HIBCTL_HIBREQ, ==, 0);
+    g_assert_cmphex(hib_readl(qts, HIBRIS) & HIB_RTCALT0, ==, HIB_RTCALT0);
+    g_assert_cmpuint(hib_readl(qts, HIBRTCC), ==, now + 8 * 3600);
+    g_assert_cmphex(hib_readl(qts, HIBDATA), ==, 0xCAFE);
+}
+
+static void test_wake_pin(void)
+{
+    QTestState *qts = global_qtest;
+
+    hib_writel(qts, HIBIC, 0xFF);
+    qtest_writel(qts, SYSCTL_RCGCGPIO, 0x1);
+    hib_writel(qts, HIBCTL, HIBCTL_CLK32EN | HIBCTL_RTCEN | HIBCTL_PINWEN |
+                            HIBCTL_HIBREQ);
+    qtest_clock_step(qts, 60 * SECOND_NS);
+    g_assert_cmphex(hib_readl(qts, HIBCTL) & HIBCTL_HIBREQ, ==, HIBCTL_HIBREQ);
+
+    qtest_set_irq_in(qts, "/machine/soc", "wake", 0, 1);
+    hib_wait_chip_reset(qts);
+    qtest_set_irq_in(qts, "/machine/soc", "wake", 0, 0);
+    g_assert_cmphex(hib_readl(qts, HIBCTL) & HIBCTL_HIBREQ, ==, 0);
+    g_assert_cmphex(hib_readl(qts, HIBRIS) & HIB_EXTW, ==, HIB_EXTW);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/hib/rtc", test_rtc);
+    qtest_add_func("/tivac/hib/data", test_data);
+    qtest_add_func("/tivac/hib/wake-rtc", test_wake_rtc);
+    qtest_add_func("/tivac/hib/wake-pin", test_wake_pin);
+
+    qtest_start("-machine tivac");
+    ret = g_test_run();
+    qtest_end();
+
+    return ret;
+}
@@ -0,0 +1,156 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) I2C modules
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include "qemu/osdep.h"
+#include "libqtest-single.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_RCGCI2C 0x620
+
+#define I2C_0_BASE 0x40020000
+#define I2C_MSA 0x000
+#define I2C_MCS 0x004
+#define I2C_MDR 0x008
+#define I2C_MRIS 0x014
+#define I2C_MICR 0x01C
+#define I2C_MCR 0x020
+#define I2C_SOAR 0x800
+#define I2C_SCSR 0x804
+#define I2C_SDR 0x808
+#define I2C_SRIS 0x810
+#define I2C_SICR 0x818
+
+#define MCS_RUN (1 << 0)
+#define MCS_START (1 << 1)
+#define MCS_STOP (1 << 2)
+
+#define MCS_BUSY (1 << 0)
+#define MCS_ERROR (1 << 1)
+#define MCS_ADRACK (1 << 2)
+#define MCS_IDLE (1 << 5)
+#define MCS_BUSBSY (1 << 6)
+
+#define MCR_LPBK (1 << 0)
+#define MCR_MFE (1 << 4)
+#define MCR_SFE (1 << 5)
+
+#define SCSR_RREQ (1 << 0)
+#define SCSR_TREQ (1 << 1)
+#define SCSR_FBR (1 << 2)
+
+#define SINT_DATA (1 << 0)
+#define SINT_START (1 << 1)
+#define SINT_STOP (1 << 2)
+
+#define SLAVE_ADDR 0x3C
+
+/* MTPR 1 at 16 MHz: 40 clocks per SCL period */
+#define BIT_NS 2500
+
+static void i2c_setup(uint32_t mcr)
+{
+    writel(SYSCTL_BASE + SYSCTL_RCGCI2C, 0x1);
+    writel(I2C_0_BASE + I2C_MCR, mcr);
+    writel(I2C_0_BASE + I2C_MICR, 0x3);
+    writel(I2C_0_BASE + I2C_SICR, 0x7);
+    writel(I2C_0_BASE + I2C_SOAR, SLAVE_ADDR);
+    writel(I2C_0_BASE + I2C_SCSR, 1);
+}
+
+/* Nobody answers the address: the master reports it once the address is out */
+static void test_address_nack(void)
+{
+    i2c_setup(MCR_MFE);
+
+    writel(I2C_0_BASE + I2C_MSA, 0x50 << 1);
+    writel(I2C_0_BASE + I2C_MDR, 0x12);
+    writel(I2C_0_BASE + I2C_MCS, MCS_START | MCS_RUN | MCS_STOP);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_MCS) & MCS_BUSY, ==, MCS_BUSY);
+
+    clock_step(21 * BIT_NS);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_MCS), ==,
+                    MCS_IDLE | MCS_ADRACK | MCS_ERROR);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_MRIS), ==, 1);
+}
+
+/* In loopback the master writes to its own slave, which stretches the clock */
+static void test_loopback_write(void)
+{
+    i2c_setup(MCR_LPBK | MCR_MFE | MCR_SFE);
+
+    writel(I2C_0_BASE + I2C_MSA, SLAVE_ADDR << 1);
+    writel(I2C_0_BASE + I2C_MDR, 0xA5);
+    writel(I2C_0_BASE + I2C_MCS, MCS_START | MCS_RUN);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_SCSR), ==, SCSR_RREQ | SCSR_FBR);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_SRIS), ==, SINT_START | SINT_DATA);
+
+    /* Held until the slave side takes the byte */
+    clock_step(40 * BIT_NS);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_MCS) & MCS_BUSY, ==, MCS_BUSY);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_SDR), ==, 0xA5);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_MCS), ==, MCS_BUSBSY);
+
+    writel(I2C_0_BASE + I2C_MDR, 0x5A);
+    writel(I2C_0_BASE + I2C_MCS, MCS_RUN | MCS_STOP);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_SCSR), ==, SCSR_RREQ);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_SDR), ==, 0x5A);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_MCS) & MCS_BUSY, ==, MCS_BUSY);
+    clock_step(10 * BIT_NS);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_MCS), ==, MCS_IDLE);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_SRIS) & SINT_STOP, ==, SINT_STOP);
+}
+
+/* ... and reads back what the slave side puts in SDR */
+static void test_loopback_read(void)
+{
+    i2c_setup(MCR_LPBK | MCR_MFE | MCR_SFE);
+
+    writel(I2C_0_BASE + I2C_MSA, (SLAVE_ADDR << 1) | 1);
+    writel(I2C_0_BASE + I2C_MCS, MCS_START | MCS_RUN | MCS_STOP);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_SCSR), ==, SCSR_TREQ);
+
+    writel(I2C_0_BASE + I2C_SDR, 0x77);
+    clock_step(21 * BIT_NS);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_MCS), ==, MCS_IDLE);
+    g_assert_cmphex(readl(I2C_0_BASE + I2C_MDR), ==, 0x77);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/i2c/address-nack", test_address_nack);
+    qtest_add_func("/tivac/i2c/loopback-write", test_loopback_write);
+    qtest_add_func("/tivac/i2c/loopback-read", test_loopback_read);
+
+    qtest_start("-machine tivac");
+    ret = g_test_run();
+    qtest_end();
+
+    return ret;
+}
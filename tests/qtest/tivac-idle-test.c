@@ -0,0 +1,187 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) sleep modes and idle skipping
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+#define SRAM_BASE 0x20000000
+#define RESULT_DONE (SRAM_BASE + 0x0)
+#define RESULT_SLEEP (SRAM_BASE + 0x4)
+#define RESULT_DEEP_SLEEP (SRAM_BASE + 0x8)
+#define RESULT_LONG (SRAM_BASE + 0xC)
+
+#define RTC_HZ 32768
+#define SECOND_NS 1000000000ULL
+
+/*
+ * Starts the hibernation RTC and SysTick on the system clock, then sleeps
+ * in WFI for a number of SysTick periods at a time. The RTC ticks each
+ * run took go to SRAM:
+ *  RESULT_SLEEP:      100 periods of 16000 cycles at 16 MHz
+ *  RESULT_DEEP_SLEEP: the same with SLEEPDEEP set, where DSLPCLKCFG
+ *                     runs the system clock from PIOSC / 16, 1 MHz
+ *  RESULT_LONG:       20 periods of 2^24 cycles at 16 MHz
+ * then RESULT_DONE is set.
+ */
+static const uint8_t kernel_idle[] = {
+    0x00, 0x80, 0x00, 0x20,                 /* Stack top address */
+    0x41, 0x00, 0x00, 0x00,                 /* Reset handler address */
+    0x00, 0x00, 0x00, 0x00,                 /* NMI */
+    0x00, 0x00, 0x00, 0x00,                 /* Hard fault */
+    0x00, 0x00, 0x00, 0x00,                 /* Memory management fault */
+    0x00, 0x00, 0x00, 0x00,                 /* Bus fault */
+    0x00, 0x00, 0x00, 0x00,                 /* Usage fault */
+    0x00, 0x00, 0x00, 0x00,                 /* Reserved */
+    0x00, 0x00, 0x00, 0x00,                 /* Reserved */
+    0x00, 0x00, 0x00, 0x00,                 /* Reserved */
+    0x00, 0x00, 0x00, 0x00,                 /* Reserved */
+    0x00, 0x00, 0x00, 0x00,                 /* SVCall */
+    0x00, 0x00, 0x00, 0x00,                 /* Debug monitor */
+    0x00, 0x00, 0x00, 0x00,                 /* Reserved */
+    0x00, 0x00, 0x00, 0x00,                 /* PendSV */
+    0xc5, 0x00, 0x00, 0x00,                 /* SysTick handler address */
+    /* reset: */
+    0x21, 0x48,                             /* ldr  r0, [pc, #132] Get RCGCHIB */
+    0x01, 0x21,                             /* movs r1, #1 */
+    0x01, 0x60,                             /* str  r1, [r0] */
+    0x21, 0x4c,                             /* ldr  r4, [pc, #132] Get HIB */
+    0x41, 0x21,                             /* movs r1, #0x41 CLK32EN | RTCEN */
+    0x21, 0x61,                             /* str  r1, [r4, #16] HIBCTL */
+    0x20, 0x48,                             /* ldr  r0, [pc, #128] Get DSLPCLKCFG */
+    0x21, 0x49,                             /* ldr  r1, [pc, #132] PIOSC / 16 */
+    0x01, 0x60,                             /* str  r1, [r0] */
+    0x21, 0x4d,                             /* ldr  r5, [pc, #132] Get SysTick */
+    0x4f, 0xf0, 0x00, 0x56,                 /* mov  r6, #0x20000000 */
+    0x43, 0xf6, 0x7f, 0x61,                 /* movw r1, #15999 */
+    0x69, 0x60,                             /* str  r1, [r5, #4] LOAD */
+    0xa9, 0x60,                             /* str  r1, [r5, #8] VAL */
+    0x07, 0x21,                             /* movs r1, #7 */
+    0x29, 0x60,                             /* str  r1, [r5] CTRL */
+    0x64, 0x27,                             /* movs r7, #100 */
+    0x00, 0xf0, 0x16, 0xf8,                 /* bl   measure */
+    0x70, 0x60,                             /* str  r0, [r6, #4] */
+    0x1b, 0x4b,                             /* ldr  r3, [pc, #108] Get SCR */
+    0x04, 0x21,                             /* movs r1, #4 SLEEPDEEP */
+    0x19, 0x60,                             /* str  r1, [r3] */
+    0x64, 0x27,                             /* movs r7, #100 */
+    0x00, 0xf0, 0x0f, 0xf8,                 /* bl   measure */
+    0xb0, 0x60,                             /* str  r0, [r6, #8] */
+    0x00, 0x21,                             /* movs r1, #0 */
+    0x19, 0x60,                             /* str  r1, [r3] */
+    0x6f, 0xf0, 0x7f, 0x41,                 /* mvn  r1, #0xff000000 */
+    0x69, 0x60,                             /* str  r1, [r5, #4] LOAD */
+    0xa9, 0x60,                             /* str  r1, [r5, #8] VAL */
+    0x14, 0x27,                             /* movs r7, #20 */
+    0x00, 0xf0, 0x05, 0xf8,                 /* bl   measure */
+    0xf0, 0x60,                             /* str  r0, [r6, #12] */
+    0x01, 0x21,                             /* movs r1, #1 */
+    0x31, 0x60,                             /* str  r1, [r6] */
+    0x30, 0xbf,                             /* wfi */
+    0xfd, 0xe7,                             /* b    .-2 */
+    /* measure: RTC ticks for r7 periods, from the start of one */
+    0x00, 0xb5,                             /* push {lr} */
+    0x30, 0xbf,                             /* wfi */
+    0x00, 0xf0, 0x09, 0xf8,                 /* bl   rtc */
+    0x80, 0x46,                             /* mov  r8, r0 */
+    0x30, 0xbf,                             /* wfi */
+    0x01, 0x3f,                             /* subs r7, #1 */
+    0xfc, 0xd1,                             /* bne  .-4 */
+    0x00, 0xf0, 0x03, 0xf8,                 /* bl   rtc */
+    0xa0, 0xeb, 0x08, 0x00,                 /* sub  r0, r0, r8 */
+    0x00, 0xbd,                             /* pop  {pc} */
+    /* rtc: RTCC << 15 | RTCSSC */
+    0x20, 0x68,                             /* ldr  r0, [r4] RTCC */
+    0xa1, 0x6a,                             /* ldr  r1, [r4, #40] RTCSS */
+    0x22, 0x68,                             /* ldr  r2, [r4] RTCC */
+    0x90, 0x42,                             /* cmp  r0, r2 */
+    0xfa, 0xd1,                             /* bne  rtc */
+    0xc1, 0xf3, 0x0e, 0x01,                 /* ubfx r1, r1, #0, #15 */
+    0x41, 0xea, 0xc0, 0x30,                 /* orr  r0, r1, r0, lsl #15 */
+    0x70, 0x47,                             /* bx   lr */
+    /* systick: */
+    0x70, 0x47,                             /* bx   lr */
+    0x00, 0x00,                             /* padding */
+    0x14, 0xe6, 0x0f, 0x40,                 /* 0x400fe614 = RCGCHIB */
+    0x00, 0xc0, 0x0f, 0x40,                 /* 0x400fc000 = HIB */
+    0x44, 0xe1, 0x0f, 0x40,                 /* 0x400fe144 = DSLPCLKCFG */
+    0x10, 0x00, 0x80, 0x07,                 /* 0x07800010 = PIOSC / 16 */
+    0x10, 0xe0, 0x00, 0xe0,                 /* 0xe000e010 = SysTick */
+    0x10, 0xed, 0x00, 0xe0,                 /* 0xe000ed10 = SCR */
+};
+
+/* Within 1% of @ns worth of RTC ticks */
+static void assert_rtc_ns(uint32_t ticks, uint64_t ns)
+{
+    uint64_t expect = ns * RTC_HZ / SECOND_NS;
+
+    g_assert_cmpuint(ticks, >=, expect - expect / 100);
+    g_assert_cmpuint(ticks, <=, expect + expect / 100);
+}
+
+/*
+ * The guest has to run, so this uses TCG rather than the qtest
+ * accelerator; -icount keeps the run independent of host speed. With
+ * idle=skip the 23 s the guest sleeps take far less real time.
+ */
+static void test_sleep_modes(void)
+{
+    g_autofree char *path = NULL;
+    QTestState *qts;
+    int64_t start;
+    int fd;
+
+    fd = g_file_open_tmp("tivac-idle-XXXXXX", &path, NULL);
+    g_assert(fd >= 0);
+    g_assert_cmpint(write(fd, kernel_idle, sizeof(kernel_idle)), ==,
+                    sizeof(kernel_idle));
+    close(fd);
+
+    qts = qtest_initf("-machine tivac,idle=skip -kernel %s -icount shift=0 "
+                      "-accel tcg", path);
+    unlink(path);
+
+    start = g_get_monotonic_time();
+    while (!qtest_readl(qts, RESULT_DONE)) {
+        g_assert_cmpint(g_get_monotonic_time() - start, <, 15 * G_USEC_PER_SEC);
+        g_usleep(10000);
+    }
+
+    assert_rtc_ns(qtest_readl(qts, RESULT_SLEEP), SECOND_NS / 10);
+    assert_rtc_ns(qtest_readl(qts, RESULT_DEEP_SLEEP), SECOND_NS * 16 / 10);
+    assert_rtc_ns(qtest_readl(qts, RESULT_LONG),
+                  20 * (1ULL << 24) * SECOND_NS / 16000000);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    if (qtest_has_accel("tcg")) {
+        qtest_add_func("/tivac/idle/sleep-modes", test_sleep_modes);
+    }
+
+    return g_test_run();
+}
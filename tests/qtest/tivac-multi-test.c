@@ -0,0 +1,226 @@
+/*
+ * QTest testcase for several TM4C123 boards in one machine
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+/* Board N's bus is mapped at N << 32 */
+#define BOARD(n) ((uint64_t)(n) << 32)
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_DID1 0x004
+#define SYSCTL_RCGCGPIO 0x608
+#define SYSCTL_RCGCUART 0x618
+#define SYSCTL_RCGCCAN 0x634
+
+/* SCB AIRCR, only reachable through board 0's core */
+#define AIRCR 0xE000ED0C
+#define AIRCR_SYSRESETREQ 0x05FA0004
+
+#define SRAM_BASE 0x20000000
+
+#define USART_1_BASE 0x4000D000
+#define USART_DR 0x000
+#define USART_FR 0x018
+#define USART_FR_RXFE (1 << 4)
+#define USART_IBRD 0x024
+#define USART_FBRD 0x028
+#define USART_LCRH 0x02C
+#define USART_CTL 0x030
+
+#define GPIO_A_BASE 0x40004000
+#define GPIO_B_BASE 0x40005000
+#define GPIO_DATA 0x3FC
+#define GPIO_DIR 0x400
+#define GPIO_DEN 0x51C
+
+#define CAN_0_BASE 0x40040000
+#define CAN_CTL 0x000
+#define CTL_INIT 0x01
+#define CAN_NWDA1 0x120
+#define CAN_IF1 0x020
+#define CAN_IF2 0x080
+#define IF_CRQ 0x00
+#define IF_CMSK 0x04
+#define IF_ARB2 0x14
+#define IF_MCTL 0x18
+#define IF_DA1 0x1C
+#define CMSK_WRNRD 0x80
+#define CMSK_ARB 0x20
+#define CMSK_CONTROL 0x10
+#define CMSK_NEWDAT 0x04
+#define CMSK_DATAA 0x02
+#define ARB2_MSGVAL 0x8000
+#define ARB2_DIR 0x2000
+#define ARB2_STD(id) ((id) << 2)
+#define MCTL_NEWDAT 0x8000
+#define MCTL_TXRQST 0x0100
+#define MCTL_EOB 0x0080
+
+/* Each board has its own SRAM and peripherals */
+static void test_separate(void)
+{
+    QTestState *qts = qtest_init("-machine tivac -smp 2");
+
+    g_assert_cmphex(qtest_readl(qts, BOARD(0) + SYSCTL_BASE + SYSCTL_DID1), ==, 0x10A1606E);
+    g_assert_cmphex(qtest_readl(qts, BOARD(1) + SYSCTL_BASE + SYSCTL_DID1), ==, 0x10A1606E);
+
+    qtest_writel(qts, BOARD(0) + SRAM_BASE, 0x12345678);
+    qtest_writel(qts, BOARD(1) + SRAM_BASE, 0x9abcdef0);
+    g_assert_cmphex(qtest_readl(qts, BOARD(0) + SRAM_BASE), ==, 0x12345678);
+    g_assert_cmphex(qtest_readl(qts, BOARD(1) + SRAM_BASE), ==, 0x9abcdef0);
+
+    qtest_writel(qts, BOARD(1) + SYSCTL_BASE + SYSCTL_RCGCUART, 0x2);
+    g_assert_cmphex(qtest_readl(qts, BOARD(0) + SYSCTL_BASE + SYSCTL_RCGCUART), ==, 0);
+    g_assert_cmphex(qtest_readl(qts, BOARD(1) + SYSCTL_BASE + SYSCTL_RCGCUART), ==, 0x2);
+
+    qtest_quit(qts);
+}
+
+/* 9600 baud 8N1 from the 16MHz PIOSC: a character takes ~1.04ms */
+static void uart_setup(QTestState *qts, uint64_t board)
+{
+    qtest_writel(qts, board + SYSCTL_BASE + SYSCTL_RCGCUART, 0x2);
+    qtest_writel(qts, board + USART_1_BASE + USART_IBRD, 104);
+    qtest_writel(qts, board + USART_1_BASE + USART_FBRD, 11);
+    qtest_writel(qts, board + USART_1_BASE + USART_LCRH, 0x70);
+    qtest_writel(qts, board + USART_1_BASE + USART_CTL, 0x301);
+}
+
+static void test_uart_link(void)
+{
+    QTestState *qts = qtest_init("-machine tivac,uart-links=0.1-1.1 -smp 2");
+
+    uart_setup(qts, BOARD(0));
+    uart_setup(qts, BOARD(1));
+
+    qtest_writel(qts, BOARD(0) + USART_1_BASE + USART_DR, 'A');
+    qtest_clock_step(qts, 500 * 1000);
+    g_assert_true(qtest_readl(qts, BOARD(1) + USART_1_BASE + USART_FR) & USART_FR_RXFE);
+
+    qtest_clock_step(qts, 1000 * 1000);
+    g_assert_false(qtest_readl(qts, BOARD(1) + USART_1_BASE + USART_FR) & USART_FR_RXFE);
+    g_assert_cmphex(qtest_readl(qts, BOARD(1) + USART_1_BASE + USART_DR), ==, 'A');
+
+    /* And back the other way */
+    qtest_writel(qts, BOARD(1) + USART_1_BASE + USART_DR, 'B');
+    qtest_clock_step(qts, 1500 * 1000);
+    g_assert_cmphex(qtest_readl(qts, BOARD(0) + USART_1_BASE + USART_DR), ==, 'B');
+
+    qtest_quit(qts);
+}
+
+static void test_gpio_link(void)
+{
+    QTestState *qts = qtest_init("-machine tivac,gpio-links=0.A3-1.B4 -smp 2");
+
+    qtest_writel(qts, BOARD(0) + SYSCTL_BASE + SYSCTL_RCGCGPIO, 0x1);
+    qtest_writel(qts, BOARD(0) + GPIO_A_BASE + GPIO_DIR, 1 << 3);
+    qtest_writel(qts, BOARD(0) + GPIO_A_BASE + GPIO_DEN, 1 << 3);
+    qtest_writel(qts, BOARD(1) + SYSCTL_BASE + SYSCTL_RCGCGPIO, 0x2);
+    qtest_writel(qts, BOARD(1) + GPIO_B_BASE + GPIO_DEN, 1 << 4);
+
+    qtest_writel(qts, BOARD(0) + GPIO_A_BASE + GPIO_DATA, 1 << 3);
+    g_assert_cmphex(qtest_readl(qts, BOARD(1) + GPIO_B_BASE + GPIO_DATA), ==, 1 << 4);
+    qtest_writel(qts, BOARD(0) + GPIO_A_BASE + GPIO_DATA, 0);
+    g_assert_cmphex(qtest_readl(qts, BOARD(1) + GPIO_B_BASE + GPIO_DATA), ==, 0);
+
+    qtest_quit(qts);
+}
+
+static void can_object(QTestState *qts, uint64_t board, int num,
+                       uint16_t arb2, uint16_t mctl, uint16_t da1)
+{
+    uint64_t base = board + CAN_0_BASE;
+
+    qtest_writel(qts, base + CAN_IF1 + IF_CMSK,
+                 CMSK_WRNRD | CMSK_ARB | CMSK_CONTROL | CMSK_DATAA);
+    qtest_writel(qts, base + CAN_IF1 + IF_ARB2, arb2);
+    qtest_writel(qts, base + CAN_IF1 + IF_MCTL, mctl);
+    qtest_writel(qts, base + CAN_IF1 + IF_DA1, da1);
+    qtest_writel(qts, base + CAN_IF1 + IF_CRQ, num);
+}
+
+/* Every board's CAN0 sits on canbus0 */
+static void test_can_link(void)
+{
+    QTestState *qts = qtest_init("-object can-bus,id=canbus "
+                                 "-machine tivac,canbus0=canbus -smp 2");
+
+    qtest_writel(qts, BOARD(1) + SYSCTL_BASE + SYSCTL_RCGCCAN, 0x1);
+    qtest_writel(qts, BOARD(1) + CAN_0_BASE + CAN_CTL, CTL_INIT);
+    can_object(qts, BOARD(1), 2, ARB2_MSGVAL | ARB2_STD(0x123), MCTL_EOB | 2, 0);
+    qtest_writel(qts, BOARD(1) + CAN_0_BASE + CAN_CTL, 0);
+
+    qtest_writel(qts, BOARD(0) + SYSCTL_BASE + SYSCTL_RCGCCAN, 0x1);
+    qtest_writel(qts, BOARD(0) + CAN_0_BASE + CAN_CTL, CTL_INIT);
+    can_object(qts, BOARD(0), 1, ARB2_MSGVAL | ARB2_DIR | ARB2_STD(0x123),
+               MCTL_TXRQST | MCTL_EOB | 2, 0xBEEF);
+    qtest_writel(qts, BOARD(0) + CAN_0_BASE + CAN_CTL, 0);
+
+    g_assert_cmphex(qtest_readl(qts, BOARD(1) + CAN_0_BASE + CAN_NWDA1), ==, 1 << 1);
+    qtest_writel(qts, BOARD(1) + CAN_0_BASE + CAN_IF2 + IF_CMSK,
+                 CMSK_CONTROL | CMSK_DATAA | CMSK_NEWDAT);
+    qtest_writel(qts, BOARD(1) + CAN_0_BASE + CAN_IF2 + IF_CRQ, 2);
+    g_assert_cmphex(qtest_readl(qts, BOARD(1) + CAN_0_BASE + CAN_IF2 + IF_MCTL) &
+                    (MCTL_NEWDAT | 0xF), ==, MCTL_NEWDAT | 2);
+    g_assert_cmphex(qtest_readl(qts, BOARD(1) + CAN_0_BASE + CAN_IF2 + IF_DA1), ==,
+                    0xBEEF);
+
+    qtest_quit(qts);
+}
+
+/* SYSRESETREQ on board 0 leaves board 1 running as it was */
+static void test_board_reset(void)
+{
+    QTestState *qts = qtest_init("-machine tivac -smp 2");
+    int i;
+
+    qtest_writel(qts, BOARD(0) + SYSCTL_BASE + SYSCTL_RCGCUART, 0x2);
+    qtest_writel(qts, BOARD(1) + SYSCTL_BASE + SYSCTL_RCGCUART, 0x2);
+
+    qtest_writel(qts, AIRCR, AIRCR_SYSRESETREQ);
+    /* There is no RESET event for one board; wait for its sysctl */
+    for (i = 0; i < 1000 &&
+         qtest_readl(qts, BOARD(0) + SYSCTL_BASE + SYSCTL_RCGCUART); i++) {
+        g_usleep(1000);
+    }
+    g_assert_cmphex(qtest_readl(qts, BOARD(0) + SYSCTL_BASE + SYSCTL_RCGCUART), ==, 0);
+    g_assert_cmphex(qtest_readl(qts, BOARD(1) + SYSCTL_BASE + SYSCTL_RCGCUART), ==, 0x2);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/multi/separate", test_separate);
+    qtest_add_func("/tivac/multi/uart-link", test_uart_link);
+    qtest_add_func("/tivac/multi/gpio-link", test_gpio_link);
+    qtest_add_func("/tivac/multi/can-link", test_can_link);
+    qtest_add_func("/tivac/multi/board-reset", test_board_reset);
+
+    return g_test_run();
+}
@@ -0,0 +1,89 @@
+/*
+ * QTest testcase for the TM4C123 part descriptions
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_DID1 0x004
+#define SYSCTL_PPUSB 0x328
+#define SYSCTL_PPCAN 0x334
+#define SYSCTL_PPPWM 0x340
+#define SYSCTL_RCGCCAN 0x634
+
+#define CAN0_BASE 0x40040000
+#define CAN_CTL 0x000
+#define CAN_CTL_INIT 0x1
+
+#define SRAM_BASE 0x20000000
+
+static void test_tm4c123gh6pm(void)
+{
+    QTestState *qts = qtest_init("-machine tivac");
+
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_BASE + SYSCTL_DID1), ==, 0x10A1606E);
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_BASE + SYSCTL_PPUSB), ==, 0x1);
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_BASE + SYSCTL_PPCAN), ==, 0x3);
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_BASE + SYSCTL_PPPWM), ==, 0x3);
+
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCCAN, 0x1);
+    g_assert_cmphex(qtest_readl(qts, CAN0_BASE + CAN_CTL), ==, CAN_CTL_INIT);
+
+    /* 32KB of SRAM */
+    qtest_writel(qts, SRAM_BASE + 32 * 1024 - 4, 0x12345678);
+    g_assert_cmphex(qtest_readl(qts, SRAM_BASE + 32 * 1024 - 4), ==, 0x12345678);
+
+    qtest_quit(qts);
+}
+
+/* The part has neither CAN nor PWM modules, and only 12KB of SRAM */
+static void test_tm4c1230c3pm(void)
+{
+    QTestState *qts = qtest_init("-machine tm4c1230c3pm");
+
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_BASE + SYSCTL_DID1), ==, 0x1022606E);
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_BASE + SYSCTL_PPUSB), ==, 0x0);
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_BASE + SYSCTL_PPCAN), ==, 0x0);
+    g_assert_cmphex(qtest_readl(qts, SYSCTL_BASE + SYSCTL_PPPWM), ==, 0x0);
+
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCCAN, 0x1);
+    g_assert_cmphex(qtest_readl(qts, CAN0_BASE + CAN_CTL), ==, 0);
+
+    qtest_writel(qts, SRAM_BASE + 12 * 1024 - 4, 0x12345678);
+    g_assert_cmphex(qtest_readl(qts, SRAM_BASE + 12 * 1024 - 4), ==, 0x12345678);
+    qtest_writel(qts, SRAM_BASE + 12 * 1024, 0x12345678);
+    g_assert_cmphex(qtest_readl(qts, SRAM_BASE + 12 * 1024), ==, 0);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/part/tm4c123gh6pm", test_tm4c123gh6pm);
+    qtest_add_func("/tivac/part/tm4c1230c3pm", test_tm4c1230c3pm);
+
+    return g_test_run();
+}
@@ -0,0 +1,259 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) PWM modules
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "libqtest-single.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_RCGCPWM 0x640
+
+#define PWM_0_BASE 0x40028000
+#define PWM_CTL 0x000
+#define PWM_ENABLE 0x008
+#define PWM_FAULT 0x010
+#define PWM_INTEN 0x014
+#define PWM_RIS 0x018
+#define PWM_ISC 0x01C
+#define PWM_STATUS 0x020
+#define PWM_FAULTVAL 0x024
+
+#define PWM_0_CTL 0x040
+#define PWM_0_INTEN 0x044
+#define PWM_0_RIS 0x048
+#define PWM_0_ISC 0x04C
+#define PWM_0_LOAD 0x050
+#define PWM_0_COUNT 0x054
+#define PWM_0_CMPA 0x058
+#define PWM_0_GENA 0x060
+#define PWM_0_DBCTL 0x068
+#define PWM_0_DBRISE 0x06C
+#define PWM_0_DBFALL 0x070
+
+#define CTL_ENABLE 0x1
+#define CTL_MODE 0x2
+
+#define EV_ZERO 0x01
+#define EV_LOAD 0x02
+#define EV_CMPAU 0x04
+#define EV_CMPAD 0x08
+
+/* pwmA high at load, low on the way down through CMPA */
+#define GENA_LOAD_HIGH_CMPAD_LOW ((3 << 2) | (2 << 6))
+
+#define PWM_0_PATH "/machine/soc/pwm[0]"
+
+/* The PWM clock is the 16 MHz system clock out of reset */
+#define TICK_NS 62.5
+#define TICKS_NS(n) ((int64_t)((n) * TICK_NS))
+
+static uint32_t pwm_readl(QTestState *qts, uint64_t reg)
+{
+    return qtest_readl(qts, PWM_0_BASE + reg);
+}
+
+static void pwm_writel(QTestState *qts, uint64_t reg, uint32_t val)
+{
+    qtest_writel(qts, PWM_0_BASE + reg, val);
+}
+
+/* Generator 0 counting down from 99, pwmA high for the first 50 ticks */
+static void pwm_setup(QTestState *qts)
+{
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCPWM, 0x1);
+    pwm_writel(qts, PWM_0_CTL, 0);
+    pwm_writel(qts, PWM_ENABLE, 0);
+    pwm_writel(qts, PWM_0_ISC, 0x3F);
+    pwm_writel(qts, PWM_ISC, 0xF0000);
+    pwm_writel(qts, PWM_0_LOAD, 99);
+    pwm_writel(qts, PWM_0_CMPA, 49);
+    pwm_writel(qts, PWM_0_GENA, GENA_LOAD_HIGH_CMPAD_LOW);
+}
+
+static void test_count_down(void)
+{
+    pwm_setup(global_qtest);
+    pwm_writel(global_qtest, PWM_0_INTEN, EV_ZERO);
+    pwm_writel(global_qtest, PWM_INTEN, 0x1);
+    pwm_writel(global_qtest, PWM_0_CTL, CTL_ENABLE);
+
+    clock_step(TICKS_NS(25) + 1);
+    g_assert_cmpuint(pwm_readl(global_qtest, PWM_0_COUNT), ==, 74);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_0_RIS), ==, EV_LOAD);
+
+    clock_step(TICKS_NS(35));
+    g_assert_cmpuint(pwm_readl(global_qtest, PWM_0_COUNT), ==, 39);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_0_RIS), ==, EV_LOAD | EV_CMPAD);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_ISC), ==, 0);
+
+    clock_step(TICKS_NS(40));
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_0_RIS), ==,
+                    EV_ZERO | EV_LOAD | EV_CMPAD);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_0_ISC), ==, EV_ZERO);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_ISC), ==, 0x1);
+
+    pwm_writel(global_qtest, PWM_0_ISC, EV_ZERO);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_ISC), ==, 0);
+    pwm_writel(global_qtest, PWM_0_CTL, 0);
+    pwm_writel(global_qtest, PWM_0_INTEN, 0);
+    pwm_writel(global_qtest, PWM_INTEN, 0);
+}
+
+static void test_up_down(void)
+{
+    pwm_setup(global_qtest);
+    pwm_writel(global_qtest, PWM_0_LOAD, 50);
+    pwm_writel(global_qtest, PWM_0_CMPA, 20);
+    pwm_writel(global_qtest, PWM_0_CTL, CTL_MODE | CTL_ENABLE);
+
+    clock_step(TICKS_NS(30) + 1);
+    g_assert_cmpuint(pwm_readl(global_qtest, PWM_0_COUNT), ==, 30);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_0_RIS), ==, EV_ZERO | EV_CMPAU);
+
+    clock_step(TICKS_NS(30));
+    g_assert_cmpuint(pwm_readl(global_qtest, PWM_0_COUNT), ==, 40);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_0_RIS), ==, EV_ZERO | EV_LOAD | EV_CMPAU);
+
+    clock_step(TICKS_NS(30));
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_0_RIS), ==,
+                    EV_ZERO | EV_LOAD | EV_CMPAU | EV_CMPAD);
+    pwm_writel(global_qtest, PWM_0_CTL, 0);
+}
+
+static void test_fault(void)
+{
+    pwm_setup(global_qtest);
+    pwm_writel(global_qtest, PWM_FAULT, 0x1);
+    pwm_writel(global_qtest, PWM_FAULTVAL, 0x1);
+    pwm_writel(global_qtest, PWM_ENABLE, 0x1);
+    pwm_writel(global_qtest, PWM_INTEN, 0x10000);
+    pwm_writel(global_qtest, PWM_0_CTL, CTL_ENABLE);
+
+    /* Without FLTSRC every generator watches MnFAULT0 */
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_STATUS), ==, 0);
+    qtest_set_irq_in(global_qtest, PWM_0_PATH, "fault", 0, 1);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_STATUS), ==, 0xF);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_ISC), ==, 0x10000);
+
+    /* Without LATCH the fault ends with the input; the interrupt stays */
+    qtest_set_irq_in(global_qtest, PWM_0_PATH, "fault", 0, 0);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_STATUS), ==, 0);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_RIS), ==, 0xF0000);
+    pwm_writel(global_qtest, PWM_ISC, 0xF0000);
+    g_assert_cmphex(pwm_readl(global_qtest, PWM_RIS), ==, 0);
+
+    pwm_writel(global_qtest, PWM_0_CTL, 0);
+    pwm_writel(global_qtest, PWM_INTEN, 0);
+    pwm_writel(global_qtest, PWM_FAULT, 0);
+}
+
+typedef struct {
+    int64_t ns;
+    int pin;
+    int level;
+} PWMEdge;
+
+/*
+ * Dead-band on generator 0: pwmA' rises 10 ticks after pwmA, pwmB' is
+ * pwmA inverted and rises 5 ticks after pwmA falls. The pins are turned
+ * on 20 ticks in, so the log starts with pwmA' already high. Both
+ * modules share the log, which must hold one header and module 0's edges.
+ */
+static void test_edge_log(void)
+{
+    g_autofree char *path = NULL;
+    g_autofree char *log = NULL;
+    g_autofree PWMEdge *expect = g_new(PWMEdge, 16);
+    QTestState *qts;
+    int64_t t0;
+    int64_t end;
+    uint64_t rec;
+    size_t len;
+    int count = 0;
+    int fd;
+    int i;
+    int k;
+
+    /* Leave a stale log behind, it must not survive the new run */
+    fd = g_file_open_tmp("tivac-pwm-edges-XXXXXX", &path, NULL);
+    g_assert(fd >= 0);
+    g_assert_cmpint(write(fd, "TM4CPWM\0stale log", 18), ==, 18);
+    close(fd);
+
+    qts = qtest_initf("-machine tivac -global tm4c123-pwm.edge-log=%s", path);
+    pwm_setup(qts);
+    pwm_writel(qts, PWM_0_DBRISE, 10);
+    pwm_writel(qts, PWM_0_DBFALL, 5);
+    pwm_writel(qts, PWM_0_DBCTL, 1);
+
+    t0 = qtest_clock_step(qts, 1);
+    pwm_writel(qts, PWM_0_CTL, CTL_ENABLE);
+    qtest_clock_step(qts, TICKS_NS(20));
+    pwm_writel(qts, PWM_ENABLE, 0x3);
+    end = qtest_clock_step(qts, TICKS_NS(3 * 100 - 20) + 100) - t0;
+    qtest_quit(qts);
+
+    expect[count++] = (PWMEdge) {TICKS_NS(20), 0, 1};
+    for (k = 0; k < 3; k++) {
+        expect[count++] = (PWMEdge) {TICKS_NS(k * 100 + 50), 0, 0};
+        expect[count++] = (PWMEdge) {TICKS_NS(k * 100 + 55), 1, 1};
+        expect[count++] = (PWMEdge) {TICKS_NS(k * 100 + 100), 1, 0};
+        if (TICKS_NS(k * 100 + 110) <= end) {
+            expect[count++] = (PWMEdge) {TICKS_NS(k * 100 + 110), 0, 1};
+        }
+    }
+
+    g_assert(g_file_get_contents(path, &log, &len, NULL));
+    unlink(path);
+    g_assert_cmpuint(len, ==, 16 + count * 8);
+    g_assert(!memcmp(log, "TM4CPWM", 8));
+    g_assert_cmpuint(ldl_le_p(log + 8), ==, 1);
+    g_assert_cmpuint(ldl_le_p(log + 12), ==, 8);
+
+    for (i = 0; i < count; i++) {
+        rec = ldq_le_p(log + 16 + i * 8);
+        g_assert_cmpint((rec >> 8) - t0, ==, expect[i].ns);
+        g_assert_cmpuint((rec >> 4) & 0xF, ==, 0);
+        g_assert_cmpuint((rec >> 1) & 0x7, ==, expect[i].pin);
+        g_assert_cmpuint(rec & 1, ==, expect[i].level);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/pwm/count-down", test_count_down);
+    qtest_add_func("/tivac/pwm/up-down", test_up_down);
+    qtest_add_func("/tivac/pwm/fault", test_fault);
+    qtest_add_func("/tivac/pwm/edge-log", test_edge_log);
+
+    qtest_start("-machine tivac");
+    ret = g_test_run();
+    qtest_end();
+
+    return ret;
+}
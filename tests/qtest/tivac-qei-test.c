@@ -0,0 +1,196 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) QEI modules
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest-single.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_RCGCQEI 0x644
+
+#define QEI_0_BASE 0x4002C000
+#define QEI_CTL 0x000
+#define QEI_STAT 0x004
+#define QEI_POS 0x008
+#define QEI_MAXPOS 0x00C
+#define QEI_LOAD 0x010
+#define QEI_SPEED 0x01C
+#define QEI_INTEN 0x020
+#define QEI_RIS 0x024
+#define QEI_ISC 0x028
+
+#define CTL_ENABLE 0x01
+#define CTL_CAPMODE 0x08
+#define CTL_RESMODE 0x10
+#define CTL_VELEN 0x20
+
+#define STAT_DIRECTION 0x2
+
+#define INT_INDEX 0x1
+#define INT_DIR 0x4
+
+#define PIN_PHA 0
+#define PIN_PHB 1
+#define PIN_IDX 2
+
+#define QEI_0_PATH "/machine/soc/qei[0]"
+
+/* 6000 rpm on a 100 line encoder: one quadrature edge every 25 us */
+#define EDGE_NS 25000
+#define MS_NS 1000000
+
+static uint32_t qei_readl(QTestState *qts, uint64_t reg)
+{
+    return qtest_readl(qts, QEI_0_BASE + reg);
+}
+
+static void qei_writel(QTestState *qts, uint64_t reg, uint32_t val)
+{
+    qtest_writel(qts, QEI_0_BASE + reg, val);
+}
+
+static void qei_pin(int pin, int level)
+{
+    qtest_set_irq_in(global_qtest, QEI_0_PATH, "pins", pin, level);
+}
+
+static void test_gpio_x4(void)
+{
+    qtest_writel(global_qtest, SYSCTL_BASE + SYSCTL_RCGCQEI, 0x1);
+    qei_writel(global_qtest, QEI_MAXPOS, 0xFFFFFFFF);
+    qei_writel(global_qtest, QEI_CTL, CTL_CAPMODE | CTL_ENABLE);
+
+    /* PhA leading PhB counts up on every edge */
+    qei_pin(PIN_PHA, 1);
+    qei_pin(PIN_PHB, 1);
+    qei_pin(PIN_PHA, 0);
+    qei_pin(PIN_PHB, 0);
+    g_assert_cmpuint(qei_readl(global_qtest, QEI_POS), ==, 4);
+    g_assert_cmphex(qei_readl(global_qtest, QEI_STAT), ==, 0);
+
+    qei_pin(PIN_PHB, 1);
+    g_assert_cmpuint(qei_readl(global_qtest, QEI_POS), ==, 3);
+    g_assert_cmphex(qei_readl(global_qtest, QEI_STAT), ==, STAT_DIRECTION);
+    g_assert_cmphex(qei_readl(global_qtest, QEI_RIS), ==, INT_DIR);
+
+    /* The index pulse resets the position in RESMODE */
+    qei_writel(global_qtest, QEI_CTL, CTL_RESMODE | CTL_CAPMODE | CTL_ENABLE);
+    qei_pin(PIN_IDX, 1);
+    qei_pin(PIN_IDX, 0);
+    g_assert_cmpuint(qei_readl(global_qtest, QEI_POS), ==, 0);
+    g_assert_cmphex(qei_readl(global_qtest, QEI_RIS), ==, INT_DIR | INT_INDEX);
+
+    qei_writel(global_qtest, QEI_ISC, 0xF);
+    g_assert_cmphex(qei_readl(global_qtest, QEI_RIS), ==, 0);
+}
+
+static void test_gpio_x2(void)
+{
+    /* PhA low, PhB high from the previous test */
+    qei_writel(global_qtest, QEI_CTL, CTL_ENABLE);
+    qei_writel(global_qtest, QEI_POS, 0);
+
+    /* Only the PhA edges count */
+    qei_pin(PIN_PHB, 0);
+    qei_pin(PIN_PHA, 1);
+    qei_pin(PIN_PHB, 1);
+    qei_pin(PIN_PHA, 0);
+    g_assert_cmpuint(qei_readl(global_qtest, QEI_POS), ==, 2);
+    g_assert_cmphex(qei_readl(global_qtest, QEI_STAT), ==, 0);
+
+    /* Counting up past MAXPOS wraps to 0 */
+    qei_writel(global_qtest, QEI_MAXPOS, 3);
+    qei_writel(global_qtest, QEI_POS, 3);
+    qei_pin(PIN_PHB, 0);
+    qei_pin(PIN_PHA, 1);
+    g_assert_cmpuint(qei_readl(global_qtest, QEI_POS), ==, 0);
+
+    qei_writel(global_qtest, QEI_CTL, 0);
+    qei_writel(global_qtest, QEI_ISC, 0xF);
+}
+
+/*
+ * 6000 rpm for 10 ms, then a linear ramp to -6000 rpm at 20 ms: the
+ * shaft turns around at 15 ms.
+ */
+static void test_profile(void)
+{
+    QTestState *qts;
+    int64_t now;
+    int64_t t;
+
+    qts = qtest_init("-machine tivac -global tm4c123-qei.profile=0:6000,10:6000,20:-6000 "
+                     "-global tm4c123-qei.lines=100");
+
+    /* Keep clear of edge boundaries */
+    now = qtest_clock_step(qts, 1);
+    qtest_clock_step(qts, (EDGE_NS + EDGE_NS / 2 - now % EDGE_NS) % EDGE_NS);
+
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCQEI, 0x1);
+    qei_writel(qts, QEI_MAXPOS, 0xFFFFFFFF);
+    /* A 1 ms velocity period at 16 MHz */
+    qei_writel(qts, QEI_LOAD, 15999);
+    qei_writel(qts, QEI_CTL, CTL_VELEN | CTL_CAPMODE | CTL_ENABLE);
+
+    qtest_clock_step(qts, MS_NS);
+    g_assert_cmpuint(qei_readl(qts, QEI_POS), ==, 40);
+    g_assert_cmpuint(qei_readl(qts, QEI_SPEED), ==, 40);
+
+    /* The first index pulse is 400 edges into the profile, at 10 ms */
+    qei_writel(qts, QEI_CTL, CTL_RESMODE | CTL_CAPMODE | CTL_ENABLE);
+    qei_writel(qts, QEI_ISC, 0xF);
+    qei_writel(qts, QEI_INTEN, INT_INDEX);
+    t = qtest_clock_step_next(qts);
+    g_assert_cmpint(t, >=, 10 * MS_NS - 1);
+    g_assert_cmpint(t, <=, 10 * MS_NS + 1);
+    g_assert_cmphex(qei_readl(qts, QEI_RIS), ==, INT_INDEX);
+    g_assert_cmpuint(qei_readl(qts, QEI_POS), ==, 0);
+
+    /* It turns at 15 ms; the first edge back comes within a millisecond */
+    qei_writel(qts, QEI_ISC, INT_INDEX);
+    qei_writel(qts, QEI_INTEN, INT_DIR);
+    t = qtest_clock_step_next(qts);
+    g_assert_cmpint(t, >, 15 * MS_NS);
+    g_assert_cmpint(t, <, 16 * MS_NS);
+    g_assert_cmphex(qei_readl(qts, QEI_STAT), ==, STAT_DIRECTION);
+    g_assert_cmphex(qei_readl(qts, QEI_RIS), ==, INT_DIR);
+
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/qei/gpio-x4", test_gpio_x4);
+    qtest_add_func("/tivac/qei/gpio-x2", test_gpio_x2);
+    qtest_add_func("/tivac/qei/profile", test_profile);
+
+    qtest_start("-machine tivac");
+    ret = g_test_run();
+    qtest_end();
+
+    return ret;
+}
@@ -0,0 +1,175 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) SSI modules
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include "qemu/osdep.h"
+#include "libqtest-single.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_RCGCSSI 0x61C
+
+#define SSI_0_BASE 0x40008000
+#define SSI_CR0 0x000
+#define SSI_CR1 0x004
+#define SSI_DR 0x008
+#define SSI_SR 0x00C
+#define SSI_CPSR 0x010
+#define SSI_IM 0x014
+#define SSI_RIS 0x018
+#define SSI_ICR 0x020
+
+#define CR1_LBM (1 << 0)
+#define CR1_SSE (1 << 1)
+#define CR1_EOT (1 << 4)
+
+#define SR_TFE (1 << 0)
+#define SR_TNF (1 << 1)
+#define SR_RNE (1 << 2)
+#define SR_RFF (1 << 3)
+#define SR_BSY (1 << 4)
+
+#define INT_ROR (1 << 0)
+#define INT_RT (1 << 1)
+#define INT_RX (1 << 2)
+#define INT_TX (1 << 3)
+
+/* 16 MHz system clock divided by 2: 8 bit frames take 1 us */
+#define FRAME_NS 1000
+#define BIT_NS 125
+
+static void ssi_setup(uint32_t cr1)
+{
+    writel(SYSCTL_BASE + SYSCTL_RCGCSSI, 0x1);
+    writel(SSI_0_BASE + SSI_CR1, 0);
+    /* Drain whatever an earlier test left behind */
+    while (readl(SSI_0_BASE + SSI_SR) & SR_RNE) {
+        readl(SSI_0_BASE + SSI_DR);
+    }
+    writel(SSI_0_BASE + SSI_ICR, INT_ROR | INT_RT);
+    writel(SSI_0_BASE + SSI_CPSR, 2);
+    writel(SSI_0_BASE + SSI_CR0, 0x07);
+    writel(SSI_0_BASE + SSI_CR1, cr1);
+}
+
+/* Frames shift at the SSInClk rate, and loop back into the RX FIFO */
+static void test_loopback(void)
+{
+    int i;
+
+    ssi_setup(CR1_LBM | CR1_SSE);
+
+    for (i = 0; i < 4; i++) {
+        writel(SSI_0_BASE + SSI_DR, 0xA0 + i);
+    }
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_SR), ==, SR_TNF | SR_BSY);
+
+    clock_step(FRAME_NS);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_SR), ==, SR_TNF | SR_RNE | SR_BSY);
+    clock_step(3 * FRAME_NS);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_SR), ==, SR_TFE | SR_TNF | SR_RNE);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_RIS) & (INT_RX | INT_TX), ==,
+                    INT_RX | INT_TX);
+
+    for (i = 0; i < 4; i++) {
+        g_assert_cmphex(readl(SSI_0_BASE + SSI_DR), ==, 0xA0 + i);
+    }
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_SR), ==, SR_TFE | SR_TNF);
+}
+
+/* A frame arriving with the RX FIFO full is lost */
+static void test_overrun(void)
+{
+    int i;
+
+    ssi_setup(CR1_LBM | CR1_SSE);
+
+    for (i = 0; i < 8; i++) {
+        writel(SSI_0_BASE + SSI_DR, i);
+    }
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_SR) & SR_TNF, ==, 0);
+    clock_step(8 * FRAME_NS);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_SR) & SR_RFF, ==, SR_RFF);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_RIS) & INT_ROR, ==, 0);
+
+    writel(SSI_0_BASE + SSI_DR, 0x55);
+    clock_step(FRAME_NS);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_RIS) & INT_ROR, ==, INT_ROR);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_DR), ==, 0);
+
+    writel(SSI_0_BASE + SSI_ICR, INT_ROR);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_RIS) & INT_ROR, ==, 0);
+}
+
+/* Unread data raises the time-out after 32 idle bit periods */
+static void test_rx_timeout(void)
+{
+    ssi_setup(CR1_LBM | CR1_SSE);
+
+    writel(SSI_0_BASE + SSI_DR, 0x42);
+    clock_step(FRAME_NS + 31 * BIT_NS);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_RIS) & INT_RT, ==, 0);
+    clock_step(BIT_NS);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_RIS) & INT_RT, ==, INT_RT);
+
+    /* Cleared, it stays clear until another frame comes in */
+    writel(SSI_0_BASE + SSI_ICR, INT_RT);
+    clock_step(64 * BIT_NS);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_RIS) & INT_RT, ==, 0);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_DR), ==, 0x42);
+}
+
+/* With EOT the TX interrupt waits for the last frame to leave */
+static void test_end_of_transmission(void)
+{
+    int i;
+
+    ssi_setup(CR1_LBM | CR1_SSE | CR1_EOT);
+
+    for (i = 0; i < 2; i++) {
+        writel(SSI_0_BASE + SSI_DR, i);
+    }
+    clock_step(FRAME_NS);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_RIS) & INT_TX, ==, 0);
+    clock_step(FRAME_NS);
+    g_assert_cmphex(readl(SSI_0_BASE + SSI_RIS) & INT_TX, ==, INT_TX);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/ssi/loopback", test_loopback);
+    qtest_add_func("/tivac/ssi/overrun", test_overrun);
+    qtest_add_func("/tivac/ssi/rx-timeout", test_rx_timeout);
+    qtest_add_func("/tivac/ssi/end-of-transmission", test_end_of_transmission);
+
+    qtest_start("-machine tivac");
+    ret = g_test_run();
+    qtest_end();
+
+    return ret;
+}
@@ -0,0 +1,204 @@
+/*
+ * QTest testcase for the TM4C123 (tivac) uDMA controller
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include "qemu/osdep.h"
+#include "qemu/bitops.h"
+#include "libqtest-single.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_RCGCTIMER 0x604
+#define SYSCTL_RCGCDMA 0x60C
+
+#define UDMA_BASE 0x400FF000
+#define UDMA_CFG 0x004
+#define UDMA_CTLBASE 0x008
+#define UDMA_SWREQ 0x014
+#define UDMA_ENASET 0x028
+#define UDMA_ENACLR 0x02C
+#define UDMA_ALTSET 0x030
+#define UDMA_ALTCLR 0x034
+#define UDMA_CHIS 0x504
+
+#define GPTM_0_BASE 0x40030000
+#define GPTM_CFG 0x000
+#define GPTM_AMR 0x004
+#define GPTM_CTL 0x00C
+#define GPTM_TAILR 0x028
+
+/* Control table, and the source and destination buffers, all in SRAM */
+#define CTL_TABLE 0x20001000
+#define ALT_TABLE (CTL_TABLE + 0x200)
+#define SRC_BUF 0x20002000
+#define DST_BUF 0x20003000
+
+#define MODE_BASIC 1
+#define MODE_AUTO 2
+#define MODE_PINGPONG 3
+
+/* Word sized, incrementing on both sides */
+#define CHCTL_WORDS(mode, items, arb) \
+    ((2u << 30) | (2u << 28) | (2u << 26) | (2u << 24) | \
+     ((arb) << 14) | (((items) - 1) << 4) | (mode))
+
+#define TICK_NS 62.5
+#define TICKS_NS(n) ((int64_t)((n) * TICK_NS))
+
+static void udma_setup(void)
+{
+    writel(SYSCTL_BASE + SYSCTL_RCGCDMA, 1);
+    writel(UDMA_BASE + UDMA_CFG, 1);
+    writel(UDMA_BASE + UDMA_CTLBASE, CTL_TABLE);
+    writel(UDMA_BASE + UDMA_ENACLR, 0xFFFFFFFF);
+    writel(UDMA_BASE + UDMA_ALTCLR, 0xFFFFFFFF);
+    writel(UDMA_BASE + UDMA_CHIS, 0xFFFFFFFF);
+}
+
+static void set_entry(uint32_t table, int ch, uint32_t src, uint32_t dst,
+                      uint32_t ctl)
+{
+    uint32_t items = extract32(ctl, 4, 10) + 1;
+    uint32_t size = 1 << extract32(ctl, 24, 2);
+
+    writel(table + ch * 16, src + (items - 1) * size);
+    writel(table + ch * 16 + 4, dst + (items - 1) * size);
+    writel(table + ch * 16 + 8, ctl);
+}
+
+static void fill_src(uint32_t words, uint32_t seed)
+{
+    uint32_t i;
+
+    for (i = 0; i < words; i++) {
+        writel(SRC_BUF + i * 4, seed + i);
+        writel(DST_BUF + i * 4, 0);
+    }
+}
+
+static void check_dst(uint32_t words, uint32_t seed)
+{
+    uint32_t i;
+
+    for (i = 0; i < words; i++) {
+        g_assert_cmphex(readl(DST_BUF + i * 4), ==, seed + i);
+    }
+}
+
+/* An auto transfer moves everything at once, completing after the bus time */
+static void test_auto_copy(void)
+{
+    udma_setup();
+    fill_src(1024, 0x1000);
+
+    set_entry(CTL_TABLE, 30, SRC_BUF, DST_BUF, CHCTL_WORDS(MODE_AUTO, 1024, 2));
+    writel(UDMA_BASE + UDMA_ENASET, 1u << 30);
+    writel(UDMA_BASE + UDMA_SWREQ, 1u << 30);
+
+    check_dst(1024, 0x1000);
+    g_assert_cmphex(readl(CTL_TABLE + 30 * 16 + 8) & 7, ==, 0);
+    g_assert_cmphex(readl(UDMA_BASE + UDMA_CHIS), ==, 0);
+
+    /* Two cycles per item at 16 MHz */
+    clock_step(TICKS_NS(2048) + 1);
+    g_assert_cmphex(readl(UDMA_BASE + UDMA_CHIS), ==, 1u << 30);
+    g_assert_cmphex(readl(UDMA_BASE + UDMA_ENASET), ==, 0);
+}
+
+/* Ping-pong swaps to the alternate structure when the primary runs out */
+static void test_pingpong(void)
+{
+    udma_setup();
+    fill_src(16, 0x2000);
+
+    set_entry(CTL_TABLE, 0, SRC_BUF, DST_BUF, CHCTL_WORDS(MODE_PINGPONG, 8, 3));
+    set_entry(ALT_TABLE, 0, SRC_BUF + 32, DST_BUF + 32,
+              CHCTL_WORDS(MODE_PINGPONG, 8, 3));
+    writel(UDMA_BASE + UDMA_ENASET, 1);
+
+    writel(UDMA_BASE + UDMA_SWREQ, 1);
+    clock_step(TICKS_NS(16) + 1);
+    g_assert_cmphex(readl(UDMA_BASE + UDMA_CHIS), ==, 1);
+    g_assert_cmphex(readl(UDMA_BASE + UDMA_ALTSET), ==, 1);
+    g_assert_cmphex(readl(UDMA_BASE + UDMA_ENASET), ==, 1);
+    g_assert_cmphex(readl(DST_BUF + 32), ==, 0);
+
+    writel(UDMA_BASE + UDMA_CHIS, 1);
+    writel(UDMA_BASE + UDMA_SWREQ, 1);
+    clock_step(TICKS_NS(16) + 1);
+    check_dst(16, 0x2000);
+    g_assert_cmphex(readl(UDMA_BASE + UDMA_CHIS), ==, 1);
+    g_assert_cmphex(readl(UDMA_BASE + UDMA_ALTSET), ==, 0);
+}
+
+/* Each timer time-out requests one arbitration of its channel */
+static void test_timer_request(void)
+{
+    int i;
+
+    udma_setup();
+    fill_src(4, 0x3000);
+
+    /* Timer 0A is channel 18, encoding 0 */
+    set_entry(CTL_TABLE, 18, SRC_BUF, DST_BUF, CHCTL_WORDS(MODE_BASIC, 4, 0));
+    writel(UDMA_BASE + UDMA_ENASET, 1u << 18);
+
+    writel(SYSCTL_BASE + SYSCTL_RCGCTIMER, 0x01);
+    writel(GPTM_0_BASE + GPTM_CTL, 0);
+    writel(GPTM_0_BASE + GPTM_CFG, 0);
+    writel(GPTM_0_BASE + GPTM_AMR, 0x2);
+    writel(GPTM_0_BASE + GPTM_TAILR, 999);
+    writel(GPTM_0_BASE + GPTM_CTL, 1);
+
+    /* Check half way between the time-outs */
+    clock_step(TICKS_NS(500));
+    for (i = 1; i <= 4; i++) {
+        clock_step(TICKS_NS(1000));
+        g_assert_cmphex(readl(DST_BUF + (i - 1) * 4), ==, 0x3000 + i - 1);
+        if (i < 4) {
+            g_assert_cmphex(readl(DST_BUF + i * 4), ==, 0);
+        }
+    }
+    writel(GPTM_0_BASE + GPTM_CTL, 0);
+
+    g_assert_cmphex(readl(UDMA_BASE + UDMA_CHIS), ==, 1u << 18);
+    g_assert_cmphex(readl(UDMA_BASE + UDMA_ENASET), ==, 0);
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/udma/auto-copy", test_auto_copy);
+    qtest_add_func("/tivac/udma/pingpong", test_pingpong);
+    qtest_add_func("/tivac/udma/timer-request", test_timer_request);
+
+    qtest_start("-machine tivac");
+    ret = g_test_run();
+    qtest_end();
+
+    return ret;
+}
@@ -0,0 +1,195 @@
+/*
+ * QTest testcase for the TM4C123 USART
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_RCGCUART 0x618
+
+#define USART_0_BASE 0x4000C000
+#define USART_DR 0x000
+#define USART_FR 0x018
+#define USART_FR_TXFE (1 << 7)
+#define USART_FR_TXFF (1 << 5)
+#define USART_FR_BUSY (1 << 3)
+#define USART_IBRD 0x024
+#define USART_FBRD 0x028
+#define USART_LCRH 0x02C
+#define USART_LCRH_8N1_FIFO 0x70
+#define USART_CTL 0x030
+#define USART_IFLS 0x034
+#define USART_IFLS_RX_1_4 (1 << 3)
+#define USART_IFLS_RX_1_2 (2 << 3)
+#define USART_RIS 0x03C
+#define USART_INT_RX (1 << 4)
+#define USART_INT_RT (1 << 6)
+
+/* Read exactly len bytes from the serial socket */
+static void uart_recv(int sock_fd, char *buf, size_t len)
+{
+    size_t got = 0;
+    ssize_t ret;
+
+    while (got < len) {
+        ret = recv(sock_fd, buf + got, len - got, 0);
+        g_assert_cmpint(ret, >, 0);
+        got += ret;
+    }
+}
+
+/*
+ * Without a baud rate and with the FIFO off, every character leaves at
+ * once: a second DR write straight after the first must not overflow.
+ */
+static void test_tx_back_to_back(void)
+{
+    int sock_fd;
+    char buf[2];
+    QTestState *qts = qtest_init_with_serial("-M tivac", &sock_fd);
+
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCUART, 0x1);
+    qtest_writel(qts, USART_0_BASE + USART_CTL, 0x301);
+
+    qtest_writel(qts, USART_0_BASE + USART_DR, 'a');
+    qtest_writel(qts, USART_0_BASE + USART_DR, 'b');
+    g_assert_false(qtest_readl(qts, USART_0_BASE + USART_FR) & USART_FR_TXFF);
+
+    uart_recv(sock_fd, buf, 2);
+    g_assert_cmpmem(buf, 2, "ab", 2);
+
+    close(sock_fd);
+    qtest_quit(qts);
+}
+
+/*
+ * RX with the FIFO on and no baud rate: seven characters stay below the
+ * 1/2 level, so only the timeout fires; lowering the level to 1/4 raises
+ * RX at once.
+ */
+static void test_rx_levels(void)
+{
+    int sock_fd;
+    int i;
+    QTestState *qts = qtest_init_with_serial("-M tivac", &sock_fd);
+
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCUART, 0x1);
+    qtest_writel(qts, USART_0_BASE + USART_LCRH, USART_LCRH_8N1_FIFO);
+    qtest_writel(qts, USART_0_BASE + USART_IFLS, USART_IFLS_RX_1_2);
+    qtest_writel(qts, USART_0_BASE + USART_CTL, 0x301);
+
+    g_assert_cmpint(send(sock_fd, "abcdefg", 7, 0), ==, 7);
+    for (i = 0; i < 1000; i++) {
+        if (qtest_readl(qts, USART_0_BASE + USART_RIS) & USART_INT_RT) {
+            break;
+        }
+        qtest_clock_step(qts, 1000);
+    }
+    g_assert_true(qtest_readl(qts, USART_0_BASE + USART_RIS) & USART_INT_RT);
+    g_assert_false(qtest_readl(qts, USART_0_BASE + USART_RIS) & USART_INT_RX);
+
+    qtest_writel(qts, USART_0_BASE + USART_IFLS, USART_IFLS_RX_1_4);
+    g_assert_true(qtest_readl(qts, USART_0_BASE + USART_RIS) & USART_INT_RX);
+
+    for (i = 0; i < 7; i++) {
+        g_assert_cmphex(qtest_readl(qts, USART_0_BASE + USART_DR) & 0xFF, ==, 'a' + i);
+    }
+    g_assert_false(qtest_readl(qts, USART_0_BASE + USART_RIS) &
+                   (USART_INT_RX | USART_INT_RT));
+
+    close(sock_fd);
+    qtest_quit(qts);
+}
+
+/* 9600 baud 8N1 from the 16MHz PIOSC: a character takes ~1.04ms */
+static void uart_setup_9600(QTestState *qts)
+{
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCUART, 0x1);
+    qtest_writel(qts, USART_0_BASE + USART_IBRD, 104);
+    qtest_writel(qts, USART_0_BASE + USART_FBRD, 11);
+    qtest_writel(qts, USART_0_BASE + USART_LCRH, USART_LCRH_8N1_FIFO);
+    qtest_writel(qts, USART_0_BASE + USART_CTL, 0x301);
+}
+
+static void uart_write_str(QTestState *qts, const char *str)
+{
+    while (*str) {
+        qtest_writel(qts, USART_0_BASE + USART_DR, *str++);
+    }
+}
+
+/* Accurate timing: four characters keep the line busy for ~4.2ms */
+static void test_timing_accurate(void)
+{
+    int sock_fd;
+    char buf[4];
+    QTestState *qts = qtest_init_with_serial("-M tivac", &sock_fd);
+
+    uart_setup_9600(qts);
+    uart_write_str(qts, "wxyz");
+    g_assert_true(qtest_readl(qts, USART_0_BASE + USART_FR) & USART_FR_BUSY);
+
+    qtest_clock_step(qts, 3 * 1000 * 1000);
+    g_assert_true(qtest_readl(qts, USART_0_BASE + USART_FR) & USART_FR_BUSY);
+
+    qtest_clock_step(qts, 2 * 1000 * 1000);
+    g_assert_true(qtest_readl(qts, USART_0_BASE + USART_FR) & USART_FR_TXFE);
+
+    uart_recv(sock_fd, buf, 4);
+    g_assert_cmpmem(buf, 4, "wxyz", 4);
+
+    close(sock_fd);
+    qtest_quit(qts);
+}
+
+/* Fast timing: the same characters leave at once */
+static void test_timing_fast(void)
+{
+    int sock_fd;
+    char buf[4];
+    QTestState *qts = qtest_init_with_serial(
+        "-M tivac -global tm4c123-usart.fast-timing=on", &sock_fd);
+
+    uart_setup_9600(qts);
+    uart_write_str(qts, "wxyz");
+    g_assert_true(qtest_readl(qts, USART_0_BASE + USART_FR) & USART_FR_TXFE);
+
+    uart_recv(sock_fd, buf, 4);
+    g_assert_cmpmem(buf, 4, "wxyz", 4);
+
+    close(sock_fd);
+    qtest_quit(qts);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/usart/tx-back-to-back", test_tx_back_to_back);
+    qtest_add_func("/tivac/usart/rx-levels", test_rx_levels);
+    qtest_add_func("/tivac/usart/timing/accurate", test_timing_accurate);
+    qtest_add_func("/tivac/usart/timing/fast", test_timing_fast);
+
+    return g_test_run();
+}
@@ -0,0 +1,184 @@
+/*
+ * QTest testcase for migrating the TM4C123 (tivac) peripherals
+ *
+ * Copyright (c) 2023 Mohamed ElSayed <m.elsayed4420@gmail.com>
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+ * THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "migration-helpers.h"
+
+#define SYSCTL_BASE 0x400FE000
+#define SYSCTL_RCC 0x060
+#define SYSCTL_RCGCWD 0x600
+#define SYSCTL_RCGCTIMER 0x604
+#define SYSCTL_RCGCGPIO 0x608
+#define SYSCTL_RCGCUART 0x618
+
+#define GPIO_F_BASE 0x40025000
+#define GPIO_DATA 0x3FC
+#define GPIO_DIR 0x400
+#define GPIO_IM 0x410
+#define GPIO_DEN 0x51C
+
+#define USART_0_BASE 0x4000C000
+#define USART_FR 0x018
+#define USART_IBRD 0x024
+#define USART_FBRD 0x028
+#define USART_LCRH 0x02C
+#define USART_CTL 0x030
+#define USART_IM 0x038
+
+#define WDT_0_BASE 0x40000000
+#define WDT_LOAD 0x000
+#define WDT_VALUE 0x004
+#define WDT_CTL 0x008
+#define WDT_RIS 0x010
+
+#define GPTM_0_BASE 0x40030000
+#define GPTM_CFG 0x000
+#define GPTM_AMR 0x004
+#define GPTM_IMR 0x018
+#define GPTM_TALIR 0x028
+#define GPTM_TAMATCHR 0x030
+
+/* Registers whose value must survive the round trip unchanged */
+static const uint32_t checked_regs[] = {
+    SYSCTL_BASE + SYSCTL_RCC,
+    SYSCTL_BASE + SYSCTL_RCGCWD,
+    SYSCTL_BASE + SYSCTL_RCGCTIMER,
+    SYSCTL_BASE + SYSCTL_RCGCGPIO,
+    SYSCTL_BASE + SYSCTL_RCGCUART,
+    GPIO_F_BASE + GPIO_DATA,
+    GPIO_F_BASE + GPIO_DIR,
+    GPIO_F_BASE + GPIO_IM,
+    GPIO_F_BASE + GPIO_DEN,
+    USART_0_BASE + USART_FR,
+    USART_0_BASE + USART_IBRD,
+    USART_0_BASE + USART_FBRD,
+    USART_0_BASE + USART_LCRH,
+    USART_0_BASE + USART_CTL,
+    USART_0_BASE + USART_IM,
+    WDT_0_BASE + WDT_LOAD,
+    WDT_0_BASE + WDT_VALUE,
+    WDT_0_BASE + WDT_CTL,
+    WDT_0_BASE + WDT_RIS,
+    GPTM_0_BASE + GPTM_CFG,
+    GPTM_0_BASE + GPTM_AMR,
+    GPTM_0_BASE + GPTM_IMR,
+    GPTM_0_BASE + GPTM_TALIR,
+    GPTM_0_BASE + GPTM_TAMATCHR,
+};
+
+static void setup_devices(QTestState *qts)
+{
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCWD, 0x1);
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCTIMER, 0x1);
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCGPIO, 0x20);
+    qtest_writel(qts, SYSCTL_BASE + SYSCTL_RCGCUART, 0x1);
+
+    qtest_writel(qts, GPIO_F_BASE + GPIO_DIR, 0x0E);
+    qtest_writel(qts, GPIO_F_BASE + GPIO_DEN, 0x1F);
+    qtest_writel(qts, GPIO_F_BASE + GPIO_DATA, 0x0A);
+
+    qtest_writel(qts, USART_0_BASE + USART_CTL, 0x0);
+    qtest_writel(qts, USART_0_BASE + USART_IBRD, 104);
+    qtest_writel(qts, USART_0_BASE + USART_FBRD, 11);
+    qtest_writel(qts, USART_0_BASE + USART_LCRH, 0x70);
+    qtest_writel(qts, USART_0_BASE + USART_IM, 0x50);
+    qtest_writel(qts, USART_0_BASE + USART_CTL, 0x301);
+
+    qtest_writel(qts, GPTM_0_BASE + GPTM_CFG, 0x0);
+    qtest_writel(qts, GPTM_0_BASE + GPTM_AMR, 0x2);
+    qtest_writel(qts, GPTM_0_BASE + GPTM_TALIR, 0x12345678);
+    qtest_writel(qts, GPTM_0_BASE + GPTM_TAMATCHR, 0x1000);
+    qtest_writel(qts, GPTM_0_BASE + GPTM_IMR, 0x1);
+
+    /* Starts the watchdog countdown */
+    qtest_writel(qts, WDT_0_BASE + WDT_LOAD, 100000);
+}
+
+static void compare_regs(QTestState *a, QTestState *b)
+{
+    int i;
+
+    for (i = 0; i < ARRAY_SIZE(checked_regs); i++) {
+        g_test_message("comparing 0x%08" PRIx32, checked_regs[i]);
+        g_assert_cmphex(qtest_readl(a, checked_regs[i]), ==,
+                        qtest_readl(b, checked_regs[i]));
+    }
+}
+
+/*
+ * Configure one machine, migrate it, and check that the destination
+ * matches a reference machine that was set up identically but never
+ * migrated, both right away and after the timers have run.
+ */
+static void test_roundtrip(void)
+{
+    g_autofree char *tmpdir = g_dir_make_tmp("tivac-vmstate-XXXXXX", NULL);
+    g_autofree char *path = NULL;
+    g_autofree char *uri = NULL;
+    QTestState *ref, *from, *to;
+
+    g_assert(tmpdir);
+    path = g_strdup_printf("%s/migsocket", tmpdir);
+    uri = g_strdup_printf("unix:%s", path);
+
+    ref = qtest_init("-machine tivac");
+    from = qtest_init("-machine tivac");
+    to = qtest_initf("-machine tivac -incoming %s", uri);
+
+    setup_devices(ref);
+    setup_devices(from);
+
+    migrate_qmp(from, uri, "{}");
+    wait_for_migration_complete(from);
+    qtest_qmp_eventwait(to, "RESUME");
+
+    compare_regs(ref, to);
+
+    /* The watchdog keeps counting from where it was */
+    qtest_clock_step(ref, 1000000);
+    qtest_clock_step(to, 1000000);
+    g_assert_cmpuint(qtest_readl(to, WDT_0_BASE + WDT_VALUE), <, 100000);
+    compare_regs(ref, to);
+
+    /* ... and times out at the same point */
+    qtest_clock_step(ref, 100000000);
+    qtest_clock_step(to, 100000000);
+    compare_regs(ref, to);
+
+    qtest_quit(ref);
+    qtest_quit(from);
+    qtest_quit(to);
+    unlink(path);
+    rmdir(tmpdir);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/tivac/vmstate/roundtrip", test_roundtrip);
+
+    return g_test_run();
+}